@@ -0,0 +1,481 @@
+extends Node
+## Headless end-to-end benchmark for the H264Decoder extension
+##
+## Plays a recorded Annex B stream through the same calls the app makes and
+## writes per-frame timings as JSON, so the cost of Variant marshalling,
+## PackedByteArray copies and ImageTexture updates shows up next to the
+## native decode and repack times.
+##
+##   godot --headless --path . res://addons/h264_decoder/benchmark/benchmark.tscn -- \
+##       --stream=/path/to/desktop.h264 [--mode=frame|rgba|batch|display|repack|overhead|all] \
+##       [--frames=N] [--batch=N] [--repack-streams=A.h264,B.h264,...] \
+##       [--thread-policy=off|on|both] [--thread-priority=high|realtime] \
+##       [--output=user://h264_benchmark.json]
+##
+## Record a stream with: reference_streamer --record desktop.h264 --duration 20
+## Without --stream, the first .h264 file in benchmark/streams/ is used.
+##
+## Modes:
+##   frame    decode_frame, then slice the planes into Images and update
+##            ImageTextures (the script integration)
+##   rgba     the same with OUTPUT_RGBA: the banded swscale conversion
+##            (reported as repack_usec) and one RGBA8 texture, against the
+##            YUV passthrough of frame mode. The YUV path's shader
+##            conversion runs on the GPU and isn't in either number.
+##   batch    decode_batch with --batch (default 4) whole access units per
+##            call, as when catching up after a stall; one record per call
+##   display  StreamDisplay.push_packet, decoded and uploaded natively
+##   repack   repack time and memory bandwidth per resolution: each of
+##            --repack-streams (default: every .h264 in benchmark/streams/)
+##            is decoded once per repack configuration (one band, bands on
+##            the worker pool, bands with streaming stores). bandwidth_gbps
+##            counts the plane bytes read from the AVFrame plus those
+##            written, over the mean repack time. Record one stream per size
+##            with reference_streamer --width/--height.
+##   overhead per-call cost of crossing into the extension: zero-length
+##            packets return before any native work, so the wall time per
+##            call is marshalling alone. decode_frame once per packet is
+##            set against decode_batch and decode_batch_buffer with 1, 4
+##            and 16 packets per call (usec per call and per packet).
+##
+## Per frame: call_usec is the wall time of the decode call from script,
+## decode_usec and repack_usec come from get_stats(), and script_usec is
+## the remainder (marshalling, allocation, copy-on-write). In batch mode
+## decode_usec covers every unit in the call: the native batch time
+## (batch_usec) minus the one repack of the newest picture. texture_usec
+## covers plane slicing and ImageTexture.update. With --headless the dummy
+## renderer makes GPU uploads free, so texture_usec is CPU-side cost only.
+##
+## --thread-policy=on places the decoders' slice threads, the shared worker
+## pool and the calling thread on the fast cores at --thread-priority
+## (default high; the pool never goes above high). both runs every mode
+## without and then with it, reported as "<mode>" and "<mode>+thread_policy";
+## compare decode_usec.stddev between the two.
+
+const AnnexB := preload("res://addons/h264_decoder/tools/annex_b.gd")
+const STREAMS_DIR := "res://addons/h264_decoder/benchmark/streams"
+const AUDIO_BYTES_PER_FRAME := 800 # 48 kHz ADPCM at 60 fps
+const DEFAULT_BATCH_UNITS := 4
+const OVERHEAD_PACKETS := 16384
+const OVERHEAD_BATCH_SIZES: Array[int] = [1, 4, 16]
+const REPACK_CONFIGS := {
+	"single_band": {"threads": 1, "streaming": false},
+	"banded": {"threads": 0, "streaming": false},
+	"banded_streaming": {"threads": 0, "streaming": true},
+}
+
+var _units: Array[PackedByteArray] = []
+var _audio_chunk := PackedByteArray()
+var _thread_policy := false
+var _thread_priority := H264Decoder.THREAD_PRIORITY_HIGH
+
+
+func _ready() -> void:
+	var options := AnnexB.parse_options()
+	var stream_path: String = options.get("stream", AnnexB.find_default_stream(STREAMS_DIR))
+	if stream_path.is_empty():
+		printerr("[Benchmark] No stream: pass --stream=FILE.h264 or put one in ", STREAMS_DIR)
+		get_tree().quit(1)
+		return
+
+	var data := FileAccess.get_file_as_bytes(stream_path)
+	if data.is_empty():
+		printerr("[Benchmark] Could not read ", stream_path)
+		get_tree().quit(1)
+		return
+	_units = AnnexB.split_access_units(data)
+	if _units.is_empty():
+		printerr("[Benchmark] No access units in ", stream_path)
+		get_tree().quit(1)
+		return
+	_audio_chunk = _make_audio_chunk()
+
+	var frame_count := int(options.get("frames", str(_units.size())))
+	var mode: String = options.get("mode", "all")
+	var modes: Array[String] = ["frame", "rgba", "batch", "display", "repack", "overhead"] if mode == "all" else [mode]
+	var repack_streams := AnnexB.find_streams(STREAMS_DIR)
+	if options.has("repack-streams"):
+		repack_streams = (options["repack-streams"] as String).split(",", false)
+	if repack_streams.is_empty():
+		repack_streams.append(stream_path)
+	var thread_policy: String = options.get("thread-policy", "off")
+	var policy_runs: Array[bool] = [false, true] if thread_policy == "both" else [thread_policy == "on"]
+	if options.get("thread-priority", "high") == "realtime":
+		_thread_priority = H264Decoder.THREAD_PRIORITY_REALTIME
+	print("[Benchmark] ", _units.size(), " access units from ", stream_path, ", ", frame_count, " frames per mode")
+
+	var report := {
+		"stream": stream_path,
+		"access_units": _units.size(),
+		"frames": frame_count,
+		"godot_version": Engine.get_version_info().get("string", ""),
+		"rendering_driver": RenderingServer.get_current_rendering_driver_name(),
+		"processor": OS.get_processor_name(),
+		"fast_cores": Array(H264Decoder.get_fast_cores()),
+		"thread_priority": _thread_priority,
+		"modes": {},
+	}
+	for policy_on in policy_runs:
+		_set_thread_policy(policy_on)
+		for m in modes:
+			var key: String = m + "+thread_policy" if policy_on else m
+			var frames: Array
+			match m:
+				"frame":
+					frames = _run_frame_mode(frame_count, H264Decoder.OUTPUT_YUV)
+				"rgba":
+					frames = _run_frame_mode(frame_count, H264Decoder.OUTPUT_RGBA)
+				"batch":
+					frames = _run_batch_mode(frame_count, maxi(1, int(options.get("batch", str(DEFAULT_BATCH_UNITS)))))
+				"display":
+					frames = await _run_display_mode(frame_count)
+				"repack":
+					report["modes"][key] = {"resolutions": _run_repack_mode(frame_count, repack_streams)}
+					continue
+				"overhead":
+					report["modes"][key] = _run_overhead_mode()
+					continue
+				_:
+					printerr("[Benchmark] Unknown mode: ", m)
+					get_tree().quit(1)
+					return
+			var summary := _summarize(frames)
+			report["modes"][key] = {"summary": summary, "frames": frames}
+			print("[Benchmark] ", key, ": ", JSON.stringify(summary))
+			print("[Benchmark] ", key, ": decode_usec stddev ", snappedf(summary["decode_usec"]["stddev"], 0.1))
+	_set_thread_policy(false)
+
+	var output_path: String = options.get("output", "user://h264_benchmark.json")
+	var file := FileAccess.open(output_path, FileAccess.WRITE)
+	if file == null:
+		printerr("[Benchmark] Could not write ", output_path)
+		get_tree().quit(1)
+		return
+	file.store_string(JSON.stringify(report, "\t"))
+	file.close()
+	print("[Benchmark] Wrote ", ProjectSettings.globalize_path(output_path))
+	get_tree().quit(0)
+
+
+# Process-wide part of the policy: the worker pool and this (calling)
+# thread. Off puts both back on every CPU at normal priority.
+func _set_thread_policy(enabled: bool) -> void:
+	_thread_policy = enabled
+	var cpus: PackedInt32Array = H264Decoder.get_fast_cores() if enabled else PackedInt32Array()
+	var priority: H264Decoder.ThreadPriority = _thread_priority if enabled else H264Decoder.THREAD_PRIORITY_NORMAL
+	H264Decoder.set_worker_pool_thread_policy(cpus, priority)
+	var placer := H264Decoder.new()
+	_apply_thread_policy(placer)
+	placer.apply_thread_policy_to_current_thread()
+
+
+# Per-decoder part: its libavcodec slice threads
+func _apply_thread_policy(decoder: H264Decoder) -> void:
+	if _thread_policy:
+		decoder.set_fast_cores_only(true)
+		decoder.set_thread_priority(_thread_priority)
+
+
+func _make_audio_chunk() -> PackedByteArray:
+	# Busy but deterministic nibbles, so the ADPCM step size keeps moving
+	var chunk := PackedByteArray()
+	chunk.resize(AUDIO_BYTES_PER_FRAME)
+	var state := 12345
+	for i in AUDIO_BYTES_PER_FRAME:
+		state = (state * 1103515245 + 12345) & 0x7FFFFFFF
+		chunk[i] = (state >> 16) & 0xFF
+	return chunk
+
+
+func _new_frame_record(index: int, unit: PackedByteArray) -> Dictionary:
+	return {"frame": index, "bytes": unit.size()}
+
+
+func _add_decoder_times(record: Dictionary, decoder: H264Decoder, produced: bool) -> void:
+	var stats := decoder.get_stats()
+	# RGBA output replaces the repack with the swscale conversion
+	var output_key := "repack_usec" if decoder.get_output_format() == H264Decoder.OUTPUT_YUV else "convert_usec"
+	record["decoded"] = produced
+	record["decode_usec"] = stats["decode_usec"] if produced else 0
+	record["repack_usec"] = stats[output_key] if produced else 0
+	record["script_usec"] = max(0, record["call_usec"] - record["decode_usec"] - record["repack_usec"])
+
+
+func _run_frame_mode(frame_count: int, output_format: H264Decoder.OutputFormat) -> Array:
+	var decoder := H264Decoder.new()
+	_apply_thread_policy(decoder)
+	decoder.set_output_format(output_format)
+	var textures = PlaneTextures.new() if output_format == H264Decoder.OUTPUT_YUV else RgbaTexture.new()
+	var frames := []
+	for i in frame_count:
+		var unit := _units[i % _units.size()]
+		var record := _new_frame_record(i, unit)
+		var frame_start := Time.get_ticks_usec()
+
+		var call_start := Time.get_ticks_usec()
+		var pixels := decoder.decode_frame(unit)
+		record["call_usec"] = Time.get_ticks_usec() - call_start
+
+		var texture_start := Time.get_ticks_usec()
+		if not pixels.is_empty():
+			textures.update(pixels, decoder.get_width(), decoder.get_height())
+		record["texture_usec"] = Time.get_ticks_usec() - texture_start
+
+		var audio_start := Time.get_ticks_usec()
+		decoder.decode_audio(_audio_chunk)
+		record["audio_usec"] = Time.get_ticks_usec() - audio_start
+		record["total_usec"] = Time.get_ticks_usec() - frame_start
+
+		_add_decoder_times(record, decoder, not pixels.is_empty())
+		frames.append(record)
+	decoder.cleanup()
+	return frames
+
+
+# Whole access units only: without AV_CODEC_FLAG2_CHUNKS libavcodec treats
+# each packet as a complete picture, so splitting one into its NAL units
+# would decode every slice as its own concealed picture
+func _run_batch_mode(frame_count: int, batch_units: int) -> Array:
+	var decoder := H264Decoder.new()
+	_apply_thread_policy(decoder)
+	var textures := PlaneTextures.new()
+	var records := []
+	for first in range(0, frame_count, batch_units):
+		var batch := []
+		var bytes := 0
+		for i in range(first, mini(first + batch_units, frame_count)):
+			var unit := _units[i % _units.size()]
+			batch.append(unit)
+			bytes += unit.size()
+		var record := {"frame": first, "units": batch.size(), "bytes": bytes}
+		var frame_start := Time.get_ticks_usec()
+
+		var call_start := Time.get_ticks_usec()
+		var result := decoder.decode_batch(batch)
+		record["call_usec"] = Time.get_ticks_usec() - call_start
+		var yuv: PackedByteArray = result["frame"]
+
+		var texture_start := Time.get_ticks_usec()
+		if not yuv.is_empty():
+			textures.update(yuv, decoder.get_width(), decoder.get_height())
+		record["texture_usec"] = Time.get_ticks_usec() - texture_start
+		record["audio_usec"] = 0
+		record["total_usec"] = Time.get_ticks_usec() - frame_start
+
+		var stats := decoder.get_stats()
+		var produced := not yuv.is_empty()
+		record["decoded"] = produced
+		record["repack_usec"] = stats["repack_usec"] if produced else 0
+		record["decode_usec"] = max(0, stats["batch_usec"] - record["repack_usec"])
+		record["script_usec"] = max(0, record["call_usec"] - stats["batch_usec"])
+		records.append(record)
+	decoder.cleanup()
+	return records
+
+
+func _run_display_mode(frame_count: int) -> Array:
+	var display := StreamDisplay.new()
+	add_child(display)
+	var decoder := display.get_decoder()
+	_apply_thread_policy(decoder)
+	var frames := []
+	var uploaded := 0
+	for i in frame_count:
+		var unit := _units[i % _units.size()]
+		var record := _new_frame_record(i, unit)
+		var frame_start := Time.get_ticks_usec()
+
+		var call_start := Time.get_ticks_usec()
+		display.push_packet(unit)
+		record["call_usec"] = Time.get_ticks_usec() - call_start
+		# Decoding and the texture upload happen in the node's process callback
+		await get_tree().process_frame
+
+		var stats := display.get_stats()
+		var produced: bool = stats["frames_uploaded"] > uploaded
+		uploaded = stats["frames_uploaded"]
+		var decoder_stats := decoder.get_stats()
+		record["decoded"] = produced
+		record["decode_usec"] = decoder_stats["decode_usec"] if produced else 0
+		record["repack_usec"] = decoder_stats["repack_usec"] if produced else 0
+		record["texture_usec"] = stats["upload_usec"] if produced else 0
+		record["audio_usec"] = 0
+		# Includes the engine's idle frame, so only compare it within this mode
+		record["total_usec"] = Time.get_ticks_usec() - frame_start
+		record["script_usec"] = record["call_usec"]
+		frames.append(record)
+	display.queue_free()
+	return frames
+
+
+# One entry per resolution (stream), one distribution per configuration
+func _run_repack_mode(frame_count: int, stream_paths: PackedStringArray) -> Dictionary:
+	var resolutions := {}
+	for path in stream_paths:
+		var units := AnnexB.split_access_units(FileAccess.get_file_as_bytes(path))
+		if units.is_empty():
+			printerr("[Benchmark] No access units in ", path)
+			continue
+		var resolution := ""
+		var configs := {}
+		for config_name in REPACK_CONFIGS:
+			var config: Dictionary = REPACK_CONFIGS[config_name]
+			var decoder := H264Decoder.new()
+			_apply_thread_policy(decoder)
+			decoder.set_repack_threads(config["threads"])
+			decoder.set_streaming_stores(config["streaming"])
+			var repack_usec := PackedInt64Array()
+			var bands := 0
+			for i in frame_count:
+				if decoder.decode_frame(units[i % units.size()]).is_empty():
+					continue
+				var stats := decoder.get_stats()
+				repack_usec.append(stats["repack_usec"])
+				bands = stats["repack_bands"]
+			var width := decoder.get_width()
+			var height := decoder.get_height()
+			decoder.cleanup()
+
+			resolution = "%dx%d" % [width, height]
+			var summary := _distribution(repack_usec)
+			summary["bands"] = bands
+			# Each plane byte is read once and written once; bytes/usec / 1000 = GB/s
+			var plane_bytes := width * height + width * (height / 2)
+			var mean: float = summary["mean"]
+			summary["bandwidth_gbps"] = 2.0 * plane_bytes / mean / 1000.0 if mean > 0.0 else 0.0
+			configs[config_name] = summary
+			print("[Benchmark] repack ", resolution, " ", config_name, ": ", snappedf(mean, 0.1),
+				" usec, ", snappedf(summary["bandwidth_gbps"], 0.01), " GB/s, ", bands, " band(s)")
+		if resolutions.has(resolution):
+			resolution += " " + path.get_file()
+		resolutions[resolution] = {"stream": path, "configs": configs}
+	return resolutions
+
+
+# OVERHEAD_PACKETS empty packets per entry point and batch size
+func _run_overhead_mode() -> Dictionary:
+	var decoder := H264Decoder.new()
+	var empty := PackedByteArray()
+	var result := {}
+
+	var start := Time.get_ticks_usec()
+	for i in OVERHEAD_PACKETS:
+		decoder.decode_frame(empty)
+	result["decode_frame"] = _overhead_entry(Time.get_ticks_usec() - start, OVERHEAD_PACKETS, 1)
+
+	for batch_size in OVERHEAD_BATCH_SIZES:
+		var calls := OVERHEAD_PACKETS / batch_size
+		var batch := []
+		batch.resize(batch_size)
+		batch.fill(empty)
+		start = Time.get_ticks_usec()
+		for i in calls:
+			decoder.decode_batch(batch)
+		result["decode_batch_%d" % batch_size] = _overhead_entry(Time.get_ticks_usec() - start, calls, batch_size)
+
+		# Every offset at the end of an empty buffer: batch_size zero-length packets
+		var offsets := PackedInt32Array()
+		offsets.resize(batch_size)
+		offsets.fill(0)
+		start = Time.get_ticks_usec()
+		for i in calls:
+			decoder.decode_batch_buffer(empty, offsets)
+		result["decode_batch_buffer_%d" % batch_size] = _overhead_entry(Time.get_ticks_usec() - start, calls, batch_size)
+	decoder.cleanup()
+
+	for entry_name in result:
+		var entry: Dictionary = result[entry_name]
+		print("[Benchmark] overhead ", entry_name, ": ", snappedf(entry["usec_per_call"], 0.001), " usec/call, ",
+			snappedf(entry["usec_per_packet"], 0.001), " usec/packet")
+	return result
+
+
+func _overhead_entry(elapsed_usec: int, calls: int, packets_per_call: int) -> Dictionary:
+	return {
+		"calls": calls,
+		"packets_per_call": packets_per_call,
+		"usec_per_call": float(elapsed_usec) / calls,
+		"usec_per_packet": float(elapsed_usec) / (calls * packets_per_call),
+	}
+
+
+func _summarize(frames: Array) -> Dictionary:
+	var summary := {"frames": frames.size()}
+	var decoded := frames.filter(func(record): return record["decoded"])
+	summary["frames_decoded"] = decoded.size()
+	for key in ["call_usec", "script_usec", "decode_usec", "repack_usec", "texture_usec", "audio_usec", "total_usec"]:
+		var values := PackedInt64Array()
+		for record in decoded:
+			values.append(record[key])
+		summary[key] = _distribution(values)
+	var total_mean: float = summary["total_usec"]["mean"]
+	var overhead: float = summary["script_usec"]["mean"] + summary["texture_usec"]["mean"]
+	# Share of each decoded frame spent outside the native decode and repack
+	summary["extension_overhead_share"] = overhead / total_mean if total_mean > 0.0 else 0.0
+	return summary
+
+
+func _distribution(values: PackedInt64Array) -> Dictionary:
+	if values.is_empty():
+		return {"mean": 0.0, "stddev": 0.0, "p50": 0, "p95": 0, "max": 0}
+	values.sort()
+	var total := 0
+	for v in values:
+		total += v
+	var mean := float(total) / values.size()
+	var variance := 0.0
+	for v in values:
+		variance += (v - mean) * (v - mean)
+	return {
+		"mean": mean,
+		"stddev": sqrt(variance / values.size()),
+		"p50": values[values.size() / 2],
+		"p95": values[mini(values.size() - 1, int(values.size() * 0.95))],
+		"max": values[values.size() - 1],
+	}
+
+
+## Y and U|V textures fed the way the app does it: slice the decode_frame
+## result, set_data on an Image, update the ImageTexture
+class PlaneTextures:
+	var y_image: Image
+	var uv_image: Image
+	var y_texture: ImageTexture
+	var uv_texture: ImageTexture
+	var width := 0
+	var height := 0
+
+	func update(yuv: PackedByteArray, w: int, h: int) -> void:
+		var y_size := w * h
+		var y_data := yuv.slice(0, y_size)
+		var uv_data := yuv.slice(y_size, y_size + w * (h / 2))
+		if w != width or h != height:
+			width = w
+			height = h
+			y_image = Image.create_from_data(w, h, false, Image.FORMAT_L8, y_data)
+			uv_image = Image.create_from_data(w, h / 2, false, Image.FORMAT_L8, uv_data)
+			y_texture = ImageTexture.create_from_image(y_image)
+			uv_texture = ImageTexture.create_from_image(uv_image)
+			return
+		y_image.set_data(w, h, false, Image.FORMAT_L8, y_data)
+		uv_image.set_data(w, h / 2, false, Image.FORMAT_L8, uv_data)
+		y_texture.update(y_image)
+		uv_texture.update(uv_image)
+
+
+## One RGBA8 texture, as the Compatibility renderer path uploads it
+class RgbaTexture:
+	var image: Image
+	var texture: ImageTexture
+	var width := 0
+	var height := 0
+
+	func update(rgba: PackedByteArray, w: int, h: int) -> void:
+		if w != width or h != height:
+			width = w
+			height = h
+			image = Image.create_from_data(w, h, false, Image.FORMAT_RGBA8, rgba)
+			texture = ImageTexture.create_from_image(image)
+			return
+		image.set_data(w, h, false, Image.FORMAT_RGBA8, rgba)
+		texture.update(image)
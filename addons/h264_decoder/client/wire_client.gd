@@ -0,0 +1,112 @@
+extends Node3D
+## Minimal client for reference_streamer's UDP framing (src/stream_wire.h)
+##
+## Receives datagrams on a UDP port, reassembles them with WireReceiver and
+## hands each message to its consumer: video access units to StreamDisplay
+## (which owns the H264Decoder), audio to H264Decoder.decode_audio and an
+## AudioStreamGenerator, cursor packets to the display's CursorChannel and
+## region commands to the decoder.
+##
+##   reference_streamer --port 9000 [--scene mixed] &
+##   godot --path . res://addons/h264_decoder/client/wire_client.tscn -- [--port=9000] \
+##       [--quality=text|drag|video|mixed]
+##
+## --quality scores every frame with QualityMeter against the streamer's
+## synthetic scene, rebuilt from the wire frame_id; pass the streamer's
+## --scene. The meter needs the decoded frame for a known frame_id, so this
+## decodes the video a second time on a plain H264Decoder (the streamer
+## sends no B-frames, so each access unit yields its own picture).
+
+const AUDIO_MIX_RATE := 48000.0
+const QUALITY_SCENES := {
+	"text": QualityMeter.REFERENCE_SYNTHETIC_TEXT,
+	"drag": QualityMeter.REFERENCE_SYNTHETIC_DRAG,
+	"video": QualityMeter.REFERENCE_SYNTHETIC_VIDEO,
+	"mixed": QualityMeter.REFERENCE_SYNTHETIC_MIXED,
+}
+
+@export var port := 9000
+
+var _udp := PacketPeerUDP.new()
+var _receiver := WireReceiver.new()
+var _display: StreamDisplay
+var _decoder: H264Decoder
+var _playback: AudioStreamGeneratorPlayback
+var _last_report_msec := 0
+var _video_latency_usec := 0
+var _meter: QualityMeter
+var _meter_decoder: H264Decoder
+
+
+func _ready() -> void:
+	for arg in OS.get_cmdline_user_args():
+		if arg.begins_with("--port="):
+			port = int(arg.substr(7))
+		elif arg.begins_with("--quality="):
+			var scene := arg.substr(10)
+			if not QUALITY_SCENES.has(scene):
+				printerr("[WireClient] Unknown --quality scene: ", scene)
+				continue
+			_meter = QualityMeter.new()
+			_meter.set_reference_source(QUALITY_SCENES[scene])
+			_meter_decoder = H264Decoder.new()
+	if _udp.bind(port) != OK:
+		printerr("[WireClient] Could not bind UDP port ", port)
+		return
+
+	_display = StreamDisplay.new()
+	add_child(_display)
+	_decoder = _display.get_decoder()
+
+	var quad := MeshInstance3D.new()
+	var mesh := QuadMesh.new()
+	mesh.size = Vector2(16.0 / 9.0, 1.0)
+	quad.mesh = mesh
+	quad.material_override = _display.get_material()
+	add_child(quad)
+	var camera := Camera3D.new()
+	camera.position = Vector3(0, 0, 1.0)
+	add_child(camera)
+
+	var generator := AudioStreamGenerator.new()
+	generator.mix_rate = AUDIO_MIX_RATE
+	var player := AudioStreamPlayer.new()
+	player.stream = generator
+	add_child(player)
+	player.play()
+	_playback = player.get_stream_playback()
+	print("[WireClient] Listening on UDP ", port)
+
+
+func _process(_delta: float) -> void:
+	if _display == null:
+		return
+	while _udp.get_available_packet_count() > 0:
+		var message := _receiver.push_datagram(_udp.get_packet())
+		if message.is_empty():
+			continue
+		var payload: PackedByteArray = message["payload"]
+		match message["type"]:
+			WireReceiver.TYPE_VIDEO:
+				# Same-machine capture-to-arrival time; both sides use the wall clock
+				_video_latency_usec = int(Time.get_unix_time_from_system() * 1000000.0) - message["timestamp_usec"]
+				_display.push_packet(payload)
+				if _meter and not _meter_decoder.decode_frame(payload).is_empty():
+					_meter.submit_frame(_meter_decoder, message["frame_id"], payload.size())
+			WireReceiver.TYPE_AUDIO:
+				var samples := _decoder.decode_audio(payload)
+				if _playback.can_push_buffer(samples.size()):
+					_playback.push_buffer(samples)
+			WireReceiver.TYPE_CURSOR:
+				_display.push_cursor_packet(payload)
+			WireReceiver.TYPE_REGION:
+				_decoder.queue_region_commands(payload)
+
+	var now := Time.get_ticks_msec()
+	if now - _last_report_msec >= 1000:
+		_last_report_msec = now
+		var stats := _receiver.get_stats()
+		print("[WireClient] messages ", stats["completed"], " lost ", stats["lost"],
+			" late ", stats["late"], " latency ", _video_latency_usec / 1000, " ms frame ", _display.get_frame_width(), "x", _display.get_frame_height())
+		if _meter:
+			print("[WireClient] quality ", JSON.stringify(_meter.get_rolling_scores()))
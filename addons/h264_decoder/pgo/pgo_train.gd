@@ -0,0 +1,56 @@
+extends Node
+## Minimal PGO training run for the H264Decoder extension
+##
+## This scene, not the benchmark, is what the pgo_train CMake target runs
+## against the instrumented library: it decodes a recorded Annex B stream
+## once per output format (YUV, RGBA), feeding whole access units through
+## both decode_frame and decode_batch, and decodes a block of ADPCM audio
+## per frame, then quits so the profile is flushed. StreamDisplay and the
+## texture paths the benchmark measures are not trained.
+##
+##   godot --headless --path . res://addons/h264_decoder/pgo/pgo_train.tscn -- \
+##       --stream=/path/to/desktop.h264 [--passes=N]
+##
+## Without --stream, the first .h264 file in pgo/streams/ is used. Record
+## one with: reference_streamer --record desktop.h264 --duration 20
+
+const AnnexB := preload("res://addons/h264_decoder/tools/annex_b.gd")
+const STREAMS_DIR := "res://addons/h264_decoder/pgo/streams"
+const AUDIO_BYTES_PER_FRAME := 800 # 48 kHz ADPCM at 60 fps
+const BATCH_UNITS := 4
+
+
+func _ready() -> void:
+	var options := AnnexB.parse_options()
+	var stream_path: String = options.get("stream", AnnexB.find_default_stream(STREAMS_DIR))
+	var data := FileAccess.get_file_as_bytes(stream_path) if not stream_path.is_empty() else PackedByteArray()
+	var units := AnnexB.split_access_units(data)
+	if units.is_empty():
+		printerr("[PGO] No stream: pass --stream=FILE.h264 or put one in ", STREAMS_DIR)
+		get_tree().quit(1)
+		return
+
+	var audio := PackedByteArray()
+	audio.resize(AUDIO_BYTES_PER_FRAME)
+	for i in AUDIO_BYTES_PER_FRAME:
+		audio[i] = (i * 37 + 11) & 0xFF
+
+	var passes := int(options.get("passes", "1"))
+	var decoded := 0
+	for pass_index in passes:
+		for output_format in [H264Decoder.OUTPUT_YUV, H264Decoder.OUTPUT_RGBA]:
+			var decoder := H264Decoder.new()
+			decoder.set_output_format(output_format)
+			for unit in units:
+				if not decoder.decode_frame(unit).is_empty():
+					decoded += 1
+				decoder.decode_audio(audio)
+			decoder.reset()
+			for first in range(0, units.size(), BATCH_UNITS):
+				var result := decoder.decode_batch(units.slice(first, first + BATCH_UNITS))
+				if not (result["frame"] as PackedByteArray).is_empty():
+					decoded += 1
+			decoder.cleanup()
+
+	print("[PGO] ", units.size(), " access units, ", decoded, " frames decoded")
+	get_tree().quit(0 if decoded > 0 else 1)
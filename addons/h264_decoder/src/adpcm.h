@@ -0,0 +1,85 @@
+/*
+ * IMA ADPCM
+ * 4:1 codec for the stream's audio, shared by the decoder and the reference streamer
+ *
+ * Stereo is packed one byte per sample frame: left in the high nibble,
+ * right in the low nibble. Both sides carry their predictor state across
+ * packets, so packets must be decoded in order.
+ */
+
+#ifndef ADPCM_H
+#define ADPCM_H
+
+#include <cstdint>
+
+namespace godot {
+
+static const int IMA_INDEX_TABLE[] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+static const int IMA_STEP_TABLE[] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+// Apply one nibble to a channel's state; returns the new 16-bit sample
+inline int adpcm_decode_nibble(uint8_t nibble, int& predicted, int& index) {
+    int step = IMA_STEP_TABLE[index];
+
+    // Calculate difference
+    int diff = step >> 3;
+    if (nibble & 4) diff += step;
+    if (nibble & 2) diff += step >> 1;
+    if (nibble & 1) diff += step >> 2;
+
+    // Update predictor
+    if (nibble & 8) predicted -= diff;
+    else predicted += diff;
+
+    // Clamp predictor to 16-bit PCM range
+    if (predicted > 32767) predicted = 32767;
+    else if (predicted < -32768) predicted = -32768;
+
+    // Update index
+    index += IMA_INDEX_TABLE[nibble];
+    if (index < 0) index = 0;
+    else if (index > 88) index = 88;
+
+    return predicted;
+}
+
+// Quantize one 16-bit sample against the channel's state. The state is
+// advanced through adpcm_decode_nibble so encoder and decoder never drift.
+inline uint8_t adpcm_encode_sample(int sample, int& predicted, int& index) {
+    int step = IMA_STEP_TABLE[index];
+    int diff = sample - predicted;
+
+    uint8_t nibble = 0;
+    if (diff < 0) {
+        nibble = 8;
+        diff = -diff;
+    }
+    if (diff >= step) {
+        nibble |= 4;
+        diff -= step;
+    }
+    if (diff >= step >> 1) {
+        nibble |= 2;
+        diff -= step >> 1;
+    }
+    if (diff >= step >> 2) {
+        nibble |= 1;
+    }
+
+    adpcm_decode_nibble(nibble, predicted, index);
+    return nibble;
+}
+
+} // namespace godot
+
+#endif // ADPCM_H
@@ -0,0 +1,170 @@
+/*
+ * Atlas Packer Implementation
+ */
+
+#include "atlas_packer.h"
+
+#include <algorithm>
+
+using namespace godot;
+
+int AtlasPacker::cell_size(int size) {
+    int aligned = (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    return aligned + PADDING;
+}
+
+void AtlasPacker::reset(int atlas_width, int atlas_height) {
+    width = atlas_width;
+    height = atlas_height;
+    used_height = 0;
+    shelves.clear();
+    allocations.clear();
+}
+
+bool AtlasPacker::insert(int id, int w, int h, AtlasRect& out) {
+    remove(id);
+    if (w <= 0 || h <= 0) {
+        return false;
+    }
+
+    int cw = cell_size(w);
+    int ch = cell_size(h);
+
+    // Best fit: the shortest shelf that's tall enough and not wastefully so
+    Shelf* best = nullptr;
+    size_t best_span = 0;
+    for (Shelf& shelf : shelves) {
+        if (shelf.height < ch || shelf.height > ch * 2) {
+            continue;
+        }
+        if (best && shelf.height >= best->height) {
+            continue;
+        }
+        for (size_t i = 0; i < shelf.free_spans.size(); i++) {
+            if (shelf.free_spans[i].w >= cw) {
+                best = &shelf;
+                best_span = i;
+                break;
+            }
+        }
+    }
+
+    if (!best) {
+        if (used_height + ch > height || cw > width) {
+            return false;
+        }
+        Shelf shelf;
+        shelf.y = used_height;
+        shelf.height = ch;
+        shelf.free_spans.push_back(Span{0, width});
+        shelves.push_back(shelf);
+        used_height += ch;
+        best = &shelves.back();
+        best_span = 0;
+    }
+
+    Span& span = best->free_spans[best_span];
+    AtlasRect cell;
+    cell.x = span.x;
+    cell.y = best->y;
+    cell.w = cw;
+    cell.h = ch;
+    span.x += cw;
+    span.w -= cw;
+    if (span.w == 0) {
+        best->free_spans.erase(best->free_spans.begin() + best_span);
+    }
+    Allocation& allocation = allocations[id];
+    allocation.cell = cell;
+    allocation.w = w;
+    allocation.h = h;
+
+    out.x = cell.x;
+    out.y = cell.y;
+    out.w = w;
+    out.h = h;
+    return true;
+}
+
+void AtlasPacker::release_span(Shelf& shelf, int x, int w) {
+    auto it = std::lower_bound(shelf.free_spans.begin(), shelf.free_spans.end(), x,
+                               [](const Span& span, int value) { return span.x < value; });
+    it = shelf.free_spans.insert(it, Span{x, w});
+
+    // Merge with the next span, then the previous one
+    auto next = it + 1;
+    if (next != shelf.free_spans.end() && it->x + it->w == next->x) {
+        it->w += next->w;
+        shelf.free_spans.erase(next);
+    }
+    if (it != shelf.free_spans.begin()) {
+        auto prev = it - 1;
+        if (prev->x + prev->w == it->x) {
+            prev->w += it->w;
+            shelf.free_spans.erase(it);
+        }
+    }
+}
+
+void AtlasPacker::remove(int id) {
+    auto it = allocations.find(id);
+    if (it == allocations.end()) {
+        return;
+    }
+    AtlasRect cell = it->second.cell;
+    allocations.erase(it);
+
+    for (Shelf& shelf : shelves) {
+        if (shelf.y == cell.y) {
+            release_span(shelf, cell.x, cell.w);
+            break;
+        }
+    }
+
+    // Give fully free shelves at the top of the stack back to new shelves
+    while (!shelves.empty()) {
+        const Shelf& last = shelves.back();
+        if (last.free_spans.size() != 1 || last.free_spans[0].w != width) {
+            break;
+        }
+        used_height = last.y;
+        shelves.pop_back();
+    }
+}
+
+bool AtlasPacker::get_rect(int id, AtlasRect& out) const {
+    auto it = allocations.find(id);
+    if (it == allocations.end()) {
+        return false;
+    }
+    out.x = it->second.cell.x;
+    out.y = it->second.cell.y;
+    out.w = it->second.w;
+    out.h = it->second.h;
+    return true;
+}
+
+bool AtlasPacker::repack(std::vector<Entry> entries) {
+    reset(width, height);
+    std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.h > b.h;
+    });
+
+    bool all_placed = true;
+    for (const Entry& entry : entries) {
+        AtlasRect rect;
+        all_placed &= insert(entry.id, entry.w, entry.h, rect);
+    }
+    return all_placed;
+}
+
+double AtlasPacker::get_occupancy() const {
+    if (width <= 0 || height <= 0) {
+        return 0.0;
+    }
+    double area = 0.0;
+    for (const auto& pair : allocations) {
+        area += (double)pair.second.cell.w * pair.second.cell.h;
+    }
+    return area / ((double)width * height);
+}
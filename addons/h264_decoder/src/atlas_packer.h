@@ -0,0 +1,89 @@
+/*
+ * Atlas Packer
+ * Shelf rectangle packer for the shared stream atlas
+ *
+ * Rects are placed on horizontal shelves; freed spans are merged and reused
+ * by later windows of similar height. When an insert fails the owner calls
+ * repack() with every live rect (tallest first) to defragment, growing the
+ * atlas if even that doesn't fit. Positions and sizes are aligned to
+ * ALIGNMENT so 4:2:0 chroma blocks never straddle two windows, and each rect
+ * keeps PADDING pixels of gutter so linear filtering doesn't bleed.
+ */
+
+#ifndef ATLAS_PACKER_H
+#define ATLAS_PACKER_H
+
+#include <unordered_map>
+#include <vector>
+
+namespace godot {
+
+struct AtlasRect {
+    int x = 0;
+    int y = 0;
+    int w = 0;
+    int h = 0;
+};
+
+class AtlasPacker {
+public:
+    static const int ALIGNMENT = 4;
+    static const int PADDING = 4;
+
+    struct Entry {
+        int id = 0;
+        int w = 0;
+        int h = 0;
+    };
+
+private:
+    struct Span {
+        int x = 0;
+        int w = 0;
+    };
+
+    struct Shelf {
+        int y = 0;
+        int height = 0;
+        std::vector<Span> free_spans; // sorted by x, non-adjacent
+    };
+
+    struct Allocation {
+        AtlasRect cell; // aligned and padded
+        int w = 0;
+        int h = 0;
+    };
+
+    int width = 0;
+    int height = 0;
+    int used_height = 0;
+    std::vector<Shelf> shelves;
+    std::unordered_map<int, Allocation> allocations;
+
+    static int cell_size(int size);
+    void release_span(Shelf& shelf, int x, int w);
+
+public:
+    // Forget every allocation and use a width x height area
+    void reset(int atlas_width, int atlas_height);
+
+    // Place a w x h rect; out receives the content position. Fails if no
+    // shelf has room (call repack or grow). Re-inserting an id moves it.
+    bool insert(int id, int w, int h, AtlasRect& out);
+    void remove(int id);
+    bool get_rect(int id, AtlasRect& out) const;
+
+    // Defragment: reset and place every entry, tallest first.
+    // Returns false if they don't all fit (allocations are then partial).
+    bool repack(std::vector<Entry> entries);
+
+    int get_width() const { return width; }
+    int get_height() const { return height; }
+    int get_count() const { return (int)allocations.size(); }
+    // Fraction of the atlas covered by allocated cells
+    double get_occupancy() const;
+};
+
+} // namespace godot
+
+#endif // ATLAS_PACKER_H
@@ -0,0 +1,283 @@
+/*
+ * Bitstream Analytics Implementation
+ */
+
+#include "bitstream_analytics.h"
+#include "nal_parser.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+extern "C" {
+#include <libavutil/motion_vector.h>
+#include <libavutil/video_enc_params.h>
+}
+
+using namespace godot;
+
+static const int CELL_COUNT = BitstreamAnalytics::GRID_WIDTH * BitstreamAnalytics::GRID_HEIGHT;
+
+static int64_t elapsed_usec(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+static NalCategory categorize(int nal_type) {
+    switch (nal_type) {
+        case NAL_SLICE: return NAL_CATEGORY_SLICE;
+        case NAL_IDR: return NAL_CATEGORY_IDR;
+        case NAL_SEI: return NAL_CATEGORY_SEI;
+        case NAL_SPS: return NAL_CATEGORY_SPS;
+        case NAL_PPS: return NAL_CATEGORY_PPS;
+        case NAL_AUD: return NAL_CATEGORY_AUD;
+        default: return NAL_CATEGORY_OTHER;
+    }
+}
+
+// Grid cell holding pixel (x, y)
+static int cell_of(int x, int y, int width, int height) {
+    int cx = std::min(std::max(x, 0) * BitstreamAnalytics::GRID_WIDTH / width, BitstreamAnalytics::GRID_WIDTH - 1);
+    int cy = std::min(std::max(y, 0) * BitstreamAnalytics::GRID_HEIGHT / height, BitstreamAnalytics::GRID_HEIGHT - 1);
+    return cy * BitstreamAnalytics::GRID_WIDTH + cx;
+}
+
+void BitstreamAnalytics::set_window(int frames) {
+    window = std::max(frames, 1);
+    while ((int)history.size() > window) {
+        history.pop_front();
+    }
+}
+
+void BitstreamAnalytics::record_packet(const uint8_t* data, size_t size) {
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<NalUnit> units;
+    parse_nal_units(data, size, units);
+    for (const NalUnit& nal : units) {
+        pending.nal_bytes[categorize(nal.type)] += (int64_t)nal.size;
+        if (nal.type == NAL_SLICE || nal.type == NAL_IDR) {
+            pending.slices++;
+        }
+    }
+    // Start codes and padding count towards the total but no NAL type
+    pending.total_bytes += (int64_t)size;
+    pending.cost_usec += elapsed_usec(start);
+}
+
+void BitstreamAnalytics::record_frame(const AVFrame* frame) {
+    auto start = std::chrono::steady_clock::now();
+
+    FrameAnalytics result = std::move(pending);
+    pending = FrameAnalytics();
+
+    result.picture_type = av_get_picture_type_char(frame->pict_type);
+    if (frame->width > 0 && frame->height > 0) {
+        read_enc_params(frame, result);
+        read_motion(frame, result);
+    }
+
+    result.cost_usec += elapsed_usec(start);
+    history.push_back(result);
+    while ((int)history.size() > window) {
+        history.pop_front();
+    }
+    last_frame = std::move(result);
+}
+
+void BitstreamAnalytics::read_enc_params(const AVFrame* frame, FrameAnalytics& out) const {
+    const AVFrameSideData* sd = av_frame_get_side_data(frame, AV_FRAME_DATA_VIDEO_ENC_PARAMS);
+    if (!sd) {
+        return;
+    }
+    AVVideoEncParams* params = (AVVideoEncParams*)sd->data;
+    out.has_qp = true;
+
+    if (params->nb_blocks == 0) {
+        // Frame-level QP only
+        out.avg_qp = (float)params->qp;
+        out.max_qp = params->qp;
+        out.region_qp.assign(CELL_COUNT, (float)params->qp);
+        return;
+    }
+
+    std::vector<double> cell_qp(CELL_COUNT, 0.0);
+    std::vector<double> cell_area(CELL_COUNT, 0.0);
+    double qp_sum = 0.0;
+    double area_sum = 0.0;
+    int max_qp = 0;
+    for (unsigned int i = 0; i < params->nb_blocks; i++) {
+        const AVVideoBlockParams* block = av_video_enc_params_block(params, i);
+        int qp = params->qp + block->delta_qp;
+        double area = (double)block->w * block->h;
+        int cell = cell_of(block->src_x + block->w / 2, block->src_y + block->h / 2, frame->width, frame->height);
+        cell_qp[cell] += qp * area;
+        cell_area[cell] += area;
+        qp_sum += qp * area;
+        area_sum += area;
+        max_qp = std::max(max_qp, qp);
+    }
+
+    out.avg_qp = area_sum > 0.0 ? (float)(qp_sum / area_sum) : (float)params->qp;
+    out.max_qp = max_qp;
+    out.region_qp.resize(CELL_COUNT);
+    for (int c = 0; c < CELL_COUNT; c++) {
+        out.region_qp[c] = cell_area[c] > 0.0 ? (float)(cell_qp[c] / cell_area[c]) : out.avg_qp;
+    }
+}
+
+void BitstreamAnalytics::read_motion(const AVFrame* frame, FrameAnalytics& out) const {
+    // Intra pictures have no vectors; counting them would read as "all changed"
+    if (frame->pict_type == AV_PICTURE_TYPE_I) {
+        return;
+    }
+    const AVFrameSideData* sd = av_frame_get_side_data(frame, AV_FRAME_DATA_MOTION_VECTORS);
+    if (!sd) {
+        return;
+    }
+    const AVMotionVector* mvs = (const AVMotionVector*)sd->data;
+    size_t count = sd->size / sizeof(AVMotionVector);
+    out.has_motion = true;
+
+    std::vector<double> cell_moving(CELL_COUNT, 0.0);
+    double skip_area = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        const AVMotionVector& mv = mvs[i];
+        double area = (double)mv.w * mv.h;
+        if (mv.source < 0 && mv.motion_x == 0 && mv.motion_y == 0) {
+            skip_area += area;
+        } else {
+            cell_moving[cell_of(mv.dst_x, mv.dst_y, frame->width, frame->height)] += area;
+        }
+    }
+
+    double frame_area = (double)frame->width * frame->height;
+    out.skip_ratio = (float)std::min(skip_area / frame_area, 1.0);
+    out.region_motion.resize(CELL_COUNT);
+    for (int cy = 0; cy < GRID_HEIGHT; cy++) {
+        int cell_h = (cy + 1) * frame->height / GRID_HEIGHT - cy * frame->height / GRID_HEIGHT;
+        for (int cx = 0; cx < GRID_WIDTH; cx++) {
+            int cell_w = (cx + 1) * frame->width / GRID_WIDTH - cx * frame->width / GRID_WIDTH;
+            int c = cy * GRID_WIDTH + cx;
+            double cell_area = std::max((double)cell_w * cell_h, 1.0);
+            out.region_motion[c] = (float)std::min(cell_moving[c] / cell_area, 1.0);
+        }
+    }
+}
+
+BitstreamAnalytics::Summary BitstreamAnalytics::get_summary() const {
+    Summary summary;
+    summary.frames = (int)history.size();
+    summary.region_qp.assign(CELL_COUNT, 0.0f);
+    summary.region_motion.assign(CELL_COUNT, 0.0f);
+    if (history.empty()) {
+        return summary;
+    }
+
+    int qp_frames = 0;
+    int motion_frames = 0;
+    int keyframes = 0;
+    for (const FrameAnalytics& f : history) {
+        summary.avg_frame_bytes += (double)f.total_bytes;
+        for (int n = 0; n < NAL_CATEGORY_COUNT; n++) {
+            summary.avg_nal_bytes[n] += (double)f.nal_bytes[n];
+        }
+        summary.avg_slices += f.slices;
+        keyframes += f.picture_type == 'I';
+        if (f.has_qp) {
+            summary.avg_qp += f.avg_qp;
+            summary.max_qp = std::max(summary.max_qp, f.max_qp);
+            for (int c = 0; c < CELL_COUNT && c < (int)f.region_qp.size(); c++) {
+                summary.region_qp[c] += f.region_qp[c];
+            }
+            qp_frames++;
+        }
+        if (f.has_motion) {
+            summary.skip_ratio += f.skip_ratio;
+            for (int c = 0; c < CELL_COUNT && c < (int)f.region_motion.size(); c++) {
+                summary.region_motion[c] += f.region_motion[c];
+            }
+            motion_frames++;
+        }
+    }
+
+    double frames = (double)summary.frames;
+    summary.avg_frame_bytes /= frames;
+    for (int n = 0; n < NAL_CATEGORY_COUNT; n++) {
+        summary.avg_nal_bytes[n] /= frames;
+    }
+    summary.avg_slices /= frames;
+    summary.keyframe_ratio = keyframes / frames;
+    if (qp_frames > 0) {
+        summary.avg_qp /= qp_frames;
+        for (float& v : summary.region_qp) {
+            v /= (float)qp_frames;
+        }
+    }
+    if (motion_frames > 0) {
+        summary.skip_ratio /= motion_frames;
+        for (float& v : summary.region_motion) {
+            v /= (float)motion_frames;
+        }
+    }
+    return summary;
+}
+
+static void put_u32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out.push_back((uint8_t)(value >> (8 * i)));
+    }
+}
+
+static void put_f32(std::vector<uint8_t>& out, double value) {
+    float f = (float)value;
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    put_u32(out, bits);
+}
+
+std::vector<uint8_t> BitstreamAnalytics::serialize_summary() const {
+    Summary summary = get_summary();
+
+    std::vector<uint8_t> out;
+    out.reserve(12 + 4 * (NAL_CATEGORY_COUNT + 6) + CELL_COUNT * 2);
+    out.push_back((uint8_t)SUMMARY_VERSION);
+    out.push_back((uint8_t)GRID_WIDTH);
+    out.push_back((uint8_t)GRID_HEIGHT);
+    out.push_back(0);
+    put_u32(out, (uint32_t)summary.frames);
+    put_f32(out, summary.avg_frame_bytes);
+    for (int n = 0; n < NAL_CATEGORY_COUNT; n++) {
+        put_f32(out, summary.avg_nal_bytes[n]);
+    }
+    put_f32(out, summary.avg_slices);
+    put_f32(out, summary.avg_qp);
+    put_f32(out, summary.max_qp);
+    put_f32(out, summary.skip_ratio);
+    put_f32(out, summary.keyframe_ratio);
+    for (float qp : summary.region_qp) {
+        out.push_back((uint8_t)std::min(std::max((int)lrintf(qp), 0), 255));
+    }
+    for (float motion : summary.region_motion) {
+        out.push_back((uint8_t)std::min(std::max((int)lrintf(motion * 255.0f), 0), 255));
+    }
+    return out;
+}
+
+double BitstreamAnalytics::get_avg_cost_usec() const {
+    if (history.empty()) {
+        return 0.0;
+    }
+    int64_t total = 0;
+    for (const FrameAnalytics& f : history) {
+        total += f.cost_usec;
+    }
+    return (double)total / (double)history.size();
+}
+
+void BitstreamAnalytics::clear() {
+    history.clear();
+    pending = FrameAnalytics();
+    last_frame = FrameAnalytics();
+}
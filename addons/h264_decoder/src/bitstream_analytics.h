@@ -0,0 +1,114 @@
+/*
+ * Bitstream Analytics
+ * Per-frame statistics about what the encoder actually sent
+ *
+ * Packets are scanned for NAL unit boundaries (bytes per NAL type, slice
+ * count) and every decoded frame contributes its exported side data:
+ * per-macroblock QP from AV_FRAME_DATA_VIDEO_ENC_PARAMS and motion vectors
+ * for the skip ratio. Both come from the software decoder only; hardware
+ * paths report byte counts alone.
+ *
+ * "Skip" here is the share of the picture covered by zero motion vectors
+ * predicted from the previous frame. libavcodec doesn't export macroblock
+ * types, and on desktop content P_Skip and zero-MV blocks are the same
+ * static areas.
+ */
+
+#ifndef BITSTREAM_ANALYTICS_H
+#define BITSTREAM_ANALYTICS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+namespace godot {
+
+enum NalCategory {
+    NAL_CATEGORY_SLICE, // non-IDR slices
+    NAL_CATEGORY_IDR,
+    NAL_CATEGORY_SEI,
+    NAL_CATEGORY_SPS,
+    NAL_CATEGORY_PPS,
+    NAL_CATEGORY_AUD,
+    NAL_CATEGORY_OTHER,
+    NAL_CATEGORY_COUNT,
+};
+
+struct FrameAnalytics {
+    int64_t nal_bytes[NAL_CATEGORY_COUNT] = {};
+    int64_t total_bytes = 0;
+    int slices = 0;
+    char picture_type = '?';
+    bool has_qp = false;
+    float avg_qp = 0.0f;
+    int max_qp = 0;
+    bool has_motion = false;
+    float skip_ratio = 0.0f;
+    // GRID_WIDTH x GRID_HEIGHT, row-major; QP by area and moving share of area
+    std::vector<float> region_qp;
+    std::vector<float> region_motion;
+    int64_t cost_usec = 0; // analytics overhead for this frame
+};
+
+class BitstreamAnalytics {
+public:
+    static const int GRID_WIDTH = 16;
+    static const int GRID_HEIGHT = 9;
+    static const uint8_t SUMMARY_VERSION = 1;
+
+    struct Summary {
+        int frames = 0;
+        double avg_frame_bytes = 0.0;
+        double avg_nal_bytes[NAL_CATEGORY_COUNT] = {};
+        double avg_slices = 0.0;
+        double avg_qp = 0.0; // over frames that exported QP
+        int max_qp = 0;
+        double skip_ratio = 0.0; // over frames that exported motion
+        double keyframe_ratio = 0.0;
+        std::vector<float> region_qp;
+        std::vector<float> region_motion;
+    };
+
+private:
+    int window = 60;
+    std::deque<FrameAnalytics> history;
+    FrameAnalytics pending; // bytes seen since the last frame came out
+    FrameAnalytics last_frame;
+
+    void read_enc_params(const AVFrame* frame, FrameAnalytics& out) const;
+    void read_motion(const AVFrame* frame, FrameAnalytics& out) const;
+
+public:
+    void set_window(int frames);
+    int get_window() const { return window; }
+
+    // Count NAL bytes of one packet; attributed to the next decoded frame
+    void record_packet(const uint8_t* data, size_t size);
+    // Close the frame: side data plus everything recorded since the last one
+    void record_frame(const AVFrame* frame);
+
+    const FrameAnalytics& get_last_frame() const { return last_frame; }
+    Summary get_summary() const;
+
+    // Summary in the compact little-endian form sent back to the server:
+    //   u8 version, u8 grid_w, u8 grid_h, u8 reserved, u32 frames,
+    //   f32 avg_frame_bytes, f32 avg_nal_bytes[NAL_CATEGORY_COUNT],
+    //   f32 avg_slices, f32 avg_qp, f32 max_qp, f32 skip_ratio, f32 keyframe_ratio,
+    //   u8 region_qp[grid_w * grid_h] (rounded), u8 region_motion[grid_w * grid_h] (0-255)
+    std::vector<uint8_t> serialize_summary() const;
+
+    // Time spent in record_packet + record_frame, last frame and window mean
+    int64_t get_last_cost_usec() const { return last_frame.cost_usec; }
+    double get_avg_cost_usec() const;
+
+    void clear();
+};
+
+} // namespace godot
+
+#endif // BITSTREAM_ANALYTICS_H
@@ -0,0 +1,265 @@
+/*
+ * Cursor Channel Implementation
+ */
+
+#include "cursor_channel.h"
+
+#include <godot_cpp/variant/utility_functions.hpp>
+
+#include <cstring>
+
+using namespace godot;
+
+static const int64_t SHAPE_HEADER_SIZE = 13;
+static const int64_t POSITION_PACKET_SIZE = 10;
+
+static inline uint32_t read_u32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline int read_u16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+static inline int read_i16(const uint8_t* p) {
+    return (int16_t)(uint16_t)read_u16(p);
+}
+
+void CursorChannel::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("push_packet", "data"), &CursorChannel::push_packet);
+    ClassDB::bind_method(D_METHOD("set_max_shapes", "count"), &CursorChannel::set_max_shapes);
+    ClassDB::bind_method(D_METHOD("get_max_shapes"), &CursorChannel::get_max_shapes);
+    ClassDB::bind_method(D_METHOD("has_shape", "id"), &CursorChannel::has_shape);
+    ClassDB::bind_method(D_METHOD("get_shape_id"), &CursorChannel::get_shape_id);
+    ClassDB::bind_method(D_METHOD("get_position"), &CursorChannel::get_position);
+    ClassDB::bind_method(D_METHOD("get_hotspot"), &CursorChannel::get_hotspot);
+    ClassDB::bind_method(D_METHOD("get_size"), &CursorChannel::get_size);
+    ClassDB::bind_method(D_METHOD("get_texture"), &CursorChannel::get_texture);
+    ClassDB::bind_method(D_METHOD("is_visible"), &CursorChannel::is_visible);
+    ClassDB::bind_method(D_METHOD("take_missing_shapes"), &CursorChannel::take_missing_shapes);
+    ClassDB::bind_method(D_METHOD("get_stats"), &CursorChannel::get_stats);
+    ClassDB::bind_method(D_METHOD("clear"), &CursorChannel::clear);
+
+    BIND_ENUM_CONSTANT(PACKET_SHAPE);
+    BIND_ENUM_CONSTANT(PACKET_POSITION);
+}
+
+CursorChannel::CursorChannel() {
+}
+
+CursorChannel::~CursorChannel() {
+    clear();
+}
+
+bool CursorChannel::push_packet(const PackedByteArray& data) {
+    return push_packet_raw(data.ptr(), data.size());
+}
+
+bool CursorChannel::push_packet_raw(const uint8_t* data, int64_t size) {
+    bool ok = false;
+    if (data && size > 0) {
+        switch (data[0]) {
+            case PACKET_SHAPE:
+                ok = parse_shape(data, size);
+                break;
+            case PACKET_POSITION:
+                ok = parse_position(data, size);
+                break;
+            default:
+                break;
+        }
+    }
+    if (!ok) {
+        rejected_packets++;
+    }
+    return ok;
+}
+
+bool CursorChannel::parse_shape(const uint8_t* data, int64_t size) {
+    if (size < SHAPE_HEADER_SIZE) {
+        return false;
+    }
+    uint32_t id = read_u32(data + 1);
+    int w = read_u16(data + 5);
+    int h = read_u16(data + 7);
+    int hot_x = read_u16(data + 9);
+    int hot_y = read_u16(data + 11);
+    if (w <= 0 || h <= 0 || w > MAX_CURSOR_SIZE || h > MAX_CURSOR_SIZE) {
+        return false;
+    }
+    int64_t pixel_bytes = (int64_t)w * h * 4;
+    if (size < SHAPE_HEADER_SIZE + pixel_bytes) {
+        return false;
+    }
+
+    PackedByteArray pixels;
+    pixels.resize(pixel_bytes);
+    memcpy(pixels.ptrw(), data + SHAPE_HEADER_SIZE, pixel_bytes);
+    Ref<Image> image = Image::create_from_data(w, h, false, Image::FORMAT_RGBA8, pixels);
+
+    auto it = shapes.find(id);
+    if (it == shapes.end()) {
+        if ((int)shapes.size() >= max_shapes) {
+            evict_oldest();
+        }
+        it = shapes.emplace(id, Shape()).first;
+        if (has_detached && detached_id == id) {
+            // Back in the cache; reuse the texture the material is showing
+            it->second = detached;
+            detached = Shape();
+            has_detached = false;
+        }
+    }
+
+    // Reuse the texture RID when the size matches so the material keeps it
+    Shape& shape = it->second;
+    if (shape.texture.is_valid() && shape.width == w && shape.height == h) {
+        shape.texture->update(image);
+    } else {
+        shape.texture = ImageTexture::create_from_image(image);
+    }
+    shape.width = w;
+    shape.height = h;
+    shape.hot_x = hot_x < w ? hot_x : w - 1;
+    shape.hot_y = hot_y < h ? hot_y : h - 1;
+    shape.last_used = ++use_counter;
+
+    if (id == current_id) {
+        changed = true;
+    }
+    shape_packets++;
+    return true;
+}
+
+bool CursorChannel::parse_position(const uint8_t* data, int64_t size) {
+    if (size < POSITION_PACKET_SIZE) {
+        return false;
+    }
+    uint32_t id = read_u32(data + 1);
+    int x = read_i16(data + 5);
+    int y = read_i16(data + 7);
+    bool now_visible = (data[9] & 1) != 0;
+
+    if (id != current_id || x != position_x || y != position_y || now_visible != visible) {
+        changed = true;
+    }
+    if (has_detached && id != detached_id) {
+        detached = Shape();
+        has_detached = false;
+    }
+    current_id = id;
+    position_x = x;
+    position_y = y;
+    visible = now_visible;
+
+    auto it = shapes.find(id);
+    if (it != shapes.end()) {
+        it->second.last_used = ++use_counter;
+    } else if (now_visible) {
+        bool reported = false;
+        for (uint32_t missing : missing_ids) {
+            reported |= missing == id;
+        }
+        if (!reported) {
+            missing_ids.push_back(id);
+        }
+    }
+
+    position_packets++;
+    return true;
+}
+
+void CursorChannel::evict_oldest() {
+    // Least recently used, preferring anything but the current shape
+    auto oldest = shapes.end();
+    for (auto it = shapes.begin(); it != shapes.end(); ++it) {
+        if (oldest == shapes.end() || (oldest->first == current_id && it->first != current_id) ||
+            ((it->first == current_id) == (oldest->first == current_id) &&
+             it->second.last_used < oldest->second.last_used)) {
+            oldest = it;
+        }
+    }
+    if (oldest == shapes.end()) {
+        return;
+    }
+    if (oldest->first == current_id) {
+        // Only the shape on screen is left: keep showing it from outside
+        // the cache, which stays within max_shapes
+        detached = oldest->second;
+        detached_id = oldest->first;
+        has_detached = true;
+    }
+    shapes.erase(oldest);
+}
+
+void CursorChannel::set_max_shapes(int count) {
+    max_shapes = count > 1 ? count : 1;
+    while ((int)shapes.size() > max_shapes) {
+        evict_oldest();
+    }
+}
+
+const CursorChannel::Shape* CursorChannel::get_current_shape() const {
+    auto it = shapes.find(current_id);
+    if (it != shapes.end()) {
+        return &it->second;
+    }
+    return has_detached && detached_id == current_id ? &detached : nullptr;
+}
+
+Vector2i CursorChannel::get_hotspot() const {
+    const Shape* shape = get_current_shape();
+    return shape ? Vector2i(shape->hot_x, shape->hot_y) : Vector2i();
+}
+
+Vector2i CursorChannel::get_size() const {
+    const Shape* shape = get_current_shape();
+    return shape ? Vector2i(shape->width, shape->height) : Vector2i();
+}
+
+Ref<ImageTexture> CursorChannel::get_texture() const {
+    const Shape* shape = get_current_shape();
+    return shape ? shape->texture : Ref<ImageTexture>();
+}
+
+bool CursorChannel::is_visible() const {
+    return visible && get_current_shape() != nullptr;
+}
+
+bool CursorChannel::take_changed() {
+    bool was_changed = changed;
+    changed = false;
+    return was_changed;
+}
+
+PackedInt64Array CursorChannel::take_missing_shapes() {
+    PackedInt64Array result;
+    result.resize(missing_ids.size());
+    int64_t* dst = result.ptrw();
+    for (size_t i = 0; i < missing_ids.size(); i++) {
+        dst[i] = missing_ids[i];
+    }
+    missing_ids.clear();
+    return result;
+}
+
+Dictionary CursorChannel::get_stats() const {
+    Dictionary stats;
+    stats["shape_packets"] = shape_packets;
+    stats["position_packets"] = position_packets;
+    stats["rejected_packets"] = rejected_packets;
+    stats["cached_shapes"] = (int64_t)shapes.size();
+    stats["shape_id"] = (int64_t)current_id;
+    stats["visible"] = is_visible();
+    return stats;
+}
+
+void CursorChannel::clear() {
+    shapes.clear();
+    detached = Shape();
+    has_detached = false;
+    missing_ids.clear();
+    current_id = 0;
+    visible = false;
+    changed = true;
+}
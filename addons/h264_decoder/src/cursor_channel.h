@@ -0,0 +1,123 @@
+/*
+ * Cursor Channel
+ * Pointer shape and position carried outside the video stream
+ *
+ * The server sends cursor bitmaps once, keyed by id, and afterwards only
+ * position updates, so moving the pointer costs a few bytes and no decode.
+ * StreamDisplay composites the current shape over the video in its shader.
+ *
+ * Packets (little endian):
+ *
+ *   SHAPE    u8 0; u32 id; u16 width, height, hot_x, hot_y; width*height RGBA8
+ *   POSITION u8 1; u32 id; i16 x, y; u8 flags (bit 0 = visible)
+ *
+ * Positions are in video frame pixels. A POSITION naming an id that isn't
+ * cached is applied but reported by take_missing_shapes() so the server
+ * can resend the bitmap.
+ */
+
+#ifndef CURSOR_CHANNEL_H
+#define CURSOR_CHANNEL_H
+
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/classes/image.hpp>
+#include <godot_cpp/classes/image_texture.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/packed_int64_array.hpp>
+#include <godot_cpp/variant/vector2i.hpp>
+
+#include <unordered_map>
+#include <vector>
+
+namespace godot {
+
+class CursorChannel : public RefCounted {
+    GDCLASS(CursorChannel, RefCounted)
+
+public:
+    enum PacketType {
+        PACKET_SHAPE = 0,
+        PACKET_POSITION = 1,
+    };
+
+    static const int MAX_CURSOR_SIZE = 256;
+
+private:
+    struct Shape {
+        Ref<ImageTexture> texture;
+        int width = 0;
+        int height = 0;
+        int hot_x = 0;
+        int hot_y = 0;
+        uint64_t last_used = 0;
+    };
+
+    std::unordered_map<uint32_t, Shape> shapes;
+    int max_shapes = 32;
+    uint64_t use_counter = 0;
+    // The current shape when it had to be evicted to keep the cap; its
+    // texture is the one the material already holds. Dropped as soon as
+    // the cursor switches to another id.
+    Shape detached;
+    uint32_t detached_id = 0;
+    bool has_detached = false;
+
+    uint32_t current_id = 0;
+    int position_x = 0;
+    int position_y = 0;
+    bool visible = false;
+    bool changed = false; // since the last take_changed()
+
+    std::vector<uint32_t> missing_ids;
+
+    // Stats
+    int64_t shape_packets = 0;
+    int64_t position_packets = 0;
+    int64_t rejected_packets = 0;
+
+    bool parse_shape(const uint8_t* data, int64_t size);
+    bool parse_position(const uint8_t* data, int64_t size);
+    void evict_oldest();
+    const Shape* get_current_shape() const;
+
+protected:
+    static void _bind_methods();
+
+public:
+    CursorChannel();
+    ~CursorChannel();
+
+    // Apply one cursor packet; false if it's malformed
+    bool push_packet(const PackedByteArray& data);
+    bool push_packet_raw(const uint8_t* data, int64_t size);
+
+    // Cursor shapes kept by id; least recently shown are dropped first
+    void set_max_shapes(int count);
+    int get_max_shapes() const { return max_shapes; }
+    bool has_shape(int64_t id) const { return shapes.count((uint32_t)id) != 0; }
+
+    int64_t get_shape_id() const { return current_id; }
+    Vector2i get_position() const { return Vector2i(position_x, position_y); }
+    Vector2i get_hotspot() const;
+    Vector2i get_size() const;
+    Ref<ImageTexture> get_texture() const;
+    // Visible and the current shape is cached
+    bool is_visible() const;
+
+    // True once after any shape, position or visibility change
+    bool take_changed();
+    // Ids referenced by POSITION packets that had no cached shape
+    PackedInt64Array take_missing_shapes();
+
+    Dictionary get_stats() const;
+
+    void clear();
+};
+
+} // namespace godot
+
+VARIANT_ENUM_CAST(CursorChannel::PacketType);
+
+#endif // CURSOR_CHANNEL_H
@@ -0,0 +1,238 @@
+/*
+ * Frame Extrapolator Implementation
+ */
+
+#include "frame_extrapolator.h"
+#include "frame_repack.h"
+#include "worker_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+using namespace godot;
+
+// How often the worker checks the clock and the cancel flag
+static const int BUDGET_CHECK_INTERVAL = 64;
+
+FrameExtrapolator::~FrameExtrapolator() {
+    std::unique_lock<std::mutex> lock(mutex);
+    generation++;
+    has_pending = false;
+    wait_idle(lock);
+}
+
+void FrameExtrapolator::wait_idle(std::unique_lock<std::mutex>& lock) {
+    idle_cv.wait(lock, [this] { return !job_running; });
+}
+
+void FrameExtrapolator::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    // A running job notices the new generation and drops its result
+    generation++;
+    has_pending = false;
+    pending_vectors.clear();
+    prediction_ready = false;
+    pred_width = 0;
+    pred_height = 0;
+}
+
+void FrameExtrapolator::release_memory() {
+    clear();
+    std::unique_lock<std::mutex> lock(mutex);
+    wait_idle(lock);
+    std::vector<uint8_t>().swap(pending_y);
+    std::vector<uint8_t>().swap(pending_uv);
+    std::vector<AVMotionVector>().swap(pending_vectors);
+    std::vector<uint8_t>().swap(base_y);
+    std::vector<uint8_t>().swap(base_uv);
+    std::vector<AVMotionVector>().swap(vectors);
+    std::vector<uint8_t>().swap(work_y);
+    std::vector<uint8_t>().swap(work_uv);
+    std::vector<uint8_t>().swap(pred_y);
+    std::vector<uint8_t>().swap(pred_uv);
+}
+
+size_t FrameExtrapolator::get_memory_usage() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t pending = pending_y.capacity() + pending_uv.capacity() +
+                     pending_vectors.capacity() * sizeof(AVMotionVector);
+    // The worker owns base, work and vectors while it runs; count base and
+    // work at the newest frame size instead of reading them
+    size_t job = job_running ? (size_t)pending_width * pending_height * 3
+                             : base_y.capacity() + base_uv.capacity() + work_y.capacity() + work_uv.capacity() +
+                               vectors.capacity() * sizeof(AVMotionVector);
+    return pending + job + pred_y.capacity() + pred_uv.capacity();
+}
+
+bool FrameExtrapolator::submit(const uint8_t* y_plane, const uint8_t* uv_plane, int frame_width, int frame_height,
+                               const AVFrame* frame) {
+    const AVFrameSideData* side_data = av_frame_get_side_data(frame, AV_FRAME_DATA_MOTION_VECTORS);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    // A newer frame makes the in-flight prediction pointless
+    generation++;
+    prediction_ready = false;
+
+    if (!side_data || side_data->size < sizeof(AVMotionVector)) {
+        // Intra frames and hardware decoders carry no vectors
+        has_pending = false;
+        pending_vectors.clear();
+        return false;
+    }
+
+    pending_width = frame_width;
+    pending_height = frame_height;
+    size_t y_size = (size_t)frame_width * frame_height;
+    size_t uv_size = (size_t)frame_width * (frame_height / 2);
+    pending_y.assign(y_plane, y_plane + y_size);
+    pending_uv.assign(uv_plane, uv_plane + uv_size);
+
+    const AVMotionVector* mvs = (const AVMotionVector*)side_data->data;
+    pending_vectors.assign(mvs, mvs + side_data->size / sizeof(AVMotionVector));
+    has_pending = true;
+
+    if (job_running) {
+        // The running job loops round to this frame once it stops
+        return true;
+    }
+    job_running = true;
+    lock.unlock();
+
+    WorkerPool::get_shared().submit([this] { run_job(); });
+    return true;
+}
+
+void FrameExtrapolator::run_job() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (has_pending) {
+        // Take the newest frame; submit refills the pending side meanwhile
+        base_y.swap(pending_y);
+        base_uv.swap(pending_uv);
+        vectors.swap(pending_vectors);
+        int width = pending_width;
+        int height = pending_height;
+        has_pending = false;
+        uint64_t job_generation = generation.load();
+        lock.unlock();
+
+        auto start = std::chrono::steady_clock::now();
+        bool overrun = build_prediction(width, height, job_generation);
+        int64_t elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+
+        lock.lock();
+        last_synth_usec = elapsed;
+        if (overrun) {
+            budget_overruns++;
+        }
+        if (generation.load() == job_generation) {
+            pred_y.swap(work_y);
+            pred_uv.swap(work_uv);
+            pred_width = width;
+            pred_height = height;
+            prediction_ready = true;
+            frames_predicted++;
+        }
+    }
+    job_running = false;
+    idle_cv.notify_all();
+}
+
+bool FrameExtrapolator::build_prediction(int width, int height, uint64_t job_generation) {
+    auto start = std::chrono::steady_clock::now();
+
+    work_y = base_y;
+    work_uv = base_uv;
+
+    int uv_width = width / 2;
+    int uv_height = height / 2;
+    bool overrun = false;
+    const int64_t budget = budget_usec.load();
+
+    for (size_t i = 0; i < vectors.size(); i++) {
+        if (i % BUDGET_CHECK_INTERVAL == 0) {
+            if (generation.load() != job_generation) {
+                break;
+            }
+            int64_t elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            if (elapsed > budget) {
+                // Blocks not moved yet simply keep their current content
+                overrun = true;
+                break;
+            }
+        }
+
+        const AVMotionVector& mv = vectors[i];
+        // Only forward prediction from a past reference says where content is heading
+        if (mv.source >= 0 || mv.motion_scale == 0) {
+            continue;
+        }
+
+        // motion_x/y point from the block back to its source; continue the
+        // movement one more frame in the opposite direction
+        int dx = -(int)lrintf((float)mv.motion_x / mv.motion_scale);
+        int dy = -(int)lrintf((float)mv.motion_y / mv.motion_scale);
+        if (dx == 0 && dy == 0) {
+            continue;
+        }
+
+        int bw = mv.w;
+        int bh = mv.h;
+        int sx = mv.dst_x - bw / 2;
+        int sy = mv.dst_y - bh / 2;
+        int tx = sx + dx;
+        int ty = sy + dy;
+
+        // Clip source and target against the frame together
+        int shift_x = std::max(std::max(-sx, -tx), 0);
+        int shift_y = std::max(std::max(-sy, -ty), 0);
+        sx += shift_x;
+        tx += shift_x;
+        bw -= shift_x;
+        sy += shift_y;
+        ty += shift_y;
+        bh -= shift_y;
+        bw = std::min(bw, width - std::max(sx, tx));
+        bh = std::min(bh, height - std::max(sy, ty));
+        if (bw <= 0 || bh <= 0) {
+            continue;
+        }
+
+        repack_copy_block(work_y.data() + (size_t)ty * width + tx, width,
+                          base_y.data() + (size_t)sy * width + sx, width, bw, bh);
+
+        // Chroma: U in the left half of each row, V in the right half
+        int csx = sx / 2;
+        int csy = sy / 2;
+        int ctx = tx / 2;
+        int cty = ty / 2;
+        int cbw = std::min(bw / 2, uv_width - std::max(csx, ctx));
+        int cbh = std::min(bh / 2, uv_height - std::max(csy, cty));
+        if (cbw <= 0 || cbh <= 0) {
+            continue;
+        }
+        for (int plane = 0; plane < 2; plane++) {
+            size_t plane_offset = plane ? (size_t)uv_width : 0;
+            repack_copy_block(work_uv.data() + plane_offset + (size_t)cty * width + ctx, width,
+                              base_uv.data() + plane_offset + (size_t)csy * width + csx, width, cbw, cbh);
+        }
+    }
+
+    return overrun;
+}
+
+bool FrameExtrapolator::take_prediction(uint8_t* y_dst, uint8_t* uv_dst, int frame_width, int frame_height) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!prediction_ready || frame_width != pred_width || frame_height != pred_height) {
+        return false;
+    }
+
+    memcpy(y_dst, pred_y.data(), pred_y.size());
+    memcpy(uv_dst, pred_uv.data(), pred_uv.size());
+    prediction_ready = false;
+    frames_taken++;
+    return true;
+}
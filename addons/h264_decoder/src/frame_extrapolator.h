@@ -0,0 +1,110 @@
+/*
+ * Frame Extrapolator
+ * Predicts the next picture from the last decoded frame's motion vectors
+ *
+ * After every real frame the repacked planes and libavcodec's exported
+ * motion vectors are handed over; a worker then moves each block one more
+ * step along its vector. When the next frame misses its deadline the
+ * prediction can be shown instead of repeating the old picture.
+ *
+ * Predictions are only ever built from decoded frames and never fed back
+ * to the decoder, so a synthesized frame can't become a reference.
+ */
+
+#ifndef FRAME_EXTRAPOLATOR_H
+#define FRAME_EXTRAPOLATOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/motion_vector.h>
+}
+
+namespace godot {
+
+class FrameExtrapolator {
+private:
+    mutable std::mutex mutex;
+    std::condition_variable idle_cv;
+    bool job_running = false;
+    // Bumped by every submit/clear; a job whose generation is stale stops
+    // at its next check and doesn't publish
+    std::atomic<uint64_t> generation{0};
+
+    // Newest frame handed over, not picked up by the worker yet
+    int pending_width = 0;
+    int pending_height = 0;
+    std::vector<uint8_t> pending_y;
+    std::vector<uint8_t> pending_uv;
+    std::vector<AVMotionVector> pending_vectors;
+    bool has_pending = false;
+
+    // Base frame and motion vectors the running job works from, and the
+    // prediction it builds; owned by the worker while job_running is set.
+    // Y + U|V layout.
+    std::vector<uint8_t> base_y;
+    std::vector<uint8_t> base_uv;
+    std::vector<AVMotionVector> vectors;
+    std::vector<uint8_t> work_y;
+    std::vector<uint8_t> work_uv;
+
+    // Last published prediction
+    int pred_width = 0;
+    int pred_height = 0;
+    std::vector<uint8_t> pred_y;
+    std::vector<uint8_t> pred_uv;
+    bool prediction_ready = false;
+
+    // Set from the main thread, read by the worker mid-job
+    std::atomic<int64_t> budget_usec{4000};
+
+    // Stats
+    int64_t last_synth_usec = 0;
+    int64_t frames_predicted = 0;
+    int64_t frames_taken = 0;
+    int64_t budget_overruns = 0;
+
+    void run_job();
+    // Moves blocks of base into work; returns true when the budget ran out
+    bool build_prediction(int width, int height, uint64_t job_generation);
+    void wait_idle(std::unique_lock<std::mutex>& lock);
+
+public:
+    FrameExtrapolator() = default;
+    ~FrameExtrapolator();
+
+    // Hand over a freshly decoded frame. Never waits for the worker: the
+    // planes are copied aside and a running job picks them up when it
+    // ends, so only the newest frame is ever extrapolated. Returns false
+    // (and drops any old prediction) when the frame carries no motion
+    // vectors, e.g. from a hardware decoder.
+    bool submit(const uint8_t* y_plane, const uint8_t* uv_plane, int frame_width, int frame_height,
+                const AVFrame* frame);
+
+    // Copy the prediction out if the worker finished it. Non-blocking; each
+    // prediction can be taken once.
+    bool take_prediction(uint8_t* y_dst, uint8_t* uv_dst, int frame_width, int frame_height);
+
+    // Drop base frame and prediction (stream reset)
+    void clear();
+    // clear() and give the buffers back to the allocator
+    void release_memory();
+    size_t get_memory_usage() const;
+
+    void set_budget_usec(int64_t usec) { budget_usec = usec > 0 ? usec : 1; }
+    int64_t get_budget_usec() const { return budget_usec.load(); }
+
+    int64_t get_last_synth_usec() const { return last_synth_usec; }
+    int64_t get_frames_predicted() const { return frames_predicted; }
+    int64_t get_frames_taken() const { return frames_taken; }
+    int64_t get_budget_overruns() const { return budget_overruns; }
+};
+
+} // namespace godot
+
+#endif // FRAME_EXTRAPOLATOR_H
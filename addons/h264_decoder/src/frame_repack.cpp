@@ -0,0 +1,159 @@
+/*
+ * Frame Repack Helpers Implementation
+ * SSE2 non-temporal stores on x86, plain memcpy elsewhere; block copies use SSE2 or NEON
+ */
+
+#include "frame_repack.h"
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define REPACK_HAS_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define REPACK_HAS_NEON 1
+#endif
+
+namespace godot {
+
+void repack_copy_streaming(uint8_t* dst, const uint8_t* src, size_t size) {
+#ifdef REPACK_HAS_SSE2
+    // Align the destination, stream the body, copy the tail normally
+    size_t head = (16 - ((uintptr_t)dst & 15)) & 15;
+    if (head > size) {
+        head = size;
+    }
+    memcpy(dst, src, head);
+    dst += head;
+    src += head;
+    size -= head;
+
+    size_t blocks = size / 64;
+    for (size_t i = 0; i < blocks; i++) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(src + 0));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + 16));
+        __m128i c = _mm_loadu_si128((const __m128i*)(src + 32));
+        __m128i d = _mm_loadu_si128((const __m128i*)(src + 48));
+        _mm_stream_si128((__m128i*)(dst + 0), a);
+        _mm_stream_si128((__m128i*)(dst + 16), b);
+        _mm_stream_si128((__m128i*)(dst + 32), c);
+        _mm_stream_si128((__m128i*)(dst + 48), d);
+        src += 64;
+        dst += 64;
+    }
+    size -= blocks * 64;
+
+    while (size >= 16) {
+        _mm_stream_si128((__m128i*)dst, _mm_loadu_si128((const __m128i*)src));
+        src += 16;
+        dst += 16;
+        size -= 16;
+    }
+    memcpy(dst, src, size);
+#else
+    memcpy(dst, src, size);
+#endif
+}
+
+void repack_fill_streaming(uint8_t* dst, uint8_t value, size_t size) {
+#ifdef REPACK_HAS_SSE2
+    size_t head = (16 - ((uintptr_t)dst & 15)) & 15;
+    if (head > size) {
+        head = size;
+    }
+    memset(dst, value, head);
+    dst += head;
+    size -= head;
+
+    __m128i v = _mm_set1_epi8((char)value);
+    while (size >= 16) {
+        _mm_stream_si128((__m128i*)dst, v);
+        dst += 16;
+        size -= 16;
+    }
+    memset(dst, value, size);
+#else
+    memset(dst, value, size);
+#endif
+}
+
+void repack_stream_fence() {
+#ifdef REPACK_HAS_SSE2
+    _mm_sfence();
+#endif
+}
+
+void repack_copy_rows(uint8_t* dst, int dst_stride, const uint8_t* src, int src_stride,
+                      int row_bytes, int rows, bool streaming) {
+    // Contiguous on both sides: one long copy streams much better than many short ones
+    if (dst_stride == row_bytes && src_stride == row_bytes) {
+        size_t size = (size_t)row_bytes * rows;
+        if (streaming) {
+            repack_copy_streaming(dst, src, size);
+        } else {
+            memcpy(dst, src, size);
+        }
+        return;
+    }
+
+    for (int i = 0; i < rows; i++) {
+        if (streaming) {
+            repack_copy_streaming(dst + (size_t)i * dst_stride, src + (size_t)i * src_stride, row_bytes);
+        } else {
+            memcpy(dst + (size_t)i * dst_stride, src + (size_t)i * src_stride, row_bytes);
+        }
+    }
+}
+
+void repack_deinterleave_rows(uint8_t* dst, int dst_stride, const uint8_t* src, int src_stride,
+                              int uv_width, int rows, bool swap_uv) {
+    repack_deinterleave_region(dst, dst + uv_width, dst_stride, src, src_stride, uv_width, rows, swap_uv);
+}
+
+REPACK_TARGET_CLONES
+void repack_deinterleave_region(uint8_t* u_dst, uint8_t* v_dst, int dst_stride,
+                                const uint8_t* src, int src_stride, int width, int rows, bool swap_uv) {
+    int first = swap_uv ? 1 : 0;
+    int second = 1 - first;
+    for (int row = 0; row < rows; row++) {
+        uint8_t* __restrict u_row = u_dst + (size_t)row * dst_stride;
+        uint8_t* __restrict v_row = v_dst + (size_t)row * dst_stride;
+        const uint8_t* __restrict row_src = src + (size_t)row * src_stride;
+        for (int x = 0; x < width; x++) {
+            u_row[x] = row_src[x * 2 + first];
+            v_row[x] = row_src[x * 2 + second];
+        }
+    }
+}
+
+void repack_copy_block(uint8_t* dst, int dst_stride, const uint8_t* src, int src_stride,
+                       int block_width, int block_height) {
+    for (int y = 0; y < block_height; y++) {
+        uint8_t* d = dst + (ptrdiff_t)y * dst_stride;
+        const uint8_t* s = src + (ptrdiff_t)y * src_stride;
+        int x = 0;
+#if defined(REPACK_HAS_SSE2)
+        for (; x + 16 <= block_width; x += 16) {
+            _mm_storeu_si128((__m128i*)(d + x), _mm_loadu_si128((const __m128i*)(s + x)));
+        }
+        if (x + 8 <= block_width) {
+            _mm_storel_epi64((__m128i*)(d + x), _mm_loadl_epi64((const __m128i*)(s + x)));
+            x += 8;
+        }
+#elif defined(REPACK_HAS_NEON)
+        for (; x + 16 <= block_width; x += 16) {
+            vst1q_u8(d + x, vld1q_u8(s + x));
+        }
+        if (x + 8 <= block_width) {
+            vst1_u8(d + x, vld1_u8(s + x));
+            x += 8;
+        }
+#endif
+        for (; x < block_width; x++) {
+            d[x] = s[x];
+        }
+    }
+}
+
+} // namespace godot
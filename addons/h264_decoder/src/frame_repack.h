@@ -0,0 +1,62 @@
+/*
+ * Frame Repack Helpers
+ * Row copy primitives used when packing decoded planes into the Y + (U|V) output layout
+ */
+
+#ifndef FRAME_REPACK_H
+#define FRAME_REPACK_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace godot {
+
+// Output buffers at least this large are written with streaming stores.
+// Anything smaller (1080p and below) fits comfortably in the LLC and is
+// read straight back by the texture upload, so plain memcpy wins there.
+static const size_t STREAMING_MIN_BYTES = 8 * 1024 * 1024;
+
+// Minimum chroma rows per band; keeps small frames from paying thread wake-ups
+static const int REPACK_MIN_BAND_ROWS = 64;
+
+// Scalar hot loops built with H264_TARGET_CLONES (CMake option) get an
+// x86-64-v3 (AVX2) clone next to the baseline one; the dynamic loader's
+// ifunc resolver picks between them when the library is loaded.
+#if defined(H264_TARGET_CLONES) && defined(__x86_64__) && defined(__ELF__) && (defined(__GNUC__) || defined(__clang__))
+#define REPACK_TARGET_CLONES __attribute__((target_clones("arch=x86-64-v3", "default")))
+#else
+#define REPACK_TARGET_CLONES
+#endif
+
+// Copy `size` bytes, bypassing the cache for the destination where supported.
+// Call repack_stream_fence() before another thread reads the destination.
+void repack_copy_streaming(uint8_t* dst, const uint8_t* src, size_t size);
+
+// Fill `size` bytes with `value`, streaming where supported
+void repack_fill_streaming(uint8_t* dst, uint8_t value, size_t size);
+
+// Order all streaming stores issued by this thread
+void repack_stream_fence();
+
+// Copy `rows` rows of `row_bytes` between strided buffers
+void repack_copy_rows(uint8_t* dst, int dst_stride, const uint8_t* src, int src_stride,
+                      int row_bytes, int rows, bool streaming);
+
+// Split interleaved chroma rows (NV12, or NV21 with swap_uv) into the U|V
+// layout: U in the first uv_width bytes of each row, V right after it
+void repack_deinterleave_rows(uint8_t* dst, int dst_stride, const uint8_t* src, int src_stride,
+                              int uv_width, int rows, bool swap_uv);
+
+// Same split into separate U and V destinations that share dst_stride, for
+// callers that only update a sub-rectangle of the U|V layout
+void repack_deinterleave_region(uint8_t* u_dst, uint8_t* v_dst, int dst_stride,
+                                const uint8_t* src, int src_stride, int width, int rows, bool swap_uv);
+
+// Copy a small block (motion-compensated macroblocks etc.) with 16-byte vector moves.
+// Source and destination must not overlap.
+void repack_copy_block(uint8_t* dst, int dst_stride, const uint8_t* src, int src_stride,
+                       int block_width, int block_height);
+
+} // namespace godot
+
+#endif // FRAME_REPACK_H
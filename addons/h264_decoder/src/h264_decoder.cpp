@@ -4,8 +4,16 @@
  */
 
 #include "h264_decoder.h"
+#include "adpcm.h"
+#include "frame_repack.h"
+#include "worker_pool.h"
 #include <godot_cpp/core/class_db.hpp>
 #include <godot_cpp/variant/utility_functions.hpp>
+#include <godot_cpp/variant/vector2i.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
 
 // FFmpeg JNI wrapper
 extern "C" {
@@ -24,38 +32,123 @@ extern "C" JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void *reserved) {
 }
 #endif
 
-static const int IMA_INDEX_TABLE[] = {
-    -1, -1, -1, -1, 2, 4, 6, 8,
-    -1, -1, -1, -1, 2, 4, 6, 8
-};
-
-static const int IMA_STEP_TABLE[] = {
-    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
-    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
-    337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
-    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
-    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
-};
-
 using namespace godot;
 
+// Keys of the nal_bytes dictionaries, indexed by NalCategory
+static const char* NAL_CATEGORY_NAMES[NAL_CATEGORY_COUNT] = { "slice", "idr", "sei", "sps", "pps", "aud", "other" };
+
 void H264Decoder::_bind_methods() {
     ClassDB::bind_method(D_METHOD("initialize", "expected_width", "expected_height"), &H264Decoder::initialize, DEFVAL(0), DEFVAL(0));
     ClassDB::bind_method(D_METHOD("decode_frame", "h264_data"), &H264Decoder::decode_frame);
+    ClassDB::bind_method(D_METHOD("decode_batch", "packets"), &H264Decoder::decode_batch);
+    ClassDB::bind_method(D_METHOD("decode_batch_buffer", "data", "offsets"), &H264Decoder::decode_batch_buffer);
     ClassDB::bind_method(D_METHOD("get_width"), &H264Decoder::get_width);
     ClassDB::bind_method(D_METHOD("get_height"), &H264Decoder::get_height);
     ClassDB::bind_method(D_METHOD("is_initialized"), &H264Decoder::is_initialized);
     ClassDB::bind_method(D_METHOD("reset"), &H264Decoder::reset);
     ClassDB::bind_method(D_METHOD("cleanup"), &H264Decoder::cleanup);
     ClassDB::bind_method(D_METHOD("decode_audio", "adpcm_data"), &H264Decoder::decode_audio);
+    ClassDB::bind_method(D_METHOD("set_repack_threads", "threads"), &H264Decoder::set_repack_threads);
+    ClassDB::bind_method(D_METHOD("get_repack_threads"), &H264Decoder::get_repack_threads);
+    ClassDB::bind_method(D_METHOD("set_streaming_stores", "enabled"), &H264Decoder::set_streaming_stores);
+    ClassDB::bind_method(D_METHOD("get_streaming_stores"), &H264Decoder::get_streaming_stores);
+    ClassDB::bind_method(D_METHOD("set_output_format", "format"), &H264Decoder::set_output_format);
+    ClassDB::bind_method(D_METHOD("get_output_format"), &H264Decoder::get_output_format);
+    ClassDB::bind_method(D_METHOD("set_extrapolation_enabled", "enabled"), &H264Decoder::set_extrapolation_enabled);
+    ClassDB::bind_method(D_METHOD("is_extrapolation_enabled"), &H264Decoder::is_extrapolation_enabled);
+    ClassDB::bind_method(D_METHOD("set_extrapolation_budget_usec", "usec"), &H264Decoder::set_extrapolation_budget_usec);
+    ClassDB::bind_method(D_METHOD("get_extrapolation_budget_usec"), &H264Decoder::get_extrapolation_budget_usec);
+    ClassDB::bind_method(D_METHOD("get_extrapolated_frame"), &H264Decoder::get_extrapolated_frame);
+    ClassDB::bind_method(D_METHOD("set_retained_mode", "enabled"), &H264Decoder::set_retained_mode);
+    ClassDB::bind_method(D_METHOD("is_retained_mode"), &H264Decoder::is_retained_mode);
+    ClassDB::bind_method(D_METHOD("queue_region_commands", "commands"), &H264Decoder::queue_region_commands);
+    ClassDB::bind_method(D_METHOD("get_dirty_rects"), &H264Decoder::get_dirty_rects);
+    ClassDB::bind_method(D_METHOD("set_tile_cache_budget", "bytes"), &H264Decoder::set_tile_cache_budget);
+    ClassDB::bind_method(D_METHOD("get_tile_cache_budget"), &H264Decoder::get_tile_cache_budget);
+    ClassDB::bind_method(D_METHOD("take_tile_cache_events"), &H264Decoder::take_tile_cache_events);
+    ClassDB::bind_method(D_METHOD("get_memory_usage"), &H264Decoder::get_memory_usage);
+    ClassDB::bind_method(D_METHOD("set_memory_budget", "bytes"), &H264Decoder::set_memory_budget);
+    ClassDB::bind_method(D_METHOD("get_memory_budget"), &H264Decoder::get_memory_budget);
+    ClassDB::bind_static_method("H264Decoder", D_METHOD("set_global_memory_budget", "bytes"), &H264Decoder::set_global_memory_budget);
+    ClassDB::bind_static_method("H264Decoder", D_METHOD("get_global_memory_budget"), &H264Decoder::get_global_memory_budget);
+    ClassDB::bind_static_method("H264Decoder", D_METHOD("get_global_memory_usage"), &H264Decoder::get_global_memory_usage);
+    ClassDB::bind_method(D_METHOD("set_codec_threads", "threads"), &H264Decoder::set_codec_threads);
+    ClassDB::bind_method(D_METHOD("get_codec_threads"), &H264Decoder::get_codec_threads);
+    ClassDB::bind_method(D_METHOD("set_software_only", "enabled"), &H264Decoder::set_software_only);
+    ClassDB::bind_method(D_METHOD("is_software_only"), &H264Decoder::is_software_only);
+    ClassDB::bind_method(D_METHOD("set_watchdog_enabled", "enabled"), &H264Decoder::set_watchdog_enabled);
+    ClassDB::bind_method(D_METHOD("is_watchdog_enabled"), &H264Decoder::is_watchdog_enabled);
+    ClassDB::bind_method(D_METHOD("set_stall_timeout_msec", "msec"), &H264Decoder::set_stall_timeout_msec);
+    ClassDB::bind_method(D_METHOD("get_stall_timeout_msec"), &H264Decoder::get_stall_timeout_msec);
+    ClassDB::bind_method(D_METHOD("is_software_fallback"), &H264Decoder::is_software_fallback);
+    ClassDB::bind_method(D_METHOD("set_thread_cpus", "cpus"), &H264Decoder::set_thread_cpus);
+    ClassDB::bind_method(D_METHOD("get_thread_cpus"), &H264Decoder::get_thread_cpus);
+    ClassDB::bind_method(D_METHOD("set_fast_cores_only", "enabled"), &H264Decoder::set_fast_cores_only);
+    ClassDB::bind_method(D_METHOD("is_fast_cores_only"), &H264Decoder::is_fast_cores_only);
+    ClassDB::bind_method(D_METHOD("set_thread_priority", "priority"), &H264Decoder::set_thread_priority);
+    ClassDB::bind_method(D_METHOD("get_thread_priority"), &H264Decoder::get_thread_priority);
+    ClassDB::bind_method(D_METHOD("apply_thread_policy_to_current_thread"), &H264Decoder::apply_thread_policy_to_current_thread);
+    ClassDB::bind_static_method("H264Decoder", D_METHOD("get_fast_cores"), &H264Decoder::get_fast_cores);
+    ClassDB::bind_static_method("H264Decoder", D_METHOD("set_worker_pool_thread_policy", "cpus", "priority"), &H264Decoder::set_worker_pool_thread_policy);
+    ClassDB::bind_method(D_METHOD("set_analytics_enabled", "enabled"), &H264Decoder::set_analytics_enabled);
+    ClassDB::bind_method(D_METHOD("is_analytics_enabled"), &H264Decoder::is_analytics_enabled);
+    ClassDB::bind_method(D_METHOD("set_analytics_window", "frames"), &H264Decoder::set_analytics_window);
+    ClassDB::bind_method(D_METHOD("get_analytics_window"), &H264Decoder::get_analytics_window);
+    ClassDB::bind_method(D_METHOD("get_frame_analytics"), &H264Decoder::get_frame_analytics);
+    ClassDB::bind_method(D_METHOD("get_analytics_summary"), &H264Decoder::get_analytics_summary);
+    ClassDB::bind_method(D_METHOD("serialize_analytics_summary"), &H264Decoder::serialize_analytics_summary);
+    ClassDB::bind_method(D_METHOD("set_refresh_gating", "enabled"), &H264Decoder::set_refresh_gating);
+    ClassDB::bind_method(D_METHOD("is_refresh_gating"), &H264Decoder::is_refresh_gating);
+    ClassDB::bind_method(D_METHOD("get_refresh_state"), &H264Decoder::get_refresh_state);
+    ClassDB::bind_method(D_METHOD("get_refresh_progress"), &H264Decoder::get_refresh_progress);
+    ClassDB::bind_method(D_METHOD("set_latency_probe_enabled", "enabled"), &H264Decoder::set_latency_probe_enabled);
+    ClassDB::bind_method(D_METHOD("is_latency_probe_enabled"), &H264Decoder::is_latency_probe_enabled);
+    ClassDB::bind_method(D_METHOD("probe_presented"), &H264Decoder::probe_presented);
+    ClassDB::bind_method(D_METHOD("get_stats"), &H264Decoder::get_stats);
+
+    BIND_ENUM_CONSTANT(OUTPUT_YUV);
+    BIND_ENUM_CONSTANT(OUTPUT_RGBA);
+    BIND_ENUM_CONSTANT(OUTPUT_BGRA);
+
+    BIND_ENUM_CONSTANT(PACKET_DECODED);
+    BIND_ENUM_CONSTANT(PACKET_PENDING);
+    BIND_ENUM_CONSTANT(PACKET_EMPTY);
+    BIND_ENUM_CONSTANT(PACKET_ERROR);
+
+    BIND_ENUM_CONSTANT(MEMORY_PRESSURE_NONE);
+    BIND_ENUM_CONSTANT(MEMORY_PRESSURE_HIGH);
+    BIND_ENUM_CONSTANT(MEMORY_PRESSURE_CRITICAL);
+
+    BIND_ENUM_CONSTANT(WATCHDOG_NONE);
+    BIND_ENUM_CONSTANT(WATCHDOG_FLUSH);
+    BIND_ENUM_CONSTANT(WATCHDOG_REOPEN);
+    BIND_ENUM_CONSTANT(WATCHDOG_SOFTWARE);
+
+    BIND_ENUM_CONSTANT(THREAD_PRIORITY_NORMAL);
+    BIND_ENUM_CONSTANT(THREAD_PRIORITY_HIGH);
+    BIND_ENUM_CONSTANT(THREAD_PRIORITY_REALTIME);
+
+    BIND_ENUM_CONSTANT(REFRESH_WAITING);
+    BIND_ENUM_CONSTANT(REFRESH_IN_PROGRESS);
+    BIND_ENUM_CONSTANT(REFRESH_CLEAN);
+
+    ADD_SIGNAL(MethodInfo("decoder_stalled", PropertyInfo(Variant::INT, "level"), PropertyInfo(Variant::INT, "stalled_msec")));
+    ADD_SIGNAL(MethodInfo("decoder_recovered", PropertyInfo(Variant::INT, "level"), PropertyInfo(Variant::INT, "frozen_msec")));
+    ADD_SIGNAL(MethodInfo("picture_clean", PropertyInfo(Variant::INT, "time_to_clean_msec")));
+    ADD_SIGNAL(MethodInfo("latency_measured", PropertyInfo(Variant::INT, "sequence"),
+                          PropertyInfo(Variant::FLOAT, "decoded_msec"), PropertyInfo(Variant::FLOAT, "presented_msec")));
+    ADD_SIGNAL(MethodInfo("memory_pressure", PropertyInfo(Variant::INT, "level"),
+                          PropertyInfo(Variant::INT, "usage_bytes"), PropertyInfo(Variant::INT, "budget_bytes")));
 }
 
 H264Decoder::H264Decoder() {
     // Decoder will be initialized on first frame or explicit call
+    MemoryAccounting::instance_added();
 }
 
 H264Decoder::~H264Decoder() {
     cleanup();
+    MemoryAccounting::instance_removed();
 }
 
 bool H264Decoder::initialize(int expected_width, int expected_height) {
@@ -63,48 +156,83 @@ bool H264Decoder::initialize(int expected_width, int expected_height) {
         return true;
     }
 
+    // Standby instances don't get to open a codec while decoders are over budget
+    int64_t global_budget = global_accounting ? MemoryAccounting::get_budget() : 0;
+    if (global_budget > 0 && MemoryAccounting::get_usage() >= global_budget) {
+        UtilityFunctions::printerr("[H264Decoder] Global memory budget exhausted (",
+            MemoryAccounting::get_usage(), " / ", global_budget, " bytes), not initializing");
+        return false;
+    }
+
+    if (!open_codec(software_decoder_only || software_fallback)) {
+        return false;
+    }
+
+    frame = av_frame_alloc();
+    receive_frame = av_frame_alloc();
+    clean_frame = av_frame_alloc();
+    packet = av_packet_alloc();
+
+    if (!frame || !receive_frame || !clean_frame || !packet) {
+        UtilityFunctions::printerr("[H264Decoder] Failed to allocate frames/packet");
+        cleanup();
+        return false;
+    }
+
+    width = expected_width;
+    height = expected_height;
+    initialized = true;
+    reset_watchdog();
+    
+    UtilityFunctions::print("[H264Decoder] Initialized successfully");
+    return true;
+}
+
+bool H264Decoder::open_codec(bool software_only) {
     // Find H.264 decoder (prefer hardware)
     const AVCodec* codec = nullptr;
     
-    // Check for Android platform using Godot's define or standard define
-    #if defined(__ANDROID__) || defined(ANDROID_ENABLED)
-    UtilityFunctions::print("[H264Decoder] Android platform detected.");
-    
-    if (!g_jvm) {
-        // Fallback: Try to get the VM from JNI_GetCreatedJavaVMs
-        JavaVM* vms[1];
-        jsize num_vms = 0;
-        if (JNI_GetCreatedJavaVMs(vms, 1, &num_vms) == JNI_OK && num_vms > 0) {
-            g_jvm = vms[0];
-            UtilityFunctions::print("[H264Decoder] JavaVM found via JNI_GetCreatedJavaVMs fallback.");
+    if (!software_only) {
+        // Check for Android platform using Godot's define or standard define
+        #if defined(__ANDROID__) || defined(ANDROID_ENABLED)
+        UtilityFunctions::print("[H264Decoder] Android platform detected.");
+
+        if (!g_jvm) {
+            // Fallback: Try to get the VM from JNI_GetCreatedJavaVMs
+            JavaVM* vms[1];
+            jsize num_vms = 0;
+            if (JNI_GetCreatedJavaVMs(vms, 1, &num_vms) == JNI_OK && num_vms > 0) {
+                g_jvm = vms[0];
+                UtilityFunctions::print("[H264Decoder] JavaVM found via JNI_GetCreatedJavaVMs fallback.");
+            }
         }
-    }
 
-    if (g_jvm) {
-        // Register JavaVM with FFmpeg so it can access MediaCodec
-        if (av_jni_set_java_vm(g_jvm, nullptr) == 0) {
-            UtilityFunctions::print("[H264Decoder] Registered JavaVM with FFmpeg.");
+        if (g_jvm) {
+            // Register JavaVM with FFmpeg so it can access MediaCodec
+            if (av_jni_set_java_vm(g_jvm, nullptr) == 0) {
+                UtilityFunctions::print("[H264Decoder] Registered JavaVM with FFmpeg.");
+            } else {
+                UtilityFunctions::printerr("[H264Decoder] Failed to register JavaVM with FFmpeg!");
+            }
         } else {
-            UtilityFunctions::printerr("[H264Decoder] Failed to register JavaVM with FFmpeg!");
+            UtilityFunctions::printerr("[H264Decoder] JavaVM not found! (JNI_OnLoad not called and JNI_GetCreatedJavaVMs failed)");
         }
-    } else {
-        UtilityFunctions::printerr("[H264Decoder] JavaVM not found! (JNI_OnLoad not called and JNI_GetCreatedJavaVMs failed)");
-    }
 
-    UtilityFunctions::print("[H264Decoder] Checking for h264_mediacodec...");
-    codec = avcodec_find_decoder_by_name("h264_mediacodec");
-    if (codec) {
-        UtilityFunctions::print("[H264Decoder] Found h264_mediacodec! Using hardware decoding.");
-    } else {
-        UtilityFunctions::print("[H264Decoder] h264_mediacodec not found in FFmpeg build.");
-    }
-    #else
-    // Try NVDEC on desktop
-    codec = avcodec_find_decoder_by_name("h264_cuvid");
-    if (codec) {
-        UtilityFunctions::print("[H264Decoder] Using NVDEC hardware decoder");
+        UtilityFunctions::print("[H264Decoder] Checking for h264_mediacodec...");
+        codec = avcodec_find_decoder_by_name("h264_mediacodec");
+        if (codec) {
+            UtilityFunctions::print("[H264Decoder] Found h264_mediacodec! Using hardware decoding.");
+        } else {
+            UtilityFunctions::print("[H264Decoder] h264_mediacodec not found in FFmpeg build.");
+        }
+        #else
+        // Try NVDEC on desktop
+        codec = avcodec_find_decoder_by_name("h264_cuvid");
+        if (codec) {
+            UtilityFunctions::print("[H264Decoder] Using NVDEC hardware decoder");
+        }
+        #endif
     }
-    #endif
     
     // Fall back to software decoder
     if (!codec) {
@@ -128,104 +256,448 @@ bool H264Decoder::initialize(int expected_width, int expected_height) {
     // Configure for low latency
     codec_ctx->flags |= AV_CODEC_FLAG_LOW_DELAY;
     codec_ctx->flags2 |= AV_CODEC_FLAG2_FAST;
-    codec_ctx->thread_count = 0; // Auto-threading for better I-frame handling on mobile
+    update_export_side_data();
+    codec_ctx->thread_count = get_effective_codec_threads(); // 0 = auto-threading for better I-frame handling on mobile
     codec_ctx->thread_type = FF_THREAD_SLICE;
+    frame_buffers.attach(codec_ctx);
 
     if (avcodec_open2(codec_ctx, codec, nullptr) < 0) {
         UtilityFunctions::printerr("[H264Decoder] Failed to open codec");
         avcodec_free_context(&codec_ctx);
         return false;
     }
-
-    frame = av_frame_alloc();
-    frame_rgb = av_frame_alloc();
-    packet = av_packet_alloc();
-
-    if (!frame || !frame_rgb || !packet) {
-        UtilityFunctions::printerr("[H264Decoder] Failed to allocate frames/packet");
-        cleanup();
-        return false;
+    // Slice threads identify (and place) themselves on their first job
+    codec_thread_tracker.attach(codec_ctx);
+    if (has_thread_policy()) {
+        apply_thread_policy();
     }
-
-    width = expected_width;
-    height = expected_height;
-    initialized = true;
-    
-    UtilityFunctions::print("[H264Decoder] Initialized successfully");
     return true;
 }
 
-PackedByteArray H264Decoder::decode_frame(const PackedByteArray& h264_data) {
-    PackedByteArray result;
-    
-    if (h264_data.size() == 0) {
-        return result;
+H264Decoder::PacketStatus H264Decoder::decode_packet(const uint8_t* data, int64_t size) {
+    if (size <= 0) {
+        return PACKET_EMPTY;
     }
 
     // Auto-initialize if needed
     if (!initialized) {
         if (!initialize()) {
-            return result;
+            return PACKET_ERROR;
         }
     }
 
-    // Set packet data
-    packet->data = const_cast<uint8_t*>(h264_data.ptr());
-    packet->size = h264_data.size();
-
-    // Send packet to decoder
-    int ret = avcodec_send_packet(codec_ctx, packet);
-    if (ret < 0 && ret != AVERROR(EAGAIN)) {
-        // Not an error if decoder needs more data
-        if (ret != AVERROR_EOF) {
-            return result;
+    // Kept so a reopened codec can start at the next IDR or recovery point
+    parameter_sets.update(data, (size_t)size);
+    if (reopen_at_sync_point && is_sync_point(data, (size_t)size)) {
+        // Nothing before this packet is needed any more, so swapping the
+        // context loses no pictures; reopen_codec replays SPS/PPS
+        reopen_at_sync_point = false;
+        if (reopen_codec(software_decoder_only || software_fallback)) {
+            UtilityFunctions::print("[H264Decoder] Codec reopened with ", codec_ctx->thread_count, " thread(s) for the memory budget");
+        }
+        if (!initialized) {
+            return PACKET_ERROR;
+        }
+    }
+    // Non-refcounted packets are copied by avcodec_send_packet
+    if (size + AV_INPUT_BUFFER_PADDING_SIZE > packet_buffer_bytes) {
+        packet_buffer_bytes = size + AV_INPUT_BUFFER_PADDING_SIZE;
+    }
+    if (analytics_enabled) {
+        analytics.record_packet(data, (size_t)size);
+        bool probe = ++export_probe_counter % EXPORT_PROBE_INTERVAL == 0;
+        if (probe != export_probe) {
+            export_probe = probe;
+            update_export_side_data();
         }
     }
 
-    // Receive decoded frame
-    ret = avcodec_receive_frame(codec_ctx, frame);
-    if (ret < 0) {
+    auto decode_start = std::chrono::steady_clock::now();
+    refresh.on_packet(data, (size_t)size, std::chrono::duration_cast<std::chrono::microseconds>(
+        decode_start.time_since_epoch()).count());
+    bool rejected = false;
+    bool got_frame = send_and_receive(data, size, rejected);
+
+    auto decode_end = std::chrono::steady_clock::now();
+    int64_t now_usec = std::chrono::duration_cast<std::chrono::microseconds>(
+        decode_end.time_since_epoch()).count();
+    if (!got_frame && check_watchdog(now_usec)) {
+        // The old context swallowed this packet; if it's the IDR the server
+        // sent in response, the fresh one can show it right away
+        got_frame = send_and_receive(data, size, rejected);
+    }
+    last_input_usec = now_usec;
+    if (rejected) {
+        refresh.on_damage(now_usec);
+    }
+    if (!got_frame) {
         // EAGAIN means we need to send more packets
         // This is normal for the first few frames
-        return result;
+        return rejected ? PACKET_ERROR : PACKET_PENDING;
+    }
+    on_frame_output(now_usec);
+    if (latency_probe_enabled) {
+        int64_t latency_usec = 0;
+        latency_probe.sample(LatencyProbe::STAGE_DECODED, frame->data[0], frame->linesize[0],
+                             frame->width, frame->height, latency_usec);
+    }
+    if (analytics_enabled) {
+        analytics.record_frame(frame);
+    }
+    if (frame->decode_error_flags || (frame->flags & AV_FRAME_FLAG_CORRUPT)) {
+        refresh.on_damage(now_usec);
+    }
+    int64_t time_to_clean_usec = 0;
+    if (refresh.take_clean_transition(time_to_clean_usec)) {
+        emit_signal("picture_clean", time_to_clean_usec / 1000);
     }
 
-    // ═══════════════════════════════════════════════════════════════════════════
-    // OPTIMIZATION: Return raw YUV data instead of converting to RGBA with sws_scale
-    // This effectively 0-copies the heavy lifting to the GPU shader.
-    // ═══════════════════════════════════════════════════════════════════════════
+    last_decode_usec = std::chrono::duration_cast<std::chrono::microseconds>(decode_end - decode_start).count();
+    decode_time_history[decode_time_pos] = last_decode_usec;
+    decode_time_pos = (decode_time_pos + 1) % DECODE_TIME_WINDOW;
+    if (decode_time_count < DECODE_TIME_WINDOW) {
+        decode_time_count++;
+    }
+    if (analytics_enabled) {
+        record_export_sample(last_decode_usec);
+    }
 
     // Update dimensions if changed
     if (frame->width != width || frame->height != height) {
         width = frame->width;
         height = frame->height;
         UtilityFunctions::print("[H264Decoder] Frame size: ", width, "x", height, 
-            " Fmt:", (int)frame->format, " (Outputting YUV)");
+            " Fmt:", (int)frame->format, output_format == OUTPUT_YUV ? " (Outputting YUV)" : " (Outputting RGBA)");
+    }
+
+    update_memory_accounting();
+
+    // Intra refresh: frame now holds a picture that isn't clean yet, so
+    // get_current_frame() serves the last clean one until the refresh ends
+    if (refresh_gating) {
+        if (!refresh.is_clean()) {
+            frames_gated++;
+            return PACKET_PENDING;
+        }
+        // A reference, not a copy: it only pins the picture's pool buffer
+        av_frame_unref(clean_frame);
+        av_frame_ref(clean_frame, frame);
+    }
+    return PACKET_DECODED;
+}
+
+const AVFrame* H264Decoder::get_current_frame() const {
+    if (refresh_gating && !refresh.is_clean()) {
+        return clean_frame && clean_frame->buf[0] ? clean_frame : nullptr;
+    }
+    return frame;
+}
+
+void H264Decoder::set_refresh_gating(bool enabled) {
+    refresh_gating = enabled;
+    if (!enabled && clean_frame) {
+        av_frame_unref(clean_frame);
+    }
+}
+
+bool H264Decoder::send_and_receive(const uint8_t* data, int64_t size, bool& rejected) {
+    // Set packet data
+    packet->data = const_cast<uint8_t*>(data);
+    packet->size = (int)size;
+
+    // Send packet to decoder. EAGAIN/EOF are not errors, the decoder just
+    // needs its output drained first
+    int ret = avcodec_send_packet(codec_ctx, packet);
+    rejected = ret < 0 && ret != AVERROR(EAGAIN) && ret != AVERROR_EOF;
+
+    // Receive decoded frames. Drain everything the packet produced and keep
+    // the newest; receive_frame unrefs its target even on EAGAIN, so pull
+    // into a scratch frame first.
+    bool got_frame = false;
+    while (avcodec_receive_frame(codec_ctx, receive_frame) >= 0) {
+        av_frame_unref(frame);
+        av_frame_move_ref(frame, receive_frame);
+        got_frame = true;
+    }
+    return got_frame;
+}
+
+PackedByteArray H264Decoder::decode_frame(const PackedByteArray& h264_data) {
+    if (decode_packet(h264_data.ptr(), h264_data.size()) != PACKET_DECODED) {
+        return PackedByteArray();
+    }
+    return output_current_frame();
+}
+
+Dictionary H264Decoder::decode_batch(const Array& packets) {
+    auto batch_start = std::chrono::steady_clock::now();
+
+    PackedInt32Array status;
+    status.resize(packets.size());
+    int32_t* status_ptr = status.ptrw();
+
+    bool got_frame = false;
+    for (int64_t i = 0; i < packets.size(); i++) {
+        const Variant& item = packets[i];
+        if (item.get_type() != Variant::PACKED_BYTE_ARRAY) {
+            status_ptr[i] = PACKET_ERROR;
+            continue;
+        }
+        // Shares the Variant's buffer, no copy
+        PackedByteArray data = item;
+        status_ptr[i] = decode_packet(data.ptr(), data.size());
+        got_frame |= status_ptr[i] == PACKET_DECODED;
+    }
+
+    return finish_batch(got_frame, status, batch_start);
+}
+
+Dictionary H264Decoder::decode_batch_buffer(const PackedByteArray& data, const PackedInt32Array& offsets) {
+    auto batch_start = std::chrono::steady_clock::now();
+
+    PackedInt32Array status;
+    status.resize(offsets.size());
+    int32_t* status_ptr = status.ptrw();
+    const int32_t* offset_ptr = offsets.ptr();
+    const uint8_t* base = data.ptr();
+    int64_t data_size = data.size();
+
+    bool got_frame = false;
+    for (int64_t i = 0; i < offsets.size(); i++) {
+        int64_t begin = offset_ptr[i];
+        int64_t end = (i + 1 < offsets.size()) ? offset_ptr[i + 1] : data_size;
+        if (begin < 0 || end > data_size || begin > end) {
+            status_ptr[i] = PACKET_ERROR;
+            continue;
+        }
+        status_ptr[i] = decode_packet(base + begin, end - begin);
+        got_frame |= status_ptr[i] == PACKET_DECODED;
+    }
+
+    return finish_batch(got_frame, status, batch_start);
+}
+
+Dictionary H264Decoder::finish_batch(bool got_frame, const PackedInt32Array& status,
+                                     std::chrono::steady_clock::time_point batch_start) {
+    Dictionary result;
+    // Only the newest picture is repacked, however many packets decoded;
+    // under refresh gating that is the last clean one, even if a later
+    // packet in this batch was damaged
+    result["frame"] = got_frame ? output_current_frame() : PackedByteArray();
+    result["status"] = status;
+
+    last_batch_packets = (int)status.size();
+    last_batch_usec = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - batch_start).count();
+    return result;
+}
+
+PackedByteArray H264Decoder::output_current_frame() {
+    PackedByteArray result;
+
+    // ═══════════════════════════════════════════════════════════════════════════
+    // OPTIMIZATION: Return raw YUV data instead of converting to RGBA with sws_scale
+    // This effectively 0-copies the heavy lifting to the GPU shader.
+    // ═══════════════════════════════════════════════════════════════════════════
+
+    // With refresh gating this is the last clean picture, which need not be
+    // the newest one decoded in this batch
+    const AVFrame* src = get_current_frame();
+    if (!src || !src->data[0]) {
+        return result;
+    }
+
+    if (output_format != OUTPUT_YUV) {
+        return convert_rgba();
     }
 
     // Prepare YUV buffer (Y + U + V)
     // Assuming YUV420P: Y is full res, U and V are half width/height
-    int y_size = width * height;
-    int uv_width = width / 2; 
-    int uv_height = height / 2;
-    int uv_size = uv_width * uv_height;
+    int y_size = src->width * src->height;
+    int uv_size = (src->width / 2) * (src->height / 2);
     int total_size = y_size + (uv_size * 2);
 
     result.resize(total_size);
+    output_buffer_bytes = total_size;
     uint8_t* dst = result.ptrw();
-    uint8_t* uv_dst_start = dst + y_size;
+    repack_yuv(dst, dst + y_size);
+
+    return result;
+}
+
+PackedByteArray H264Decoder::convert_rgba() {
+    PackedByteArray result;
+    const AVFrame* src = get_current_frame();
+    if (!src || !src->data[0]) {
+        return result;
+    }
+    auto convert_start = std::chrono::steady_clock::now();
+    int width = src->width;
+    int height = src->height;
+
+    result.resize((int64_t)width * height * 4);
+    output_buffer_bytes = result.size();
+    AVPixelFormat dst_format = output_format == OUTPUT_BGRA ? AV_PIX_FMT_BGRA : AV_PIX_FMT_RGBA;
+    int bands = repack_threads > 0 ? repack_threads : WorkerPool::get_shared().get_thread_count() + 1;
+
+    if (!rgba_converter.convert(src, result.ptrw(), width * 4, width, height, dst_format, bands)) {
+        static int warn_count = 0;
+        if (warn_count++ % 100 == 0) {
+            UtilityFunctions::printerr("[H264Decoder] RGBA conversion failed for format: ", (int)src->format);
+        }
+        result.clear();
+        return result;
+    }
+
+    last_convert_usec = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - convert_start).count();
+    return result;
+}
+
+void H264Decoder::repack_yuv(uint8_t* y_dst, uint8_t* uv_dst) {
+    const AVFrame* src = get_current_frame();
+    if (!src || !src->data[0]) {
+        return;
+    }
+    int width = src->width;
+    int height = src->height;
+
+    if (retained_mode && apply_region_commands(src)) {
+        // Only the commanded regions changed; hand out the retained picture
+        auto copy_start = std::chrono::steady_clock::now();
+        bool streaming = streaming_stores && (size_t)width * height * 3 / 2 >= STREAMING_MIN_BYTES;
+        repack_copy_rows(y_dst, width, retained.get_y(), width, width, height, streaming);
+        repack_copy_rows(uv_dst, width, retained.get_uv(), width, width, height / 2, streaming);
+        if (streaming) {
+            repack_stream_fence();
+        }
+        last_repack_usec = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - copy_start).count();
+    } else {
+        repack_planes(src, y_dst, uv_dst);
+        if (retained_mode) {
+            retained.replace(y_dst, uv_dst, width, height);
+        }
+    }
+
+    if (extrapolation_enabled) {
+        extrapolator.submit(y_dst, uv_dst, width, height, src);
+    }
+}
+
+bool H264Decoder::apply_region_commands(const AVFrame* src) {
+    std::vector<RegionCommand> commands;
+    commands.swap(pending_region_commands);
+    RetainedFrame::parse_frame_commands(src, commands);
+    last_region_commands = (int)commands.size();
+
+    // No commands means the decoded picture is the whole truth
+    if (commands.empty() || !retained.is_valid(src->width, src->height)) {
+        return false;
+    }
+
+    retained.clear_dirty();
+    for (const RegionCommand& cmd : commands) {
+        switch (cmd.type) {
+            case RegionCommand::COPY:
+                retained.copy_rect(cmd.rect, cmd.dst_x, cmd.dst_y);
+                break;
+            case RegionCommand::UPDATE:
+                if (!retained.update_from_frame(src, cmd.rect)) {
+                    return false;
+                }
+                break;
+            case RegionCommand::TILE:
+                // A miss leaves the area stale; it's reported so the server resends it
+                retained.blit_tile(tile_cache, cmd.tile_id, cmd.dst_x, cmd.dst_y);
+                break;
+            default:
+                break;
+        }
+    }
+
+    // STORE runs last so it sees this frame's final content
+    for (const RegionCommand& cmd : commands) {
+        if (cmd.type == RegionCommand::STORE && tile_cache.is_enabled()) {
+            retained.store_tiles(tile_cache, cmd.rect);
+        }
+    }
+    return true;
+}
 
-    // 1. Copy Y Plane (Plane 0 is always Y)
-    if (frame->data[0]) {
-        for (int i = 0; i < height; i++) {
-            memcpy(dst + (i * width), frame->data[0] + (i * frame->linesize[0]), width);
+bool H264Decoder::queue_region_commands(const PackedByteArray& commands) {
+    if (!RetainedFrame::parse_commands(commands.ptr(), commands.size(), pending_region_commands)) {
+        UtilityFunctions::printerr("[H264Decoder] Malformed region command payload");
+        return false;
+    }
+    return true;
+}
+
+PackedInt32Array H264Decoder::get_dirty_rects() const {
+    PackedInt32Array result;
+    if (!retained_mode) {
+        return result;
+    }
+    const std::vector<RegionRect>& rects = retained.get_dirty_rects();
+    result.resize(rects.size() * 4);
+    int32_t* dst = result.ptrw();
+    for (const RegionRect& r : rects) {
+        *dst++ = r.x;
+        *dst++ = r.y;
+        *dst++ = r.w;
+        *dst++ = r.h;
+    }
+    return result;
+}
+
+void H264Decoder::set_tile_cache_budget(int64_t bytes) {
+    tile_cache.set_budget(bytes > 0 ? (size_t)bytes : 0);
+}
+
+Dictionary H264Decoder::take_tile_cache_events() {
+    std::vector<uint64_t> added;
+    std::vector<uint64_t> evicted;
+    std::vector<uint64_t> missed;
+    tile_cache.take_events(added, evicted, missed);
+
+    auto to_packed = [](const std::vector<uint64_t>& ids) {
+        PackedInt64Array result;
+        result.resize(ids.size());
+        int64_t* dst = result.ptrw();
+        for (size_t i = 0; i < ids.size(); i++) {
+            dst[i] = (int64_t)ids[i];
         }
+        return result;
+    };
+
+    Dictionary events;
+    events["added"] = to_packed(added);
+    events["evicted"] = to_packed(evicted);
+    events["missed"] = to_packed(missed);
+    return events;
+}
+
+void H264Decoder::set_retained_mode(bool enabled) {
+    retained_mode = enabled;
+    if (!enabled) {
+        retained.clear();
+        pending_region_commands.clear();
     }
+}
+
+void H264Decoder::repack_planes(const AVFrame* src, uint8_t* y_dst, uint8_t* uv_dst) {
+    auto repack_start = std::chrono::steady_clock::now();
+    int width = src->width;
+    int height = src->height;
 
-    // 2. Determine Invalidity (Green Screen check)
+    int uv_width = width / 2;
+    int uv_height = height / 2;
+    int uv_size = uv_width * uv_height;
+
+    // 1. Determine Invalidity (Green Screen check)
     // If planes are missing OR all zeros, we must force Grey.
-    bool u_missing = !frame->data[1];
-    bool v_missing = !frame->data[2] && (frame->format != AV_PIX_FMT_NV12 && frame->format != AV_PIX_FMT_NV21);
+    bool u_missing = !src->data[1];
+    bool v_missing = !src->data[2] && (src->format != AV_PIX_FMT_NV12 && src->format != AV_PIX_FMT_NV21);
     
     bool u_invalid = false;
     bool v_invalid = false;
@@ -233,69 +705,128 @@ PackedByteArray H264Decoder::decode_frame(const PackedByteArray& h264_data) {
     if (!u_missing) {
         // Validation: Check multiple points. Only if ALL are 0 do we assume it's uninitialized.
         // This prevents false positives on dark pixels.
-        u_invalid = (frame->data[1][0] == 0 && 
-                     frame->data[1][uv_width/2] == 0 && 
-                     frame->data[1][uv_width-1] == 0 &&
-                     frame->data[1][uv_size/4] == 0 &&
-                     frame->data[1][uv_size/2] == 0 &&
-                     frame->data[1][uv_size-1] == 0);
-    }
-    if (!v_missing && frame->data[2]) {
-        v_invalid = (frame->data[2][0] == 0 && 
-                     frame->data[2][uv_width/2] == 0 && 
-                     frame->data[2][uv_width-1] == 0 &&
-                     frame->data[2][uv_size/4] == 0 &&
-                     frame->data[2][uv_size/2] == 0 &&
-                     frame->data[2][uv_size-1] == 0);
-    }
-
-    // 3. NUCLEAR ACTION: Pre-fill UV with Grey if anything is fishy
+        u_invalid = (src->data[1][0] == 0 && 
+                     src->data[1][uv_width/2] == 0 && 
+                     src->data[1][uv_width-1] == 0 &&
+                     src->data[1][uv_size/4] == 0 &&
+                     src->data[1][uv_size/2] == 0 &&
+                     src->data[1][uv_size-1] == 0);
+    }
+    if (!v_missing && src->data[2]) {
+        v_invalid = (src->data[2][0] == 0 && 
+                     src->data[2][uv_width/2] == 0 && 
+                     src->data[2][uv_width-1] == 0 &&
+                     src->data[2][uv_size/4] == 0 &&
+                     src->data[2][uv_size/2] == 0 &&
+                     src->data[2][uv_size-1] == 0);
+    }
+
+    RepackJob job;
+    job.src = src;
+    job.width = width;
+    job.height = height;
+    job.y_dst = y_dst;
+    job.uv_dst = uv_dst;
     // We use || because if either color channel is dead, the image is distorted.
-    if (u_missing || v_missing || u_invalid || v_invalid) {
-         memset(uv_dst_start, 128, uv_size * 2);
+    job.fill_grey = u_missing || v_missing || u_invalid || v_invalid;
+    job.u_missing = u_missing;
+    job.v_missing = v_missing;
+    job.streaming = streaming_stores && (size_t)(width * height + uv_size * 2) >= STREAMING_MIN_BYTES;
+
+    bool known_format = src->format == AV_PIX_FMT_YUV420P || src->format == AV_PIX_FMT_YUVJ420P ||
+                        src->format == AV_PIX_FMT_NV12 || src->format == AV_PIX_FMT_NV21 ||
+                        src->format == AV_PIX_FMT_YUV422P || src->format == AV_PIX_FMT_YUVJ422P;
+    if (!known_format) {
+        static int warn_count = 0;
+        if (warn_count++ % 100 == 0) {
+             UtilityFunctions::printerr("[H264Decoder] Unknown frame format: ", (int)src->format);
+        }
     }
 
-    // 4. Coping based on format
-    if (frame->format == AV_PIX_FMT_YUV420P || frame->format == AV_PIX_FMT_YUVJ420P) {
-        if (!u_missing && !v_missing) {
-            for (int i = 0; i < uv_height; i++) {
-                uint8_t* row_dst = uv_dst_start + (i * width);
-                memcpy(row_dst, frame->data[1] + (i * frame->linesize[1]), uv_width);
-                memcpy(row_dst + uv_width, frame->data[2] + (i * frame->linesize[2]), uv_width);
-            }
+    // 2. Split into row bands. Each band owns a run of chroma rows plus the
+    // matching pairs of luma rows; the last band also picks up an odd luma row.
+    WorkerPool& pool = WorkerPool::get_shared();
+    int bands = repack_threads > 0 ? repack_threads : pool.get_thread_count() + 1;
+    int max_bands = uv_height / REPACK_MIN_BAND_ROWS;
+    if (bands > max_bands) {
+        bands = max_bands;
+    }
+    if (bands < 1) {
+        bands = 1;
+    }
+
+    pool.parallel_for(bands, [this, &job, bands, uv_height](int band) {
+        int uv_begin = (int)((int64_t)uv_height * band / bands);
+        int uv_end = (int)((int64_t)uv_height * (band + 1) / bands);
+        int y_begin = uv_begin * 2;
+        int y_end = (band == bands - 1) ? job.height : uv_end * 2;
+        repack_band(job, y_begin, y_end, uv_begin, uv_end);
+    });
+
+    last_repack_usec = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - repack_start).count();
+    last_repack_bands = bands;
+    last_repack_streaming = job.streaming;
+}
+
+void H264Decoder::repack_band(const RepackJob& job, int y_begin, int y_end, int uv_begin, int uv_end) {
+    const AVFrame* src = job.src;
+    int width = job.width;
+    int uv_width = width / 2;
+    int uv_rows = uv_end - uv_begin;
+
+    // 3. Copy Y Plane (Plane 0 is always Y)
+    if (src->data[0]) {
+        repack_copy_rows(job.y_dst + (size_t)y_begin * width, width,
+                         src->data[0] + (size_t)y_begin * src->linesize[0], src->linesize[0],
+                         width, y_end - y_begin, job.streaming);
+    }
+
+    uint8_t* uv_dst_start = job.uv_dst + (size_t)uv_begin * width;
+
+    // 4. NUCLEAR ACTION: Pre-fill UV with Grey if anything is fishy
+    if (job.fill_grey) {
+        size_t fill_size = (size_t)uv_width * 2 * uv_rows;
+        if (job.streaming) {
+            repack_fill_streaming(uv_dst_start, 128, fill_size);
+        } else {
+            memset(uv_dst_start, 128, fill_size);
+        }
+    }
+
+    // 5. Coping based on format
+    if (src->format == AV_PIX_FMT_YUV420P || src->format == AV_PIX_FMT_YUVJ420P) {
+        if (!job.u_missing && !job.v_missing) {
+            repack_copy_rows(uv_dst_start, width,
+                             src->data[1] + (size_t)uv_begin * src->linesize[1], src->linesize[1],
+                             uv_width, uv_rows, job.streaming);
+            repack_copy_rows(uv_dst_start + uv_width, width,
+                             src->data[2] + (size_t)uv_begin * src->linesize[2], src->linesize[2],
+                             uv_width, uv_rows, job.streaming);
         }
     } 
-    else if (frame->format == AV_PIX_FMT_NV12 || frame->format == AV_PIX_FMT_NV21) {
-        if (!u_missing) {
-            bool is_nv12 = (frame->format == AV_PIX_FMT_NV12);
-            for (int i = 0; i < uv_height; i++) {
-                uint8_t* row_dst = uv_dst_start + (i * width);
-                uint8_t* uv_src_row = frame->data[1] + (i * frame->linesize[1]);
-                for (int x = 0; x < uv_width; x++) {
-                    row_dst[x] = is_nv12 ? uv_src_row[x * 2] : uv_src_row[x * 2 + 1];
-                    row_dst[uv_width + x] = is_nv12 ? uv_src_row[x * 2 + 1] : uv_src_row[x * 2];
-                }
-            }
+    else if (src->format == AV_PIX_FMT_NV12 || src->format == AV_PIX_FMT_NV21) {
+        if (!job.u_missing) {
+            repack_deinterleave_rows(uv_dst_start, width,
+                                     src->data[1] + (size_t)uv_begin * src->linesize[1], src->linesize[1],
+                                     uv_width, uv_rows, src->format == AV_PIX_FMT_NV21);
         }
     }
-    else if (frame->format == AV_PIX_FMT_YUV422P || frame->format == AV_PIX_FMT_YUVJ422P) {
+    else if (src->format == AV_PIX_FMT_YUV422P || src->format == AV_PIX_FMT_YUVJ422P) {
         // Sample every other row for 420 conversion
-        if (!u_missing && !v_missing) {
-            for (int i = 0; i < uv_height; i++) {
-                uint8_t* row_dst = uv_dst_start + (i * width);
-                memcpy(row_dst, frame->data[1] + (i * 2 * frame->linesize[1]), uv_width);
-                memcpy(row_dst + uv_width, frame->data[2] + (i * 2 * frame->linesize[2]), uv_width);
-            }
-        }
-    }
-    else {
-        static int warn_count = 0;
-        if (warn_count++ % 100 == 0) {
-             UtilityFunctions::printerr("[H264Decoder] Unknown frame format: ", (int)frame->format);
+        if (!job.u_missing && !job.v_missing) {
+            repack_copy_rows(uv_dst_start, width,
+                             src->data[1] + (size_t)uv_begin * 2 * src->linesize[1], src->linesize[1] * 2,
+                             uv_width, uv_rows, job.streaming);
+            repack_copy_rows(uv_dst_start + uv_width, width,
+                             src->data[2] + (size_t)uv_begin * 2 * src->linesize[2], src->linesize[2] * 2,
+                             uv_width, uv_rows, job.streaming);
         }
     }
 
-    return result;
+    if (job.streaming) {
+        repack_stream_fence();
+    }
 }
 
 PackedVector2Array H264Decoder::decode_audio(const PackedByteArray& adpcm_data) {
@@ -319,62 +850,654 @@ PackedVector2Array H264Decoder::decode_audio(const PackedByteArray& adpcm_data)
 }
 
 float H264Decoder::decode_sample_ima(uint8_t nibble, int& predicted, int& index) {
-    int step = IMA_STEP_TABLE[index];
-    
-    // Calculate difference
-    int diff = step >> 3;
-    if (nibble & 4) diff += step;
-    if (nibble & 2) diff += step >> 1;
-    if (nibble & 1) diff += step >> 2;
+    // Return normalized float (-1.0 to 1.0)
+    return (float)adpcm_decode_nibble(nibble, predicted, index) / 32768.0f;
+}
 
-    // Update predictor
-    if (nibble & 8) predicted -= diff;
-    else predicted += diff;
+Dictionary H264Decoder::get_stats() const {
+    Dictionary stats;
+    stats["width"] = width;
+    stats["height"] = height;
+    stats["repack_usec"] = last_repack_usec;
+    stats["repack_bands"] = last_repack_bands;
+    stats["repack_streaming"] = last_repack_streaming;
+    stats["output_format"] = (int)output_format;
+    stats["convert_usec"] = last_convert_usec;
+    stats["batch_packets"] = last_batch_packets;
+    stats["batch_usec"] = last_batch_usec;
+    stats["extrapolation_enabled"] = extrapolation_enabled;
+    stats["extrapolation_usec"] = extrapolator.get_last_synth_usec();
+    stats["frames_extrapolated"] = extrapolator.get_frames_predicted();
+    stats["extrapolated_frames_shown"] = extrapolator.get_frames_taken();
+    stats["extrapolation_overruns"] = extrapolator.get_budget_overruns();
+    stats["retained_mode"] = retained_mode;
+    stats["region_commands"] = last_region_commands;
+    stats["tile_cache_hits"] = tile_cache.get_hits();
+    stats["tile_cache_misses"] = tile_cache.get_misses();
+    stats["tile_cache_hit_ratio"] = tile_cache.get_hit_ratio();
+    stats["tile_cache_entries"] = (int64_t)tile_cache.get_entry_count();
+    stats["tile_cache_used_bytes"] = (int64_t)tile_cache.get_used_bytes();
+    stats["tile_cache_budget_bytes"] = (int64_t)tile_cache.get_budget();
+    stats["memory_bytes"] = accounted_bytes;
+    stats["memory_pressure"] = (int)memory_pressure;
+    stats["memory_budget_actions"] = budget_actions;
+    int64_t decode_max = 0;
+    double decode_mean = 0.0;
+    double decode_var = 0.0;
+    for (int i = 0; i < decode_time_count; i++) {
+        decode_mean += (double)decode_time_history[i];
+        decode_max = std::max(decode_max, decode_time_history[i]);
+    }
+    if (decode_time_count > 0) {
+        decode_mean /= decode_time_count;
+        for (int i = 0; i < decode_time_count; i++) {
+            double d = (double)decode_time_history[i] - decode_mean;
+            decode_var += d * d;
+        }
+        decode_var /= decode_time_count;
+    }
+    stats["decode_usec"] = last_decode_usec;
+    stats["decode_usec_mean"] = decode_mean;
+    stats["decode_usec_stddev"] = std::sqrt(decode_var);
+    stats["decode_usec_max"] = decode_max;
+    stats["codec_thread_count"] = (int)codec_thread_tracker.get_thread_ids().size();
+    stats["threads_placed"] = threads_placed;
+    stats["thread_priority_applied"] = (int)priority_applied;
+    stats["analytics_enabled"] = analytics_enabled;
+    stats["analytics_usec"] = analytics.get_last_cost_usec();
+    // Scan cost plus libavcodec's export cost, against decoding without
+    // export; until a probe frame has been measured only the scan counts
+    double export_usec = 0.0;
+    double baseline_usec = decode_mean;
+    if (export_on_samples > 0 && export_off_samples > 0) {
+        export_usec = std::max(0.0, export_on_usec - export_off_usec);
+        baseline_usec = export_off_usec;
+    }
+    stats["analytics_export_usec"] = export_usec;
+    stats["analytics_export_samples"] = export_off_samples;
+    stats["analytics_cost_ratio"] = baseline_usec > 0.0 ? (analytics.get_avg_cost_usec() + export_usec) / baseline_usec : 0.0;
+    stats["watchdog_level"] = (int)stall_level;
+    stats["watchdog_flushes"] = watchdog_flushes;
+    stats["watchdog_reopens"] = watchdog_reopens;
+    stats["watchdog_fallbacks"] = watchdog_fallbacks;
+    stats["software_fallback"] = software_fallback;
+    stats["frozen_msec_total"] = frozen_usec_total / 1000;
+    stats["longest_freeze_msec"] = longest_freeze_usec / 1000;
+    stats["refresh_state"] = (int)refresh.get_state();
+    stats["refresh_progress"] = refresh.get_progress();
+    stats["refresh_gating"] = refresh_gating;
+    stats["recovery_points"] = refresh.get_recovery_points();
+    stats["frames_gated"] = frames_gated;
+    stats["time_to_clean_msec"] = refresh.get_last_time_to_clean_usec() / 1000;
+    stats["longest_time_to_clean_msec"] = refresh.get_longest_time_to_clean_usec() / 1000;
+    stats["latency_probe_enabled"] = latency_probe_enabled;
+    stats["latency_decoded_usec"] = latency_probe.get_last_usec(LatencyProbe::STAGE_DECODED);
+    stats["latency_presented_usec"] = latency_probe.get_last_usec(LatencyProbe::STAGE_PRESENTED);
+    stats["latency_decoded_avg_usec"] = latency_probe.get_average_usec(LatencyProbe::STAGE_DECODED);
+    stats["latency_presented_avg_usec"] = latency_probe.get_average_usec(LatencyProbe::STAGE_PRESENTED);
+    stats["latency_presented_max_usec"] = latency_probe.get_max_usec(LatencyProbe::STAGE_PRESENTED);
+    stats["latency_markers_found"] = latency_probe.get_found(LatencyProbe::STAGE_DECODED);
+    stats["latency_markers_missed"] = latency_probe.get_missed(LatencyProbe::STAGE_DECODED);
+    return stats;
+}
 
-    // Clamp predictor to 16-bit PCM range
-    if (predicted > 32767) predicted = 32767;
-    else if (predicted < -32768) predicted = -32768;
+int64_t H264Decoder::compute_memory_usage() const {
+    return (int64_t)(frame_buffers.get_bytes() + retained.get_memory_usage() +
+                     tile_cache.get_memory_usage() + extrapolator.get_memory_usage()) +
+           packet_buffer_bytes + output_buffer_bytes;
+}
+
+bool H264Decoder::is_sync_point(const uint8_t* data, size_t size) {
+    sync_units.clear();
+    parse_nal_units(data, size, sync_units);
+    for (const NalUnit& nal : sync_units) {
+        RecoveryPoint point;
+        if (nal.type == NAL_IDR || (nal.type == NAL_SEI && parse_recovery_point(nal, point))) {
+            return true;
+        }
+    }
+    return false;
+}
 
-    // Update index
-    index += IMA_INDEX_TABLE[nibble];
-    if (index < 0) index = 0;
-    else if (index > 88) index = 88;
+Dictionary H264Decoder::get_memory_usage() const {
+    Dictionary usage;
+    usage["frame_buffers"] = (int64_t)frame_buffers.get_bytes();
+    usage["frame_buffer_count"] = frame_buffers.get_count();
+    usage["retained_frame"] = (int64_t)retained.get_memory_usage();
+    usage["tile_cache"] = (int64_t)tile_cache.get_memory_usage();
+    usage["extrapolator"] = (int64_t)extrapolator.get_memory_usage();
+    usage["packet_buffer"] = packet_buffer_bytes;
+    usage["output_buffer"] = output_buffer_bytes;
+    usage["codec_threads"] = codec_ctx ? codec_ctx->thread_count : 0;
+    usage["codec_thread_limit"] = budget_codec_threads;
+    usage["total"] = compute_memory_usage();
+    usage["budget"] = memory_budget;
+    usage["global_total"] = MemoryAccounting::get_usage();
+    usage["global_peak"] = MemoryAccounting::get_peak();
+    usage["global_budget"] = MemoryAccounting::get_budget();
+    usage["instances"] = MemoryAccounting::get_instance_count();
+    return usage;
+}
 
-    // Return normalized float (-1.0 to 1.0)
-    return (float)predicted / 32768.0f;
+void H264Decoder::update_memory_accounting() {
+    int64_t total = compute_memory_usage();
+    double pressure = 0.0;
+    int64_t budget = 0;
+    int64_t usage = 0;
+    if (global_accounting) {
+        MemoryAccounting::add(total - accounted_bytes);
+        accounted_bytes = total;
+        pressure = MemoryAccounting::get_pressure();
+        budget = MemoryAccounting::get_budget();
+        usage = MemoryAccounting::get_usage();
+    }
+    if (memory_budget > 0 && (double)total / (double)memory_budget > pressure) {
+        pressure = (double)total / (double)memory_budget;
+        budget = memory_budget;
+        usage = total;
+    }
+
+    MemoryPressure level = MEMORY_PRESSURE_NONE;
+    if (pressure > 1.0) {
+        level = MEMORY_PRESSURE_CRITICAL;
+    } else if (pressure > 0.9) {
+        level = MEMORY_PRESSURE_HIGH;
+    }
+    if (level != memory_pressure) {
+        memory_pressure = level;
+        emit_signal("memory_pressure", (int)level, usage, budget);
+    }
+    if (level == MEMORY_PRESSURE_CRITICAL) {
+        enforce_memory_budget();
+    } else if (level == MEMORY_PRESSURE_NONE && budget_codec_threads > 0) {
+        relax_memory_budget();
+    }
+}
+
+void H264Decoder::set_global_accounting(bool enabled) {
+    global_accounting = enabled;
+    if (!enabled) {
+        MemoryAccounting::add(-accounted_bytes);
+        accounted_bytes = 0;
+    }
+}
+
+void H264Decoder::enforce_memory_budget() {
+    // One step per frame; the next frame re-measures before shedding more
+    size_t cache_budget = tile_cache.get_budget();
+    if (cache_budget > 0) {
+        size_t shrunk = cache_budget / 2 >= TileCache::TILE_BYTES * 16 ? cache_budget / 2 : 0;
+        tile_cache.set_budget(shrunk);
+        UtilityFunctions::print("[H264Decoder] Over memory budget: tile cache ", (int64_t)cache_budget, " -> ", (int64_t)shrunk, " bytes");
+    } else if (extrapolation_enabled) {
+        set_extrapolation_enabled(false);
+        extrapolator.release_memory();
+        UtilityFunctions::print("[H264Decoder] Over memory budget: extrapolation disabled");
+    } else if (budget_codec_threads != 1 || (codec_ctx && codec_ctx->thread_count > 1 && !reopen_at_sync_point)) {
+        // Fewer slice threads means fewer per-thread contexts. Swapping the
+        // context mid-GOP would drop references, so wait for a sync point.
+        // codec_threads keeps the user's setting for when pressure eases.
+        budget_codec_threads = 1;
+        reopen_at_sync_point = codec_ctx && codec_ctx->thread_count > 1;
+        UtilityFunctions::print("[H264Decoder] Over memory budget: codec threads limited to 1",
+            reopen_at_sync_point ? ", reopening at the next IDR or recovery point" : "");
+    } else {
+        return;
+    }
+    budget_actions++;
+}
+
+void H264Decoder::relax_memory_budget() {
+    // Only the thread limit comes back; the tile cache and extrapolation
+    // stay as the script left them after a budget action
+    budget_codec_threads = 0;
+    reopen_at_sync_point = codec_ctx && codec_ctx->thread_count == 1 && codec_threads != 1;
+    UtilityFunctions::print("[H264Decoder] Memory pressure eased: codec threads back to ",
+        codec_threads == 0 ? String("auto") : String::num_int64(codec_threads),
+        reopen_at_sync_point ? ", reopening at the next IDR or recovery point" : "");
+}
+
+int H264Decoder::get_effective_codec_threads() const {
+    if (budget_codec_threads > 0 && (codec_threads == 0 || codec_threads > budget_codec_threads)) {
+        return budget_codec_threads;
+    }
+    return codec_threads;
+}
+
+void H264Decoder::set_watchdog_enabled(bool enabled) {
+    watchdog_enabled = enabled;
+    reset_watchdog();
+}
+
+void H264Decoder::reset_watchdog() {
+    stall_level = WATCHDOG_NONE;
+    stall_start_usec = 0;
+    last_escalation_usec = 0;
+    last_input_usec = 0;
+}
+
+void H264Decoder::on_frame_output(int64_t now_usec) {
+    if (stall_level != WATCHDOG_NONE) {
+        int64_t frozen = now_usec - stall_start_usec;
+        frozen_usec_total += frozen;
+        if (frozen > longest_freeze_usec) {
+            longest_freeze_usec = frozen;
+        }
+        UtilityFunctions::print("[H264Decoder] Recovered from stall after ", frozen / 1000, " ms");
+        emit_signal("decoder_recovered", (int)stall_level, frozen / 1000);
+    }
+    stall_level = WATCHDOG_NONE;
+    stall_start_usec = 0;
+}
+
+bool H264Decoder::check_watchdog(int64_t now_usec) {
+    // Until SPS/PPS have gone in, a silent decoder is just waiting for them
+    if (!watchdog_enabled || !parameter_sets.has_parameter_sets()) {
+        return false;
+    }
+    // Same while an intra refresh is under way: the software decoder holds
+    // back pictures until the recovery point's frame
+    if (refresh.is_refreshing()) {
+        stall_start_usec = now_usec;
+        return false;
+    }
+
+    // A gap in the input is the stream pausing, not the decoder stalling
+    int64_t timeout_usec = (int64_t)stall_timeout_msec * 1000;
+    if (stall_start_usec == 0 || (stall_level == WATCHDOG_NONE && now_usec - last_input_usec > timeout_usec)) {
+        stall_start_usec = now_usec;
+        return false;
+    }
+
+    int64_t since = stall_level == WATCHDOG_NONE ? stall_start_usec : last_escalation_usec;
+    if (now_usec - since < timeout_usec) {
+        return false;
+    }
+
+    if (stall_level < WATCHDOG_SOFTWARE) {
+        stall_level = (WatchdogLevel)(stall_level + 1);
+    }
+    WatchdogLevel level = stall_level;
+    last_escalation_usec = now_usec;
+    int64_t stalled_msec = (now_usec - stall_start_usec) / 1000;
+
+    bool reopened = false;
+    switch (level) {
+        case WATCHDOG_FLUSH:
+            UtilityFunctions::printerr("[H264Decoder] No output for ", stalled_msec, " ms, flushing decoder");
+            avcodec_flush_buffers(codec_ctx);
+            refresh.reset();
+            watchdog_flushes++;
+            break;
+        case WATCHDOG_REOPEN:
+            UtilityFunctions::printerr("[H264Decoder] Still stalled after flush, reopening codec");
+            reopened = reopen_codec(software_decoder_only || software_fallback);
+            watchdog_reopens++;
+            break;
+        default:
+            // Later timeouts keep reopening the software decoder
+            if (!software_fallback) {
+                UtilityFunctions::printerr("[H264Decoder] Still stalled after reopen, falling back to software decoding");
+                software_fallback = true;
+                watchdog_fallbacks++;
+            } else {
+                watchdog_reopens++;
+            }
+            reopened = reopen_codec(true);
+            break;
+    }
+
+    // Pictures in flight are gone either way; an IDR from the server is the
+    // fastest way out
+    retained.clear();
+    extrapolator.clear();
+    emit_signal("decoder_stalled", (int)level, stalled_msec);
+    return reopened;
+}
+
+bool H264Decoder::reopen_codec(bool software_only) {
+    if (codec_ctx) {
+        codec_thread_tracker.detach();
+        avcodec_free_context(&codec_ctx);
+        codec_ctx = nullptr;
+    }
+    if (!open_codec(software_only) && (software_only || !open_codec(true))) {
+        // Leave the instance for auto-initialize to rebuild on the next packet
+        UtilityFunctions::printerr("[H264Decoder] Reopen failed");
+        cleanup();
+        return false;
+    }
+
+    refresh.reset();
+
+    // Parameter sets only arrive with keyframes; without them the new
+    // context would drop everything up to the next SPS
+    if (parameter_sets.has_parameter_sets()) {
+        std::vector<uint8_t> headers = parameter_sets.build_annex_b();
+        packet->data = headers.data();
+        packet->size = (int)headers.size();
+        avcodec_send_packet(codec_ctx, packet);
+        packet->data = nullptr;
+        packet->size = 0;
+    }
+    return true;
+}
+
+ThreadPolicy H264Decoder::get_effective_thread_policy() const {
+    ThreadPolicy policy = thread_policy;
+    if (policy.cpus.empty() && fast_cores_only) {
+        policy.cpus = thread_policy_fast_cores();
+    }
+    return policy;
+}
+
+bool H264Decoder::has_thread_policy() const {
+    return !thread_policy.cpus.empty() || fast_cores_only || thread_policy.priority != ThreadPolicy::PRIORITY_NORMAL;
+}
+
+void H264Decoder::apply_thread_policy() {
+    ThreadPolicy policy = get_effective_thread_policy();
+    codec_thread_tracker.set_policy(policy, has_thread_policy());
+    // Only this decoder's own slice threads; the shared pool is placed
+    // process-wide with set_worker_pool_thread_policy
+    std::vector<int64_t> targets = codec_thread_tracker.get_thread_ids();
+
+    // Report the weakest priority any thread ended up with
+    threads_placed = 0;
+    priority_applied = policy.priority;
+    for (int64_t id : targets) {
+        ThreadPolicyResult result = thread_policy_apply(policy, id);
+        threads_placed += result.affinity_applied || result.priority_applied != ThreadPolicy::PRIORITY_NORMAL;
+        priority_applied = std::min(priority_applied, result.priority_applied);
+    }
+    if (targets.empty()) {
+        priority_applied = ThreadPolicy::PRIORITY_NORMAL;
+    }
+    if (priority_applied != policy.priority) {
+        UtilityFunctions::print("[H264Decoder] Thread priority ", (int)policy.priority,
+            " not permitted, using ", (int)priority_applied);
+    }
+}
+
+void H264Decoder::set_thread_cpus(const PackedInt32Array& cpus) {
+    thread_policy.cpus.assign(cpus.ptr(), cpus.ptr() + cpus.size());
+    apply_thread_policy();
+}
+
+PackedInt32Array H264Decoder::get_thread_cpus() const {
+    PackedInt32Array result;
+    for (int cpu : thread_policy.cpus) {
+        result.push_back(cpu);
+    }
+    return result;
+}
+
+void H264Decoder::set_fast_cores_only(bool enabled) {
+    fast_cores_only = enabled;
+    apply_thread_policy();
+}
+
+void H264Decoder::set_thread_priority(ThreadPriority priority) {
+    thread_policy.priority = (ThreadPolicy::Priority)priority;
+    apply_thread_policy();
+}
+
+bool H264Decoder::apply_thread_policy_to_current_thread() {
+    ThreadPolicy policy = get_effective_thread_policy();
+    ThreadPolicyResult result = thread_policy_apply(policy, 0);
+    return result.priority_applied == policy.priority && (policy.cpus.empty() || result.affinity_applied);
+}
+
+int H264Decoder::set_worker_pool_thread_policy(const PackedInt32Array& cpus, ThreadPriority priority) {
+    ThreadPolicy policy;
+    policy.cpus.assign(cpus.ptr(), cpus.ptr() + cpus.size());
+    policy.priority = (ThreadPolicy::Priority)priority;
+    return WorkerPool::get_shared().set_thread_policy(policy);
+}
+
+PackedInt32Array H264Decoder::get_fast_cores() {
+    PackedInt32Array result;
+    for (int cpu : thread_policy_fast_cores()) {
+        result.push_back(cpu);
+    }
+    return result;
+}
+
+void H264Decoder::update_export_side_data() {
+    if (!codec_ctx) {
+        return;
+    }
+    // Read per frame by libavcodec, so this works on an open decoder too.
+    // Only the software decoder exports these; hardware paths ignore them.
+    int flags = codec_ctx->export_side_data & ~(AV_CODEC_EXPORT_DATA_MVS | AV_CODEC_EXPORT_DATA_VIDEO_ENC_PARAMS);
+    if (extrapolation_enabled || analytics_enabled) {
+        flags |= AV_CODEC_EXPORT_DATA_MVS;
+    }
+    if (analytics_enabled && !export_probe) {
+        flags |= AV_CODEC_EXPORT_DATA_VIDEO_ENC_PARAMS;
+    }
+    if (export_probe && !extrapolation_enabled) {
+        flags &= ~AV_CODEC_EXPORT_DATA_MVS;
+    }
+    codec_ctx->export_side_data = flags;
+}
+
+void H264Decoder::record_export_sample(int64_t decode_usec) {
+    // Running mean over the last EXPORT_PROBE_SAMPLES samples of each kind.
+    // With frame threads the packet that changed the flags may not be the
+    // one whose frame came out, but the probe packets still carry the
+    // cheaper decode, so the means converge all the same.
+    double& mean = export_probe ? export_off_usec : export_on_usec;
+    int& samples = export_probe ? export_off_samples : export_on_samples;
+    if (samples < EXPORT_PROBE_SAMPLES) {
+        samples++;
+    }
+    mean += ((double)decode_usec - mean) / samples;
+}
+
+void H264Decoder::reset_export_probe() {
+    export_probe = false;
+    export_probe_counter = 0;
+    export_on_usec = 0.0;
+    export_off_usec = 0.0;
+    export_on_samples = 0;
+    export_off_samples = 0;
+}
+
+void H264Decoder::set_extrapolation_enabled(bool enabled) {
+    extrapolation_enabled = enabled;
+    update_export_side_data();
+    if (!enabled) {
+        extrapolator.clear();
+    }
+}
+
+void H264Decoder::set_analytics_enabled(bool enabled) {
+    analytics_enabled = enabled;
+    reset_export_probe();
+    update_export_side_data();
+    if (!enabled) {
+        analytics.clear();
+    }
+}
+
+void H264Decoder::set_latency_probe_enabled(bool enabled) {
+    latency_probe_enabled = enabled;
+    latency_probe.clear();
+}
+
+bool H264Decoder::probe_presented() {
+    const AVFrame* src = get_current_frame();
+    if (!src || !src->data[0]) {
+        return false;
+    }
+    return probe_presented_plane(src->data[0], src->linesize[0], src->width, src->height);
+}
+
+bool H264Decoder::probe_presented_plane(const uint8_t* luma, int stride, int width, int height) {
+    if (!latency_probe_enabled) {
+        return false;
+    }
+    int64_t latency_usec = 0;
+    if (!latency_probe.sample(LatencyProbe::STAGE_PRESENTED, luma, stride, width, height, latency_usec)) {
+        return false;
+    }
+    // Both stages saw the same marker: report the frame's path end to end
+    int sequence = latency_probe.get_last_sequence(LatencyProbe::STAGE_PRESENTED);
+    if (sequence == latency_probe.get_last_sequence(LatencyProbe::STAGE_DECODED)) {
+        emit_signal("latency_measured", sequence,
+                    latency_probe.get_last_usec(LatencyProbe::STAGE_DECODED) / 1000.0,
+                    latency_usec / 1000.0);
+    }
+    return true;
+}
+
+Dictionary H264Decoder::get_frame_analytics() const {
+    const FrameAnalytics& f = analytics.get_last_frame();
+    Dictionary nal_bytes;
+    for (int n = 0; n < NAL_CATEGORY_COUNT; n++) {
+        nal_bytes[NAL_CATEGORY_NAMES[n]] = f.nal_bytes[n];
+    }
+
+    auto to_packed = [](const std::vector<float>& values) {
+        PackedFloat32Array result;
+        result.resize(values.size());
+        for (size_t i = 0; i < values.size(); i++) {
+            result.set(i, values[i]);
+        }
+        return result;
+    };
+
+    Dictionary result;
+    result["bytes"] = f.total_bytes;
+    result["nal_bytes"] = nal_bytes;
+    result["slices"] = f.slices;
+    result["picture_type"] = String::chr(f.picture_type);
+    result["has_qp"] = f.has_qp;
+    result["avg_qp"] = f.avg_qp;
+    result["max_qp"] = f.max_qp;
+    result["has_motion"] = f.has_motion;
+    result["skip_ratio"] = f.skip_ratio;
+    result["grid_size"] = Vector2i(BitstreamAnalytics::GRID_WIDTH, BitstreamAnalytics::GRID_HEIGHT);
+    result["region_qp"] = to_packed(f.region_qp);
+    result["region_motion"] = to_packed(f.region_motion);
+    result["cost_usec"] = f.cost_usec;
+    return result;
+}
+
+Dictionary H264Decoder::get_analytics_summary() const {
+    BitstreamAnalytics::Summary summary = analytics.get_summary();
+    Dictionary nal_bytes;
+    for (int n = 0; n < NAL_CATEGORY_COUNT; n++) {
+        nal_bytes[NAL_CATEGORY_NAMES[n]] = summary.avg_nal_bytes[n];
+    }
+
+    PackedFloat32Array region_qp;
+    PackedFloat32Array region_motion;
+    for (size_t i = 0; i < summary.region_qp.size(); i++) {
+        region_qp.push_back(summary.region_qp[i]);
+        region_motion.push_back(summary.region_motion[i]);
+    }
+
+    Dictionary result;
+    result["frames"] = summary.frames;
+    result["avg_frame_bytes"] = summary.avg_frame_bytes;
+    result["avg_nal_bytes"] = nal_bytes;
+    result["avg_slices"] = summary.avg_slices;
+    result["avg_qp"] = summary.avg_qp;
+    result["max_qp"] = summary.max_qp;
+    result["skip_ratio"] = summary.skip_ratio;
+    result["keyframe_ratio"] = summary.keyframe_ratio;
+    result["grid_size"] = Vector2i(BitstreamAnalytics::GRID_WIDTH, BitstreamAnalytics::GRID_HEIGHT);
+    result["region_qp"] = region_qp;
+    result["region_motion"] = region_motion;
+    result["avg_cost_usec"] = analytics.get_avg_cost_usec();
+    result["export_usec"] = export_on_samples > 0 && export_off_samples > 0 ? std::max(0.0, export_on_usec - export_off_usec) : 0.0;
+    return result;
+}
+
+PackedByteArray H264Decoder::serialize_analytics_summary() const {
+    std::vector<uint8_t> bytes = analytics.serialize_summary();
+    PackedByteArray result;
+    result.resize(bytes.size());
+    memcpy(result.ptrw(), bytes.data(), bytes.size());
+    return result;
+}
+
+PackedByteArray H264Decoder::get_extrapolated_frame() {
+    PackedByteArray result;
+    if (!extrapolation_enabled || width <= 0 || height <= 0) {
+        return result;
+    }
+
+    int y_size = width * height;
+    result.resize(y_size + width * (height / 2));
+    uint8_t* dst = result.ptrw();
+    if (!extrapolator.take_prediction(dst, dst + y_size, width, height)) {
+        result.clear();
+    }
+    return result;
+}
+
+bool H264Decoder::take_extrapolated_planes(uint8_t* y_dst, uint8_t* uv_dst) {
+    return extrapolation_enabled && extrapolator.take_prediction(y_dst, uv_dst, width, height);
 }
 
 void H264Decoder::reset() {
     if (codec_ctx) {
         avcodec_flush_buffers(codec_ctx);
     }
+    extrapolator.clear();
+    retained.clear();
+    pending_region_commands.clear();
+    analytics.clear();
+    refresh.reset();
+    reset_watchdog();
     UtilityFunctions::print("[H264Decoder] Reset");
 }
 
 void H264Decoder::cleanup() {
-    if (sws_ctx) {
-        sws_freeContext(sws_ctx);
-        sws_ctx = nullptr;
-    }
+    rgba_converter.clear();
+    extrapolator.clear();
+    retained.clear();
+    pending_region_commands.clear();
+    tile_cache.clear();
+    analytics.clear();
+    reset_export_probe();
     if (frame) {
         av_frame_free(&frame);
         frame = nullptr;
     }
-    if (frame_rgb) {
-        av_frame_free(&frame_rgb);
-        frame_rgb = nullptr;
+    if (receive_frame) {
+        av_frame_free(&receive_frame);
+        receive_frame = nullptr;
+    }
+    if (clean_frame) {
+        av_frame_free(&clean_frame);
+        clean_frame = nullptr;
     }
     if (packet) {
         av_packet_free(&packet);
         packet = nullptr;
     }
     if (codec_ctx) {
+        codec_thread_tracker.detach();
         avcodec_free_context(&codec_ctx);
         codec_ctx = nullptr;
     }
+    frame_buffers.reset();
+    MemoryAccounting::add(-accounted_bytes);
+    accounted_bytes = 0;
+    parameter_sets.clear();
+    software_fallback = false;
+    reopen_at_sync_point = false;
+    budget_codec_threads = 0;
+    packet_buffer_bytes = 0;
+    output_buffer_bytes = 0;
+    refresh.reset();
+    reset_watchdog();
     
     initialized = false;
     width = 0;
     height = 0;
-    rgb_buffer.clear();
 }
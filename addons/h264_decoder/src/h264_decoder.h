@@ -12,6 +12,24 @@
 #include <godot_cpp/variant/packed_byte_array.hpp>
 #include <godot_cpp/core/class_db.hpp>
 #include <godot_cpp/variant/packed_vector2_array.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
+#include <godot_cpp/variant/array.hpp>
+#include <godot_cpp/variant/packed_int32_array.hpp>
+#include <godot_cpp/variant/packed_int64_array.hpp>
+#include <godot_cpp/variant/packed_float32_array.hpp>
+
+#include <chrono>
+
+#include "bitstream_analytics.h"
+#include "frame_extrapolator.h"
+#include "latency_probe.h"
+#include "memory_accounting.h"
+#include "nal_parser.h"
+#include "refresh_tracker.h"
+#include "retained_frame.h"
+#include "rgba_converter.h"
+#include "thread_policy.h"
+#include "tile_cache.h"
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -24,18 +42,183 @@ namespace godot {
 class H264Decoder : public RefCounted {
     GDCLASS(H264Decoder, RefCounted)
 
+public:
+    enum OutputFormat {
+        OUTPUT_YUV,  // Y plane + U|V rows, converted in the shader (default)
+        OUTPUT_RGBA, // Packed RGBA8 via swscale (Compatibility renderer, screenshots)
+        OUTPUT_BGRA,
+    };
+
+    // Reported by the memory_pressure signal
+    enum MemoryPressure {
+        MEMORY_PRESSURE_NONE,
+        MEMORY_PRESSURE_HIGH,     // above 90% of the instance or global budget
+        MEMORY_PRESSURE_CRITICAL, // over budget; the decoder is shedding memory
+    };
+
+    // Recovery steps taken by the stall watchdog, in escalation order
+    enum WatchdogLevel {
+        WATCHDOG_NONE,
+        WATCHDOG_FLUSH,    // avcodec_flush_buffers
+        WATCHDOG_REOPEN,   // close and reopen the codec, replay cached SPS/PPS
+        WATCHDOG_SOFTWARE, // reopen on the software decoder for good
+    };
+
+    // Scheduling class for codec, worker and opted-in threads
+    enum ThreadPriority {
+        THREAD_PRIORITY_NORMAL,
+        THREAD_PRIORITY_HIGH,     // nice -10
+        THREAD_PRIORITY_REALTIME, // SCHED_FIFO, falls back to HIGH without rights
+    };
+
+    // Where the picture stands in a gradual intra refresh (RefreshTracker)
+    enum RefreshState {
+        REFRESH_WAITING,     // no IDR or recovery point since start or damage
+        REFRESH_IN_PROGRESS, // counting pictures from a recovery point SEI
+        REFRESH_CLEAN,
+    };
+
+    // Per-packet result reported by decode_batch
+    enum PacketStatus {
+        PACKET_DECODED, // Accepted and produced a frame
+        PACKET_PENDING, // Accepted, decoder needs more input
+        PACKET_EMPTY,   // Zero-length packet skipped
+        PACKET_ERROR,   // Rejected by the decoder (or not a PackedByteArray)
+    };
+
 private:
     AVCodecContext* codec_ctx = nullptr;
     AVFrame* frame = nullptr;
-    AVFrame* frame_rgb = nullptr;
+    AVFrame* receive_frame = nullptr; // scratch target while draining the decoder
+    AVFrame* clean_frame = nullptr;   // last clean picture, kept while refresh_gating
     AVPacket* packet = nullptr;
-    SwsContext* sws_ctx = nullptr;
     
     int width = 0;
     int height = 0;
     bool initialized = false;
-    
-    PackedByteArray rgb_buffer;
+
+    OutputFormat output_format = OUTPUT_YUV;
+    RgbaConverter rgba_converter;
+    int64_t last_convert_usec = 0;
+    int last_batch_packets = 0;
+    int64_t last_batch_usec = 0;
+
+    // Motion-vector extrapolation for late frames (software decoder only)
+    bool extrapolation_enabled = false;
+    FrameExtrapolator extrapolator;
+
+    // Optional per-frame bitstream statistics
+    bool analytics_enabled = false;
+    BitstreamAnalytics analytics;
+    // The side data analytics asks for is produced inside libavcodec, where
+    // analytics_usec can't see it. Every EXPORT_PROBE_INTERVAL packets one
+    // is decoded without it, and the difference between the mean decode
+    // time with and without export is the hidden cost.
+    static const int EXPORT_PROBE_INTERVAL = 16;
+    static const int EXPORT_PROBE_SAMPLES = 32; // running mean horizon
+    bool export_probe = false;
+    int export_probe_counter = 0;
+    double export_on_usec = 0.0;
+    double export_off_usec = 0.0;
+    int export_on_samples = 0;
+    int export_off_samples = 0;
+    void record_export_sample(int64_t decode_usec);
+    void reset_export_probe();
+
+    // Side data libavcodec should export for extrapolation and analytics
+    void update_export_side_data();
+
+    // Retained output picture edited by server region commands
+    bool retained_mode = false;
+    RetainedFrame retained;
+    std::vector<RegionCommand> pending_region_commands; // from the side channel
+    int last_region_commands = 0;
+    TileCache tile_cache;
+
+    // Memory accounting and budget enforcement
+    FrameBufferTracker frame_buffers;
+    int64_t memory_budget = 0;    // this instance, 0 = unlimited
+    int64_t accounted_bytes = 0;  // our share of MemoryAccounting's total
+    bool global_accounting = true; // counts toward (and reacts to) the global budget
+    MemoryPressure memory_pressure = MEMORY_PRESSURE_NONE;
+    int64_t budget_actions = 0;
+    int codec_threads = 0;        // 0 = libavcodec picks
+    int budget_codec_threads = 0; // limit imposed under memory pressure, 0 = none
+    bool software_decoder_only = false; // never take a hardware decoder session
+    bool reopen_at_sync_point = false;  // shed slice contexts at the next IDR/recovery point
+    std::vector<NalUnit> sync_units;    // scratch for the sync point check
+    int64_t packet_buffer_bytes = 0;    // largest packet libavcodec copied since open
+    int64_t output_buffer_bytes = 0;    // last frame handed to script
+
+    int64_t compute_memory_usage() const;
+    // Re-total this instance, publish the delta and react to pressure
+    void update_memory_accounting();
+    // Shed one step of memory: tile cache, then extrapolation, then threads
+    void enforce_memory_budget();
+    // Drop the budget's thread limit once pressure has eased
+    void relax_memory_budget();
+    // codec_threads, capped by the budget's limit
+    int get_effective_codec_threads() const;
+    // IDR or recovery point SEI: a reopened codec can start here
+    bool is_sync_point(const uint8_t* data, size_t size);
+
+    // Stall watchdog: packets going in but no frame coming out
+    bool watchdog_enabled = true;
+    int stall_timeout_msec = 500;
+    ParameterSetCache parameter_sets;
+    bool software_fallback = false; // sticky until cleanup
+    WatchdogLevel stall_level = WATCHDOG_NONE;
+    int64_t stall_start_usec = 0;      // first packet with no output since the last frame
+    int64_t last_escalation_usec = 0;
+    int64_t last_input_usec = 0;
+    int64_t watchdog_flushes = 0;
+    int64_t watchdog_reopens = 0;
+    int64_t watchdog_fallbacks = 0;
+    int64_t frozen_usec_total = 0;
+    int64_t longest_freeze_usec = 0;
+
+    // Find a decoder (hardware first unless software_only) and open it
+    bool open_codec(bool software_only);
+    // Replace the open codec, then prime it with the cached parameter sets
+    bool reopen_codec(bool software_only);
+    // Feed one packet and drain; true if a new frame landed in `frame`
+    bool send_and_receive(const uint8_t* data, int64_t size, bool& rejected);
+    void on_frame_output(int64_t now_usec);
+    // Escalate one step once the decoder has been silent for the timeout.
+    // Returns true if the codec was replaced by a working one.
+    bool check_watchdog(int64_t now_usec);
+    void reset_watchdog();
+
+    // Intra refresh tracking and optional display gating
+    RefreshTracker refresh;
+    bool refresh_gating = false;
+    int64_t frames_gated = 0;
+
+    // Motion-to-photon markers read from the luma plane
+    bool latency_probe_enabled = false;
+    LatencyProbe latency_probe;
+
+    // Thread placement for this decoder's libavcodec threads
+    ThreadPolicy thread_policy;
+    bool fast_cores_only = false;
+    CodecThreadTracker codec_thread_tracker; // slice threads, recorded from inside their jobs
+    int threads_placed = 0;
+    ThreadPolicy::Priority priority_applied = ThreadPolicy::PRIORITY_NORMAL;
+
+    // Rolling decode (send + receive) time of frame-producing packets
+    static const int DECODE_TIME_WINDOW = 120;
+    int64_t decode_time_history[DECODE_TIME_WINDOW] = {};
+    int decode_time_count = 0;
+    int decode_time_pos = 0;
+    int64_t last_decode_usec = 0;
+
+    ThreadPolicy get_effective_thread_policy() const;
+    bool has_thread_policy() const;
+    void apply_thread_policy();
+
+    // Apply this frame's COPY/UPDATE commands to the retained picture.
+    // Returns false when the frame has to replace it entirely.
+    bool apply_region_commands(const AVFrame* src);
 
     // Audio State (IMA ADPCM)
     int last_sample_l = 0;
@@ -46,6 +229,40 @@ private:
     // Internal helper for ADPCM
     float decode_sample_ima(uint8_t nibble, int& predicted, int& index);
 
+    // Repack settings (0 threads = one band per pool thread)
+    int repack_threads = 0;
+    bool streaming_stores = true;
+
+    // Last repack timings, reported through get_stats()
+    int64_t last_repack_usec = 0;
+    int last_repack_bands = 0;
+    bool last_repack_streaming = false;
+
+    struct RepackJob {
+        const AVFrame* src = nullptr;
+        int width = 0;
+        int height = 0;
+        uint8_t* y_dst = nullptr;
+        uint8_t* uv_dst = nullptr;
+        bool fill_grey = false;
+        bool u_missing = false;
+        bool v_missing = false;
+        bool streaming = false;
+    };
+
+    // Full repack of src, split into bands
+    void repack_planes(const AVFrame* src, uint8_t* y_dst, uint8_t* uv_dst);
+    void repack_band(const RepackJob& job, int y_begin, int y_end, int uv_begin, int uv_end);
+
+    // Convert the current frame to packed RGBA/BGRA (width*height*4)
+    PackedByteArray convert_rgba();
+
+    // Current frame in the configured output format
+    PackedByteArray output_current_frame();
+
+    Dictionary finish_batch(bool got_frame, const PackedInt32Array& status,
+                            std::chrono::steady_clock::time_point batch_start);
+
 protected:
     static void _bind_methods();
 
@@ -56,10 +273,33 @@ public:
     // Initialize decoder (optional - auto-inits on first frame)
     bool initialize(int expected_width = 0, int expected_height = 0);
     
-    // Decode H.264 NAL units and return RGBA pixels
+    // Decode H.264 NAL units
     // Input: Raw H.264 data (with or without start codes)
-    // Output: RGBA pixel data (width * height * 4 bytes) or empty on error
+    // Output: OUTPUT_YUV - Y plane followed by U|V rows (width * height * 3/2 bytes)
+    //         OUTPUT_RGBA/BGRA - packed pixels (width * height * 4 bytes)
+    //         Empty when no frame is ready or on error
     PackedByteArray decode_frame(const PackedByteArray& h264_data);
+
+    // Decode several packets in one call (high-fps streams, catching up).
+    // Each packet must hold whole pictures: without AV_CODEC_FLAG2_CHUNKS a
+    // packet with only some slices of one decodes as a concealed picture.
+    // Returns {"frame": PackedByteArray of the newest frame or empty,
+    //          "status": PackedInt32Array of PacketStatus per packet}
+    Dictionary decode_batch(const Array& packets);
+    // Same, with packets laid out back to back in one buffer; offsets[i] is
+    // where packet i starts, it ends at the next offset (or the buffer end)
+    Dictionary decode_batch_buffer(const PackedByteArray& data, const PackedInt32Array& offsets);
+    
+    // Native entry points (not bound) for nodes that keep pixels out of script.
+    // decode_packet returns PACKET_DECODED when a new frame is ready; repack_yuv
+    // then packs get_current_frame() into Y (width*height) and U|V rows
+    // (width * height/2), sized from that frame rather than get_width().
+    PacketStatus decode_packet(const uint8_t* data, int64_t size);
+    void repack_yuv(uint8_t* y_dst, uint8_t* uv_dst);
+    // With refresh gating, the last clean picture (or null) while the
+    // decoder's newest one is still being refreshed
+    const AVFrame* get_current_frame() const;
+    bool take_extrapolated_planes(uint8_t* y_dst, uint8_t* uv_dst);
     
     // Audio: Decode IMA ADPCM (4:1) to PCM Stereo (Vector2)
     PackedVector2Array decode_audio(const PackedByteArray& adpcm_data);
@@ -71,6 +311,141 @@ public:
     // Check if decoder is ready
     bool is_initialized() const { return initialized; }
     
+    // Repack tuning: row bands across the shared worker pool, streaming stores for 4K+
+    void set_repack_threads(int threads) { repack_threads = threads < 0 ? 0 : threads; }
+    int get_repack_threads() const { return repack_threads; }
+    void set_streaming_stores(bool enabled) { streaming_stores = enabled; }
+    bool get_streaming_stores() const { return streaming_stores; }
+
+    // Late-frame extrapolation. When enabled, every decoded frame kicks off a
+    // background prediction of the next one from its motion vectors;
+    // get_extrapolated_frame returns it (same layout as OUTPUT_YUV) once,
+    // or empty if none is ready. Synthesized frames never reach the decoder.
+    void set_extrapolation_enabled(bool enabled);
+    bool is_extrapolation_enabled() const { return extrapolation_enabled; }
+    void set_extrapolation_budget_usec(int64_t usec) { extrapolator.set_budget_usec(usec); }
+    int64_t get_extrapolation_budget_usec() const { return extrapolator.get_budget_usec(); }
+    PackedByteArray get_extrapolated_frame();
+
+    // Retained mode: the output picture persists across frames and server
+    // region commands (SEI or queue_region_commands, see retained_frame.h)
+    // move regions of it, so only newly exposed areas come from the decoder.
+    // get_dirty_rects returns [x, y, w, h, ...] changed by the last frame.
+    void set_retained_mode(bool enabled);
+    bool is_retained_mode() const { return retained_mode; }
+    bool queue_region_commands(const PackedByteArray& commands);
+    PackedInt32Array get_dirty_rects() const;
+
+    // Tile cache for TILE/STORE region commands (retained mode). Ids are the
+    // murmur3 hash of the tile; take_tile_cache_events returns
+    // {"added", "evicted", "missed"} PackedInt64Arrays for the server.
+    void set_tile_cache_budget(int64_t bytes);
+    int64_t get_tile_cache_budget() const { return (int64_t)tile_cache.get_budget(); }
+    Dictionary take_tile_cache_events();
+
+    // Bitstream analytics: bytes per NAL type, slices, QP (software decoder),
+    // zero-motion ("skip") share and a 16x9 region map of QP and motion.
+    // get_analytics_summary averages the last analytics_window frames;
+    // serialize_analytics_summary packs it for the server (bitstream_analytics.h).
+    // One packet in EXPORT_PROBE_INTERVAL decodes without QP/motion export
+    // so get_stats() can report the full cost (analytics_cost_ratio).
+    void set_analytics_enabled(bool enabled);
+    bool is_analytics_enabled() const { return analytics_enabled; }
+    void set_analytics_window(int frames) { analytics.set_window(frames); }
+    int get_analytics_window() const { return analytics.get_window(); }
+    Dictionary get_frame_analytics() const;
+    Dictionary get_analytics_summary() const;
+    PackedByteArray serialize_analytics_summary() const;
+
+    // Output layout returned by decode_frame
+    void set_output_format(OutputFormat format) { output_format = format; }
+    OutputFormat get_output_format() const { return output_format; }
+
+    // Memory held by this instance, by category, plus the process-wide
+    // total over all decoders. Budgets are enforced after each decoded
+    // frame by shrinking the tile cache, dropping extrapolation and
+    // reopening on one codec thread at the next IDR or recovery point
+    // (which frees the extra slice contexts); over the global
+    // budget, uninitialized instances refuse to initialize.
+    Dictionary get_memory_usage() const;
+    void set_memory_budget(int64_t bytes) { memory_budget = bytes > 0 ? bytes : 0; }
+    int64_t get_memory_budget() const { return memory_budget; }
+    static void set_global_memory_budget(int64_t bytes) { MemoryAccounting::set_budget(bytes); }
+    static int64_t get_global_memory_budget() { return MemoryAccounting::get_budget(); }
+    static int64_t get_global_memory_usage() { return MemoryAccounting::get_usage(); }
+    // Native owners of a background decoder (TimeShiftBuffer) turn this off
+    // so it neither counts toward the global budget nor reacts to it, and
+    // can't push the live decoders into shedding memory
+    void set_global_accounting(bool enabled);
+
+    // libavcodec slice threads used when the codec is opened (0 = auto).
+    // Memory pressure may cap this for a while without changing it.
+    void set_codec_threads(int threads) { codec_threads = threads < 0 ? 0 : threads; }
+    int get_codec_threads() const { return codec_threads; }
+    // Skip hardware decoders from the next initialize (secondary decoders
+    // that shouldn't compete with the live one for a hardware session)
+    void set_software_only(bool enabled) { software_decoder_only = enabled; }
+    bool is_software_only() const { return software_decoder_only; }
+
+    // Stall watchdog. When packets keep arriving but no frame comes out for
+    // stall_timeout_msec, the decoder is flushed, then reopened with the
+    // cached SPS/PPS, then moved to the software decoder, one step per
+    // timeout. decoder_stalled fires on each step (a good moment to ask the
+    // server for an IDR); decoder_recovered reports the frozen time.
+    void set_watchdog_enabled(bool enabled);
+    bool is_watchdog_enabled() const { return watchdog_enabled; }
+    void set_stall_timeout_msec(int msec) { stall_timeout_msec = msec > 10 ? msec : 10; }
+    int get_stall_timeout_msec() const { return stall_timeout_msec; }
+    bool is_software_fallback() const { return software_fallback; }
+
+    // Thread placement. The policy covers this decoder's libavcodec slice
+    // threads only (each places itself on its first job, so only real codec
+    // threads are touched, on Windows too); they go away with the codec
+    // context, so nothing outlives the decoder. Threads owned by the app
+    // (receive, audio, a decode Thread) opt in by calling
+    // apply_thread_policy_to_current_thread from that thread. The shared
+    // worker pool runs other decoders' and nodes' jobs too, so it has its
+    // own process-wide setter, which never uses REALTIME.
+    // decode_usec_stddev in get_stats() shows the effect on frame time.
+    void set_thread_cpus(const PackedInt32Array& cpus);
+    PackedInt32Array get_thread_cpus() const;
+    void set_fast_cores_only(bool enabled);
+    bool is_fast_cores_only() const { return fast_cores_only; }
+    void set_thread_priority(ThreadPriority priority);
+    ThreadPriority get_thread_priority() const { return (ThreadPriority)thread_policy.priority; }
+    bool apply_thread_policy_to_current_thread();
+    // CPUs above the lowest capacity (big/prime clusters), empty when symmetric
+    static PackedInt32Array get_fast_cores();
+    // Returns the number of running workers placed (Linux/Android; on
+    // Windows workers only pick it up as they start)
+    static int set_worker_pool_thread_policy(const PackedInt32Array& cpus, ThreadPriority priority);
+
+    // Gradual intra refresh. Streams without periodic IDRs start at any
+    // recovery point SEI; the state and progress follow the refresh from
+    // the packets, and picture_clean reports the time from start (or the
+    // last decode error) to the first fully refreshed picture. With gating
+    // on, decode_* return nothing until then, so the last clean picture
+    // stays up instead of a half-refreshed one.
+    void set_refresh_gating(bool enabled);
+    bool is_refresh_gating() const { return refresh_gating; }
+    RefreshState get_refresh_state() const { return (RefreshState)refresh.get_state(); }
+    float get_refresh_progress() const { return refresh.get_progress(); }
+
+    // Latency probe. When the sender paints timestamp markers into the
+    // frame corner (latency_probe.h, reference_streamer --latency-probe),
+    // each decoded frame is checked right after avcodec_receive_frame.
+    // probe_presented checks the current frame again once the caller has
+    // updated its texture (StreamDisplay does this itself), and
+    // latency_measured reports both ages of the same frame.
+    void set_latency_probe_enabled(bool enabled);
+    bool is_latency_probe_enabled() const { return latency_probe_enabled; }
+    bool probe_presented();
+    // Native variant for nodes that upload their own copy of the Y plane
+    bool probe_presented_plane(const uint8_t* luma, int stride, int width, int height);
+
+    // Per-frame timings and state for profiling
+    Dictionary get_stats() const;
+    
     // Reset decoder state (call after stream interruption)
     void reset();
     
@@ -80,4 +455,11 @@ public:
 
 } // namespace godot
 
+VARIANT_ENUM_CAST(H264Decoder::OutputFormat);
+VARIANT_ENUM_CAST(H264Decoder::PacketStatus);
+VARIANT_ENUM_CAST(H264Decoder::MemoryPressure);
+VARIANT_ENUM_CAST(H264Decoder::WatchdogLevel);
+VARIANT_ENUM_CAST(H264Decoder::ThreadPriority);
+VARIANT_ENUM_CAST(H264Decoder::RefreshState);
+
 #endif // H264_DECODER_H
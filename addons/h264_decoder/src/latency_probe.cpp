@@ -0,0 +1,179 @@
+/*
+ * Latency Probe Implementation
+ * SSE2 on x86, NEON on ARM, scalar elsewhere
+ */
+
+#include "latency_probe.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PROBE_HAS_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define PROBE_HAS_NEON 1
+#endif
+
+namespace godot {
+
+static const uint8_t MARKER_BLACK = 16;
+static const uint8_t MARKER_WHITE = 235;
+// Cell means must be this far from mid grey (128) to count as a bit
+static const int MARKER_MARGIN = 40;
+static const int MARKER_BITS = LATENCY_MARKER_COLUMNS * LATENCY_MARKER_ROWS;
+static const int SAMPLE_SIZE = 8; // middle of each cell
+
+// CRC-8, polynomial 0x07
+static uint8_t crc8(const uint8_t* data, size_t size) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < size; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (uint8_t)((crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1);
+        }
+    }
+    return crc;
+}
+
+// 6 bytes, most significant bit first: timestamp (4), sequence, CRC
+static void marker_bytes(const LatencyMarker& marker, uint8_t bytes[6]) {
+    bytes[0] = (uint8_t)(marker.timestamp_usec >> 24);
+    bytes[1] = (uint8_t)(marker.timestamp_usec >> 16);
+    bytes[2] = (uint8_t)(marker.timestamp_usec >> 8);
+    bytes[3] = (uint8_t)marker.timestamp_usec;
+    bytes[4] = marker.sequence;
+    bytes[5] = crc8(bytes, 5);
+}
+
+// Sum of an 8x8 block of bytes
+static int block_sum_8x8(const uint8_t* src, int stride) {
+#if defined(PROBE_HAS_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = _mm_setzero_si128();
+    for (int y = 0; y < SAMPLE_SIZE; y += 2) {
+        __m128i rows = _mm_unpacklo_epi64(
+            _mm_loadl_epi64((const __m128i*)(src + (size_t)y * stride)),
+            _mm_loadl_epi64((const __m128i*)(src + (size_t)(y + 1) * stride)));
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(rows, zero));
+    }
+    return _mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+#elif defined(PROBE_HAS_NEON)
+    uint16x8_t acc = vdupq_n_u16(0);
+    for (int y = 0; y < SAMPLE_SIZE; y++) {
+        acc = vaddw_u8(acc, vld1_u8(src + (size_t)y * stride));
+    }
+    uint64x2_t total = vpaddlq_u32(vpaddlq_u16(acc));
+    return (int)(vgetq_lane_u64(total, 0) + vgetq_lane_u64(total, 1));
+#else
+    int sum = 0;
+    for (int y = 0; y < SAMPLE_SIZE; y++) {
+        for (int x = 0; x < SAMPLE_SIZE; x++) {
+            sum += src[(size_t)y * stride + x];
+        }
+    }
+    return sum;
+#endif
+}
+
+void latency_marker_paint(uint8_t* luma, int stride, const LatencyMarker& marker) {
+    uint8_t bytes[6];
+    marker_bytes(marker, bytes);
+    for (int bit = 0; bit < MARKER_BITS; bit++) {
+        bool set = (bytes[bit / 8] >> (7 - bit % 8)) & 1;
+        int cell_x = (bit % LATENCY_MARKER_COLUMNS) * LATENCY_MARKER_CELL;
+        int cell_y = (bit / LATENCY_MARKER_COLUMNS) * LATENCY_MARKER_CELL;
+        for (int y = 0; y < LATENCY_MARKER_CELL; y++) {
+            memset(luma + (size_t)(cell_y + y) * stride + cell_x, set ? MARKER_WHITE : MARKER_BLACK,
+                   LATENCY_MARKER_CELL);
+        }
+    }
+}
+
+bool latency_marker_read(const uint8_t* luma, int stride, int width, int height, LatencyMarker& out) {
+    if (!luma || width < LATENCY_MARKER_WIDTH || height < LATENCY_MARKER_HEIGHT) {
+        return false;
+    }
+    const int offset = (LATENCY_MARKER_CELL - SAMPLE_SIZE) / 2;
+    const int threshold = 128 * SAMPLE_SIZE * SAMPLE_SIZE;
+    const int margin = MARKER_MARGIN * SAMPLE_SIZE * SAMPLE_SIZE;
+
+    uint8_t bytes[6] = {};
+    for (int bit = 0; bit < MARKER_BITS; bit++) {
+        int cell_x = (bit % LATENCY_MARKER_COLUMNS) * LATENCY_MARKER_CELL + offset;
+        int cell_y = (bit / LATENCY_MARKER_COLUMNS) * LATENCY_MARKER_CELL + offset;
+        int sum = block_sum_8x8(luma + (size_t)cell_y * stride + cell_x, stride);
+        if (sum > threshold - margin && sum < threshold + margin) {
+            return false; // not a marker cell (or mangled beyond use)
+        }
+        if (sum >= threshold) {
+            bytes[bit / 8] |= (uint8_t)(0x80 >> (bit % 8));
+        }
+    }
+    if (crc8(bytes, 5) != bytes[5]) {
+        return false;
+    }
+    out.timestamp_usec = ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) |
+                         ((uint32_t)bytes[2] << 8) | bytes[3];
+    out.sequence = bytes[4];
+    return true;
+}
+
+int64_t latency_marker_age_usec(const LatencyMarker& marker, uint64_t now_unix_usec) {
+    return (int32_t)((uint32_t)now_unix_usec - marker.timestamp_usec);
+}
+
+uint64_t latency_probe_unix_usec() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+bool LatencyProbe::sample(Stage stage, const uint8_t* luma, int stride, int width, int height,
+                          int64_t& latency_usec) {
+    History& history = stages[stage];
+    LatencyMarker marker;
+    if (!latency_marker_read(luma, stride, width, height, marker)) {
+        history.missed++;
+        return false;
+    }
+    latency_usec = latency_marker_age_usec(marker, latency_probe_unix_usec());
+    history.samples[history.pos] = latency_usec;
+    history.pos = (history.pos + 1) % WINDOW;
+    if (history.count < WINDOW) {
+        history.count++;
+    }
+    history.last_usec = latency_usec;
+    history.last_sequence = marker.sequence;
+    history.found++;
+    return true;
+}
+
+int64_t LatencyProbe::get_average_usec(Stage stage) const {
+    const History& history = stages[stage];
+    if (history.count == 0) {
+        return 0;
+    }
+    int64_t total = 0;
+    for (int i = 0; i < history.count; i++) {
+        total += history.samples[i];
+    }
+    return total / history.count;
+}
+
+int64_t LatencyProbe::get_max_usec(Stage stage) const {
+    const History& history = stages[stage];
+    if (history.count == 0) {
+        return 0;
+    }
+    return *std::max_element(history.samples, history.samples + history.count);
+}
+
+void LatencyProbe::clear() {
+    for (History& history : stages) {
+        history = History();
+    }
+}
+
+} // namespace godot
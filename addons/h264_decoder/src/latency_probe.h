@@ -0,0 +1,93 @@
+/*
+ * Latency Probe
+ * Motion-to-photon markers painted into, and read back from, the luma plane
+ *
+ * In probe mode the sender paints a grid of LATENCY_MARKER_COLUMNS x
+ * LATENCY_MARKER_ROWS cells into the top-left corner of every frame. Each
+ * cell is flat black (bit 0) or white (bit 1) and covers exactly one
+ * macroblock, so the encoder codes it as a DC level and quantization can't
+ * flip a bit. The 48 bits carry the low 32 bits of the capture time (Unix
+ * epoch microseconds), an 8-bit sequence number and a CRC-8 over both.
+ *
+ * The reader averages the middle 8x8 of each cell, which keeps edge
+ * ringing out, using an SSE2/NEON SAD against zero. A marker only counts
+ * if every cell is clearly above or below mid grey and the CRC matches, so
+ * a frame without a marker costs 48 small sums.
+ *
+ * Latency is the receiver's wall clock minus the marker time, so the two
+ * clocks must agree: same machine, or NTP/PTP synced.
+ */
+
+#ifndef LATENCY_PROBE_H
+#define LATENCY_PROBE_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace godot {
+
+static const int LATENCY_MARKER_CELL = 16;
+static const int LATENCY_MARKER_COLUMNS = 8;
+static const int LATENCY_MARKER_ROWS = 6;
+static const int LATENCY_MARKER_WIDTH = LATENCY_MARKER_CELL * LATENCY_MARKER_COLUMNS;
+static const int LATENCY_MARKER_HEIGHT = LATENCY_MARKER_CELL * LATENCY_MARKER_ROWS;
+
+struct LatencyMarker {
+    uint32_t timestamp_usec = 0; // low 32 bits of Unix epoch microseconds
+    uint8_t sequence = 0;
+};
+
+// Paint a marker into an 8-bit luma plane at least LATENCY_MARKER_WIDTH x
+// LATENCY_MARKER_HEIGHT in size (studio range black and white)
+void latency_marker_paint(uint8_t* luma, int stride, const LatencyMarker& marker);
+
+// Read the marker from the top-left corner; false if there is none
+bool latency_marker_read(const uint8_t* luma, int stride, int width, int height, LatencyMarker& out);
+
+// now minus the marker time, correct while the two are within about 35 minutes
+int64_t latency_marker_age_usec(const LatencyMarker& marker, uint64_t now_unix_usec);
+
+uint64_t latency_probe_unix_usec();
+
+// Rolling per-stage latency for the decoder's stats
+class LatencyProbe {
+public:
+    enum Stage {
+        STAGE_DECODED,   // right after avcodec_receive_frame
+        STAGE_PRESENTED, // after the texture update
+        STAGE_COUNT,
+    };
+
+private:
+    static const int WINDOW = 120;
+
+    struct History {
+        int64_t samples[WINDOW] = {};
+        int count = 0;
+        int pos = 0;
+        int64_t last_usec = 0;
+        int last_sequence = -1;
+        int64_t found = 0;
+        int64_t missed = 0;
+    };
+    History stages[STAGE_COUNT];
+
+public:
+    // Read the marker from a luma plane and record its age for the stage.
+    // Returns false (and counts a miss) when the frame carries none.
+    bool sample(Stage stage, const uint8_t* luma, int stride, int width, int height, int64_t& latency_usec);
+
+    int64_t get_last_usec(Stage stage) const { return stages[stage].last_usec; }
+    int get_last_sequence(Stage stage) const { return stages[stage].last_sequence; }
+    int64_t get_found(Stage stage) const { return stages[stage].found; }
+    int64_t get_missed(Stage stage) const { return stages[stage].missed; }
+    // Over the last WINDOW samples; 0 without samples
+    int64_t get_average_usec(Stage stage) const;
+    int64_t get_max_usec(Stage stage) const;
+
+    void clear();
+};
+
+} // namespace godot
+
+#endif // LATENCY_PROBE_H
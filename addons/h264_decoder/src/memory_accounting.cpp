@@ -0,0 +1,78 @@
+/*
+ * Memory Accounting Implementation
+ */
+
+#include "memory_accounting.h"
+
+using namespace godot;
+
+std::atomic<int64_t> MemoryAccounting::usage{0};
+std::atomic<int64_t> MemoryAccounting::peak{0};
+std::atomic<int64_t> MemoryAccounting::budget{0};
+std::atomic<int> MemoryAccounting::instances{0};
+
+void MemoryAccounting::add(int64_t delta) {
+    int64_t now = usage.fetch_add(delta) + delta;
+    int64_t previous = peak.load();
+    while (now > previous && !peak.compare_exchange_weak(previous, now)) {
+    }
+}
+
+double MemoryAccounting::get_pressure() {
+    int64_t limit = budget.load();
+    return limit > 0 ? (double)usage.load() / (double)limit : 0.0;
+}
+
+void FrameBufferTracker::attach(AVCodecContext* ctx) {
+    reset();
+    ctx->opaque = this;
+    ctx->get_buffer2 = &FrameBufferTracker::get_buffer2;
+}
+
+int FrameBufferTracker::get_buffer2(AVCodecContext* ctx, AVFrame* frame, int flags) {
+    int ret = avcodec_default_get_buffer2(ctx, frame, flags);
+    if (ret >= 0 && ctx->opaque) {
+        static_cast<FrameBufferTracker*>(ctx->opaque)->record(frame);
+    }
+    return ret;
+}
+
+void FrameBufferTracker::record(const AVFrame* frame) {
+    // May run on libavcodec's frame threads
+    std::lock_guard<std::mutex> lock(mutex);
+    if (frame->width != pool_width || frame->height != pool_height || frame->format != pool_format) {
+        buffers.clear();
+        total_bytes = 0;
+        pool_width = frame->width;
+        pool_height = frame->height;
+        pool_format = frame->format;
+    }
+
+    // Pool entries keep their data pointer across reuse, so a pointer seen
+    // before is the same allocation coming back
+    for (int i = 0; i < AV_NUM_DATA_POINTERS && frame->buf[i]; i++) {
+        const AVBufferRef* buf = frame->buf[i];
+        if (buffers.emplace(buf->data, buf->size).second) {
+            total_bytes += buf->size;
+        }
+    }
+}
+
+size_t FrameBufferTracker::get_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return total_bytes;
+}
+
+int FrameBufferTracker::get_count() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return (int)buffers.size();
+}
+
+void FrameBufferTracker::reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    buffers.clear();
+    total_bytes = 0;
+    pool_width = 0;
+    pool_height = 0;
+    pool_format = -1;
+}
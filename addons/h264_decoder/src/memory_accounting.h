@@ -0,0 +1,76 @@
+/*
+ * Memory Accounting
+ * Process-wide totals for decoder-owned memory, plus frame buffer tracking
+ *
+ * libavutil has no allocator hooks, so the av_malloc-level view covers frame
+ * buffers only: FrameBufferTracker wraps get_buffer2 and records every
+ * distinct pool buffer libavcodec hands out (reference frames, the output
+ * frame, per-thread copies). Buffers are forgotten when the picture size or
+ * format changes, since libavcodec rebuilds its pool then. Everything else
+ * (retained frame, tile cache, extrapolator) reports exact capacities.
+ */
+
+#ifndef MEMORY_ACCOUNTING_H
+#define MEMORY_ACCOUNTING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+namespace godot {
+
+class MemoryAccounting {
+private:
+    static std::atomic<int64_t> usage;
+    static std::atomic<int64_t> peak;
+    static std::atomic<int64_t> budget;
+    static std::atomic<int> instances;
+
+public:
+    // Decoders report changes in their own total
+    static void add(int64_t delta);
+    static int64_t get_usage() { return usage.load(); }
+    static int64_t get_peak() { return peak.load(); }
+
+    // 0 = unlimited
+    static void set_budget(int64_t bytes) { budget = bytes > 0 ? bytes : 0; }
+    static int64_t get_budget() { return budget.load(); }
+    // usage / budget, or 0 without a budget
+    static double get_pressure();
+
+    static void instance_added() { instances++; }
+    static void instance_removed() { instances--; }
+    static int get_instance_count() { return instances.load(); }
+};
+
+class FrameBufferTracker {
+private:
+    mutable std::mutex mutex;
+    std::unordered_map<const uint8_t*, size_t> buffers;
+    size_t total_bytes = 0;
+    int pool_width = 0;
+    int pool_height = 0;
+    int pool_format = -1;
+
+    static int get_buffer2(AVCodecContext* ctx, AVFrame* frame, int flags);
+    void record(const AVFrame* frame);
+
+public:
+    // Route the context's frame allocations through the tracker. Hardware
+    // decoders that don't call get_buffer2 simply report nothing.
+    void attach(AVCodecContext* ctx);
+
+    size_t get_bytes() const;
+    int get_count() const;
+    void reset();
+};
+
+} // namespace godot
+
+#endif // MEMORY_ACCOUNTING_H
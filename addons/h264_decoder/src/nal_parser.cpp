@@ -0,0 +1,245 @@
+/*
+ * NAL Parser Implementation
+ */
+
+#include "nal_parser.h"
+
+using namespace godot;
+
+static const int MAX_SPS_ID = 31;
+static const int MAX_PPS_ID = 255;
+
+// Offset of the next 00 00 01 start code at or after `pos`, or `size`
+static size_t find_start_code(const uint8_t* data, size_t size, size_t pos) {
+    while (pos + 3 <= size) {
+        if (data[pos + 2] > 1) {
+            pos += 3;
+        } else if (data[pos] == 0 && data[pos + 1] == 0 && data[pos + 2] == 1) {
+            return pos;
+        } else {
+            pos++;
+        }
+    }
+    return size;
+}
+
+int godot::parse_nal_units(const uint8_t* data, size_t size, std::vector<NalUnit>& out) {
+    if (!data || size == 0) {
+        return 0;
+    }
+
+    size_t pos = find_start_code(data, size, 0);
+    if (pos == size) {
+        NalUnit nal;
+        nal.type = data[0] & 0x1f;
+        nal.data = data;
+        nal.size = size;
+        out.push_back(nal);
+        return 1;
+    }
+
+    int count = 0;
+    while (pos < size) {
+        size_t begin = pos + 3;
+        size_t next = find_start_code(data, size, begin);
+        size_t end = next;
+        // Trailing zero belongs to the next 4-byte start code
+        while (end > begin && data[end - 1] == 0) {
+            end--;
+        }
+        if (end > begin) {
+            NalUnit nal;
+            nal.type = data[begin] & 0x1f;
+            nal.data = data + begin;
+            nal.size = end - begin;
+            out.push_back(nal);
+            count++;
+        }
+        pos = next;
+    }
+    return count;
+}
+
+// Exp-Golomb reader over the first bytes of a NAL payload; enough for the
+// ids and the recovery point fields
+class IdReader {
+private:
+    uint8_t bytes[16];
+    size_t count = 0;
+    size_t bit = 0;
+
+public:
+    // escaped = false for bytes that already went through unescape_rbsp
+    IdReader(const uint8_t* data, size_t size, bool escaped = true) {
+        // Drop emulation prevention bytes (00 00 03)
+        int zeros = 0;
+        for (size_t i = 0; i < size && count < sizeof(bytes); i++) {
+            if (escaped && zeros >= 2 && data[i] == 3) {
+                zeros = 0;
+                continue;
+            }
+            zeros = data[i] == 0 ? zeros + 1 : 0;
+            bytes[count++] = data[i];
+        }
+    }
+
+    int read_bit() {
+        if (bit >= count * 8) {
+            return -1;
+        }
+        int value = (bytes[bit / 8] >> (7 - bit % 8)) & 1;
+        bit++;
+        return value;
+    }
+
+    void skip(size_t bits) { bit += bits; }
+
+    // -1 if the value runs past the buffer
+    int read_ue() {
+        int leading = 0;
+        int b;
+        while ((b = read_bit()) == 0) {
+            if (++leading > 16) {
+                return -1;
+            }
+        }
+        if (b < 0) {
+            return -1;
+        }
+        int value = 0;
+        for (int i = 0; i < leading; i++) {
+            int next = read_bit();
+            if (next < 0) {
+                return -1;
+            }
+            value = (value << 1) | next;
+        }
+        return (1 << leading) - 1 + value;
+    }
+};
+
+static void unescape_rbsp(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+    out.clear();
+    out.reserve(size);
+    int zeros = 0;
+    for (size_t i = 0; i < size; i++) {
+        if (zeros >= 2 && data[i] == 3) {
+            zeros = 0;
+            continue;
+        }
+        zeros = data[i] == 0 ? zeros + 1 : 0;
+        out.push_back(data[i]);
+    }
+}
+
+// SEI payloadType/payloadSize: runs of 0xFF plus a final byte
+static bool read_sei_value(const std::vector<uint8_t>& rbsp, size_t& pos, size_t& value) {
+    value = 0;
+    while (pos < rbsp.size() && rbsp[pos] == 0xFF) {
+        value += 255;
+        pos++;
+    }
+    if (pos >= rbsp.size()) {
+        return false;
+    }
+    value += rbsp[pos++];
+    return true;
+}
+
+bool godot::parse_recovery_point(const NalUnit& nal, RecoveryPoint& out) {
+    if (nal.type != NAL_SEI || nal.size < 3) {
+        return false;
+    }
+    std::vector<uint8_t> rbsp;
+    unescape_rbsp(nal.data + 1, nal.size - 1, rbsp);
+
+    // Walk the messages up to the rbsp trailing bits (0x80)
+    size_t pos = 0;
+    while (pos < rbsp.size() && rbsp[pos] != 0x80) {
+        size_t type, size;
+        if (!read_sei_value(rbsp, pos, type) || !read_sei_value(rbsp, pos, size) || pos + size > rbsp.size()) {
+            return false;
+        }
+        if (type == SEI_RECOVERY_POINT) {
+            IdReader reader(rbsp.data() + pos, size, false);
+            int count = reader.read_ue();
+            int exact_match = reader.read_bit();
+            int broken_link = reader.read_bit();
+            if (count < 0 || broken_link < 0) {
+                return false;
+            }
+            out.recovery_frame_cnt = count;
+            out.exact_match = exact_match == 1;
+            out.broken_link = broken_link == 1;
+            return true;
+        }
+        pos += size;
+    }
+    return false;
+}
+
+void ParameterSetCache::store(std::vector<std::vector<uint8_t>>& table, int id, const NalUnit& nal) {
+    if ((size_t)id >= table.size()) {
+        table.resize(id + 1);
+    }
+    table[id].assign(nal.data, nal.data + nal.size);
+}
+
+bool ParameterSetCache::update(const uint8_t* data, size_t size) {
+    std::vector<NalUnit> units;
+    parse_nal_units(data, size, units);
+
+    bool found = false;
+    for (const NalUnit& nal : units) {
+        if (nal.type == NAL_SPS && nal.size > 4) {
+            // profile_idc, constraint flags, level_idc, then seq_parameter_set_id
+            IdReader reader(nal.data + 1, nal.size - 1);
+            reader.skip(24);
+            int id = reader.read_ue();
+            if (id >= 0 && id <= MAX_SPS_ID) {
+                store(sps, id, nal);
+                found = true;
+            }
+        } else if (nal.type == NAL_PPS && nal.size > 1) {
+            IdReader reader(nal.data + 1, nal.size - 1);
+            int id = reader.read_ue();
+            if (id >= 0 && id <= MAX_PPS_ID) {
+                store(pps, id, nal);
+                found = true;
+            }
+        }
+    }
+    return found;
+}
+
+bool ParameterSetCache::has_parameter_sets() const {
+    bool has_sps = false;
+    bool has_pps = false;
+    for (const auto& nal : sps) {
+        has_sps |= !nal.empty();
+    }
+    for (const auto& nal : pps) {
+        has_pps |= !nal.empty();
+    }
+    return has_sps && has_pps;
+}
+
+std::vector<uint8_t> ParameterSetCache::build_annex_b() const {
+    static const uint8_t START_CODE[4] = { 0, 0, 0, 1 };
+    std::vector<uint8_t> out;
+    for (const auto* table : { &sps, &pps }) {
+        for (const auto& nal : *table) {
+            if (nal.empty()) {
+                continue;
+            }
+            out.insert(out.end(), START_CODE, START_CODE + 4);
+            out.insert(out.end(), nal.begin(), nal.end());
+        }
+    }
+    return out;
+}
+
+void ParameterSetCache::clear() {
+    sps.clear();
+    pps.clear();
+}
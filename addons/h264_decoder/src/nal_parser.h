@@ -0,0 +1,79 @@
+/*
+ * NAL Parser
+ * Minimal Annex B scanning for H.264 packets
+ *
+ * Only finds NAL unit boundaries and types, plus the few fields the
+ * decoder acts on (parameter set ids, recovery point SEI); no slice parsing.
+ * Used to cache parameter sets so a reopened decoder can start at the
+ * next IDR or recovery point without waiting for the server to resend SPS/PPS.
+ */
+
+#ifndef NAL_PARSER_H
+#define NAL_PARSER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace godot {
+
+enum NalType {
+    NAL_SLICE = 1,
+    NAL_IDR = 5,
+    NAL_SEI = 6,
+    NAL_SPS = 7,
+    NAL_PPS = 8,
+    NAL_AUD = 9,
+};
+
+struct NalUnit {
+    int type = 0;
+    const uint8_t* data = nullptr; // first byte after the start code (the NAL header)
+    size_t size = 0;
+};
+
+// Split an Annex B buffer into NAL units. A buffer without start codes is
+// treated as a single NAL unit. Returns the number of units appended.
+int parse_nal_units(const uint8_t* data, size_t size, std::vector<NalUnit>& out);
+
+// Slice with first_mb_in_slice == 0, i.e. the start of a new picture
+// (ue(v) 0 is a single 1 bit)
+inline bool nal_starts_picture(const NalUnit& nal) {
+    return (nal.type == NAL_SLICE || nal.type == NAL_IDR) && nal.size > 1 && (nal.data[1] & 0x80);
+}
+
+static const int SEI_RECOVERY_POINT = 6;
+
+// recovery_point SEI: the picture recovery_frame_cnt frames after the one
+// carrying it (in frame_num order) and everything after it decode correctly
+struct RecoveryPoint {
+    int recovery_frame_cnt = 0;
+    bool exact_match = false;
+    bool broken_link = false;
+};
+
+// Find a recovery point message in an SEI NAL; false if it has none
+bool parse_recovery_point(const NalUnit& nal, RecoveryPoint& out);
+
+// Keeps the latest SPS and PPS (by id) as Annex B, ready to prepend
+class ParameterSetCache {
+private:
+    std::vector<std::vector<uint8_t>> sps; // indexed by seq_parameter_set_id
+    std::vector<std::vector<uint8_t>> pps; // indexed by pic_parameter_set_id
+
+    static void store(std::vector<std::vector<uint8_t>>& table, int id, const NalUnit& nal);
+
+public:
+    // Record any SPS/PPS in the packet; returns true if one was found
+    bool update(const uint8_t* data, size_t size);
+
+    bool has_parameter_sets() const;
+    // Every cached SPS then PPS, each with a 4-byte start code
+    std::vector<uint8_t> build_annex_b() const;
+
+    void clear();
+};
+
+} // namespace godot
+
+#endif // NAL_PARSER_H
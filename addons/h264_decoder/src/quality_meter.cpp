@@ -0,0 +1,378 @@
+/*
+ * Quality Meter Implementation
+ */
+
+#include "quality_meter.h"
+#include "frame_repack.h"
+#include "quality_metrics.h"
+
+#include <godot_cpp/variant/utility_functions.hpp>
+
+#include <algorithm>
+#include <chrono>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__) || defined(__ANDROID__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace godot;
+
+static int64_t now_usec() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static const char* PLANE_SUFFIX[3] = { "_y", "_u", "_v" };
+
+void QualityMeter::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("submit_reference", "frame_id", "i420", "width", "height"), &QualityMeter::submit_reference);
+    ClassDB::bind_method(D_METHOD("submit_frame", "decoder", "frame_id", "packet_bytes"), &QualityMeter::submit_frame, DEFVAL(0));
+    ClassDB::bind_method(D_METHOD("set_reference_source", "source"), &QualityMeter::set_reference_source);
+    ClassDB::bind_method(D_METHOD("get_reference_source"), &QualityMeter::get_reference_source);
+    ClassDB::bind_method(D_METHOD("set_window", "frames"), &QualityMeter::set_window);
+    ClassDB::bind_method(D_METHOD("get_window"), &QualityMeter::get_window);
+    ClassDB::bind_method(D_METHOD("get_last_scores"), &QualityMeter::get_last_scores);
+    ClassDB::bind_method(D_METHOD("get_rolling_scores"), &QualityMeter::get_rolling_scores);
+    ClassDB::bind_method(D_METHOD("reset"), &QualityMeter::reset);
+    ClassDB::bind_method(D_METHOD("get_stats"), &QualityMeter::get_stats);
+    ClassDB::bind_method(D_METHOD("_flush_results"), &QualityMeter::_flush_results);
+
+    BIND_ENUM_CONSTANT(REFERENCE_SUBMITTED);
+    BIND_ENUM_CONSTANT(REFERENCE_SYNTHETIC_TEXT);
+    BIND_ENUM_CONSTANT(REFERENCE_SYNTHETIC_DRAG);
+    BIND_ENUM_CONSTANT(REFERENCE_SYNTHETIC_VIDEO);
+    BIND_ENUM_CONSTANT(REFERENCE_SYNTHETIC_MIXED);
+
+    ADD_SIGNAL(MethodInfo("quality_measured", PropertyInfo(Variant::DICTIONARY, "scores")));
+}
+
+QualityMeter::QualityMeter() {
+    worker = std::thread(&QualityMeter::worker_loop, this);
+}
+
+QualityMeter::~QualityMeter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+
+    for (Job& job : pending) {
+        av_frame_free(&job.frame);
+    }
+    pending.clear();
+}
+
+void QualityMeter::worker_loop() {
+    // Best effort, like snapshots: scoring must lose to decode and render
+#if defined(_WIN32)
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#elif defined(__linux__) || defined(__ANDROID__)
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 10);
+#endif
+
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this] { return stopping || !pending.empty(); });
+            if (stopping) {
+                return;
+            }
+            job = std::move(pending.front());
+            pending.pop_front();
+        }
+
+        Scores scores;
+        bool ok = score(job, scores);
+        av_frame_free(&job.frame);
+        if (!ok) {
+            continue;
+        }
+
+        bool schedule = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            results.push_back(scores);
+            schedule = !flush_scheduled;
+            flush_scheduled = true;
+        }
+        if (schedule) {
+            call_deferred("_flush_results");
+        }
+    }
+}
+
+bool QualityMeter::score(Job& job, Scores& out) {
+    int64_t start = now_usec();
+    const AVFrame* frame = job.frame;
+    int width = frame->width;
+    int height = frame->height;
+    int uv_width = (width + 1) / 2;
+    int uv_height = (height + 1) / 2;
+
+    // Decoded planes; semi-planar chroma is split into scratch first
+    const uint8_t* dec[3] = { frame->data[0], frame->data[1], frame->data[2] };
+    int dec_stride[3] = { frame->linesize[0], frame->linesize[1], frame->linesize[2] };
+    switch (frame->format) {
+        case AV_PIX_FMT_YUV420P:
+        case AV_PIX_FMT_YUVJ420P:
+            break;
+        case AV_PIX_FMT_NV12:
+        case AV_PIX_FMT_NV21:
+            chroma_scratch.resize((size_t)uv_width * 2 * uv_height);
+            repack_deinterleave_rows(chroma_scratch.data(), uv_width * 2, frame->data[1], frame->linesize[1],
+                                     uv_width, uv_height, frame->format == AV_PIX_FMT_NV21);
+            dec[1] = chroma_scratch.data();
+            dec[2] = chroma_scratch.data() + uv_width;
+            dec_stride[1] = dec_stride[2] = uv_width * 2;
+            break;
+        default:
+            frames_unsupported++;
+            return false;
+    }
+
+    // Reference planes
+    const uint8_t* ref[3];
+    int ref_stride[3] = { width, uv_width, uv_width };
+    if (job.source == REFERENCE_SUBMITTED) {
+        ref[0] = job.reference.data();
+    } else {
+        SyntheticDesktop::Scene scene = (SyntheticDesktop::Scene)(job.source - REFERENCE_SYNTHETIC_TEXT);
+        synthetic_scratch.resize((size_t)width * height + (size_t)uv_width * uv_height * 2);
+        uint8_t* y = synthetic_scratch.data();
+        uint8_t* u = y + (size_t)width * height;
+        uint8_t* v = u + (size_t)uv_width * uv_height;
+        SyntheticDesktop(width, height, scene).render((int)job.frame_id, { y, u, v, width, uv_width, uv_width });
+        ref[0] = synthetic_scratch.data();
+    }
+    ref[1] = ref[0] + (size_t)width * height;
+    ref[2] = ref[1] + (size_t)uv_width * uv_height;
+
+    uint64_t sse_total = 0;
+    uint64_t samples_total = 0;
+    for (int p = 0; p < 3; p++) {
+        int w = p == 0 ? width : uv_width;
+        int h = p == 0 ? height : uv_height;
+        uint64_t sse = quality_plane_sse(dec[p], dec_stride[p], ref[p], ref_stride[p], w, h);
+        uint64_t samples = (uint64_t)w * h;
+        out.psnr[p] = quality_psnr(sse, samples);
+        out.ssim[p] = quality_plane_ssim(dec[p], dec_stride[p], ref[p], ref_stride[p], w, h, ssim_scratch);
+        sse_total += sse;
+        samples_total += samples;
+    }
+    out.psnr_total = quality_psnr(sse_total, samples_total);
+    out.ssim_total = (4.0 * out.ssim[0] + out.ssim[1] + out.ssim[2]) / 6.0;
+    out.frame_id = job.frame_id;
+    out.bytes = job.bytes;
+    out.submit_usec = job.submit_usec;
+    out.score_usec = now_usec() - start;
+
+    frames_scored++;
+    last_score_usec = out.score_usec;
+    return true;
+}
+
+void QualityMeter::_flush_results() {
+    std::deque<Scores> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.swap(results);
+        flush_scheduled = false;
+    }
+
+    for (const Scores& scores : ready) {
+        history.push_back(scores);
+        while ((int)history.size() > window) {
+            history.pop_front();
+        }
+        last_scores = scores;
+        has_scores = true;
+        emit_signal("quality_measured", scores_to_dictionary(scores));
+    }
+}
+
+bool QualityMeter::submit_reference(int64_t frame_id, const PackedByteArray& i420, int width, int height) {
+    if (width <= 0 || height <= 0) {
+        return false;
+    }
+    int64_t uv_size = (int64_t)((width + 1) / 2) * ((height + 1) / 2);
+    int64_t expected = (int64_t)width * height + uv_size * 2;
+    if (i420.size() != expected) {
+        UtilityFunctions::printerr("[QualityMeter] Reference ", frame_id, " is ", i420.size(),
+                                   " bytes, expected ", expected, " for ", width, "x", height, " I420");
+        return false;
+    }
+
+    Reference reference;
+    reference.frame_id = frame_id;
+    reference.width = width;
+    reference.height = height;
+    reference.planes.assign(i420.ptr(), i420.ptr() + expected);
+    references.push_back(std::move(reference));
+    while ((int)references.size() > MAX_REFERENCES) {
+        references.pop_front();
+    }
+    return true;
+}
+
+bool QualityMeter::submit_frame(const Ref<H264Decoder>& decoder, int64_t frame_id, int64_t packet_bytes) {
+    if (decoder.is_null()) {
+        return false;
+    }
+    return submit_native_frame(decoder->get_current_frame(), frame_id, packet_bytes);
+}
+
+bool QualityMeter::submit_native_frame(const AVFrame* frame, int64_t frame_id, int64_t packet_bytes) {
+    if (!frame || !frame->buf[0] || frame->width <= 0 || frame->height <= 0) {
+        return false;
+    }
+
+    Job job;
+    job.frame_id = frame_id;
+    job.bytes = packet_bytes;
+    job.submit_usec = now_usec();
+    job.source = reference_source;
+
+    if (reference_source == REFERENCE_SUBMITTED) {
+        // References for frames that were never decoded are dropped on the way
+        auto it = std::find_if(references.begin(), references.end(),
+                               [frame_id](const Reference& r) { return r.frame_id == frame_id; });
+        if (it == references.end()) {
+            frames_unmatched++;
+            return false;
+        }
+        bool same_size = it->width == frame->width && it->height == frame->height;
+        if (same_size) {
+            job.reference = std::move(it->planes);
+        }
+        references.erase(references.begin(), it + 1);
+        if (!same_size) {
+            frames_unmatched++;
+            return false;
+        }
+    }
+
+    // A new reference to the decoder's buffers; no pixels are copied
+    job.frame = av_frame_clone(frame);
+    if (!job.frame) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if ((int)pending.size() >= MAX_PENDING) {
+            av_frame_free(&pending.front().frame);
+            pending.pop_front();
+            frames_dropped++;
+        }
+        pending.push_back(std::move(job));
+    }
+    cv.notify_one();
+    return true;
+}
+
+void QualityMeter::set_reference_source(ReferenceSource source) {
+    reference_source = source;
+    references.clear();
+}
+
+void QualityMeter::set_window(int frames) {
+    window = std::max(frames, 1);
+    while ((int)history.size() > window) {
+        history.pop_front();
+    }
+}
+
+Dictionary QualityMeter::scores_to_dictionary(const Scores& scores) {
+    Dictionary result;
+    result["frame_id"] = scores.frame_id;
+    for (int p = 0; p < 3; p++) {
+        result[String("psnr") + PLANE_SUFFIX[p]] = scores.psnr[p];
+        result[String("ssim") + PLANE_SUFFIX[p]] = scores.ssim[p];
+    }
+    result["psnr"] = scores.psnr_total;
+    result["ssim"] = scores.ssim_total;
+    result["bytes"] = scores.bytes;
+    result["score_usec"] = scores.score_usec;
+    return result;
+}
+
+Dictionary QualityMeter::get_last_scores() const {
+    if (!has_scores) {
+        return Dictionary();
+    }
+    return scores_to_dictionary(last_scores);
+}
+
+Dictionary QualityMeter::get_rolling_scores() const {
+    Dictionary result;
+    int count = (int)history.size();
+    result["frames"] = count;
+    if (count == 0) {
+        return result;
+    }
+
+    Scores mean;
+    double min_psnr = QUALITY_PSNR_MAX;
+    double min_ssim = 1.0;
+    int64_t bytes = 0;
+    for (const Scores& s : history) {
+        for (int p = 0; p < 3; p++) {
+            mean.psnr[p] += s.psnr[p];
+            mean.ssim[p] += s.ssim[p];
+        }
+        mean.psnr_total += s.psnr_total;
+        mean.ssim_total += s.ssim_total;
+        min_psnr = std::min(min_psnr, s.psnr_total);
+        min_ssim = std::min(min_ssim, s.ssim_total);
+        bytes += s.bytes;
+    }
+    for (int p = 0; p < 3; p++) {
+        result[String("psnr") + PLANE_SUFFIX[p]] = mean.psnr[p] / count;
+        result[String("ssim") + PLANE_SUFFIX[p]] = mean.ssim[p] / count;
+    }
+    result["psnr"] = mean.psnr_total / count;
+    result["ssim"] = mean.ssim_total / count;
+    result["min_psnr"] = min_psnr;
+    result["min_ssim"] = min_ssim;
+
+    // Bitrate of the scored frames, from their submit times; dropped
+    // frames make this an estimate, not the link rate
+    double kbps = 0.0;
+    if (count >= 2) {
+        double span_sec = (history.back().submit_usec - history.front().submit_usec) / 1000000.0;
+        double frame_sec = span_sec / (count - 1);
+        if (frame_sec > 0.0) {
+            kbps = bytes * 8.0 / 1000.0 / (frame_sec * count);
+        }
+    }
+    result["kbps"] = kbps;
+    return result;
+}
+
+void QualityMeter::reset() {
+    references.clear();
+    history.clear();
+    has_scores = false;
+}
+
+Dictionary QualityMeter::get_stats() const {
+    Dictionary stats;
+    stats["frames_scored"] = frames_scored.load();
+    stats["frames_dropped"] = frames_dropped.load();
+    stats["frames_unmatched"] = frames_unmatched.load();
+    stats["frames_unsupported"] = frames_unsupported.load();
+    stats["score_usec"] = last_score_usec.load();
+    return stats;
+}
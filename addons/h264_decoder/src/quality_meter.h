@@ -0,0 +1,158 @@
+/*
+ * Quality Meter
+ * PSNR/SSIM of decoded frames against their source, for bitrate tuning
+ *
+ * submit_frame() takes a reference to the decoder's current AVFrame and
+ * pairs it with the source picture for the same frame id: either one
+ * handed in with submit_reference() (e.g. read from a lossless recording)
+ * or, for the reference streamer, rebuilt from SyntheticDesktop, whose
+ * frames are a pure function of the wire frame_id (WireReceiver returns
+ * it with each video message; client/wire_client.gd --quality shows the
+ * wiring). A worker thread scores Y, U and V (quality_metrics.h) and
+ * results come back on the main thread through quality_measured, with
+ * rolling averages next to the bitrate.
+ *
+ * Scoring is best effort: when the worker falls behind, the oldest queued
+ * frame is dropped instead of holding decoder buffers.
+ */
+
+#ifndef QUALITY_METER_H
+#define QUALITY_METER_H
+
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "h264_decoder.h"
+#include "synthetic_desktop.h"
+
+namespace godot {
+
+class QualityMeter : public RefCounted {
+    GDCLASS(QualityMeter, RefCounted)
+
+public:
+    // Where the source picture for a frame id comes from
+    enum ReferenceSource {
+        REFERENCE_SUBMITTED,       // submit_reference, I420
+        REFERENCE_SYNTHETIC_TEXT,  // reference streamer --scene text
+        REFERENCE_SYNTHETIC_DRAG,  // --scene drag
+        REFERENCE_SYNTHETIC_VIDEO, // --scene video
+        REFERENCE_SYNTHETIC_MIXED, // --scene mixed (its default)
+    };
+
+private:
+    static const int MAX_REFERENCES = 32;
+    static const int MAX_PENDING = 4;
+
+    struct Reference {
+        int64_t frame_id = 0;
+        int width = 0;
+        int height = 0;
+        std::vector<uint8_t> planes; // Y, U, V back to back, no padding
+    };
+
+    struct Job {
+        AVFrame* frame = nullptr;
+        int64_t frame_id = 0;
+        int64_t bytes = 0;
+        int64_t submit_usec = 0;
+        ReferenceSource source = REFERENCE_SUBMITTED;
+        std::vector<uint8_t> reference; // REFERENCE_SUBMITTED only
+    };
+
+    struct Scores {
+        int64_t frame_id = 0;
+        double psnr[3] = {};
+        double psnr_total = 0.0; // over all samples, i.e. weighted 4:1:1
+        double ssim[3] = {};
+        double ssim_total = 0.0; // (4 * Y + U + V) / 6
+        int64_t bytes = 0;
+        int64_t submit_usec = 0;
+        int64_t score_usec = 0;
+    };
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping = false;
+
+    // Guarded by mutex
+    std::deque<Job> pending;
+    std::deque<Scores> results;
+    bool flush_scheduled = false;
+
+    // Worker-only
+    std::vector<uint8_t> chroma_scratch;
+    std::vector<uint8_t> synthetic_scratch;
+    std::vector<int> ssim_scratch;
+
+    // Main thread
+    ReferenceSource reference_source = REFERENCE_SUBMITTED;
+    std::deque<Reference> references;
+    std::deque<Scores> history;
+    int window = 120;
+    Scores last_scores;
+    bool has_scores = false;
+
+    // Stats
+    std::atomic<int64_t> frames_scored{0};
+    std::atomic<int64_t> frames_dropped{0};     // worker behind
+    std::atomic<int64_t> frames_unmatched{0};   // no reference, or a different size
+    std::atomic<int64_t> frames_unsupported{0}; // pixel format not 4:2:0 8-bit
+    std::atomic<int64_t> last_score_usec{0};
+
+    void worker_loop();
+    bool score(Job& job, Scores& out);
+    void _flush_results();
+    static Dictionary scores_to_dictionary(const Scores& scores);
+
+protected:
+    static void _bind_methods();
+
+public:
+    QualityMeter();
+    ~QualityMeter();
+
+    // Source picture for frame_id: I420, width * height luma followed by
+    // both (width+1)/2 * (height+1)/2 chroma planes. Must arrive before the
+    // decoded frame; the oldest are dropped past MAX_REFERENCES.
+    bool submit_reference(int64_t frame_id, const PackedByteArray& i420, int width, int height);
+
+    // Score the decoder's current frame as frame_id. packet_bytes is the
+    // compressed size, used for the bitrate next to the scores.
+    bool submit_frame(const Ref<H264Decoder>& decoder, int64_t frame_id, int64_t packet_bytes = 0);
+    // Same, for native callers holding the frame
+    bool submit_native_frame(const AVFrame* frame, int64_t frame_id, int64_t packet_bytes);
+
+    void set_reference_source(ReferenceSource source);
+    ReferenceSource get_reference_source() const { return reference_source; }
+
+    // Frames averaged by get_rolling_scores
+    void set_window(int frames);
+    int get_window() const { return window; }
+
+    // {frame_id, psnr_y, psnr_u, psnr_v, psnr, ssim_y, ssim_u, ssim_v, ssim, bytes, score_usec}
+    Dictionary get_last_scores() const;
+    // Means over the window plus min_psnr, min_ssim and kbps
+    Dictionary get_rolling_scores() const;
+
+    // Forget references and history (queued frames are still scored)
+    void reset();
+
+    Dictionary get_stats() const;
+};
+
+} // namespace godot
+
+VARIANT_ENUM_CAST(QualityMeter::ReferenceSource);
+
+#endif // QUALITY_METER_H
@@ -0,0 +1,221 @@
+/*
+ * Quality Metrics Implementation
+ */
+
+#include "quality_metrics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define QUALITY_HAS_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define QUALITY_HAS_NEON 1
+#endif
+
+namespace godot {
+
+uint64_t quality_plane_sse(const uint8_t* a, int a_stride, const uint8_t* b, int b_stride,
+                           int width, int height) {
+    uint64_t total = 0;
+    for (int y = 0; y < height; y++) {
+        const uint8_t* pa = a + (ptrdiff_t)y * a_stride;
+        const uint8_t* pb = b + (ptrdiff_t)y * b_stride;
+        int x = 0;
+        // One row at a time keeps the 32-bit lanes safe up to 8K widths
+#if defined(QUALITY_HAS_SSE2)
+        __m128i zero = _mm_setzero_si128();
+        __m128i acc = zero;
+        for (; x + 16 <= width; x += 16) {
+            __m128i va = _mm_loadu_si128((const __m128i*)(pa + x));
+            __m128i vb = _mm_loadu_si128((const __m128i*)(pb + x));
+            __m128i d_lo = _mm_sub_epi16(_mm_unpacklo_epi8(va, zero), _mm_unpacklo_epi8(vb, zero));
+            __m128i d_hi = _mm_sub_epi16(_mm_unpackhi_epi8(va, zero), _mm_unpackhi_epi8(vb, zero));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(d_lo, d_lo));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(d_hi, d_hi));
+        }
+        alignas(16) uint32_t lanes[4];
+        _mm_store_si128((__m128i*)lanes, acc);
+        total += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(QUALITY_HAS_NEON)
+        uint32x4_t acc = vdupq_n_u32(0);
+        for (; x + 16 <= width; x += 16) {
+            uint8x16_t diff = vabdq_u8(vld1q_u8(pa + x), vld1q_u8(pb + x));
+            acc = vpadalq_u16(acc, vmull_u8(vget_low_u8(diff), vget_low_u8(diff)));
+            acc = vpadalq_u16(acc, vmull_u8(vget_high_u8(diff), vget_high_u8(diff)));
+        }
+        uint32_t lanes[4];
+        vst1q_u32(lanes, acc);
+        total += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+        for (; x < width; x++) {
+            int d = (int)pa[x] - (int)pb[x];
+            total += (uint64_t)(d * d);
+        }
+    }
+    return total;
+}
+
+double quality_psnr(uint64_t sse, uint64_t samples) {
+    if (samples == 0 || sse == 0) {
+        return QUALITY_PSNR_MAX;
+    }
+    double mse = (double)sse / (double)samples;
+    return std::min(10.0 * log10(255.0 * 255.0 / mse), QUALITY_PSNR_MAX);
+}
+
+// Per-block sums are stored as 4 ints: s1 = sum a, s2 = sum b,
+// ss = sum a^2 + sum b^2, s12 = sum a*b
+static const int SSIM_SUMS = 4;
+
+#if defined(QUALITY_HAS_SSE2) || defined(QUALITY_HAS_NEON)
+// pairs[m][k] holds component m summed over columns 2k and 2k+1 of a
+// 16-pixel strip; adjacent pairs make one 4-wide block
+static void ssim_combine_pairs(const int32_t pairs[SSIM_SUMS][8], int* sums) {
+    for (int block = 0; block < 4; block++) {
+        for (int m = 0; m < SSIM_SUMS; m++) {
+            sums[block * SSIM_SUMS + m] = pairs[m][block * 2] + pairs[m][block * 2 + 1];
+        }
+    }
+}
+#endif
+
+// Sums for one row of 4x4 blocks starting at a/b
+static void ssim_block_row(const uint8_t* a, int a_stride, const uint8_t* b, int b_stride,
+                           int blocks, int* sums) {
+    int i = 0;
+#if defined(QUALITY_HAS_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+    for (; i + 4 <= blocks; i += 4) {
+        __m128i s1_lo = zero, s1_hi = zero, s2_lo = zero, s2_hi = zero;
+        __m128i ss_lo = zero, ss_hi = zero, s12_lo = zero, s12_hi = zero;
+        for (int r = 0; r < 4; r++) {
+            __m128i va = _mm_loadu_si128((const __m128i*)(a + (ptrdiff_t)r * a_stride + i * 4));
+            __m128i vb = _mm_loadu_si128((const __m128i*)(b + (ptrdiff_t)r * b_stride + i * 4));
+            __m128i a_lo = _mm_unpacklo_epi8(va, zero);
+            __m128i a_hi = _mm_unpackhi_epi8(va, zero);
+            __m128i b_lo = _mm_unpacklo_epi8(vb, zero);
+            __m128i b_hi = _mm_unpackhi_epi8(vb, zero);
+            s1_lo = _mm_add_epi16(s1_lo, a_lo);
+            s1_hi = _mm_add_epi16(s1_hi, a_hi);
+            s2_lo = _mm_add_epi16(s2_lo, b_lo);
+            s2_hi = _mm_add_epi16(s2_hi, b_hi);
+            // madd pairs adjacent pixels, which never straddle a block
+            ss_lo = _mm_add_epi32(ss_lo, _mm_add_epi32(_mm_madd_epi16(a_lo, a_lo), _mm_madd_epi16(b_lo, b_lo)));
+            ss_hi = _mm_add_epi32(ss_hi, _mm_add_epi32(_mm_madd_epi16(a_hi, a_hi), _mm_madd_epi16(b_hi, b_hi)));
+            s12_lo = _mm_add_epi32(s12_lo, _mm_madd_epi16(a_lo, b_lo));
+            s12_hi = _mm_add_epi32(s12_hi, _mm_madd_epi16(a_hi, b_hi));
+        }
+        alignas(16) int32_t pairs[SSIM_SUMS][8];
+        _mm_store_si128((__m128i*)(pairs[0] + 0), _mm_madd_epi16(s1_lo, ones));
+        _mm_store_si128((__m128i*)(pairs[0] + 4), _mm_madd_epi16(s1_hi, ones));
+        _mm_store_si128((__m128i*)(pairs[1] + 0), _mm_madd_epi16(s2_lo, ones));
+        _mm_store_si128((__m128i*)(pairs[1] + 4), _mm_madd_epi16(s2_hi, ones));
+        _mm_store_si128((__m128i*)(pairs[2] + 0), ss_lo);
+        _mm_store_si128((__m128i*)(pairs[2] + 4), ss_hi);
+        _mm_store_si128((__m128i*)(pairs[3] + 0), s12_lo);
+        _mm_store_si128((__m128i*)(pairs[3] + 4), s12_hi);
+        ssim_combine_pairs(pairs, sums + i * SSIM_SUMS);
+    }
+#elif defined(QUALITY_HAS_NEON)
+    for (; i + 4 <= blocks; i += 4) {
+        uint16x8_t s1 = vdupq_n_u16(0), s2 = vdupq_n_u16(0);
+        uint32x4_t ss_lo = vdupq_n_u32(0), ss_hi = vdupq_n_u32(0);
+        uint32x4_t s12_lo = vdupq_n_u32(0), s12_hi = vdupq_n_u32(0);
+        for (int r = 0; r < 4; r++) {
+            uint8x16_t va = vld1q_u8(a + (ptrdiff_t)r * a_stride + i * 4);
+            uint8x16_t vb = vld1q_u8(b + (ptrdiff_t)r * b_stride + i * 4);
+            uint8x8_t a_lo = vget_low_u8(va), a_hi = vget_high_u8(va);
+            uint8x8_t b_lo = vget_low_u8(vb), b_hi = vget_high_u8(vb);
+            s1 = vpadalq_u8(s1, va);
+            s2 = vpadalq_u8(s2, vb);
+            ss_lo = vpadalq_u16(ss_lo, vmull_u8(a_lo, a_lo));
+            ss_lo = vpadalq_u16(ss_lo, vmull_u8(b_lo, b_lo));
+            ss_hi = vpadalq_u16(ss_hi, vmull_u8(a_hi, a_hi));
+            ss_hi = vpadalq_u16(ss_hi, vmull_u8(b_hi, b_hi));
+            s12_lo = vpadalq_u16(s12_lo, vmull_u8(a_lo, b_lo));
+            s12_hi = vpadalq_u16(s12_hi, vmull_u8(a_hi, b_hi));
+        }
+        int32_t pairs[SSIM_SUMS][8];
+        vst1q_s32(pairs[0] + 0, vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(s1))));
+        vst1q_s32(pairs[0] + 4, vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(s1))));
+        vst1q_s32(pairs[1] + 0, vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(s2))));
+        vst1q_s32(pairs[1] + 4, vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(s2))));
+        vst1q_s32(pairs[2] + 0, vreinterpretq_s32_u32(ss_lo));
+        vst1q_s32(pairs[2] + 4, vreinterpretq_s32_u32(ss_hi));
+        vst1q_s32(pairs[3] + 0, vreinterpretq_s32_u32(s12_lo));
+        vst1q_s32(pairs[3] + 4, vreinterpretq_s32_u32(s12_hi));
+        ssim_combine_pairs(pairs, sums + i * SSIM_SUMS);
+    }
+#endif
+    for (; i < blocks; i++) {
+        int s1 = 0, s2 = 0, ss = 0, s12 = 0;
+        for (int r = 0; r < 4; r++) {
+            const uint8_t* pa = a + (ptrdiff_t)r * a_stride + i * 4;
+            const uint8_t* pb = b + (ptrdiff_t)r * b_stride + i * 4;
+            for (int x = 0; x < 4; x++) {
+                int va = pa[x];
+                int vb = pb[x];
+                s1 += va;
+                s2 += vb;
+                ss += va * va + vb * vb;
+                s12 += va * vb;
+            }
+        }
+        int* out = sums + i * SSIM_SUMS;
+        out[0] = s1;
+        out[1] = s2;
+        out[2] = ss;
+        out[3] = s12;
+    }
+}
+
+// SSIM of one 8x8 window from its summed statistics (64 samples)
+static float ssim_end(int s1, int s2, int ss, int s12) {
+    static const int C1 = (int)(0.01 * 0.01 * 255 * 255 * 64 + 0.5);
+    static const int C2 = (int)(0.03 * 0.03 * 255 * 255 * 64 * 63 + 0.5);
+    int vars = ss * 64 - s1 * s1 - s2 * s2;
+    int covar = s12 * 64 - s1 * s2;
+    return (float)(2 * s1 * s2 + C1) * (float)(2 * covar + C2) /
+           ((float)(s1 * s1 + s2 * s2 + C1) * (float)(vars + C2));
+}
+
+double quality_plane_ssim(const uint8_t* a, int a_stride, const uint8_t* b, int b_stride,
+                          int width, int height, std::vector<int>& scratch) {
+    int blocks_x = width / 4;
+    int blocks_y = height / 4;
+    if (blocks_x < 2 || blocks_y < 2) {
+        return 1.0;
+    }
+
+    scratch.resize((size_t)blocks_x * SSIM_SUMS * 2);
+    int* prev = scratch.data();
+    int* cur = prev + blocks_x * SSIM_SUMS;
+    ssim_block_row(a, a_stride, b, b_stride, blocks_x, prev);
+
+    double total = 0.0;
+    for (int by = 1; by < blocks_y; by++) {
+        ssim_block_row(a + (ptrdiff_t)by * 4 * a_stride, a_stride,
+                       b + (ptrdiff_t)by * 4 * b_stride, b_stride, blocks_x, cur);
+        // Each window is the 2x2 blocks at (bx, by-1)..(bx+1, by)
+        for (int bx = 0; bx + 1 < blocks_x; bx++) {
+            const int* p = prev + bx * SSIM_SUMS;
+            const int* c = cur + bx * SSIM_SUMS;
+            int s[SSIM_SUMS];
+            for (int m = 0; m < SSIM_SUMS; m++) {
+                s[m] = p[m] + p[m + SSIM_SUMS] + c[m] + c[m + SSIM_SUMS];
+            }
+            total += ssim_end(s[0], s[1], s[2], s[3]);
+        }
+        int* swap = prev;
+        prev = cur;
+        cur = swap;
+    }
+    return total / ((double)(blocks_x - 1) * (blocks_y - 1));
+}
+
+} // namespace godot
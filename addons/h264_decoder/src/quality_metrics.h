@@ -0,0 +1,33 @@
+/*
+ * Quality Metrics
+ * PSNR and SSIM kernels for 8-bit planes, SSE2 on x86, NEON on ARM
+ *
+ * SSIM follows x264: sums over 4x4 blocks, combined into 8x8 windows
+ * overlapping by 4 pixels, with the usual C1/C2 constants for 8-bit.
+ */
+
+#ifndef QUALITY_METRICS_H
+#define QUALITY_METRICS_H
+
+#include <cstdint>
+#include <vector>
+
+namespace godot {
+
+// Sum of squared differences between two planes
+uint64_t quality_plane_sse(const uint8_t* a, int a_stride, const uint8_t* b, int b_stride,
+                           int width, int height);
+
+// PSNR in dB for a sum of squared errors over `samples` 8-bit values;
+// identical planes report QUALITY_PSNR_MAX instead of infinity
+double quality_psnr(uint64_t sse, uint64_t samples);
+static const double QUALITY_PSNR_MAX = 100.0;
+
+// Mean SSIM over all 8x8 windows; 1.0 for planes too small to have one.
+// scratch is reused between calls to avoid per-frame allocation.
+double quality_plane_ssim(const uint8_t* a, int a_stride, const uint8_t* b, int b_stride,
+                          int width, int height, std::vector<int>& scratch);
+
+} // namespace godot
+
+#endif // QUALITY_METRICS_H
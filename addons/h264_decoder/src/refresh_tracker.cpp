@@ -0,0 +1,101 @@
+/*
+ * Refresh Tracker Implementation
+ */
+
+#include "refresh_tracker.h"
+
+#include <algorithm>
+
+using namespace godot;
+
+void RefreshTracker::on_packet(const uint8_t* data, size_t size, int64_t now_usec) {
+    if (dirty_since_usec == 0 && state != STATE_CLEAN) {
+        dirty_since_usec = now_usec;
+    }
+
+    units.clear();
+    parse_nal_units(data, size, units);
+    for (const NalUnit& nal : units) {
+        if (nal.type == NAL_SEI) {
+            RecoveryPoint point;
+            if (parse_recovery_point(nal, point)) {
+                pending_recovery = point.recovery_frame_cnt;
+            }
+            continue;
+        }
+        if (!nal_starts_picture(nal)) {
+            continue;
+        }
+
+        if (nal.type == NAL_IDR) {
+            pending_recovery = -1;
+            become_clean(now_usec);
+            continue;
+        }
+
+        if (pending_recovery >= 0) {
+            // Periodic recovery points on a clean stream change nothing
+            if (state != STATE_CLEAN) {
+                state = STATE_REFRESHING;
+                recovery_frame_cnt = pending_recovery;
+                pictures_since_recovery = 0;
+            }
+            recovery_points++;
+            pending_recovery = -1;
+        } else if (state == STATE_REFRESHING) {
+            pictures_since_recovery++;
+        }
+        if (state == STATE_REFRESHING && pictures_since_recovery >= recovery_frame_cnt) {
+            become_clean(now_usec);
+        }
+    }
+}
+
+void RefreshTracker::become_clean(int64_t now_usec) {
+    if (state == STATE_CLEAN) {
+        return;
+    }
+    state = STATE_CLEAN;
+    clean_unreported = true;
+    clean_transition_usec = dirty_since_usec > 0 ? now_usec - dirty_since_usec : 0;
+    dirty_since_usec = 0;
+}
+
+void RefreshTracker::on_damage(int64_t now_usec) {
+    if (state != STATE_CLEAN) {
+        return;
+    }
+    state = STATE_WAITING;
+    dirty_since_usec = now_usec;
+    clean_unreported = false;
+}
+
+void RefreshTracker::reset() {
+    state = STATE_WAITING;
+    pending_recovery = -1;
+    pictures_since_recovery = 0;
+    dirty_since_usec = 0; // starts with the next packet
+    clean_unreported = false;
+}
+
+float RefreshTracker::get_progress() const {
+    switch (state) {
+        case STATE_CLEAN:
+            return 1.0f;
+        case STATE_REFRESHING:
+            return std::min((float)(pictures_since_recovery + 1) / (float)(recovery_frame_cnt + 1), 1.0f);
+        default:
+            return 0.0f;
+    }
+}
+
+bool RefreshTracker::take_clean_transition(int64_t& time_to_clean_usec) {
+    if (!clean_unreported || state != STATE_CLEAN) {
+        return false;
+    }
+    clean_unreported = false;
+    time_to_clean_usec = clean_transition_usec;
+    last_time_to_clean_usec = clean_transition_usec;
+    longest_time_to_clean_usec = std::max(longest_time_to_clean_usec, clean_transition_usec);
+    return true;
+}
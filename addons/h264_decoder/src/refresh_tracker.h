@@ -0,0 +1,75 @@
+/*
+ * Refresh Tracker
+ * Follows gradual intra refresh from the bitstream side
+ *
+ * A stream without periodic IDRs becomes decodable at a recovery point
+ * SEI: recovery_frame_cnt pictures later every macroblock has been coded
+ * intra (or predicted from refreshed areas) and the picture is clean. The
+ * tracker watches packets going into the decoder, so it works the same for
+ * software and hardware decoders, and counts pictures from the recovery
+ * point. Streams are low delay (one reference frame per picture, no
+ * B-frames), so the picture count stands in for frame_num.
+ */
+
+#ifndef REFRESH_TRACKER_H
+#define REFRESH_TRACKER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "nal_parser.h"
+
+namespace godot {
+
+class RefreshTracker {
+public:
+    enum State {
+        STATE_WAITING,    // no clean start yet, or damaged with no recovery point since
+        STATE_REFRESHING, // counting pictures from a recovery point
+        STATE_CLEAN,      // IDR or completed refresh, and no damage since
+    };
+
+private:
+    State state = STATE_WAITING;
+    int pending_recovery = -1;     // recovery_frame_cnt for the next picture, from its SEI
+    int recovery_frame_cnt = 0;
+    int pictures_since_recovery = 0;
+    int64_t dirty_since_usec = 0;  // when the picture last stopped being clean
+    bool clean_unreported = false;
+    int64_t clean_transition_usec = 0;
+
+    std::vector<NalUnit> units; // reused between packets
+
+    int64_t recovery_points = 0;
+    int64_t last_time_to_clean_usec = 0;
+    int64_t longest_time_to_clean_usec = 0;
+
+    void become_clean(int64_t now_usec);
+
+public:
+    // Inspect one packet before it is decoded
+    void on_packet(const uint8_t* data, size_t size, int64_t now_usec);
+    // Decode error or lost references: wait for the next recovery point
+    void on_damage(int64_t now_usec);
+    // Codec (re)opened or flushed; nothing decoded so far counts
+    void reset();
+
+    State get_state() const { return state; }
+    bool is_clean() const { return state == STATE_CLEAN; }
+    bool is_refreshing() const { return state == STATE_REFRESHING; }
+    // 0..1 through the current refresh; 1 when clean
+    float get_progress() const;
+
+    // True once per clean transition, with the time it took from the
+    // decoder starting (or the damage) to the first clean picture
+    bool take_clean_transition(int64_t& time_to_clean_usec);
+
+    int64_t get_recovery_points() const { return recovery_points; }
+    int64_t get_last_time_to_clean_usec() const { return last_time_to_clean_usec; }
+    int64_t get_longest_time_to_clean_usec() const { return longest_time_to_clean_usec; }
+};
+
+} // namespace godot
+
+#endif // REFRESH_TRACKER_H
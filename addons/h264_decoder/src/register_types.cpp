@@ -1,9 +1,18 @@
 /*
  * GDExtension Entry Point
- * Registers H264Decoder class with Godot
+ * Registers the decoder, display, atlas, cursor, snapshot, quality, audio mixer, simulcast, time-shift and wire receiver classes with Godot
  */
 
+#include "cursor_channel.h"
 #include "h264_decoder.h"
+#include "quality_meter.h"
+#include "simulcast_decoder.h"
+#include "snapshot_service.h"
+#include "stream_atlas.h"
+#include "stream_audio_mixer.h"
+#include "stream_display.h"
+#include "time_shift_buffer.h"
+#include "wire_receiver.h"
 #include <godot_cpp/core/class_db.hpp>
 #include <godot_cpp/godot.hpp>
 
@@ -14,6 +23,15 @@ void initialize_h264_decoder_module(ModuleInitializationLevel p_level) {
         return;
     }
     ClassDB::register_class<H264Decoder>();
+    ClassDB::register_class<StreamDisplay>();
+    ClassDB::register_class<CursorChannel>();
+    ClassDB::register_class<StreamAtlas>();
+    ClassDB::register_class<SnapshotService>();
+    ClassDB::register_class<QualityMeter>();
+    ClassDB::register_class<StreamAudioMixer>();
+    ClassDB::register_class<SimulcastDecoder>();
+    ClassDB::register_class<TimeShiftBuffer>();
+    ClassDB::register_class<WireReceiver>();
 }
 
 void uninitialize_h264_decoder_module(ModuleInitializationLevel p_level) {
@@ -0,0 +1,237 @@
+/*
+ * Retained Frame Implementation
+ */
+
+#include "retained_frame.h"
+#include "frame_repack.h"
+#include "tile_cache.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace godot {
+
+const uint8_t REGION_COMMAND_UUID[16] = {
+    0x57, 0x44, 0x52, 0x43, 0x6d, 0x64, 0x73, 0x01, // "WDRCmds" v1
+    0x9b, 0x3e, 0x4f, 0x1a, 0xb2, 0x77, 0x0c, 0xd5
+};
+
+static const size_t COMMAND_HEADER_SIZE = 2;
+static const size_t COMMAND_RECORD_SIZE = 13;
+
+static inline int read_u16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+static inline uint64_t read_u64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+bool RetainedFrame::parse_commands(const uint8_t* data, size_t size, std::vector<RegionCommand>& out) {
+    if (size < COMMAND_HEADER_SIZE || data[0] != 1) {
+        return false;
+    }
+    size_t count = data[1];
+    if (size < COMMAND_HEADER_SIZE + count * COMMAND_RECORD_SIZE) {
+        return false;
+    }
+
+    const uint8_t* p = data + COMMAND_HEADER_SIZE;
+    for (size_t i = 0; i < count; i++, p += COMMAND_RECORD_SIZE) {
+        RegionCommand cmd;
+        cmd.type = p[0];
+        cmd.rect.x = read_u16(p + 1);
+        cmd.rect.y = read_u16(p + 3);
+        cmd.rect.w = read_u16(p + 5);
+        cmd.rect.h = read_u16(p + 7);
+        cmd.dst_x = read_u16(p + 9);
+        cmd.dst_y = read_u16(p + 11);
+        if (cmd.type == RegionCommand::TILE) {
+            cmd.tile_id = read_u64(p + 1);
+            cmd.rect = RegionRect();
+        }
+        if (cmd.type >= RegionCommand::COPY && cmd.type <= RegionCommand::STORE) {
+            out.push_back(cmd);
+        }
+    }
+    return true;
+}
+
+bool RetainedFrame::parse_frame_commands(const AVFrame* frame, std::vector<RegionCommand>& out) {
+    bool found = false;
+    for (int i = 0; i < frame->nb_side_data; i++) {
+        const AVFrameSideData* sd = frame->side_data[i];
+        if (sd->type != AV_FRAME_DATA_SEI_UNREGISTERED || sd->size < sizeof(REGION_COMMAND_UUID)) {
+            continue;
+        }
+        if (memcmp(sd->data, REGION_COMMAND_UUID, sizeof(REGION_COMMAND_UUID)) != 0) {
+            continue;
+        }
+        found |= parse_commands(sd->data + sizeof(REGION_COMMAND_UUID),
+                                sd->size - sizeof(REGION_COMMAND_UUID), out);
+    }
+    return found;
+}
+
+bool RetainedFrame::is_valid(int frame_width, int frame_height) const {
+    return width > 0 && width == frame_width && height == frame_height;
+}
+
+void RetainedFrame::clear() {
+    width = 0;
+    height = 0;
+    y_plane.clear();
+    uv_plane.clear();
+    dirty_rects.clear();
+}
+
+bool RetainedFrame::clip_rect(RegionRect& rect) const {
+    int x0 = std::max(rect.x & ~1, 0);
+    int y0 = std::max(rect.y & ~1, 0);
+    int x1 = std::min((rect.x + rect.w + 1) & ~1, width & ~1);
+    int y1 = std::min((rect.y + rect.h + 1) & ~1, height & ~1);
+    rect.x = x0;
+    rect.y = y0;
+    rect.w = x1 - x0;
+    rect.h = y1 - y0;
+    return rect.w > 0 && rect.h > 0;
+}
+
+void RetainedFrame::add_dirty(const RegionRect& rect) {
+    dirty_rects.push_back(rect);
+}
+
+void RetainedFrame::replace(const uint8_t* y_src, const uint8_t* uv_src, int frame_width, int frame_height) {
+    width = frame_width;
+    height = frame_height;
+    y_plane.assign(y_src, y_src + (size_t)width * height);
+    uv_plane.assign(uv_src, uv_src + (size_t)width * (height / 2));
+
+    dirty_rects.clear();
+    RegionRect full;
+    full.w = width;
+    full.h = height;
+    add_dirty(full);
+}
+
+void RetainedFrame::copy_rect(const RegionRect& src, int dst_x, int dst_y) {
+    // Even coordinates keep the 2x2 chroma sites together
+    int sx = src.x & ~1;
+    int sy = src.y & ~1;
+    int tx = dst_x & ~1;
+    int ty = dst_y & ~1;
+    int w = (src.w + 1) & ~1;
+    int h = (src.h + 1) & ~1;
+
+    // Clip source and target together
+    int shift_x = std::max(std::max(-sx, -tx), 0);
+    int shift_y = std::max(std::max(-sy, -ty), 0);
+    sx += shift_x;
+    tx += shift_x;
+    w -= shift_x;
+    sy += shift_y;
+    ty += shift_y;
+    h -= shift_y;
+    w = std::min(w, (width & ~1) - std::max(sx, tx));
+    h = std::min(h, (height & ~1) - std::max(sy, ty));
+    if (w <= 0 || h <= 0 || (sx == tx && sy == ty)) {
+        return;
+    }
+
+    // Walk rows away from the overlap; memmove handles overlap within a row
+    bool bottom_up = ty > sy;
+    for (int i = 0; i < h; i++) {
+        int row = bottom_up ? h - 1 - i : i;
+        memmove(y_plane.data() + (size_t)(ty + row) * width + tx,
+                y_plane.data() + (size_t)(sy + row) * width + sx, w);
+    }
+
+    int uv_width = width / 2;
+    int cw = w / 2;
+    int ch = h / 2;
+    for (int i = 0; i < ch; i++) {
+        int row = bottom_up ? ch - 1 - i : i;
+        uint8_t* dst_row = uv_plane.data() + (size_t)(ty / 2 + row) * width;
+        const uint8_t* src_row = uv_plane.data() + (size_t)(sy / 2 + row) * width;
+        memmove(dst_row + tx / 2, src_row + sx / 2, cw);
+        memmove(dst_row + uv_width + tx / 2, src_row + uv_width + sx / 2, cw);
+    }
+
+    RegionRect dirty;
+    dirty.x = tx;
+    dirty.y = ty;
+    dirty.w = w;
+    dirty.h = h;
+    add_dirty(dirty);
+}
+
+bool RetainedFrame::update_from_frame(const AVFrame* frame, const RegionRect& region) {
+    bool planar_420 = frame->format == AV_PIX_FMT_YUV420P || frame->format == AV_PIX_FMT_YUVJ420P;
+    bool planar_422 = frame->format == AV_PIX_FMT_YUV422P || frame->format == AV_PIX_FMT_YUVJ422P;
+    bool semi_planar = frame->format == AV_PIX_FMT_NV12 || frame->format == AV_PIX_FMT_NV21;
+    if (!planar_420 && !planar_422 && !semi_planar) {
+        return false;
+    }
+    if (!frame->data[0] || !frame->data[1] || (!semi_planar && !frame->data[2])) {
+        return false;
+    }
+
+    RegionRect rect = region;
+    if (!clip_rect(rect)) {
+        return true;
+    }
+
+    for (int row = rect.y; row < rect.y + rect.h; row++) {
+        memcpy(y_plane.data() + (size_t)row * width + rect.x,
+               frame->data[0] + (size_t)row * frame->linesize[0] + rect.x, rect.w);
+    }
+
+    int uv_width = width / 2;
+    int cx = rect.x / 2;
+    int cw = rect.w / 2;
+    int first_row = rect.y / 2;
+    int end_row = (rect.y + rect.h) / 2;
+    if (semi_planar) {
+        uint8_t* dst = uv_plane.data() + (size_t)first_row * width + cx;
+        repack_deinterleave_region(dst, dst + uv_width, width,
+                                   frame->data[1] + (size_t)first_row * frame->linesize[1] + cx * 2,
+                                   frame->linesize[1], cw, end_row - first_row,
+                                   frame->format == AV_PIX_FMT_NV21);
+    } else {
+        for (int row = first_row; row < end_row; row++) {
+            uint8_t* dst_row = uv_plane.data() + (size_t)row * width;
+            // 4:2:2 is sampled every other row, same as the full repack
+            int src_row = planar_422 ? row * 2 : row;
+            memcpy(dst_row + cx, frame->data[1] + (size_t)src_row * frame->linesize[1] + cx, cw);
+            memcpy(dst_row + uv_width + cx, frame->data[2] + (size_t)src_row * frame->linesize[2] + cx, cw);
+        }
+    }
+
+    add_dirty(rect);
+    return true;
+}
+
+bool RetainedFrame::blit_tile(TileCache& cache, uint64_t id, int x, int y) {
+    if (!cache.blit_to_planes(id, y_plane.data(), uv_plane.data(), width, height, x, y)) {
+        return false;
+    }
+    RegionRect dirty;
+    dirty.x = x & ~1;
+    dirty.y = y & ~1;
+    dirty.w = TileCache::TILE_SIZE;
+    dirty.h = TileCache::TILE_SIZE;
+    if (clip_rect(dirty)) {
+        add_dirty(dirty);
+    }
+    return true;
+}
+
+int RetainedFrame::store_tiles(TileCache& cache, const RegionRect& rect) const {
+    return cache.insert_region(y_plane.data(), uv_plane.data(), width, height, rect.x, rect.y, rect.w, rect.h);
+}
+
+} // namespace godot
@@ -0,0 +1,108 @@
+/*
+ * Retained Frame
+ * Client-side copy of the last output picture that server region commands edit in place
+ *
+ * Scrolling and window drags arrive as COPY commands that move regions of
+ * the retained Y and U|V planes; only UPDATE regions are taken from the
+ * decoded picture. Commands come from a user_data_unregistered SEI tagged
+ * with REGION_COMMAND_UUID or from a side channel, using the same payload:
+ *
+ *   u8  version (1)
+ *   u8  count
+ *   count x { u8 type; u16 x, y, w, h, dst_x, dst_y }   (little endian)
+ *
+ *   type 0 = COPY   move (x, y, w, h) to (dst_x, dst_y) inside the retained frame
+ *   type 1 = UPDATE take (x, y, w, h) from the decoded picture
+ *   type 2 = TILE   draw cached tile (x..h hold its u64 id) at (dst_x, dst_y)
+ *   type 3 = STORE  cache every whole tile inside (x, y, w, h) after this frame
+ *
+ * Commands apply in order. A frame with no commands replaces the whole picture.
+ */
+
+#ifndef RETAINED_FRAME_H
+#define RETAINED_FRAME_H
+
+#include <cstdint>
+#include <vector>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+namespace godot {
+
+class TileCache;
+
+// SEI user_data_unregistered UUID carrying region commands
+extern const uint8_t REGION_COMMAND_UUID[16];
+
+struct RegionRect {
+    int x = 0;
+    int y = 0;
+    int w = 0;
+    int h = 0;
+};
+
+struct RegionCommand {
+    enum Type {
+        COPY = 0,
+        UPDATE = 1,
+        TILE = 2,
+        STORE = 3,
+    };
+
+    int type = UPDATE;
+    RegionRect rect;
+    int dst_x = 0;
+    int dst_y = 0;
+    uint64_t tile_id = 0;
+};
+
+class RetainedFrame {
+private:
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> y_plane;
+    std::vector<uint8_t> uv_plane; // U|V rows, `width` bytes per row
+    std::vector<RegionRect> dirty_rects;
+
+    // Clip to the frame and snap to even coordinates so chroma stays aligned
+    bool clip_rect(RegionRect& rect) const;
+    void add_dirty(const RegionRect& rect);
+
+public:
+    // Parse a command payload; returns false if malformed (nothing appended)
+    static bool parse_commands(const uint8_t* data, size_t size, std::vector<RegionCommand>& out);
+    // Collect commands from the frame's unregistered SEI, if any
+    static bool parse_frame_commands(const AVFrame* frame, std::vector<RegionCommand>& out);
+
+    bool is_valid(int frame_width, int frame_height) const;
+
+    // Start over from a fully repacked picture
+    void replace(const uint8_t* y_src, const uint8_t* uv_src, int frame_width, int frame_height);
+
+    // Move a region inside the retained planes; source and target may overlap
+    void copy_rect(const RegionRect& src, int dst_x, int dst_y);
+
+    // Take a region from the decoded frame. Returns false for pixel formats it
+    // can't read directly; the caller then falls back to a full replace.
+    bool update_from_frame(const AVFrame* frame, const RegionRect& rect);
+
+    // Draw a cached tile at (x, y); false on a cache miss
+    bool blit_tile(TileCache& cache, uint64_t id, int x, int y);
+    // Cache the whole tiles inside a region of the retained picture
+    int store_tiles(TileCache& cache, const RegionRect& rect) const;
+
+    void clear_dirty() { dirty_rects.clear(); }
+    const std::vector<RegionRect>& get_dirty_rects() const { return dirty_rects; }
+
+    const uint8_t* get_y() const { return y_plane.data(); }
+    const uint8_t* get_uv() const { return uv_plane.data(); }
+    size_t get_memory_usage() const { return y_plane.capacity() + uv_plane.capacity(); }
+
+    void clear();
+};
+
+} // namespace godot
+
+#endif // RETAINED_FRAME_H
@@ -0,0 +1,165 @@
+/*
+ * RGBA Converter Implementation
+ */
+
+#include "rgba_converter.h"
+#include "worker_pool.h"
+
+extern "C" {
+#include <libavutil/pixdesc.h>
+}
+
+using namespace godot;
+
+bool RgbaConverter::Key::operator==(const Key& other) const {
+    return src_width == other.src_width && src_height == other.src_height &&
+           src_format == other.src_format && dst_width == other.dst_width &&
+           dst_height == other.dst_height && dst_format == other.dst_format &&
+           colorspace == other.colorspace && full_range == other.full_range &&
+           bands == other.bands;
+}
+
+RgbaConverter::~RgbaConverter() {
+    clear();
+}
+
+void RgbaConverter::clear() {
+    for (SwsContext* ctx : contexts) {
+        sws_freeContext(ctx);
+    }
+    contexts.clear();
+    band_rows.clear();
+    key = Key();
+}
+
+int RgbaConverter::get_sws_colorspace(const AVFrame* src) {
+    switch (src->colorspace) {
+        case AVCOL_SPC_BT709:
+            return SWS_CS_ITU709;
+        case AVCOL_SPC_FCC:
+            return SWS_CS_FCC;
+        case AVCOL_SPC_SMPTE240M:
+            return SWS_CS_SMPTE240M;
+        case AVCOL_SPC_BT2020_NCL:
+        case AVCOL_SPC_BT2020_CL:
+            return SWS_CS_BT2020;
+        case AVCOL_SPC_BT470BG:
+        case AVCOL_SPC_SMPTE170M:
+            return SWS_CS_ITU601;
+        default:
+            // Unspecified: encoders in practice tag nothing and use 709 for HD
+            return src->height >= 720 ? SWS_CS_ITU709 : SWS_CS_ITU601;
+    }
+}
+
+bool RgbaConverter::is_full_range(const AVFrame* src) {
+    return src->color_range == AVCOL_RANGE_JPEG ||
+           src->format == AV_PIX_FMT_YUVJ420P ||
+           src->format == AV_PIX_FMT_YUVJ422P ||
+           src->format == AV_PIX_FMT_YUVJ444P;
+}
+
+// swscale warns about the deprecated J formats; feed it the plain
+// equivalent and pass the range explicitly instead.
+static AVPixelFormat strip_jpeg_format(int format) {
+    switch (format) {
+        case AV_PIX_FMT_YUVJ420P: return AV_PIX_FMT_YUV420P;
+        case AV_PIX_FMT_YUVJ422P: return AV_PIX_FMT_YUV422P;
+        case AV_PIX_FMT_YUVJ444P: return AV_PIX_FMT_YUV444P;
+        default: return (AVPixelFormat)format;
+    }
+}
+
+bool RgbaConverter::rebuild(const Key& new_key, int flags) {
+    clear();
+
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get((AVPixelFormat)new_key.src_format);
+    if (!desc) {
+        return false;
+    }
+
+    // Band edges must land on chroma rows
+    int align = 1 << desc->log2_chroma_h;
+    for (int b = 0; b < new_key.bands; b++) {
+        int row = (int)((int64_t)new_key.src_height * b / new_key.bands);
+        band_rows.push_back(row - row % align);
+    }
+    band_rows.push_back(new_key.src_height);
+
+    const int* src_coeffs = sws_getCoefficients(new_key.colorspace);
+    const int* dst_coeffs = sws_getCoefficients(SWS_CS_DEFAULT);
+
+    for (int b = 0; b < new_key.bands; b++) {
+        int src_rows = band_rows[b + 1] - band_rows[b];
+        // Bands are only used 1:1, so a band's output height equals its input height
+        int dst_rows = new_key.bands == 1 ? new_key.dst_height : src_rows;
+
+        SwsContext* ctx = sws_getContext(new_key.src_width, src_rows, (AVPixelFormat)new_key.src_format,
+                                         new_key.dst_width, dst_rows, (AVPixelFormat)new_key.dst_format,
+                                         flags, nullptr, nullptr, nullptr);
+        if (!ctx) {
+            clear();
+            return false;
+        }
+        sws_setColorspaceDetails(ctx, src_coeffs, new_key.full_range, dst_coeffs, 1, 0, 1 << 16, 1 << 16);
+        contexts.push_back(ctx);
+    }
+
+    key = new_key;
+    return true;
+}
+
+bool RgbaConverter::convert(const AVFrame* src, uint8_t* dst, int dst_stride, int dst_width, int dst_height,
+                            AVPixelFormat dst_format, int bands, int flags) {
+    if (!src || !src->data[0] || !dst || dst_width <= 0 || dst_height <= 0) {
+        return false;
+    }
+
+    bool scaled = dst_width != src->width || dst_height != src->height;
+    if (scaled || bands < 1) {
+        bands = 1;
+    }
+    // Keep at least a couple of chroma rows per band
+    if (bands > src->height / 4) {
+        bands = src->height / 4 > 0 ? src->height / 4 : 1;
+    }
+
+    Key new_key;
+    new_key.src_width = src->width;
+    new_key.src_height = src->height;
+    new_key.src_format = strip_jpeg_format(src->format);
+    new_key.dst_width = dst_width;
+    new_key.dst_height = dst_height;
+    new_key.dst_format = dst_format;
+    new_key.colorspace = get_sws_colorspace(src);
+    new_key.full_range = is_full_range(src) ? 1 : 0;
+    new_key.bands = bands;
+
+    if (contexts.empty() || !(new_key == key)) {
+        if (!rebuild(new_key, flags)) {
+            return false;
+        }
+    }
+
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get((AVPixelFormat)key.src_format);
+
+    WorkerPool::get_shared().parallel_for(bands, [&](int band) {
+        int row = band_rows[band];
+        int rows = band_rows[band + 1] - row;
+
+        const uint8_t* src_planes[4] = { nullptr, nullptr, nullptr, nullptr };
+        int src_strides[4] = { 0, 0, 0, 0 };
+        for (int p = 0; p < 4 && src->data[p]; p++) {
+            int plane_row = (p == 1 || p == 2) ? (row >> desc->log2_chroma_h) : row;
+            src_planes[p] = src->data[p] + (ptrdiff_t)plane_row * src->linesize[p];
+            src_strides[p] = src->linesize[p];
+        }
+
+        uint8_t* dst_planes[4] = { dst + (ptrdiff_t)row * dst_stride, nullptr, nullptr, nullptr };
+        int dst_strides[4] = { dst_stride, 0, 0, 0 };
+
+        sws_scale(contexts[band], src_planes, src_strides, 0, rows, dst_planes, dst_strides);
+    });
+
+    return true;
+}
@@ -0,0 +1,69 @@
+/*
+ * RGBA Converter
+ * Cached swscale conversion of decoded frames to packed RGBA/BGRA
+ *
+ * Used by the Compatibility renderer fallback and for CPU-side images
+ * (screenshots, thumbnails). Frames are split into horizontal bands, each
+ * with its own SwsContext, so bands can be converted in parallel.
+ */
+
+#ifndef RGBA_CONVERTER_H
+#define RGBA_CONVERTER_H
+
+#include <cstdint>
+#include <vector>
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/pixfmt.h>
+#include <libswscale/swscale.h>
+}
+
+namespace godot {
+
+class RgbaConverter {
+private:
+    // Everything the band contexts were built for; any change rebuilds them
+    struct Key {
+        int src_width = 0;
+        int src_height = 0;
+        int src_format = AV_PIX_FMT_NONE;
+        int dst_width = 0;
+        int dst_height = 0;
+        int dst_format = AV_PIX_FMT_NONE;
+        int colorspace = 0;
+        int full_range = 0;
+        int bands = 0;
+
+        bool operator==(const Key& other) const;
+    };
+
+    Key key;
+    std::vector<SwsContext*> contexts;
+    std::vector<int> band_rows; // first source row of each band, plus the end row
+
+    bool rebuild(const Key& new_key, int flags);
+
+public:
+    RgbaConverter() = default;
+    ~RgbaConverter();
+
+    RgbaConverter(const RgbaConverter&) = delete;
+    RgbaConverter& operator=(const RgbaConverter&) = delete;
+
+    // Convert `src` into dst (dst_stride bytes per row, 4 bytes per pixel).
+    // dst_format must be AV_PIX_FMT_RGBA or AV_PIX_FMT_BGRA. Bands are only
+    // used for 1:1 conversion; scaled output always runs as a single band.
+    bool convert(const AVFrame* src, uint8_t* dst, int dst_stride, int dst_width, int dst_height,
+                 AVPixelFormat dst_format, int bands, int flags = SWS_BILINEAR);
+
+    // Swscale colorspace (SWS_CS_*) and range chosen for a frame's color metadata
+    static int get_sws_colorspace(const AVFrame* src);
+    static bool is_full_range(const AVFrame* src);
+
+    void clear();
+};
+
+} // namespace godot
+
+#endif // RGBA_CONVERTER_H
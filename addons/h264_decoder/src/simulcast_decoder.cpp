@@ -0,0 +1,409 @@
+/*
+ * Simulcast Decoder Implementation
+ */
+
+#include "simulcast_decoder.h"
+
+#include <godot_cpp/variant/array.hpp>
+#include <godot_cpp/variant/utility_functions.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+using namespace godot;
+
+// Smoothing for loss share, interval and load
+static const float LOSS_ALPHA = 1.0f / 32.0f;
+static const float EMA_ALPHA = 0.1f;
+
+static int64_t current_usec() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static const char* layer_name(int layer) {
+    return layer == SimulcastDecoder::LAYER_HIGH ? "high" : "low";
+}
+
+void SimulcastDecoder::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("push_datagram", "layer", "datagram"), &SimulcastDecoder::push_datagram);
+    ClassDB::bind_method(D_METHOD("push_packet", "layer", "h264_data"), &SimulcastDecoder::push_packet);
+    ClassDB::bind_method(D_METHOD("report_loss", "layer", "frames"), &SimulcastDecoder::report_loss);
+    ClassDB::bind_method(D_METHOD("get_layer_decoder", "layer"), &SimulcastDecoder::get_layer_decoder);
+    ClassDB::bind_method(D_METHOD("get_active_layer"), &SimulcastDecoder::get_active_layer);
+    ClassDB::bind_method(D_METHOD("is_switching"), &SimulcastDecoder::is_switching);
+    ClassDB::bind_method(D_METHOD("get_target_layer"), &SimulcastDecoder::get_target_layer);
+    ClassDB::bind_method(D_METHOD("get_width"), &SimulcastDecoder::get_width);
+    ClassDB::bind_method(D_METHOD("get_height"), &SimulcastDecoder::get_height);
+    ClassDB::bind_method(D_METHOD("set_layer_mode", "mode"), &SimulcastDecoder::set_layer_mode);
+    ClassDB::bind_method(D_METHOD("get_layer_mode"), &SimulcastDecoder::get_layer_mode);
+    ClassDB::bind_method(D_METHOD("set_downgrade_load", "value"), &SimulcastDecoder::set_downgrade_load);
+    ClassDB::bind_method(D_METHOD("get_downgrade_load"), &SimulcastDecoder::get_downgrade_load);
+    ClassDB::bind_method(D_METHOD("set_upgrade_load", "value"), &SimulcastDecoder::set_upgrade_load);
+    ClassDB::bind_method(D_METHOD("get_upgrade_load"), &SimulcastDecoder::get_upgrade_load);
+    ClassDB::bind_method(D_METHOD("set_loss_threshold", "value"), &SimulcastDecoder::set_loss_threshold);
+    ClassDB::bind_method(D_METHOD("get_loss_threshold"), &SimulcastDecoder::get_loss_threshold);
+    ClassDB::bind_method(D_METHOD("set_downgrade_hold_msec", "msec"), &SimulcastDecoder::set_downgrade_hold_msec);
+    ClassDB::bind_method(D_METHOD("get_downgrade_hold_msec"), &SimulcastDecoder::get_downgrade_hold_msec);
+    ClassDB::bind_method(D_METHOD("set_upgrade_hold_msec", "msec"), &SimulcastDecoder::set_upgrade_hold_msec);
+    ClassDB::bind_method(D_METHOD("get_upgrade_hold_msec"), &SimulcastDecoder::get_upgrade_hold_msec);
+    ClassDB::bind_method(D_METHOD("set_switch_timeout_msec", "msec"), &SimulcastDecoder::set_switch_timeout_msec);
+    ClassDB::bind_method(D_METHOD("get_switch_timeout_msec"), &SimulcastDecoder::get_switch_timeout_msec);
+    ClassDB::bind_method(D_METHOD("get_stats"), &SimulcastDecoder::get_stats);
+    ClassDB::bind_method(D_METHOD("reset"), &SimulcastDecoder::reset);
+
+    BIND_ENUM_CONSTANT(LAYER_LOW);
+    BIND_ENUM_CONSTANT(LAYER_HIGH);
+
+    BIND_ENUM_CONSTANT(LAYER_MODE_AUTO);
+    BIND_ENUM_CONSTANT(LAYER_MODE_LOW);
+    BIND_ENUM_CONSTANT(LAYER_MODE_HIGH);
+
+    BIND_ENUM_CONSTANT(SWITCH_REASON_NONE);
+    BIND_ENUM_CONSTANT(SWITCH_REASON_LOAD);
+    BIND_ENUM_CONSTANT(SWITCH_REASON_LOSS);
+    BIND_ENUM_CONSTANT(SWITCH_REASON_HEADROOM);
+    BIND_ENUM_CONSTANT(SWITCH_REASON_MANUAL);
+
+    ADD_SIGNAL(MethodInfo("layer_switched",
+        PropertyInfo(Variant::INT, "from_layer"),
+        PropertyInfo(Variant::INT, "to_layer"),
+        PropertyInfo(Variant::INT, "reason"),
+        PropertyInfo(Variant::INT, "switch_msec")));
+}
+
+SimulcastDecoder::SimulcastDecoder() {
+    for (LayerState& state : layers) {
+        state.decoder.instantiate();
+    }
+}
+
+PackedByteArray SimulcastDecoder::push_datagram(int layer, const PackedByteArray& datagram) {
+    if (!valid_layer(layer)) {
+        return PackedByteArray();
+    }
+    LayerState& state = layers[layer];
+    WireReassembler::Message message;
+    bool complete = state.reassembler.push(datagram.ptr(), (size_t)datagram.size(), message);
+
+    int64_t now = current_usec();
+    int64_t lost = state.reassembler.get_lost();
+    if (lost > state.lost_seen) {
+        record_loss(state, lost - state.lost_seen);
+        state.lost_seen = lost;
+    }
+    if (!complete || message.type != WIRE_VIDEO) {
+        // Fragments of a layer that keeps losing frames still drive the policy
+        evaluate_policy(now);
+        return PackedByteArray();
+    }
+
+    // Only the layers being decoded need the access unit as a PackedByteArray
+    PackedByteArray packet;
+    if (layer == active || (switching && layer == target)) {
+        packet.resize((int64_t)message.size);
+        if (message.size > 0) {
+            memcpy(packet.ptrw(), message.data, message.size);
+        }
+    }
+    return process_packet((Layer)layer, message.data, message.size, packet, now);
+}
+
+PackedByteArray SimulcastDecoder::push_packet(int layer, const PackedByteArray& h264_data) {
+    if (!valid_layer(layer) || h264_data.is_empty()) {
+        return PackedByteArray();
+    }
+    return process_packet((Layer)layer, h264_data.ptr(), (size_t)h264_data.size(), h264_data, current_usec());
+}
+
+void SimulcastDecoder::report_loss(int layer, int frames) {
+    if (valid_layer(layer) && frames > 0) {
+        record_loss(layers[layer], frames);
+    }
+}
+
+void SimulcastDecoder::record_loss(LayerState& state, int64_t frames) {
+    state.lost += frames;
+    // n losses in a row: 1 - (1 - rate) * (1 - alpha)^n
+    int64_t steps = std::min<int64_t>(frames, 256);
+    float kept = 1.0f - state.loss_rate;
+    for (int64_t i = 0; i < steps; i++) {
+        kept *= 1.0f - LOSS_ALPHA;
+    }
+    state.loss_rate = 1.0f - kept;
+}
+
+bool SimulcastDecoder::is_switch_point(const uint8_t* data, size_t size) {
+    units.clear();
+    parse_nal_units(data, size, units);
+    for (const NalUnit& nal : units) {
+        if (nal.type == NAL_IDR) {
+            return true;
+        }
+        RecoveryPoint point;
+        if (nal.type == NAL_SEI && parse_recovery_point(nal, point)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+PackedByteArray SimulcastDecoder::process_packet(Layer layer, const uint8_t* data, size_t size,
+                                                 const PackedByteArray& packet, int64_t now_usec) {
+    LayerState& state = layers[layer];
+    state.packets++;
+    state.bytes += (int64_t)size;
+    state.loss_rate *= 1.0f - LOSS_ALPHA;
+    if (state.last_packet_usec > 0) {
+        float interval = (float)(now_usec - state.last_packet_usec);
+        state.interval_usec = state.interval_usec > 0.0f
+            ? state.interval_usec + (interval - state.interval_usec) * EMA_ALPHA
+            : interval;
+    }
+    state.last_packet_usec = now_usec;
+
+    // Cheap bookkeeping for both layers, so either can start at any time
+    state.parameter_sets.update(data, size);
+    bool switch_point = is_switch_point(data, size);
+    if (switch_point) {
+        state.switch_points++;
+    }
+
+    PackedByteArray output;
+    if (switching && layer == target) {
+        output = feed_target(packet, switch_point, now_usec);
+    } else if (layer == active) {
+        auto start = std::chrono::steady_clock::now();
+        output = state.decoder->decode_frame(packet);
+        last_decode_usec = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+
+        if (!output.is_empty()) {
+            state.frames_decoded++;
+            state.width = state.decoder->get_width();
+            state.height = state.decoder->get_height();
+            if (state.interval_usec > 0.0f) {
+                float sample = (float)last_decode_usec / state.interval_usec;
+                load = load_samples > 0 ? load + (sample - load) * EMA_ALPHA : sample;
+                load_samples++;
+            }
+        }
+    }
+    // On every packet of either layer, so the switch timeout and loss-driven
+    // switches still fire when the active layer has gone quiet
+    evaluate_policy(now_usec);
+    return output;
+}
+
+PackedByteArray SimulcastDecoder::feed_target(const PackedByteArray& packet, bool switch_point, int64_t now_usec) {
+    LayerState& state = layers[target];
+    PackedByteArray input = packet;
+    if (!target_started) {
+        if (!switch_point) {
+            return PackedByteArray();
+        }
+        target_started = true;
+        // Fresh codec, and the SPS/PPS it may have missed while idle
+        state.decoder->cleanup();
+        std::vector<uint8_t> sets = state.parameter_sets.build_annex_b();
+        if (!sets.empty()) {
+            input.resize((int64_t)sets.size() + packet.size());
+            memcpy(input.ptrw(), sets.data(), sets.size());
+            memcpy(input.ptrw() + sets.size(), packet.ptr(), (size_t)packet.size());
+        }
+    }
+
+    PackedByteArray output = state.decoder->decode_frame(input);
+    if (output.is_empty()) {
+        return output;
+    }
+    state.frames_decoded++;
+    state.width = state.decoder->get_width();
+    state.height = state.decoder->get_height();
+    // Until the refresh completes the old layer's picture stays up
+    if (state.decoder->get_refresh_state() != H264Decoder::REFRESH_CLEAN) {
+        return PackedByteArray();
+    }
+    complete_switch(now_usec);
+    return output;
+}
+
+void SimulcastDecoder::evaluate_policy(int64_t now_usec) {
+    if (switching && now_usec - switch_request_usec > (int64_t)switch_timeout_msec * 1000) {
+        UtilityFunctions::print("[SimulcastDecoder] No clean picture on the ", layer_name(target),
+                                " layer after ", switch_timeout_msec, " ms, staying on ", layer_name(active));
+        abandon_switch();
+        switch_timeouts++;
+        next_switch_usec = now_usec + (int64_t)switch_timeout_msec * 1000;
+    }
+
+    Layer desired = active;
+    SwitchReason reason = SWITCH_REASON_NONE;
+    if (mode != LAYER_MODE_AUTO) {
+        desired = mode == LAYER_MODE_HIGH ? LAYER_HIGH : LAYER_LOW;
+        reason = SWITCH_REASON_MANUAL;
+    } else if (active == LAYER_HIGH) {
+        const LayerState& high = layers[LAYER_HIGH];
+        const LayerState& low = layers[LAYER_LOW];
+        if (load_samples >= MIN_LOAD_SAMPLES && load > downgrade_load) {
+            if (overload_since_usec == 0) {
+                overload_since_usec = now_usec;
+            }
+        } else {
+            overload_since_usec = 0;
+        }
+        if (overload_since_usec > 0 && now_usec - overload_since_usec >= (int64_t)downgrade_hold_msec * 1000) {
+            desired = LAYER_LOW;
+            reason = SWITCH_REASON_LOAD;
+        } else if (high.loss_rate > loss_threshold && low.packets > 0 && low.loss_rate < high.loss_rate) {
+            desired = LAYER_LOW;
+            reason = SWITCH_REASON_LOSS;
+        }
+    } else {
+        const LayerState& high = layers[LAYER_HIGH];
+        bool headroom = load_samples >= MIN_LOAD_SAMPLES && high.packets > 0 &&
+                        load * get_cost_ratio() < upgrade_load && high.loss_rate < loss_threshold * 0.5f;
+        if (headroom) {
+            if (headroom_since_usec == 0) {
+                headroom_since_usec = now_usec;
+            }
+        } else {
+            headroom_since_usec = 0;
+        }
+        if (headroom_since_usec > 0 && now_usec - headroom_since_usec >= (int64_t)upgrade_hold_msec * 1000) {
+            desired = LAYER_HIGH;
+            reason = SWITCH_REASON_HEADROOM;
+        }
+    }
+
+    if (desired == active) {
+        // Automatic switches run to completion; a pinned mode overrides them
+        if (switching && reason == SWITCH_REASON_MANUAL) {
+            abandon_switch();
+        }
+        return;
+    }
+    if (switching || (reason != SWITCH_REASON_MANUAL && now_usec < next_switch_usec)) {
+        return;
+    }
+    begin_switch(desired, reason, now_usec);
+}
+
+void SimulcastDecoder::begin_switch(Layer layer, SwitchReason reason, int64_t now_usec) {
+    switching = true;
+    target = layer;
+    pending_reason = reason;
+    target_started = false;
+    switch_request_usec = now_usec;
+    UtilityFunctions::print("[SimulcastDecoder] Switching to the ", layer_name(layer),
+                            " layer at its next IDR or recovery point");
+}
+
+void SimulcastDecoder::complete_switch(int64_t now_usec) {
+    Layer from = active;
+    active = target;
+    switching = false;
+    target_started = false;
+
+    last_switch_usec = now_usec - switch_request_usec;
+    longest_switch_usec = std::max(longest_switch_usec, last_switch_usec);
+    switches++;
+    switches_by_reason[pending_reason]++;
+
+    // The old layer's frames and codec are no longer needed
+    layers[from].decoder->cleanup();
+    load = 0.0f;
+    load_samples = 0;
+    overload_since_usec = 0;
+    headroom_since_usec = 0;
+
+    UtilityFunctions::print("[SimulcastDecoder] Switched to the ", layer_name(active), " layer in ",
+                            last_switch_usec / 1000, " ms");
+    emit_signal("layer_switched", (int)from, (int)active, (int)pending_reason, last_switch_usec / 1000);
+}
+
+void SimulcastDecoder::abandon_switch() {
+    if (!switching) {
+        return;
+    }
+    layers[target].decoder->cleanup();
+    switching = false;
+    target_started = false;
+}
+
+float SimulcastDecoder::get_cost_ratio() const {
+    const LayerState& low = layers[LAYER_LOW];
+    const LayerState& high = layers[LAYER_HIGH];
+    if (low.width > 0 && low.height > 0 && high.width > 0 && high.height > 0) {
+        return (float)((int64_t)high.width * high.height) / (float)((int64_t)low.width * low.height);
+    }
+    return 4.0f;
+}
+
+Ref<H264Decoder> SimulcastDecoder::get_layer_decoder(int layer) const {
+    return valid_layer(layer) ? layers[layer].decoder : Ref<H264Decoder>();
+}
+
+int SimulcastDecoder::get_width() const {
+    return layers[active].decoder->get_width();
+}
+
+int SimulcastDecoder::get_height() const {
+    return layers[active].decoder->get_height();
+}
+
+Dictionary SimulcastDecoder::get_stats() const {
+    Dictionary stats;
+    stats["active_layer"] = (int)active;
+    stats["target_layer"] = (int)get_target_layer();
+    stats["switching"] = switching;
+    stats["layer_mode"] = (int)mode;
+    stats["load"] = load;
+    stats["cost_ratio"] = get_cost_ratio();
+    stats["decode_usec"] = last_decode_usec;
+    stats["switches"] = switches;
+    stats["switches_load"] = switches_by_reason[SWITCH_REASON_LOAD];
+    stats["switches_loss"] = switches_by_reason[SWITCH_REASON_LOSS];
+    stats["switches_headroom"] = switches_by_reason[SWITCH_REASON_HEADROOM];
+    stats["switches_manual"] = switches_by_reason[SWITCH_REASON_MANUAL];
+    stats["switch_timeouts"] = switch_timeouts;
+    stats["last_switch_msec"] = last_switch_usec / 1000;
+    stats["longest_switch_msec"] = longest_switch_usec / 1000;
+
+    Array layer_stats;
+    for (const LayerState& state : layers) {
+        Dictionary entry;
+        entry["packets"] = state.packets;
+        entry["bytes"] = state.bytes;
+        entry["lost"] = state.lost;
+        entry["loss_rate"] = state.loss_rate;
+        entry["switch_points"] = state.switch_points;
+        entry["frames_decoded"] = state.frames_decoded;
+        entry["width"] = state.width;
+        entry["height"] = state.height;
+        entry["late_datagrams"] = state.reassembler.get_late();
+        entry["malformed_datagrams"] = state.reassembler.get_malformed();
+        layer_stats.push_back(entry);
+    }
+    stats["layers"] = layer_stats;
+    return stats;
+}
+
+void SimulcastDecoder::reset() {
+    abandon_switch();
+    for (LayerState& state : layers) {
+        state.decoder->cleanup();
+        state.reassembler.reset();
+        state.parameter_sets.clear();
+        state.lost_seen = 0;
+        state.loss_rate = 0.0f;
+        state.last_packet_usec = 0;
+        state.interval_usec = 0.0f;
+    }
+    load = 0.0f;
+    load_samples = 0;
+    overload_since_usec = 0;
+    headroom_since_usec = 0;
+    next_switch_usec = 0;
+}
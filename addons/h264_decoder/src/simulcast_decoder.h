@@ -0,0 +1,187 @@
+/*
+ * Simulcast Decoder
+ * Two resolution layers of the same desktop, one of them decoded at a time
+ *
+ * The server encodes the desktop twice, for example at 1080p and at 4K.
+ * Packets from both layers keep arriving here, so each layer's wire
+ * reassembly, loss figure and SPS/PPS cache stay current. Only the active
+ * layer is decoded.
+ *
+ * When decode load or loss says the other layer fits better, that layer
+ * becomes the target. Nothing changes until the target's next IDR or
+ * recovery point SEI. From there the target decodes next to the active
+ * layer until its RefreshTracker reports a clean picture, and only then
+ * does the output flip. The old layer's picture stays up until that
+ * frame, so a switch shows neither a gap nor a half-refreshed picture;
+ * only the resolution changes.
+ *
+ * Like H264Decoder, this is not thread-safe: push from one thread.
+ */
+
+#ifndef SIMULCAST_DECODER_H
+#define SIMULCAST_DECODER_H
+
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+
+#include <vector>
+
+#include "h264_decoder.h"
+#include "nal_parser.h"
+#include "wire_reassembler.h"
+
+namespace godot {
+
+class SimulcastDecoder : public RefCounted {
+    GDCLASS(SimulcastDecoder, RefCounted)
+
+public:
+    enum Layer {
+        LAYER_LOW,
+        LAYER_HIGH,
+    };
+
+    enum LayerMode {
+        LAYER_MODE_AUTO, // switch on decode load and loss
+        LAYER_MODE_LOW,  // pinned, e.g. from a settings menu
+        LAYER_MODE_HIGH,
+    };
+
+    enum SwitchReason {
+        SWITCH_REASON_NONE,
+        SWITCH_REASON_LOAD,     // high layer decoding too slowly
+        SWITCH_REASON_LOSS,     // high layer losing frames
+        SWITCH_REASON_HEADROOM, // low layer leaves room for the high one
+        SWITCH_REASON_MANUAL,   // layer mode changed
+    };
+
+private:
+    static const int LAYER_COUNT = 2;
+    // Frame-producing packets needed before load drives a decision
+    static const int MIN_LOAD_SAMPLES = 30;
+
+    struct LayerState {
+        Ref<H264Decoder> decoder;
+        WireReassembler reassembler;
+        ParameterSetCache parameter_sets; // replayed when decoding starts mid-stream
+        int64_t lost_seen = 0;            // reassembler losses already in loss_rate
+        float loss_rate = 0.0f;           // smoothed share of lost frames
+        int64_t packets = 0;
+        int64_t bytes = 0;
+        int64_t lost = 0;                 // reassembly losses plus report_loss
+        int64_t switch_points = 0;
+        int64_t frames_decoded = 0;
+        int64_t last_packet_usec = 0;
+        float interval_usec = 0.0f;       // smoothed time between packets
+        int width = 0;                    // last decoded size
+        int height = 0;
+    };
+    LayerState layers[LAYER_COUNT];
+    std::vector<NalUnit> units; // reused between packets
+
+    Layer active = LAYER_LOW;
+    LayerMode mode = LAYER_MODE_AUTO;
+
+    // Switch in progress
+    bool switching = false;
+    Layer target = LAYER_LOW;
+    SwitchReason pending_reason = SWITCH_REASON_NONE;
+    bool target_started = false; // target has reached a switch point
+    int64_t switch_request_usec = 0;
+    int64_t next_switch_usec = 0; // backoff after an abandoned switch
+
+    // Decode load of the active layer: decode time / packet interval
+    float load = 0.0f;
+    int load_samples = 0;
+    int64_t overload_since_usec = 0;
+    int64_t headroom_since_usec = 0;
+
+    // Policy
+    float downgrade_load = 0.85f;
+    float upgrade_load = 0.6f;  // compared with the predicted high-layer load
+    float loss_threshold = 0.03f;
+    int downgrade_hold_msec = 500;
+    int upgrade_hold_msec = 5000;
+    int switch_timeout_msec = 3000;
+
+    // Stats
+    int64_t switches = 0;
+    int64_t switches_by_reason[SWITCH_REASON_MANUAL + 1] = {};
+    int64_t switch_timeouts = 0;
+    int64_t last_switch_usec = 0; // request to flip
+    int64_t longest_switch_usec = 0;
+    int64_t last_decode_usec = 0;
+
+    bool valid_layer(int layer) const { return layer == LAYER_LOW || layer == LAYER_HIGH; }
+    // Packets of the target layer that can start a decoder: IDR or recovery point
+    bool is_switch_point(const uint8_t* data, size_t size);
+    void record_loss(LayerState& state, int64_t frames);
+    // `packet` holds the same bytes and may be empty unless the layer is decoded
+    PackedByteArray process_packet(Layer layer, const uint8_t* data, size_t size,
+                                   const PackedByteArray& packet, int64_t now_usec);
+    PackedByteArray feed_target(const PackedByteArray& packet, bool switch_point, int64_t now_usec);
+    void evaluate_policy(int64_t now_usec);
+    void begin_switch(Layer layer, SwitchReason reason, int64_t now_usec);
+    void complete_switch(int64_t now_usec);
+    void abandon_switch();
+    // high pixels / low pixels, 4 (1080p vs 4K) until both sizes are known
+    float get_cost_ratio() const;
+
+protected:
+    static void _bind_methods();
+
+public:
+    SimulcastDecoder();
+
+    // One wire datagram (stream_wire.h) of a layer. Only WIRE_VIDEO messages
+    // are consumed; route audio and cursor datagrams elsewhere. Returns the
+    // new output frame (H264Decoder.decode_frame layout) or empty.
+    PackedByteArray push_datagram(int layer, const PackedByteArray& datagram);
+    // A complete access unit, for callers that reassemble themselves
+    PackedByteArray push_packet(int layer, const PackedByteArray& h264_data);
+    // Frames the caller knows were lost on a layer (own reassembly)
+    void report_loss(int layer, int frames);
+
+    // Per-layer decoders, for output format, threads and so on
+    Ref<H264Decoder> get_layer_decoder(int layer) const;
+
+    Layer get_active_layer() const { return active; }
+    bool is_switching() const { return switching; }
+    Layer get_target_layer() const { return switching ? target : active; }
+    int get_width() const;
+    int get_height() const;
+
+    void set_layer_mode(LayerMode p_mode) { mode = p_mode; }
+    LayerMode get_layer_mode() const { return mode; }
+
+    // Share of the frame interval spent decoding above which the high layer
+    // is dropped (after downgrade_hold_msec)
+    void set_downgrade_load(float value) { downgrade_load = value; }
+    float get_downgrade_load() const { return downgrade_load; }
+    // Predicted high-layer load below which the low layer moves up (after upgrade_hold_msec)
+    void set_upgrade_load(float value) { upgrade_load = value; }
+    float get_upgrade_load() const { return upgrade_load; }
+    // Smoothed high-layer loss above which the low layer is preferred
+    void set_loss_threshold(float value) { loss_threshold = value; }
+    float get_loss_threshold() const { return loss_threshold; }
+    void set_downgrade_hold_msec(int msec) { downgrade_hold_msec = msec > 0 ? msec : 0; }
+    int get_downgrade_hold_msec() const { return downgrade_hold_msec; }
+    void set_upgrade_hold_msec(int msec) { upgrade_hold_msec = msec > 0 ? msec : 0; }
+    int get_upgrade_hold_msec() const { return upgrade_hold_msec; }
+    // A target without a clean picture by then is given up
+    void set_switch_timeout_msec(int msec) { switch_timeout_msec = msec > 100 ? msec : 100; }
+    int get_switch_timeout_msec() const { return switch_timeout_msec; }
+
+    Dictionary get_stats() const;
+    void reset();
+};
+
+} // namespace godot
+
+VARIANT_ENUM_CAST(SimulcastDecoder::Layer);
+VARIANT_ENUM_CAST(SimulcastDecoder::LayerMode);
+VARIANT_ENUM_CAST(SimulcastDecoder::SwitchReason);
+
+#endif // SIMULCAST_DECODER_H
@@ -0,0 +1,301 @@
+/*
+ * Snapshot Service Implementation
+ */
+
+#include "snapshot_service.h"
+
+#include <godot_cpp/variant/utility_functions.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__) || defined(__ANDROID__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace godot;
+
+static int64_t now_usec() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void SnapshotService::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("submit_frame", "decoder"), &SnapshotService::submit_frame);
+    ClassDB::bind_method(D_METHOD("request_snapshot", "decoder", "format", "quality"), &SnapshotService::request_snapshot, DEFVAL(0.9f));
+    ClassDB::bind_method(D_METHOD("set_thumbnail_interval_msec", "msec"), &SnapshotService::set_thumbnail_interval_msec);
+    ClassDB::bind_method(D_METHOD("get_thumbnail_interval_msec"), &SnapshotService::get_thumbnail_interval_msec);
+    ClassDB::bind_method(D_METHOD("set_thumbnail_max_size", "size"), &SnapshotService::set_thumbnail_max_size);
+    ClassDB::bind_method(D_METHOD("get_thumbnail_max_size"), &SnapshotService::get_thumbnail_max_size);
+    ClassDB::bind_method(D_METHOD("get_latest_thumbnail"), &SnapshotService::get_latest_thumbnail);
+    ClassDB::bind_method(D_METHOD("get_stats"), &SnapshotService::get_stats);
+    ClassDB::bind_method(D_METHOD("_flush_results"), &SnapshotService::_flush_results);
+
+    BIND_ENUM_CONSTANT(SNAPSHOT_PNG);
+    BIND_ENUM_CONSTANT(SNAPSHOT_WEBP);
+
+    ADD_SIGNAL(MethodInfo("thumbnail_ready", PropertyInfo(Variant::OBJECT, "image")));
+    ADD_SIGNAL(MethodInfo("snapshot_ready", PropertyInfo(Variant::INT, "request_id"),
+                          PropertyInfo(Variant::PACKED_BYTE_ARRAY, "data"), PropertyInfo(Variant::INT, "format")));
+    ADD_SIGNAL(MethodInfo("snapshot_failed", PropertyInfo(Variant::INT, "request_id")));
+}
+
+SnapshotService::SnapshotService() {
+    start_worker();
+}
+
+SnapshotService::~SnapshotService() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+
+    av_frame_free(&pending_thumbnail);
+    for (SnapshotJob& job : pending_snapshots) {
+        av_frame_free(&job.frame);
+    }
+    pending_snapshots.clear();
+}
+
+void SnapshotService::start_worker() {
+    worker = std::thread(&SnapshotService::worker_loop, this);
+}
+
+void SnapshotService::set_worker_priority() {
+    // Best effort: scaling and PNG encoding must lose to decode and render
+#if defined(_WIN32)
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#elif defined(__linux__) || defined(__ANDROID__)
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 10);
+#endif
+}
+
+void SnapshotService::worker_loop() {
+    set_worker_priority();
+
+    while (true) {
+        AVFrame* thumbnail_frame = nullptr;
+        SnapshotJob snapshot;
+        bool has_snapshot = false;
+        Vector2i max_size;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this] { return stopping || pending_thumbnail || !pending_snapshots.empty(); });
+            if (stopping) {
+                return;
+            }
+            // Explicit snapshot requests go first; thumbnails are best effort
+            if (!pending_snapshots.empty()) {
+                snapshot = pending_snapshots.front();
+                pending_snapshots.pop_front();
+                has_snapshot = true;
+            } else {
+                thumbnail_frame = pending_thumbnail;
+                pending_thumbnail = nullptr;
+                max_size = thumbnail_max_size;
+            }
+        }
+
+        if (has_snapshot) {
+            push_result(make_snapshot(snapshot));
+            av_frame_free(&snapshot.frame);
+        } else {
+            push_result(make_thumbnail(thumbnail_frame, max_size));
+            av_frame_free(&thumbnail_frame);
+        }
+    }
+}
+
+SnapshotService::Result SnapshotService::make_thumbnail(AVFrame* frame, Vector2i max_size) {
+    int64_t start = now_usec();
+    Result result;
+    result.is_thumbnail = true;
+
+    // Fit inside max_size, never upscale; even sizes keep chroma sampling simple
+    double scale = std::min(1.0, std::min((double)max_size.x / frame->width, (double)max_size.y / frame->height));
+    int width = std::max(2, (int)std::lround(frame->width * scale) & ~1);
+    int height = std::max(2, (int)std::lround(frame->height * scale) & ~1);
+
+    PackedByteArray pixels;
+    pixels.resize((int64_t)width * height * 4);
+    // SWS_AREA averages the source footprint, avoiding aliasing on text
+    if (thumbnail_converter.convert(frame, pixels.ptrw(), width * 4, width, height, AV_PIX_FMT_RGBA, 1, SWS_AREA)) {
+        result.image = Image::create_from_data(width, height, false, Image::FORMAT_RGBA8, pixels);
+        result.ok = true;
+        thumbnails_made++;
+    }
+    last_thumbnail_usec = now_usec() - start;
+    return result;
+}
+
+SnapshotService::Result SnapshotService::make_snapshot(const SnapshotJob& job) {
+    int64_t start = now_usec();
+    Result result;
+    result.request_id = job.request_id;
+    result.format = job.format;
+
+    int width = job.frame->width;
+    int height = job.frame->height;
+    PackedByteArray pixels;
+    pixels.resize((int64_t)width * height * 4);
+    if (snapshot_converter.convert(job.frame, pixels.ptrw(), width * 4, width, height, AV_PIX_FMT_RGBA, 1)) {
+        Ref<Image> image = Image::create_from_data(width, height, false, Image::FORMAT_RGBA8, pixels);
+        if (job.format == SNAPSHOT_WEBP) {
+            bool lossy = job.quality < 1.0f;
+            result.data = image->save_webp_to_buffer(lossy, job.quality);
+        } else {
+            result.data = image->save_png_to_buffer();
+        }
+        result.ok = result.data.size() > 0;
+    }
+
+    if (result.ok) {
+        snapshots_made++;
+    } else {
+        snapshots_failed++;
+    }
+    last_snapshot_usec = now_usec() - start;
+    return result;
+}
+
+void SnapshotService::push_result(Result&& result) {
+    bool schedule = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // Only the newest thumbnail is worth delivering
+        if (result.is_thumbnail) {
+            for (auto it = results.begin(); it != results.end(); ++it) {
+                if (it->is_thumbnail) {
+                    results.erase(it);
+                    break;
+                }
+            }
+        }
+        results.push_back(std::move(result));
+        schedule = !flush_scheduled;
+        flush_scheduled = true;
+    }
+    if (schedule) {
+        call_deferred("_flush_results");
+    }
+}
+
+void SnapshotService::_flush_results() {
+    std::deque<Result> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.swap(results);
+        flush_scheduled = false;
+    }
+
+    for (Result& result : ready) {
+        if (result.is_thumbnail) {
+            if (result.ok) {
+                latest_thumbnail = result.image;
+                emit_signal("thumbnail_ready", result.image);
+            }
+        } else if (result.ok) {
+            emit_signal("snapshot_ready", result.request_id, result.data, (int)result.format);
+        } else {
+            emit_signal("snapshot_failed", result.request_id);
+        }
+    }
+}
+
+bool SnapshotService::submit_frame(const Ref<H264Decoder>& decoder) {
+    if (decoder.is_null()) {
+        return false;
+    }
+    return submit_native_frame(decoder->get_current_frame());
+}
+
+bool SnapshotService::submit_native_frame(const AVFrame* frame, bool force) {
+    if (!frame || !frame->buf[0] || frame->width <= 0 || frame->height <= 0) {
+        return false;
+    }
+    int64_t now = now_usec();
+    if (!force && last_thumbnail_submit_usec > 0 && now - last_thumbnail_submit_usec < thumbnail_interval_usec) {
+        return false;
+    }
+
+    // A new reference to the decoder's buffers; no pixels are copied
+    AVFrame* ref = av_frame_clone(frame);
+    if (!ref) {
+        return false;
+    }
+    last_thumbnail_submit_usec = now;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pending_thumbnail) {
+            av_frame_free(&pending_thumbnail);
+            thumbnails_replaced++;
+        }
+        pending_thumbnail = ref;
+    }
+    cv.notify_one();
+    return true;
+}
+
+int SnapshotService::request_snapshot(const Ref<H264Decoder>& decoder, SnapshotFormat format, float quality) {
+    if (decoder.is_null()) {
+        return 0;
+    }
+    const AVFrame* frame = decoder->get_current_frame();
+    if (!frame || !frame->buf[0]) {
+        return 0;
+    }
+
+    SnapshotJob job;
+    job.frame = av_frame_clone(frame);
+    if (!job.frame) {
+        return 0;
+    }
+    job.request_id = next_request_id++;
+    job.format = format;
+    job.quality = std::clamp(quality, 0.0f, 1.0f);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending_snapshots.push_back(job);
+    }
+    cv.notify_one();
+    return job.request_id;
+}
+
+void SnapshotService::set_thumbnail_interval_msec(int msec) {
+    thumbnail_interval_usec = (int64_t)std::max(msec, 0) * 1000;
+}
+
+void SnapshotService::set_thumbnail_max_size(const Vector2i& size) {
+    std::lock_guard<std::mutex> lock(mutex);
+    thumbnail_max_size = Vector2i(std::max(size.x, 2), std::max(size.y, 2));
+}
+
+Vector2i SnapshotService::get_thumbnail_max_size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return thumbnail_max_size;
+}
+
+Dictionary SnapshotService::get_stats() const {
+    Dictionary stats;
+    stats["thumbnails_made"] = thumbnails_made.load();
+    stats["thumbnails_replaced"] = thumbnails_replaced.load();
+    stats["thumbnail_usec"] = last_thumbnail_usec.load();
+    stats["snapshots_made"] = snapshots_made.load();
+    stats["snapshots_failed"] = snapshots_failed.load();
+    stats["snapshot_usec"] = last_snapshot_usec.load();
+    return stats;
+}
@@ -0,0 +1,132 @@
+/*
+ * Snapshot Service
+ * Thumbnails and full-resolution snapshots produced off the decode path
+ *
+ * submit_frame() only takes a reference to the decoder's current AVFrame
+ * (no pixel copy); a low-priority worker thread scales it with swscale and
+ * encodes PNG/WebP. Results come back on the main thread as signals, so
+ * neither the decode nor the render thread ever waits on it.
+ *
+ * Thumbnails are rate limited and latest-wins: a frame offered while the
+ * worker is busy replaces the queued one instead of piling up.
+ */
+
+#ifndef SNAPSHOT_SERVICE_H
+#define SNAPSHOT_SERVICE_H
+
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/classes/image.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/vector2i.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "h264_decoder.h"
+#include "rgba_converter.h"
+
+namespace godot {
+
+class SnapshotService : public RefCounted {
+    GDCLASS(SnapshotService, RefCounted)
+
+public:
+    enum SnapshotFormat {
+        SNAPSHOT_PNG,
+        SNAPSHOT_WEBP,
+    };
+
+private:
+    struct SnapshotJob {
+        AVFrame* frame = nullptr;
+        int request_id = 0;
+        SnapshotFormat format = SNAPSHOT_PNG;
+        float quality = 0.9f;
+    };
+
+    struct Result {
+        bool is_thumbnail = false;
+        int request_id = 0;
+        SnapshotFormat format = SNAPSHOT_PNG;
+        Ref<Image> image;
+        PackedByteArray data;
+        bool ok = false;
+    };
+
+    std::thread worker;
+    mutable std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping = false;
+
+    // Guarded by mutex
+    AVFrame* pending_thumbnail = nullptr;
+    std::deque<SnapshotJob> pending_snapshots;
+    std::deque<Result> results;
+    Vector2i thumbnail_max_size = Vector2i(256, 256);
+    bool flush_scheduled = false;
+
+    // Worker-only
+    RgbaConverter thumbnail_converter;
+    RgbaConverter snapshot_converter;
+
+    // Main thread
+    int64_t thumbnail_interval_usec = 500000;
+    int64_t last_thumbnail_submit_usec = 0;
+    int next_request_id = 1;
+    Ref<Image> latest_thumbnail;
+
+    // Stats (written by the worker)
+    std::atomic<int64_t> thumbnails_made{0};
+    std::atomic<int64_t> thumbnails_replaced{0};
+    std::atomic<int64_t> snapshots_made{0};
+    std::atomic<int64_t> snapshots_failed{0};
+    std::atomic<int64_t> last_thumbnail_usec{0};
+    std::atomic<int64_t> last_snapshot_usec{0};
+
+    void start_worker();
+    void worker_loop();
+    void set_worker_priority();
+    Result make_thumbnail(AVFrame* frame, Vector2i max_size);
+    Result make_snapshot(const SnapshotJob& job);
+    void push_result(Result&& result);
+    // Runs deferred on the main thread; emits the queued results
+    void _flush_results();
+
+protected:
+    static void _bind_methods();
+
+public:
+    SnapshotService();
+    ~SnapshotService();
+
+    // Offer the decoder's current frame for a thumbnail. Cheap (a reference);
+    // ignored until the thumbnail interval has passed. Returns true if taken.
+    bool submit_frame(const Ref<H264Decoder>& decoder);
+    // Same, for native callers holding the frame
+    bool submit_native_frame(const AVFrame* frame, bool force = false);
+
+    // Queue a full-resolution snapshot of the current frame; returns the
+    // request id reported by snapshot_ready/snapshot_failed, or 0.
+    int request_snapshot(const Ref<H264Decoder>& decoder, SnapshotFormat format, float quality = 0.9f);
+
+    void set_thumbnail_interval_msec(int msec);
+    int get_thumbnail_interval_msec() const { return (int)(thumbnail_interval_usec / 1000); }
+    // Thumbnails fit inside this size, keeping the aspect ratio
+    void set_thumbnail_max_size(const Vector2i& size);
+    Vector2i get_thumbnail_max_size() const;
+
+    Ref<Image> get_latest_thumbnail() const { return latest_thumbnail; }
+
+    Dictionary get_stats() const;
+};
+
+} // namespace godot
+
+VARIANT_ENUM_CAST(SnapshotService::SnapshotFormat);
+
+#endif // SNAPSHOT_SERVICE_H
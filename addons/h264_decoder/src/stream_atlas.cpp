@@ -0,0 +1,449 @@
+/*
+ * Stream Atlas Node Implementation
+ */
+
+#include "stream_atlas.h"
+#include "frame_repack.h"
+#include "rgba_converter.h"
+
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/utility_functions.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+using namespace godot;
+
+// Same conversion as StreamDisplay's shader, but sampling is clamped to the
+// instance's window rect so linear filtering never reads a neighbour.
+// Planes are texture arrays of pages; layer rows 0 and rows + 1 repeat the
+// neighbouring pages' edge rows.
+static const char* STREAM_ATLAS_SHADER = R"(
+shader_type spatial;
+render_mode unshaded, cull_disabled;
+
+uniform sampler2DArray y_tex : filter_linear, repeat_disable;
+uniform sampler2DArray uv_tex : filter_linear, repeat_disable;
+uniform vec2 atlas_size = vec2(1024.0);
+uniform float page_rows = 256.0;
+instance uniform vec4 window_rect = vec4(0.0, 0.0, 1.0, 1.0);
+instance uniform int color_mode = 0;
+
+vec3 srgb_to_linear(vec3 c) {
+    return mix(c / 12.92, pow((c + 0.055) / 1.055, vec3(2.4)), step(vec3(0.04045), c));
+}
+
+float sample_paged(sampler2DArray tex, vec2 uv, float plane_height, float rows) {
+    float y = uv.y * plane_height;
+    float page = min(floor(y / rows), ceil(plane_height / rows) - 1.0);
+    return texture(tex, vec3(uv.x, (y - page * rows + 1.0) / (rows + 2.0), page)).r;
+}
+
+void fragment() {
+    vec2 texel = 1.0 / atlas_size;
+    vec2 lo = window_rect.xy;
+    vec2 hi = window_rect.xy + window_rect.zw;
+    vec2 uv = lo + clamp(UV, vec2(0.0), vec2(1.0)) * window_rect.zw;
+
+    // Chroma texels cover two luma texels
+    vec2 y_uv = clamp(uv, lo + texel * 0.5, hi - texel * 0.5);
+    vec2 c_uv = clamp(uv, lo + texel, hi - texel);
+
+    float y = sample_paged(y_tex, y_uv, atlas_size.y, page_rows);
+    float u = sample_paged(uv_tex, vec2(c_uv.x * 0.5, c_uv.y), atlas_size.y * 0.5, page_rows * 0.5);
+    float v = sample_paged(uv_tex, vec2(c_uv.x * 0.5 + 0.5, c_uv.y), atlas_size.y * 0.5, page_rows * 0.5);
+
+    if ((color_mode & 1) != 0) {
+        u -= 0.5;
+        v -= 0.5;
+    } else {
+        y = (y - 16.0 / 255.0) * (255.0 / 219.0);
+        u = (u - 128.0 / 255.0) * (255.0 / 224.0);
+        v = (v - 128.0 / 255.0) * (255.0 / 224.0);
+    }
+
+    vec3 rgb;
+    if ((color_mode & 4) != 0) {
+        rgb = vec3(y + 1.4746 * v, y - 0.164553 * u - 0.571353 * v, y + 1.8814 * u);
+    } else if ((color_mode & 2) != 0) {
+        rgb = vec3(y + 1.402 * v, y - 0.344136 * u - 0.714136 * v, y + 1.772 * u);
+    } else {
+        rgb = vec3(y + 1.5748 * v, y - 0.1873 * u - 0.4681 * v, y + 1.8556 * u);
+    }
+
+    ALBEDO = srgb_to_linear(clamp(rgb, 0.0, 1.0));
+}
+)";
+
+void StreamAtlas::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("add_window", "id"), &StreamAtlas::add_window);
+    ClassDB::bind_method(D_METHOD("remove_window", "id"), &StreamAtlas::remove_window);
+    ClassDB::bind_method(D_METHOD("has_window", "id"), &StreamAtlas::has_window);
+    ClassDB::bind_method(D_METHOD("get_window_ids"), &StreamAtlas::get_window_ids);
+    ClassDB::bind_method(D_METHOD("push_packet", "id", "h264_data"), &StreamAtlas::push_packet);
+    ClassDB::bind_method(D_METHOD("get_window_uv_rect", "id"), &StreamAtlas::get_window_uv_rect);
+    ClassDB::bind_method(D_METHOD("get_window_pixel_rect", "id"), &StreamAtlas::get_window_pixel_rect);
+    ClassDB::bind_method(D_METHOD("get_window_color_mode", "id"), &StreamAtlas::get_window_color_mode);
+    ClassDB::bind_method(D_METHOD("get_window_decoder", "id"), &StreamAtlas::get_window_decoder);
+    ClassDB::bind_method(D_METHOD("set_atlas_size", "width", "height"), &StreamAtlas::set_atlas_size);
+    ClassDB::bind_method(D_METHOD("get_atlas_width"), &StreamAtlas::get_atlas_width);
+    ClassDB::bind_method(D_METHOD("get_atlas_height"), &StreamAtlas::get_atlas_height);
+    ClassDB::bind_method(D_METHOD("get_material"), &StreamAtlas::get_material);
+    ClassDB::bind_method(D_METHOD("get_y_texture"), &StreamAtlas::get_y_texture);
+    ClassDB::bind_method(D_METHOD("get_uv_texture"), &StreamAtlas::get_uv_texture);
+    ClassDB::bind_method(D_METHOD("get_stats"), &StreamAtlas::get_stats);
+
+    ADD_SIGNAL(MethodInfo("atlas_changed"));
+    ADD_SIGNAL(MethodInfo("window_size_changed", PropertyInfo(Variant::INT, "id"),
+                          PropertyInfo(Variant::INT, "width"), PropertyInfo(Variant::INT, "height")));
+}
+
+StreamAtlas::StreamAtlas() {
+    shader.instantiate();
+    shader->set_code(STREAM_ATLAS_SHADER);
+    material.instantiate();
+    material->set_shader(shader);
+
+    resize_atlas(atlas_width, atlas_height);
+    packer.reset(atlas_width, atlas_height);
+}
+
+StreamAtlas::~StreamAtlas() {
+    windows.clear();
+}
+
+bool StreamAtlas::add_window(int id) {
+    if (windows.count(id)) {
+        return false;
+    }
+    windows[id].decoder.instantiate();
+    return true;
+}
+
+void StreamAtlas::remove_window(int id) {
+    packer.remove(id);
+    windows.erase(id);
+    retry_failed_windows();
+}
+
+void StreamAtlas::retry_failed_windows() {
+    for (auto& pair : windows) {
+        Window& window = pair.second;
+        if (!window.placement_failed || window.y_scratch.empty()) {
+            continue;
+        }
+        window.placement_failed = !place_window(pair.first, window);
+        if (window.placed) {
+            blit_window(window);
+            emit_signal("window_size_changed", pair.first, window.width, window.height);
+        }
+    }
+}
+
+PackedInt32Array StreamAtlas::get_window_ids() const {
+    PackedInt32Array ids;
+    for (const auto& pair : windows) {
+        ids.push_back(pair.first);
+    }
+    return ids;
+}
+
+void StreamAtlas::push_packet(int id, const PackedByteArray& h264_data) {
+    auto it = windows.find(id);
+    if (it == windows.end() || h264_data.size() == 0) {
+        return;
+    }
+    it->second.pending_packets.push_back(h264_data);
+}
+
+void StreamAtlas::_process(double p_delta) {
+    for (auto& pair : windows) {
+        Window& window = pair.second;
+
+        bool new_frame = false;
+        for (const PackedByteArray& packet : window.pending_packets) {
+            if (window.decoder->decode_packet(packet.ptr(), packet.size()) == H264Decoder::PACKET_DECODED) {
+                new_frame = true;
+            }
+        }
+        window.pending_packets.clear();
+
+        // With refresh gating the decoder serves its last clean picture
+        const AVFrame* frame = window.decoder->get_current_frame();
+        if (!new_frame || !frame || !frame->buf[0]) {
+            continue;
+        }
+        int width = frame->width;
+        int height = frame->height;
+        if (width <= 0 || height <= 0) {
+            continue;
+        }
+
+        // Keep the newest planes per window; defragmentation redraws from them
+        window.y_scratch.resize((size_t)width * height);
+        window.uv_scratch.resize((size_t)width * (height / 2));
+        window.decoder->repack_yuv(window.y_scratch.data(), window.uv_scratch.data());
+
+        int colorspace = RgbaConverter::get_sws_colorspace(frame);
+        window.color_mode = (RgbaConverter::is_full_range(frame) ? 1 : 0) |
+                            (colorspace == SWS_CS_BT2020 ? 4 : colorspace != SWS_CS_ITU709 ? 2 : 0);
+
+        if (width != window.width || height != window.height || (!window.placed && !window.placement_failed)) {
+            window.width = width;
+            window.height = height;
+            window.placement_failed = !place_window(pair.first, window);
+            emit_signal("window_size_changed", pair.first, width, height);
+        }
+        if (!window.placed) {
+            continue;
+        }
+
+        blit_window(window);
+        frames_blitted++;
+    }
+
+    if (dirty_row_begin < dirty_row_end) {
+        upload_atlas();
+    }
+}
+
+bool StreamAtlas::place_window(int id, Window& window) {
+    AtlasRect rect;
+    if (packer.insert(id, window.width, window.height, rect)) {
+        window.rect = rect;
+        window.placed = true;
+        return true;
+    }
+    return defragment(id, window.width, window.height);
+}
+
+bool StreamAtlas::defragment(int extra_id, int extra_w, int extra_h) {
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<AtlasPacker::Entry> entries;
+    for (const auto& pair : windows) {
+        if (pair.second.placed && pair.first != extra_id) {
+            entries.push_back(AtlasPacker::Entry{pair.first, pair.second.width, pair.second.height});
+        }
+    }
+    std::vector<AtlasPacker::Entry> with_extra = entries;
+    if (extra_w > 0 && extra_h > 0) {
+        with_extra.push_back(AtlasPacker::Entry{extra_id, extra_w, extra_h});
+    }
+
+    // Grow the shorter side first so the atlas stays roughly square
+    int new_width = atlas_width;
+    int new_height = atlas_height;
+    packer.reset(new_width, new_height);
+    bool fits = packer.repack(with_extra);
+    while (!fits && (new_width < MAX_ATLAS_SIZE || new_height < MAX_ATLAS_SIZE)) {
+        if (new_width <= new_height && new_width < MAX_ATLAS_SIZE) {
+            new_width = std::min(new_width * 2, (int)MAX_ATLAS_SIZE);
+        } else {
+            new_height = std::min(new_height * 2, (int)MAX_ATLAS_SIZE);
+        }
+        packer.reset(new_width, new_height);
+        fits = packer.repack(with_extra);
+    }
+
+    if (!fits) {
+        // Leave the new window out and keep everyone else
+        UtilityFunctions::printerr("[StreamAtlas] Window ", extra_id, " (", extra_w, "x", extra_h, ") does not fit in the atlas");
+        placement_failures++;
+        new_width = atlas_width;
+        new_height = atlas_height;
+        packer.reset(new_width, new_height);
+        packer.repack(entries);
+    }
+
+    if (new_width != atlas_width || new_height != atlas_height) {
+        UtilityFunctions::print("[StreamAtlas] Atlas size: ", new_width, "x", new_height);
+        atlas_grows++;
+    }
+    resize_atlas(new_width, new_height);
+
+    for (auto& pair : windows) {
+        Window& window = pair.second;
+        window.placed = packer.get_rect(pair.first, window.rect);
+        if (window.placed && !window.y_scratch.empty()) {
+            blit_window(window);
+        }
+    }
+
+    // The repack may have freed enough space for windows that failed earlier
+    for (auto& pair : windows) {
+        Window& window = pair.second;
+        if (window.placement_failed && pair.first != extra_id &&
+            packer.insert(pair.first, window.width, window.height, window.rect)) {
+            window.placed = true;
+            window.placement_failed = false;
+            blit_window(window);
+        }
+    }
+
+    defragmentations++;
+    last_defrag_usec = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    emit_signal("atlas_changed");
+    return fits;
+}
+
+void StreamAtlas::resize_atlas(int new_width, int new_height) {
+    if (new_width != atlas_width || new_height != atlas_height) {
+        // Textures are recreated by the next upload
+        y_texture.unref();
+        uv_texture.unref();
+    }
+    atlas_width = new_width;
+    atlas_height = new_height;
+    page_rows = std::min((int)PAGE_ROWS, atlas_height);
+
+    // Unused area is video black
+    y_atlas.assign((size_t)atlas_width * atlas_height, 16);
+    uv_atlas.assign((size_t)atlas_width * (atlas_height / 2), 128);
+    mark_rows_dirty(0, atlas_height);
+}
+
+void StreamAtlas::blit_window(const Window& window) {
+    const AtlasRect& rect = window.rect;
+    int width = window.width;
+    int height = window.height;
+    if (window.y_scratch.size() < (size_t)width * height) {
+        return;
+    }
+
+    repack_copy_rows(y_atlas.data() + (size_t)rect.y * atlas_width + rect.x, atlas_width,
+                     window.y_scratch.data(), width, width, height, false);
+
+    // Window rows are U|V halves of `width`; atlas rows are U|V halves of atlas_width
+    int chroma_width = width / 2;
+    uint8_t* uv_dst = uv_atlas.data() + (size_t)(rect.y / 2) * atlas_width + rect.x / 2;
+    repack_copy_rows(uv_dst, atlas_width, window.uv_scratch.data(), width, chroma_width, height / 2, false);
+    repack_copy_rows(uv_dst + atlas_width / 2, atlas_width, window.uv_scratch.data() + chroma_width, width,
+                     chroma_width, height / 2, false);
+
+    mark_rows_dirty(rect.y, rect.y + height);
+}
+
+void StreamAtlas::mark_rows_dirty(int begin, int end) {
+    if (dirty_row_begin >= dirty_row_end) {
+        dirty_row_begin = begin;
+        dirty_row_end = end;
+    } else {
+        dirty_row_begin = std::min(dirty_row_begin, begin);
+        dirty_row_end = std::max(dirty_row_end, end);
+    }
+}
+
+Ref<Image> StreamAtlas::build_page(const std::vector<uint8_t>& plane, int plane_height, int rows, int page) const {
+    PackedByteArray data;
+    data.resize((int64_t)atlas_width * (rows + 2));
+    uint8_t* dst = data.ptrw();
+    for (int row = 0; row < rows + 2; row++) {
+        int src_row = std::clamp(page * rows - 1 + row, 0, plane_height - 1);
+        memcpy(dst + (size_t)row * atlas_width, plane.data() + (size_t)src_row * atlas_width, atlas_width);
+    }
+    return Image::create_from_data(atlas_width, rows + 2, false, Image::FORMAT_R8, data);
+}
+
+void StreamAtlas::upload_atlas() {
+    auto upload_start = std::chrono::steady_clock::now();
+    int uv_height = atlas_height / 2;
+    int uv_rows = page_rows / 2;
+    int page_count = get_page_count();
+    int64_t page_bytes = (int64_t)atlas_width * (page_rows + 2 + uv_rows + 2);
+
+    if (y_texture.is_null() || uv_texture.is_null()) {
+        Array y_pages;
+        Array uv_pages;
+        for (int page = 0; page < page_count; page++) {
+            y_pages.push_back(build_page(y_atlas, atlas_height, page_rows, page));
+            uv_pages.push_back(build_page(uv_atlas, uv_height, uv_rows, page));
+        }
+        y_texture.instantiate();
+        uv_texture.instantiate();
+        y_texture->create_from_images(y_pages);
+        uv_texture->create_from_images(uv_pages);
+        material->set_shader_parameter("y_tex", y_texture);
+        material->set_shader_parameter("uv_tex", uv_texture);
+        material->set_shader_parameter("atlas_size", Vector2(atlas_width, atlas_height));
+        material->set_shader_parameter("page_rows", (float)page_rows);
+        last_upload_pages = page_count;
+    } else {
+        // Page p holds luma rows [p * page_rows - 1, (p + 1) * page_rows + 1),
+        // so a dirty row on a page edge also lands in the neighbour's apron
+        int uv_begin = dirty_row_begin / 2;
+        int uv_end = (dirty_row_end + 1) / 2;
+        int first = std::min(std::max(dirty_row_begin - 1, 0) / page_rows, std::max(uv_begin - 1, 0) / uv_rows);
+        int last = std::min(std::max(dirty_row_end / page_rows, uv_end / uv_rows), page_count - 1);
+        for (int page = first; page <= last; page++) {
+            y_texture->update_layer(build_page(y_atlas, atlas_height, page_rows, page), page);
+            uv_texture->update_layer(build_page(uv_atlas, uv_height, uv_rows, page), page);
+        }
+        last_upload_pages = last - first + 1;
+    }
+
+    last_upload_bytes = last_upload_pages * page_bytes;
+    dirty_row_begin = 0;
+    dirty_row_end = 0;
+    last_upload_usec = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - upload_start).count();
+}
+
+Rect2 StreamAtlas::get_window_uv_rect(int id) const {
+    auto it = windows.find(id);
+    if (it == windows.end() || !it->second.placed) {
+        return Rect2();
+    }
+    const AtlasRect& rect = it->second.rect;
+    return Rect2((float)rect.x / atlas_width, (float)rect.y / atlas_height,
+                 (float)it->second.width / atlas_width, (float)it->second.height / atlas_height);
+}
+
+Rect2i StreamAtlas::get_window_pixel_rect(int id) const {
+    auto it = windows.find(id);
+    if (it == windows.end() || !it->second.placed) {
+        return Rect2i();
+    }
+    const AtlasRect& rect = it->second.rect;
+    return Rect2i(rect.x, rect.y, it->second.width, it->second.height);
+}
+
+int StreamAtlas::get_window_color_mode(int id) const {
+    auto it = windows.find(id);
+    return it != windows.end() ? it->second.color_mode : 0;
+}
+
+Ref<H264Decoder> StreamAtlas::get_window_decoder(int id) const {
+    auto it = windows.find(id);
+    return it != windows.end() ? it->second.decoder : Ref<H264Decoder>();
+}
+
+void StreamAtlas::set_atlas_size(int width, int height) {
+    width = std::clamp(width & ~(AtlasPacker::ALIGNMENT - 1), 64, (int)MAX_ATLAS_SIZE);
+    height = std::clamp(height & ~(AtlasPacker::ALIGNMENT - 1), 64, (int)MAX_ATLAS_SIZE);
+    if (width == atlas_width && height == atlas_height) {
+        return;
+    }
+    resize_atlas(width, height);
+    defragment(-1, 0, 0);
+}
+
+Dictionary StreamAtlas::get_stats() const {
+    Dictionary stats;
+    stats["windows"] = (int64_t)windows.size();
+    stats["atlas_width"] = atlas_width;
+    stats["atlas_height"] = atlas_height;
+    stats["atlas_bytes"] = (int64_t)(y_atlas.size() + uv_atlas.size());
+    stats["occupancy"] = packer.get_occupancy();
+    stats["defragmentations"] = defragmentations;
+    stats["defrag_usec"] = last_defrag_usec;
+    stats["atlas_grows"] = atlas_grows;
+    stats["placement_failures"] = placement_failures;
+    stats["frames_blitted"] = frames_blitted;
+    stats["upload_usec"] = last_upload_usec;
+    stats["upload_pages"] = last_upload_pages;
+    stats["upload_bytes"] = last_upload_bytes;
+    return stats;
+}
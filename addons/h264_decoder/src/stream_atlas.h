@@ -0,0 +1,144 @@
+/*
+ * Stream Atlas Node
+ * Decodes many small window streams into one shared Y and U|V texture pair
+ *
+ * Each window gets its own H264Decoder and a rect in the atlas, placed by
+ * AtlasPacker. The U|V atlas uses the decoder's output layout at atlas
+ * scale (U in the left half, V in the right half), so a window at luma
+ * (x, y) has its U block at (x/2, y/2) and V at (W/2 + x/2, y/2).
+ *
+ * All windows draw with get_material(); set the per-instance uniforms
+ * window_rect (get_window_uv_rect) and color_mode (get_window_color_mode)
+ * on each mesh. When a window resizes and no longer fits, the atlas is
+ * defragmented (and grown up to MAX_ATLAS_SIZE) and atlas_changed is
+ * emitted so every rect is re-read.
+ *
+ * Both planes are uploaded as a texture array of PAGE_ROWS-row pages, each
+ * with one apron row from its neighbours so filtering across a page edge
+ * matches a single texture. Only pages touched by a blit go up each tick.
+ */
+
+#ifndef STREAM_ATLAS_H
+#define STREAM_ATLAS_H
+
+#include <godot_cpp/classes/node.hpp>
+#include <godot_cpp/classes/image.hpp>
+#include <godot_cpp/classes/texture2d_array.hpp>
+#include <godot_cpp/classes/shader.hpp>
+#include <godot_cpp/classes/shader_material.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/packed_int32_array.hpp>
+#include <godot_cpp/variant/rect2.hpp>
+#include <godot_cpp/variant/rect2i.hpp>
+
+#include <map>
+#include <vector>
+
+#include "atlas_packer.h"
+#include "h264_decoder.h"
+
+namespace godot {
+
+class StreamAtlas : public Node {
+    GDCLASS(StreamAtlas, Node)
+
+public:
+    static const int MAX_ATLAS_SIZE = 4096;
+    // Luma rows per uploaded page (chroma pages hold half as many)
+    static const int PAGE_ROWS = 256;
+
+private:
+    struct Window {
+        Ref<H264Decoder> decoder;
+        std::vector<PackedByteArray> pending_packets;
+        int width = 0;
+        int height = 0;
+        bool placed = false;
+        bool placement_failed = false; // too big even for a full atlas; retried on resize or when space frees up
+        AtlasRect rect;
+        int color_mode = 0; // bit 0 = full range, bit 1 = BT.601, bit 2 = BT.2020
+        std::vector<uint8_t> y_scratch;
+        std::vector<uint8_t> uv_scratch;
+    };
+
+    std::map<int, Window> windows;
+    AtlasPacker packer;
+
+    int atlas_width = 1024;
+    int atlas_height = 1024;
+    int page_rows = PAGE_ROWS;
+    // CPU copy of the atlas; uploads copy dirty pages out of it
+    std::vector<uint8_t> y_atlas;
+    std::vector<uint8_t> uv_atlas;
+    // Luma rows changed since the last upload (empty when begin == end)
+    int dirty_row_begin = 0;
+    int dirty_row_end = 0;
+
+    Ref<Texture2DArray> y_texture;
+    Ref<Texture2DArray> uv_texture;
+    Ref<Shader> shader;
+    Ref<ShaderMaterial> material;
+
+    // Stats
+    int64_t defragmentations = 0;
+    int64_t atlas_grows = 0;
+    int64_t placement_failures = 0;
+    int64_t frames_blitted = 0;
+    int64_t last_upload_usec = 0;
+    int64_t last_upload_pages = 0;
+    int64_t last_upload_bytes = 0;
+    int64_t last_defrag_usec = 0;
+
+    // Give a window a rect for its current size; defragments/grows as needed
+    bool place_window(int id, Window& window);
+    // Repack every placed window (plus `extra_id` if extra_w > 0), growing
+    // the atlas if needed, and redraw them all from their last frame
+    bool defragment(int extra_id, int extra_w, int extra_h);
+    void resize_atlas(int new_width, int new_height);
+    void blit_window(const Window& window);
+    void mark_rows_dirty(int begin, int end);
+    int get_page_count() const { return (atlas_height + page_rows - 1) / page_rows; }
+    // One page of a plane with its apron rows, clamped at the plane edges
+    Ref<Image> build_page(const std::vector<uint8_t>& plane, int plane_height, int rows, int page) const;
+    void upload_atlas();
+    // Windows that failed placement get another try after space frees up
+    void retry_failed_windows();
+
+protected:
+    static void _bind_methods();
+
+public:
+    StreamAtlas();
+    ~StreamAtlas();
+
+    bool add_window(int id);
+    void remove_window(int id);
+    bool has_window(int id) const { return windows.count(id) != 0; }
+    PackedInt32Array get_window_ids() const;
+
+    // Queue a compressed packet for a window; decoded on the next process callback
+    void push_packet(int id, const PackedByteArray& h264_data);
+
+    // Window content inside the atlas, normalized to the Y texture (empty until placed)
+    Rect2 get_window_uv_rect(int id) const;
+    Rect2i get_window_pixel_rect(int id) const;
+    int get_window_color_mode(int id) const;
+    Ref<H264Decoder> get_window_decoder(int id) const;
+
+    // Starting atlas size; larger windows grow it up to MAX_ATLAS_SIZE
+    void set_atlas_size(int width, int height);
+    int get_atlas_width() const { return atlas_width; }
+    int get_atlas_height() const { return atlas_height; }
+
+    Ref<ShaderMaterial> get_material() const { return material; }
+    Ref<Texture2DArray> get_y_texture() const { return y_texture; }
+    Ref<Texture2DArray> get_uv_texture() const { return uv_texture; }
+
+    Dictionary get_stats() const;
+
+    void _process(double p_delta) override;
+};
+
+} // namespace godot
+
+#endif // STREAM_ATLAS_H
@@ -0,0 +1,391 @@
+/*
+ * Stream Audio Mixer Implementation
+ * SSE on x86, NEON on ARM, scalar elsewhere
+ */
+
+#include "stream_audio_mixer.h"
+#include "adpcm.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define MIXER_HAS_SSE 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MIXER_HAS_NEON 1
+#endif
+
+using namespace godot;
+
+// Mixed blocks are handed to Godot as PackedVector2Array without conversion
+static_assert(sizeof(Vector2) == 2 * sizeof(float), "StreamAudioMixer needs single-precision Vector2");
+
+static int64_t elapsed_usec(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+// out += in * gain for interleaved stereo, with the channel gains moving
+// linearly by step per frame (frame i uses start + step * i)
+static void mix_ramp(float* out, const float* in, size_t frames,
+                     float start_l, float start_r, float step_l, float step_r) {
+    size_t i = 0;
+#if defined(MIXER_HAS_SSE)
+    __m128 gain = _mm_setr_ps(start_l, start_r, start_l + step_l, start_r + step_r);
+    const __m128 step = _mm_setr_ps(2 * step_l, 2 * step_r, 2 * step_l, 2 * step_r);
+    for (; i + 2 <= frames; i += 2) {
+        __m128 acc = _mm_loadu_ps(out + i * 2);
+        __m128 x = _mm_loadu_ps(in + i * 2);
+        _mm_storeu_ps(out + i * 2, _mm_add_ps(acc, _mm_mul_ps(x, gain)));
+        gain = _mm_add_ps(gain, step);
+    }
+#elif defined(MIXER_HAS_NEON)
+    float32x4_t gain = { start_l, start_r, start_l + step_l, start_r + step_r };
+    const float32x4_t step = { 2 * step_l, 2 * step_r, 2 * step_l, 2 * step_r };
+    for (; i + 2 <= frames; i += 2) {
+        vst1q_f32(out + i * 2, vmlaq_f32(vld1q_f32(out + i * 2), vld1q_f32(in + i * 2), gain));
+        gain = vaddq_f32(gain, step);
+    }
+#endif
+    for (; i < frames; i++) {
+        out[i * 2] += in[i * 2] * (start_l + step_l * (float)i);
+        out[i * 2 + 1] += in[i * 2 + 1] * (start_r + step_r * (float)i);
+    }
+}
+
+static void clip_samples(float* data, size_t count) {
+    size_t i = 0;
+#if defined(MIXER_HAS_SSE)
+    const __m128 lo = _mm_set1_ps(-1.0f);
+    const __m128 hi = _mm_set1_ps(1.0f);
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(data + i, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(data + i), lo), hi));
+    }
+#elif defined(MIXER_HAS_NEON)
+    const float32x4_t lo = vdupq_n_f32(-1.0f);
+    const float32x4_t hi = vdupq_n_f32(1.0f);
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(data + i, vminq_f32(vmaxq_f32(vld1q_f32(data + i), lo), hi));
+    }
+#endif
+    for (; i < count; i++) {
+        data[i] = std::min(std::max(data[i], -1.0f), 1.0f);
+    }
+}
+
+size_t StreamAudioMixer::Stream::read(float* dst, size_t frames) {
+    size_t count = std::min(frames, buffered);
+    size_t cap = capacity();
+    size_t first = std::min(count, cap - read_pos);
+    memcpy(dst, ring.data() + read_pos * 2, first * 2 * sizeof(float));
+    memcpy(dst + first * 2, ring.data(), (count - first) * 2 * sizeof(float));
+    read_pos = (read_pos + count) % cap;
+    buffered -= count;
+    return count;
+}
+
+void StreamAudioMixer::Stream::target_gains(float& left, float& right) const {
+    float g = muted ? 0.0f : gain;
+    left = g * (pan > 0.0f ? 1.0f - pan : 1.0f);
+    right = g * (pan < 0.0f ? 1.0f + pan : 1.0f);
+}
+
+void StreamAudioMixer::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("add_stream"), &StreamAudioMixer::add_stream);
+    ClassDB::bind_method(D_METHOD("remove_stream", "id"), &StreamAudioMixer::remove_stream);
+    ClassDB::bind_method(D_METHOD("has_stream", "id"), &StreamAudioMixer::has_stream);
+    ClassDB::bind_method(D_METHOD("get_stream_ids"), &StreamAudioMixer::get_stream_ids);
+    ClassDB::bind_method(D_METHOD("push_packet", "id", "adpcm_data"), &StreamAudioMixer::push_packet);
+    ClassDB::bind_method(D_METHOD("set_stream_gain", "id", "gain"), &StreamAudioMixer::set_stream_gain);
+    ClassDB::bind_method(D_METHOD("get_stream_gain", "id"), &StreamAudioMixer::get_stream_gain);
+    ClassDB::bind_method(D_METHOD("set_stream_pan", "id", "pan"), &StreamAudioMixer::set_stream_pan);
+    ClassDB::bind_method(D_METHOD("get_stream_pan", "id"), &StreamAudioMixer::get_stream_pan);
+    ClassDB::bind_method(D_METHOD("set_stream_muted", "id", "muted"), &StreamAudioMixer::set_stream_muted);
+    ClassDB::bind_method(D_METHOD("is_stream_muted", "id"), &StreamAudioMixer::is_stream_muted);
+    ClassDB::bind_method(D_METHOD("set_stream_separate", "id", "separate"), &StreamAudioMixer::set_stream_separate);
+    ClassDB::bind_method(D_METHOD("is_stream_separate", "id"), &StreamAudioMixer::is_stream_separate);
+    ClassDB::bind_method(D_METHOD("mix", "frames"), &StreamAudioMixer::mix);
+    ClassDB::bind_method(D_METHOD("mix_to", "playback"), &StreamAudioMixer::mix_to);
+    ClassDB::bind_method(D_METHOD("read_stream", "id", "frames"), &StreamAudioMixer::read_stream);
+    ClassDB::bind_method(D_METHOD("push_stream_to", "id", "playback"), &StreamAudioMixer::push_stream_to);
+    ClassDB::bind_method(D_METHOD("set_mix_rate", "rate"), &StreamAudioMixer::set_mix_rate);
+    ClassDB::bind_method(D_METHOD("get_mix_rate"), &StreamAudioMixer::get_mix_rate);
+    ClassDB::bind_method(D_METHOD("set_max_latency_msec", "msec"), &StreamAudioMixer::set_max_latency_msec);
+    ClassDB::bind_method(D_METHOD("get_max_latency_msec"), &StreamAudioMixer::get_max_latency_msec);
+    ClassDB::bind_method(D_METHOD("set_clip_output", "enabled"), &StreamAudioMixer::set_clip_output);
+    ClassDB::bind_method(D_METHOD("is_clip_output"), &StreamAudioMixer::is_clip_output);
+    ClassDB::bind_method(D_METHOD("get_stream_stats", "id"), &StreamAudioMixer::get_stream_stats);
+    ClassDB::bind_method(D_METHOD("get_stats"), &StreamAudioMixer::get_stats);
+}
+
+StreamAudioMixer::Stream* StreamAudioMixer::find_stream(int id) {
+    for (Stream& stream : streams) {
+        if (stream.id == id) {
+            return &stream;
+        }
+    }
+    return nullptr;
+}
+
+const StreamAudioMixer::Stream* StreamAudioMixer::find_stream(int id) const {
+    return const_cast<StreamAudioMixer*>(this)->find_stream(id);
+}
+
+size_t StreamAudioMixer::ring_frames() const {
+    return std::max<size_t>((size_t)mix_rate * max_latency_msec / 1000, 1);
+}
+
+int StreamAudioMixer::add_stream() {
+    std::lock_guard<std::mutex> lock(mutex);
+    Stream stream;
+    stream.id = next_id++;
+    stream.ring.assign(ring_frames() * 2, 0.0f);
+    streams.push_back(std::move(stream));
+    return streams.back().id;
+}
+
+void StreamAudioMixer::remove_stream(int id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    streams.erase(std::remove_if(streams.begin(), streams.end(),
+                                 [id](const Stream& s) { return s.id == id; }),
+                  streams.end());
+}
+
+bool StreamAudioMixer::has_stream(int id) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return find_stream(id) != nullptr;
+}
+
+PackedInt32Array StreamAudioMixer::get_stream_ids() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    PackedInt32Array ids;
+    for (const Stream& stream : streams) {
+        ids.push_back(stream.id);
+    }
+    return ids;
+}
+
+bool StreamAudioMixer::push_packet(int id, const PackedByteArray& adpcm_data) {
+    auto start = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+    Stream* stream = find_stream(id);
+    if (!stream) {
+        return false;
+    }
+
+    const uint8_t* src = adpcm_data.ptr();
+    int64_t count = adpcm_data.size();
+    size_t cap = stream->capacity();
+    float* ring = stream->ring.data();
+    for (int64_t i = 0; i < count; i++) {
+        if (stream->buffered == cap) {
+            // Consumer fell behind: drop the oldest frame to bound latency
+            stream->read_pos = (stream->read_pos + 1) % cap;
+            stream->buffered--;
+            stream->dropped_frames++;
+        }
+        size_t pos = (stream->read_pos + stream->buffered) % cap;
+        uint8_t byte = src[i];
+        ring[pos * 2] = (float)adpcm_decode_nibble(byte >> 4, stream->predicted_l, stream->index_l) / 32768.0f;
+        ring[pos * 2 + 1] = (float)adpcm_decode_nibble(byte & 0x0F, stream->predicted_r, stream->index_r) / 32768.0f;
+        stream->buffered++;
+    }
+
+    stream->started = true;
+    packets_decoded++;
+    last_decode_usec = elapsed_usec(start);
+    return true;
+}
+
+void StreamAudioMixer::set_stream_gain(int id, float gain) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (Stream* stream = find_stream(id)) {
+        stream->gain = std::max(gain, 0.0f);
+    }
+}
+
+float StreamAudioMixer::get_stream_gain(int id) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    const Stream* stream = find_stream(id);
+    return stream ? stream->gain : 0.0f;
+}
+
+void StreamAudioMixer::set_stream_pan(int id, float pan) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (Stream* stream = find_stream(id)) {
+        stream->pan = std::min(std::max(pan, -1.0f), 1.0f);
+    }
+}
+
+float StreamAudioMixer::get_stream_pan(int id) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    const Stream* stream = find_stream(id);
+    return stream ? stream->pan : 0.0f;
+}
+
+void StreamAudioMixer::set_stream_muted(int id, bool muted) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (Stream* stream = find_stream(id)) {
+        stream->muted = muted;
+    }
+}
+
+bool StreamAudioMixer::is_stream_muted(int id) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    const Stream* stream = find_stream(id);
+    return stream && stream->muted;
+}
+
+void StreamAudioMixer::set_stream_separate(int id, bool separate) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (Stream* stream = find_stream(id)) {
+        stream->separate = separate;
+    }
+}
+
+bool StreamAudioMixer::is_stream_separate(int id) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    const Stream* stream = find_stream(id);
+    return stream && stream->separate;
+}
+
+PackedVector2Array StreamAudioMixer::mix(int frames) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return mix_locked(frames);
+}
+
+PackedVector2Array StreamAudioMixer::mix_locked(int frames) {
+    PackedVector2Array result;
+    if (frames <= 0) {
+        return result;
+    }
+    auto start = std::chrono::steady_clock::now();
+
+    result.resize(frames);
+    float* out = (float*)result.ptrw();
+    memset(out, 0, (size_t)frames * 2 * sizeof(float));
+    scratch.resize((size_t)frames * 2);
+
+    for (Stream& stream : streams) {
+        if (stream.separate) {
+            continue;
+        }
+        size_t got = stream.read(scratch.data(), frames);
+        if (got < (size_t)frames && stream.started) {
+            stream.underrun_frames += frames - (int64_t)got;
+        }
+
+        float target_l, target_r;
+        stream.target_gains(target_l, target_r);
+        // Muted and already faded out: consume only
+        if (target_l == 0.0f && target_r == 0.0f && stream.applied_l == 0.0f && stream.applied_r == 0.0f) {
+            continue;
+        }
+        float step_l = (target_l - stream.applied_l) / (float)frames;
+        float step_r = (target_r - stream.applied_r) / (float)frames;
+        // Missing frames are silence; only mix what was read
+        mix_ramp(out, scratch.data(), got, stream.applied_l + step_l, stream.applied_r + step_r, step_l, step_r);
+        stream.applied_l = target_l;
+        stream.applied_r = target_r;
+    }
+
+    if (clip_output) {
+        clip_samples(out, (size_t)frames * 2);
+    }
+    last_mix_usec = elapsed_usec(start);
+    return result;
+}
+
+int StreamAudioMixer::mix_to(const Ref<AudioStreamGeneratorPlayback>& playback) {
+    if (playback.is_null()) {
+        return 0;
+    }
+    int frames = playback->get_frames_available();
+    if (frames <= 0) {
+        return 0;
+    }
+    playback->push_buffer(mix(frames));
+    return frames;
+}
+
+PackedVector2Array StreamAudioMixer::read_stream(int id, int frames) {
+    std::lock_guard<std::mutex> lock(mutex);
+    PackedVector2Array result;
+    Stream* stream = find_stream(id);
+    if (!stream || frames <= 0) {
+        return result;
+    }
+    result.resize(std::min((size_t)frames, stream->buffered));
+    stream->read((float*)result.ptrw(), result.size());
+    return result;
+}
+
+int StreamAudioMixer::push_stream_to(int id, const Ref<AudioStreamGeneratorPlayback>& playback) {
+    if (playback.is_null()) {
+        return 0;
+    }
+    PackedVector2Array samples = read_stream(id, playback->get_frames_available());
+    if (samples.is_empty()) {
+        return 0;
+    }
+    playback->push_buffer(samples);
+    return (int)samples.size();
+}
+
+void StreamAudioMixer::set_mix_rate(int rate) {
+    std::lock_guard<std::mutex> lock(mutex);
+    mix_rate = std::max(rate, 8000);
+    for (Stream& stream : streams) {
+        stream.ring.assign(ring_frames() * 2, 0.0f);
+        stream.read_pos = 0;
+        stream.buffered = 0;
+    }
+}
+
+void StreamAudioMixer::set_max_latency_msec(int msec) {
+    std::lock_guard<std::mutex> lock(mutex);
+    max_latency_msec = std::max(msec, 10);
+    for (Stream& stream : streams) {
+        stream.ring.assign(ring_frames() * 2, 0.0f);
+        stream.read_pos = 0;
+        stream.buffered = 0;
+    }
+}
+
+Dictionary StreamAudioMixer::get_stream_stats(int id) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Dictionary stats;
+    const Stream* stream = find_stream(id);
+    if (!stream) {
+        return stats;
+    }
+    stats["buffered_msec"] = (double)stream->buffered * 1000.0 / mix_rate;
+    stats["underrun_frames"] = stream->underrun_frames;
+    stats["dropped_frames"] = stream->dropped_frames;
+    stats["gain"] = stream->gain;
+    stats["pan"] = stream->pan;
+    stats["muted"] = stream->muted;
+    stats["separate"] = stream->separate;
+    return stats;
+}
+
+Dictionary StreamAudioMixer::get_stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Dictionary stats;
+    int64_t underruns = 0;
+    int64_t dropped = 0;
+    for (const Stream& stream : streams) {
+        underruns += stream.underrun_frames;
+        dropped += stream.dropped_frames;
+    }
+    stats["streams"] = (int)streams.size();
+    stats["mix_usec"] = last_mix_usec;
+    stats["decode_usec"] = last_decode_usec;
+    stats["packets_decoded"] = packets_decoded;
+    stats["underrun_frames"] = underruns;
+    stats["dropped_frames"] = dropped;
+    return stats;
+}
@@ -0,0 +1,139 @@
+/*
+ * Stream Audio Mixer
+ * Decodes the ADPCM audio of several streamed windows and mixes it natively
+ *
+ * Each stream has its own IMA ADPCM state and a float ring buffer that
+ * push_packet decodes into. mix() pulls the same number of frames from
+ * every stream, applies gain, pan and mute with SIMD (gain changes are
+ * ramped over the block so they don't click) and returns one stereo
+ * buffer, ready for an AudioStreamGenerator.
+ *
+ * Streams that need their own AudioStreamPlayer3D for spatial audio are
+ * marked separate: they skip the mix, and read_stream / push_stream_to
+ * hand out their samples straight from the ring.
+ *
+ * There is no resampling; streams are expected at the output mix rate.
+ */
+
+#ifndef STREAM_AUDIO_MIXER_H
+#define STREAM_AUDIO_MIXER_H
+
+#include <godot_cpp/classes/audio_stream_generator_playback.hpp>
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/packed_int32_array.hpp>
+#include <godot_cpp/variant/packed_vector2_array.hpp>
+
+#include <mutex>
+#include <vector>
+
+namespace godot {
+
+class StreamAudioMixer : public RefCounted {
+    GDCLASS(StreamAudioMixer, RefCounted)
+
+private:
+    struct Stream {
+        int id = 0;
+        // ADPCM predictor state per channel
+        int predicted_l = 0, index_l = 0;
+        int predicted_r = 0, index_r = 0;
+
+        // Interleaved L/R floats; capacity is fixed by the latency cap
+        std::vector<float> ring;
+        size_t read_pos = 0; // in frames
+        size_t buffered = 0; // in frames
+        bool started = false; // underruns only count once audio has arrived
+
+        float gain = 1.0f;
+        float pan = 0.0f;
+        bool muted = false;
+        bool separate = false;
+        // Channel gains reached at the end of the last mix, ramp start for the next
+        float applied_l = 1.0f;
+        float applied_r = 1.0f;
+
+        int64_t underrun_frames = 0;
+        int64_t dropped_frames = 0;
+
+        size_t capacity() const { return ring.size() / 2; }
+        // Copy up to `frames` out of the ring; returns how many were there
+        size_t read(float* dst, size_t frames);
+        void target_gains(float& left, float& right) const;
+    };
+
+    mutable std::mutex mutex;
+    std::vector<Stream> streams;
+    int next_id = 1;
+    int mix_rate = 48000;
+    int max_latency_msec = 250;
+    bool clip_output = true;
+
+    std::vector<float> scratch; // one stream's block, before gain
+
+    // Stats
+    int64_t last_mix_usec = 0;
+    int64_t last_decode_usec = 0;
+    int64_t packets_decoded = 0;
+
+    Stream* find_stream(int id);
+    const Stream* find_stream(int id) const;
+    size_t ring_frames() const;
+    PackedVector2Array mix_locked(int frames);
+
+protected:
+    static void _bind_methods();
+
+public:
+    // Returns the new stream's id
+    int add_stream();
+    void remove_stream(int id);
+    bool has_stream(int id) const;
+    PackedInt32Array get_stream_ids() const;
+
+    // Decode one ADPCM packet (one byte per frame, left in the high nibble)
+    // into the stream's ring. Past the latency cap the oldest audio is dropped.
+    bool push_packet(int id, const PackedByteArray& adpcm_data);
+
+    // Per-stream mix controls. Pan is a balance: -1 is left only, 0 leaves
+    // both channels at full gain, 1 is right only.
+    void set_stream_gain(int id, float gain);
+    float get_stream_gain(int id) const;
+    void set_stream_pan(int id, float pan);
+    float get_stream_pan(int id) const;
+    void set_stream_muted(int id, bool muted);
+    bool is_stream_muted(int id) const;
+    // Separate streams stay out of the mix and are read on their own
+    void set_stream_separate(int id, bool separate);
+    bool is_stream_separate(int id) const;
+
+    // Mix `frames` frames of every mixed stream. Streams short of data
+    // contribute silence for the missing part (counted as underruns).
+    PackedVector2Array mix(int frames);
+    // Mix exactly as many frames as the playback can take and push them
+    int mix_to(const Ref<AudioStreamGeneratorPlayback>& playback);
+
+    // Unmixed samples of one stream, for spatialized playback
+    PackedVector2Array read_stream(int id, int frames);
+    int push_stream_to(int id, const Ref<AudioStreamGeneratorPlayback>& playback);
+
+    // Output rate, used to turn the latency cap into frames
+    void set_mix_rate(int rate);
+    int get_mix_rate() const { return mix_rate; }
+    // Audio a stream may buffer before the oldest is dropped
+    void set_max_latency_msec(int msec);
+    int get_max_latency_msec() const { return max_latency_msec; }
+    // Clamp the mix to [-1, 1]
+    void set_clip_output(bool enabled) { clip_output = enabled; }
+    bool is_clip_output() const { return clip_output; }
+
+    // {"buffered_msec", "underrun_frames", "dropped_frames", "gain", "pan", "muted", "separate"}
+    Dictionary get_stream_stats(int id) const;
+    Dictionary get_stats() const;
+};
+
+} // namespace godot
+
+#endif // STREAM_AUDIO_MIXER_H
@@ -0,0 +1,602 @@
+/*
+ * Stream Display Node Implementation
+ */
+
+#include "stream_display.h"
+#include "rgba_converter.h"
+
+#include <godot_cpp/classes/global_constants.hpp>
+#include <godot_cpp/classes/rendering_server.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/color.hpp>
+#include <godot_cpp/variant/utility_functions.hpp>
+
+#include <chrono>
+#include <cstring>
+
+extern "C" {
+#include <libavutil/mem.h>
+#include <libavutil/murmur3.h>
+}
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__) || defined(__ANDROID__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace godot;
+
+// Image::compress_from_channels needs the etcpak/betsy/cvtt modules, which
+// editor builds have and export templates usually don't (ERR_UNAVAILABLE).
+// One 4x4 block answers it, once per process and mode.
+static bool probe_compression(Image::CompressMode mode) {
+    PackedByteArray block;
+    block.resize(16);
+    memset(block.ptrw(), 128, 16);
+    Ref<Image> probe = Image::create_from_data(4, 4, false, Image::FORMAT_R8, block);
+    return probe.is_valid() && probe->compress_from_channels(mode, Image::USED_CHANNELS_R) == OK;
+}
+
+// R8 planes compress to single-channel ETC2 R11 (mobile/Quest) or BC4
+// (desktop). False when the GPU takes neither or this build can't encode it.
+static bool select_compress_mode(Image::CompressMode& mode) {
+    static int etc2_available = -1;
+    static int s3tc_available = -1;
+    RenderingServer* rs = RenderingServer::get_singleton();
+    if (rs->has_os_feature("etc2")) {
+        mode = Image::COMPRESS_ETC2;
+        if (etc2_available < 0) {
+            etc2_available = probe_compression(mode) ? 1 : 0;
+        }
+        return etc2_available == 1;
+    }
+    if (rs->has_os_feature("s3tc")) {
+        mode = Image::COMPRESS_S3TC;
+        if (s3tc_available < 0) {
+            s3tc_available = probe_compression(mode) ? 1 : 0;
+        }
+        return s3tc_available == 1;
+    }
+    return false;
+}
+
+// U occupies the left half of each chroma row, V the right half (same
+// layout decode_frame returns). Chroma lookups are clamped to their half
+// so linear filtering never bleeds U into V.
+static const char* STREAM_DISPLAY_SHADER = R"(
+shader_type spatial;
+render_mode unshaded, cull_disabled;
+
+uniform sampler2D y_tex : filter_linear, repeat_disable;
+uniform sampler2D uv_tex : filter_linear, repeat_disable;
+uniform bool full_range = false;
+uniform int color_matrix = 0; // 0 = BT.709, 1 = BT.601, 2 = BT.2020
+
+// Cursor overlay: rect is (x, y, w, h) in UV space, texture is RGBA8
+uniform sampler2D cursor_tex : filter_nearest, repeat_disable;
+uniform vec4 cursor_rect = vec4(0.0);
+uniform bool cursor_visible = false;
+
+vec3 srgb_to_linear(vec3 c) {
+    return mix(c / 12.92, pow((c + 0.055) / 1.055, vec3(2.4)), step(vec3(0.04045), c));
+}
+
+void fragment() {
+    float half_texel = 0.5 / float(textureSize(uv_tex, 0).x);
+    float cx = clamp(UV.x * 0.5, half_texel, 0.5 - half_texel);
+
+    float y = texture(y_tex, UV).r;
+    float u = texture(uv_tex, vec2(cx, UV.y)).r;
+    float v = texture(uv_tex, vec2(cx + 0.5, UV.y)).r;
+
+    if (full_range) {
+        u -= 0.5;
+        v -= 0.5;
+    } else {
+        y = (y - 16.0 / 255.0) * (255.0 / 219.0);
+        u = (u - 128.0 / 255.0) * (255.0 / 224.0);
+        v = (v - 128.0 / 255.0) * (255.0 / 224.0);
+    }
+
+    vec3 rgb;
+    if (color_matrix == 2) {
+        rgb = vec3(y + 1.4746 * v, y - 0.164553 * u - 0.571353 * v, y + 1.8814 * u);
+    } else if (color_matrix == 1) {
+        rgb = vec3(y + 1.402 * v, y - 0.344136 * u - 0.714136 * v, y + 1.772 * u);
+    } else {
+        rgb = vec3(y + 1.5748 * v, y - 0.1873 * u - 0.4681 * v, y + 1.8556 * u);
+    }
+
+    rgb = clamp(rgb, 0.0, 1.0);
+
+    // Blend in sRGB space, same as the desktop compositor
+    if (cursor_visible) {
+        vec2 cuv = (UV - cursor_rect.xy) / cursor_rect.zw;
+        if (all(greaterThanEqual(cuv, vec2(0.0))) && all(lessThan(cuv, vec2(1.0)))) {
+            vec4 c = texture(cursor_tex, cuv);
+            rgb = mix(rgb, c.rgb, c.a);
+        }
+    }
+
+    ALBEDO = srgb_to_linear(rgb);
+}
+)";
+
+void StreamDisplay::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("push_packet", "h264_data"), &StreamDisplay::push_packet);
+    ClassDB::bind_method(D_METHOD("get_decoder"), &StreamDisplay::get_decoder);
+    ClassDB::bind_method(D_METHOD("get_material"), &StreamDisplay::get_material);
+    ClassDB::bind_method(D_METHOD("get_y_texture"), &StreamDisplay::get_y_texture);
+    ClassDB::bind_method(D_METHOD("get_uv_texture"), &StreamDisplay::get_uv_texture);
+    ClassDB::bind_method(D_METHOD("get_frame_width"), &StreamDisplay::get_frame_width);
+    ClassDB::bind_method(D_METHOD("get_frame_height"), &StreamDisplay::get_frame_height);
+    ClassDB::bind_method(D_METHOD("push_cursor_packet", "data"), &StreamDisplay::push_cursor_packet);
+    ClassDB::bind_method(D_METHOD("get_cursor_channel"), &StreamDisplay::get_cursor_channel);
+    ClassDB::bind_method(D_METHOD("set_snapshot_service", "service"), &StreamDisplay::set_snapshot_service);
+    ClassDB::bind_method(D_METHOD("get_snapshot_service"), &StreamDisplay::get_snapshot_service);
+    ClassDB::bind_method(D_METHOD("set_extrapolate_late_frames", "enabled"), &StreamDisplay::set_extrapolate_late_frames);
+    ClassDB::bind_method(D_METHOD("get_extrapolate_late_frames"), &StreamDisplay::get_extrapolate_late_frames);
+    ClassDB::bind_method(D_METHOD("set_compress_after_static_frames", "frames"), &StreamDisplay::set_compress_after_static_frames);
+    ClassDB::bind_method(D_METHOD("get_compress_after_static_frames"), &StreamDisplay::get_compress_after_static_frames);
+    ClassDB::bind_method(D_METHOD("is_static_compressed"), &StreamDisplay::is_static_compressed);
+    ClassDB::bind_method(D_METHOD("get_stats"), &StreamDisplay::get_stats);
+
+    ADD_PROPERTY(PropertyInfo(Variant::BOOL, "extrapolate_late_frames"), "set_extrapolate_late_frames", "get_extrapolate_late_frames");
+    ADD_PROPERTY(PropertyInfo(Variant::INT, "compress_after_static_frames"), "set_compress_after_static_frames", "get_compress_after_static_frames");
+
+    ADD_SIGNAL(MethodInfo("frame_size_changed", PropertyInfo(Variant::INT, "width"), PropertyInfo(Variant::INT, "height")));
+}
+
+StreamDisplay::StreamDisplay() {
+    decoder.instantiate();
+    cursor.instantiate();
+    compress_result = std::make_shared<CompressResult>();
+
+    shader.instantiate();
+    shader->set_code(STREAM_DISPLAY_SHADER);
+    material.instantiate();
+    material->set_shader(shader);
+}
+
+StreamDisplay::~StreamDisplay() {
+    cancel_static_compression();
+    {
+        std::lock_guard<std::mutex> lock(compress_worker_mutex);
+        compress_worker_stopping = true;
+        compress_job = nullptr;
+    }
+    compress_worker_cv.notify_all();
+    if (compress_worker.joinable()) {
+        compress_worker.join();
+    }
+    pending_packets.clear();
+    av_free(plane_hasher);
+}
+
+void StreamDisplay::push_packet(const PackedByteArray& h264_data) {
+    if (h264_data.size() == 0) {
+        return;
+    }
+    pending_packets.push_back(h264_data);
+}
+
+bool StreamDisplay::push_cursor_packet(const PackedByteArray& data) {
+    return cursor->push_packet(data);
+}
+
+void StreamDisplay::_process(double p_delta) {
+    int64_t now_usec = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    // Decode everything that arrived since last frame; only the newest
+    // picture is repacked and uploaded.
+    bool new_frame = false;
+    for (const PackedByteArray& packet : pending_packets) {
+        if (decoder->decode_packet(packet.ptr(), packet.size()) == H264Decoder::PACKET_DECODED) {
+            new_frame = true;
+        }
+    }
+    pending_packets.clear();
+
+    bool changed = false;
+    if (new_frame) {
+        if (last_frame_usec > 0) {
+            int64_t interval = now_usec - last_frame_usec;
+            frame_interval_usec = frame_interval_usec > 0 ? (frame_interval_usec * 7 + interval) / 8 : interval;
+        }
+        last_frame_usec = now_usec;
+        changed = upload_current_frame();
+    } else if (extrapolate_late_frames && frame_interval_usec > 0 && last_frame_usec > 0 &&
+               now_usec - last_frame_usec > frame_interval_usec * 3 / 2) {
+        // Deadline missed: show the predicted picture instead of repeating
+        // the last one. At most one prediction per decoded frame.
+        changed = upload_extrapolated_frame();
+    }
+
+    if (changed) {
+        static_frames = 0;
+    } else if (compress_after_static_frames > 0 && y_texture.is_valid()) {
+        static_frames++;
+        if (compress_pending) {
+            apply_static_compression();
+        } else if (!compressed_active && static_frames == compress_after_static_frames) {
+            start_static_compression();
+        }
+    }
+
+    update_cursor_params(false);
+}
+
+void StreamDisplay::resize_textures(int width, int height) {
+    texture_width = width;
+    texture_height = height;
+
+    // Textures are recreated from the first frame at the new size
+    cancel_static_compression();
+    uploaded_hash_valid = false;
+    compressed_active = false;
+    y_texture.unref();
+    uv_texture.unref();
+
+    UtilityFunctions::print("[StreamDisplay] Texture size: ", width, "x", height);
+    emit_signal("frame_size_changed", width, height);
+
+    // Cursor rect is normalized to the frame size
+    update_cursor_params(true);
+}
+
+void StreamDisplay::update_cursor_params(bool force) {
+    if (!cursor->take_changed() && !force) {
+        return;
+    }
+
+    bool show = cursor->is_visible() && texture_width > 0 && texture_height > 0;
+    if (show) {
+        Vector2i position = cursor->get_position();
+        Vector2i hotspot = cursor->get_hotspot();
+        Vector2i size = cursor->get_size();
+        material->set_shader_parameter("cursor_tex", cursor->get_texture());
+        material->set_shader_parameter("cursor_rect", Color(
+            (float)(position.x - hotspot.x) / texture_width,
+            (float)(position.y - hotspot.y) / texture_height,
+            (float)size.x / texture_width,
+            (float)size.y / texture_height));
+    }
+    if (show != cursor_shown) {
+        cursor_shown = show;
+        material->set_shader_parameter("cursor_visible", show);
+    }
+}
+
+void StreamDisplay::update_color_params() {
+    const AVFrame* frame = decoder->get_current_frame();
+    bool full_range = RgbaConverter::is_full_range(frame);
+    // FCC and SMPTE 240M are close enough to BT.601 for display
+    int colorspace = RgbaConverter::get_sws_colorspace(frame);
+    int matrix = colorspace == SWS_CS_BT2020 ? 2 : colorspace != SWS_CS_ITU709 ? 1 : 0;
+
+    if (full_range != color_full_range) {
+        color_full_range = full_range;
+        material->set_shader_parameter("full_range", full_range);
+    }
+    if (matrix != color_matrix) {
+        color_matrix = matrix;
+        material->set_shader_parameter("color_matrix", matrix);
+    }
+}
+
+bool StreamDisplay::upload_current_frame() {
+    // Never repack an unreferenced frame: a receive that returned EAGAIN
+    // must not leave us uploading empty planes. With refresh gating this is
+    // the last clean picture, and its size is the one that counts.
+    const AVFrame* current = decoder->get_current_frame();
+    if (!current || !current->buf[0]) {
+        return false;
+    }
+    int width = current->width;
+    int height = current->height;
+    if (width <= 0 || height <= 0) {
+        return false;
+    }
+
+    auto upload_start = std::chrono::steady_clock::now();
+
+    if (width != texture_width || height != texture_height) {
+        resize_textures(width, height);
+    }
+
+    // Fresh buffers each frame: the images keep the previous ones alive until
+    // set_data, so writing into those would trigger a copy-on-write anyway.
+    PackedByteArray y_data;
+    PackedByteArray uv_data;
+    y_data.resize((int64_t)width * height);
+    uv_data.resize((int64_t)width * (height / 2));
+    decoder->repack_yuv(y_data.ptrw(), uv_data.ptrw());
+
+    if (snapshot_service.is_valid()) {
+        snapshot_service->submit_native_frame(current);
+    }
+
+    // Region commands that touched nothing leave the textures as they are
+    if (decoder->is_retained_mode() && decoder->get_dirty_rects().size() == 0 && y_texture.is_valid()) {
+        return false;
+    }
+
+    // An idle desktop still sends (all-skip) P-frames; compare content so
+    // those count as static instead of resetting the countdown
+    if (compress_after_static_frames > 0) {
+        uint64_t hash = hash_planes(y_data, uv_data);
+        if (uploaded_hash_valid && hash == uploaded_hash && y_texture.is_valid()) {
+            frames_unchanged++;
+            return false;
+        }
+        uploaded_hash = hash;
+        uploaded_hash_valid = true;
+    }
+
+    update_color_params();
+    upload_planes(y_data, uv_data);
+    if (decoder->is_latency_probe_enabled()) {
+        decoder->probe_presented_plane(y_data.ptr(), width, width, height);
+    }
+
+    frames_uploaded++;
+    last_upload_usec = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - upload_start).count();
+    return true;
+}
+
+bool StreamDisplay::upload_extrapolated_frame() {
+    if (texture_width <= 0 || texture_height <= 0 || y_texture.is_null()) {
+        return false;
+    }
+
+    PackedByteArray y_data;
+    PackedByteArray uv_data;
+    y_data.resize((int64_t)texture_width * texture_height);
+    uv_data.resize((int64_t)texture_width * (texture_height / 2));
+    if (!decoder->take_extrapolated_planes(y_data.ptrw(), uv_data.ptrw())) {
+        return false;
+    }
+
+    upload_planes(y_data, uv_data);
+    uploaded_hash_valid = false;
+    frames_extrapolated++;
+    return true;
+}
+
+void StreamDisplay::upload_planes(const PackedByteArray& y_data, const PackedByteArray& uv_data) {
+    int uv_height = texture_height / 2;
+    cancel_static_compression();
+
+    if (compressed_active && y_texture.is_valid() && uv_texture.is_valid()) {
+        // Leaving the compressed path: the RIDs hold block-compressed data
+        // of a different format, so swap raw textures back in under them.
+        y_image = Image::create_from_data(texture_width, texture_height, false, Image::FORMAT_R8, y_data);
+        uv_image = Image::create_from_data(texture_width, uv_height, false, Image::FORMAT_R8, uv_data);
+        RenderingServer* rs = RenderingServer::get_singleton();
+        rs->texture_replace(y_texture->get_rid(), rs->texture_2d_create(y_image));
+        rs->texture_replace(uv_texture->get_rid(), rs->texture_2d_create(uv_image));
+        compressed_active = false;
+        compressed_bytes = 0;
+        compress_restores++;
+    } else if (y_texture.is_null() || uv_texture.is_null()) {
+        y_image = Image::create_from_data(texture_width, texture_height, false, Image::FORMAT_R8, y_data);
+        uv_image = Image::create_from_data(texture_width, uv_height, false, Image::FORMAT_R8, uv_data);
+        y_texture = ImageTexture::create_from_image(y_image);
+        uv_texture = ImageTexture::create_from_image(uv_image);
+        material->set_shader_parameter("y_tex", y_texture);
+        material->set_shader_parameter("uv_tex", uv_texture);
+    } else {
+        // Same size and format: update the existing RIDs in place.
+        // RenderingServer has no sub-rect upload, so the whole plane goes up.
+        y_image->set_data(texture_width, texture_height, false, Image::FORMAT_R8, y_data);
+        uv_image->set_data(texture_width, uv_height, false, Image::FORMAT_R8, uv_data);
+        RenderingServer* rs = RenderingServer::get_singleton();
+        rs->texture_2d_update(y_texture->get_rid(), y_image, 0);
+        rs->texture_2d_update(uv_texture->get_rid(), uv_image, 0);
+    }
+}
+
+int64_t StreamDisplay::get_raw_plane_bytes() const {
+    return (int64_t)texture_width * texture_height + (int64_t)texture_width * (texture_height / 2);
+}
+
+void StreamDisplay::start_static_compression() {
+    if (y_image.is_null() || uv_image.is_null()) {
+        return;
+    }
+
+    Image::CompressMode mode;
+    if (compression_available != 1 || !select_compress_mode(mode)) {
+        return;
+    }
+
+    // The worker gets its own images; they share the plane buffers
+    // copy-on-write, so later uploads can't race with it.
+    Ref<Image> y_copy = Image::create_from_data(texture_width, texture_height, false, Image::FORMAT_R8, y_image->get_data());
+    Ref<Image> uv_copy = Image::create_from_data(texture_width, texture_height / 2, false, Image::FORMAT_R8, uv_image->get_data());
+
+    std::shared_ptr<CompressResult> result = compress_result;
+    uint64_t generation = ++compress_generation;
+    {
+        std::lock_guard<std::mutex> lock(result->mutex);
+        result->generation = generation;
+        result->ready = false;
+    }
+    compress_pending = true;
+
+    queue_compress_job([result, generation, mode, y_copy, uv_copy]() {
+        auto start = std::chrono::steady_clock::now();
+        bool ok = y_copy->compress_from_channels(mode, Image::USED_CHANNELS_R) == OK &&
+                  uv_copy->compress_from_channels(mode, Image::USED_CHANNELS_R) == OK;
+        int64_t usec = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+
+        std::lock_guard<std::mutex> lock(result->mutex);
+        if (result->generation != generation) {
+            return;
+        }
+        result->ready = true;
+        result->failed = !ok;
+        result->y_image = ok ? y_copy : Ref<Image>();
+        result->uv_image = ok ? uv_copy : Ref<Image>();
+        result->usec = usec;
+    });
+}
+
+void StreamDisplay::queue_compress_job(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(compress_worker_mutex);
+        // A job still queued is for an older picture; its generation is stale
+        compress_job = std::move(job);
+    }
+    if (!compress_worker.joinable()) {
+        compress_worker = std::thread(&StreamDisplay::compress_worker_loop, this);
+    }
+    compress_worker_cv.notify_one();
+}
+
+void StreamDisplay::compress_worker_loop() {
+    // Best effort: compressing a static picture must lose to decode and render
+#if defined(_WIN32)
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#elif defined(__linux__) || defined(__ANDROID__)
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 10);
+#endif
+
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(compress_worker_mutex);
+            compress_worker_cv.wait(lock, [this] { return compress_worker_stopping || compress_job; });
+            if (compress_worker_stopping) {
+                return;
+            }
+            job = std::move(compress_job);
+            compress_job = nullptr;
+        }
+        job();
+    }
+}
+
+void StreamDisplay::apply_static_compression() {
+    Ref<Image> y_compressed;
+    Ref<Image> uv_compressed;
+    {
+        std::lock_guard<std::mutex> lock(compress_result->mutex);
+        if (!compress_result->ready || compress_result->generation != compress_generation) {
+            return;
+        }
+        compress_pending = false;
+        compress_result->ready = false;
+        last_compress_usec = compress_result->usec;
+        if (compress_result->failed) {
+            compress_failures++;
+            return;
+        }
+        y_compressed = compress_result->y_image;
+        uv_compressed = compress_result->uv_image;
+        compress_result->y_image.unref();
+        compress_result->uv_image.unref();
+    }
+
+    if (y_texture.is_null() || uv_texture.is_null()) {
+        return;
+    }
+
+    // texture_replace keeps the RIDs the material samples and frees the new ones
+    RenderingServer* rs = RenderingServer::get_singleton();
+    rs->texture_replace(y_texture->get_rid(), rs->texture_2d_create(y_compressed));
+    rs->texture_replace(uv_texture->get_rid(), rs->texture_2d_create(uv_compressed));
+
+    compressed_bytes = y_compressed->get_data_size() + uv_compressed->get_data_size();
+    compressed_active = true;
+    compressions++;
+
+    // The raw planes are rebuilt by the next changed frame
+    y_image.unref();
+    uv_image.unref();
+}
+
+uint64_t StreamDisplay::hash_planes(const PackedByteArray& y_data, const PackedByteArray& uv_data) {
+    auto hash_start = std::chrono::steady_clock::now();
+    if (!plane_hasher) {
+        plane_hasher = av_murmur3_alloc();
+    }
+    uint8_t digest[16];
+    av_murmur3_init(plane_hasher);
+    av_murmur3_update(plane_hasher, y_data.ptr(), (size_t)y_data.size());
+    av_murmur3_update(plane_hasher, uv_data.ptr(), (size_t)uv_data.size());
+    av_murmur3_final(plane_hasher, digest);
+    uint64_t hash;
+    memcpy(&hash, digest, sizeof(hash));
+    last_hash_usec = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - hash_start).count();
+    return hash;
+}
+
+void StreamDisplay::cancel_static_compression() {
+    if (!compress_pending) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(compress_result->mutex);
+    compress_result->generation = ++compress_generation;
+    compress_result->ready = false;
+    compress_result->y_image.unref();
+    compress_result->uv_image.unref();
+    compress_pending = false;
+}
+
+void StreamDisplay::set_compress_after_static_frames(int frames) {
+    if (frames > 0 && compression_available < 0) {
+        Image::CompressMode mode;
+        compression_available = select_compress_mode(mode) ? 1 : 0;
+        if (!compression_available) {
+            UtilityFunctions::printerr("[StreamDisplay] No ETC2/BC4 encoder in this build or GPU support; static compression stays off");
+        }
+    }
+    if (compression_available == 0) {
+        frames = 0;
+    }
+    compress_after_static_frames = frames > 0 ? frames : 0;
+    static_frames = 0;
+    uploaded_hash_valid = false;
+    if (compress_after_static_frames == 0) {
+        cancel_static_compression();
+    }
+}
+
+void StreamDisplay::set_extrapolate_late_frames(bool enabled) {
+    extrapolate_late_frames = enabled;
+    decoder->set_extrapolation_enabled(enabled);
+}
+
+Dictionary StreamDisplay::get_stats() const {
+    Dictionary stats = decoder->get_stats();
+    stats["frames_uploaded"] = frames_uploaded;
+    stats["upload_usec"] = last_upload_usec;
+    stats["pending_packets"] = (int64_t)pending_packets.size();
+    stats["frames_extrapolated_shown"] = frames_extrapolated;
+    stats["frame_interval_usec"] = frame_interval_usec;
+    stats["cursor"] = cursor->get_stats();
+    stats["static_frames"] = static_frames;
+    stats["static_compressed"] = compressed_active;
+    stats["static_compression_available"] = compression_available == 1;
+    stats["compress_usec"] = last_compress_usec;
+    stats["compressions"] = compressions;
+    stats["compress_failures"] = compress_failures;
+    stats["compress_restores"] = compress_restores;
+    stats["frames_unchanged"] = frames_unchanged;
+    stats["hash_usec"] = last_hash_usec;
+    stats["compressed_bytes"] = compressed_active ? compressed_bytes : (int64_t)0;
+    // VRAM plus the dropped CPU copy of the planes
+    stats["compress_saved_bytes"] = compressed_active ? get_raw_plane_bytes() * 2 - compressed_bytes : (int64_t)0;
+    return stats;
+}
@@ -0,0 +1,189 @@
+/*
+ * Stream Display Node
+ * Owns an H264Decoder plus the Y and U|V textures it feeds
+ *
+ * Script only pushes compressed packets; decoding, plane repacking and
+ * texture uploads happen natively in the node's process callback, so no
+ * pixel data crosses into GDScript. Bind get_material() to a mesh/quad.
+ *
+ * Cursor packets go to a CursorChannel and are composited in the shader,
+ * so pointer motion never waits for (or costs) a video frame.
+ *
+ * Optional static compression: once the picture hasn't changed for
+ * compress_after_static_frames process ticks, both planes are block
+ * compressed on a low-priority worker (ETC2 R11 or BC4, whichever the GPU
+ * takes) and swapped into the existing texture RIDs; the raw CPU copies
+ * are dropped. The encoders are Godot modules that export templates
+ * usually leave out; without one the feature stays off
+ * (static_compression_available in get_stats()).
+ * The next changed frame restores the uncompressed path. "Unchanged"
+ * means the repacked planes hash the same as the last upload, so a desktop
+ * stream that keeps sending P-frames for an idle screen still counts as
+ * static (and skips those redundant uploads).
+ */
+
+#ifndef STREAM_DISPLAY_H
+#define STREAM_DISPLAY_H
+
+#include <godot_cpp/classes/node.hpp>
+#include <godot_cpp/classes/image.hpp>
+#include <godot_cpp/classes/image_texture.hpp>
+#include <godot_cpp/classes/shader.hpp>
+#include <godot_cpp/classes/shader_material.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct AVMurMur3;
+
+#include "cursor_channel.h"
+#include "h264_decoder.h"
+#include "snapshot_service.h"
+
+namespace godot {
+
+class StreamDisplay : public Node {
+    GDCLASS(StreamDisplay, Node)
+
+private:
+    Ref<H264Decoder> decoder;
+    std::vector<PackedByteArray> pending_packets;
+
+    Ref<Image> y_image;
+    Ref<Image> uv_image;
+    Ref<ImageTexture> y_texture;
+    Ref<ImageTexture> uv_texture;
+    Ref<Shader> shader;
+    Ref<ShaderMaterial> material;
+
+    int texture_width = 0;
+    int texture_height = 0;
+    bool color_full_range = false;
+    int color_matrix = 0; // shader color_matrix: 0 = BT.709, 1 = BT.601, 2 = BT.2020
+
+    int64_t frames_uploaded = 0;
+    int64_t last_upload_usec = 0;
+
+    // Late-frame extrapolation
+    bool extrapolate_late_frames = false;
+    int64_t last_frame_usec = 0;
+    int64_t frame_interval_usec = 0; // smoothed interval between decoded frames
+    int64_t frames_extrapolated = 0;
+
+    Ref<CursorChannel> cursor;
+    bool cursor_shown = false;
+
+    Ref<SnapshotService> snapshot_service;
+
+    // Static-window compression. The worker publishes into shared state so
+    // it can outlive the node; generation drops results made stale by a new frame.
+    struct CompressResult {
+        std::mutex mutex;
+        uint64_t generation = 0;
+        bool ready = false;
+        bool failed = false;
+        Ref<Image> y_image;
+        Ref<Image> uv_image;
+        int64_t usec = 0;
+    };
+    std::shared_ptr<CompressResult> compress_result;
+    // Encoding a plane takes tens of milliseconds, so it gets its own
+    // below-normal thread instead of holding up the repack pool. Only the
+    // newest job is kept; started on first use.
+    std::thread compress_worker;
+    std::mutex compress_worker_mutex;
+    std::condition_variable compress_worker_cv;
+    std::function<void()> compress_job;
+    bool compress_worker_stopping = false;
+    int compression_available = -1; // -1 until probed
+    int compress_after_static_frames = 0; // 0 = off
+    int static_frames = 0;
+    uint64_t compress_generation = 0;
+    bool compress_pending = false;
+    bool compressed_active = false;
+    int64_t compressed_bytes = 0;
+    int64_t compressions = 0;
+    int64_t compress_failures = 0;
+    int64_t compress_restores = 0;
+    int64_t last_compress_usec = 0;
+    // Content hash of the uploaded planes, only kept while compression is on
+    AVMurMur3* plane_hasher = nullptr;
+    uint64_t uploaded_hash = 0;
+    bool uploaded_hash_valid = false;
+    int64_t frames_unchanged = 0;
+    int64_t last_hash_usec = 0;
+
+    // Recreate textures for a new frame size
+    void resize_textures(int width, int height);
+    // Repack the decoder's current frame and push it to the GPU.
+    // Returns false if the picture didn't change (retained mode, nothing dirty).
+    bool upload_current_frame();
+    // Show the decoder's motion-extrapolated prediction, if one is ready
+    bool upload_extrapolated_frame();
+    void upload_planes(const PackedByteArray& y_data, const PackedByteArray& uv_data);
+    void update_color_params();
+    // Push cursor placement to the shader when it moved or the frame resized
+    void update_cursor_params(bool force);
+
+    void start_static_compression();
+    void apply_static_compression();
+    void queue_compress_job(std::function<void()> job);
+    void compress_worker_loop();
+    // Invalidate any running job so its result is never applied; the
+    // uncompressed textures come back with the next upload_planes()
+    void cancel_static_compression();
+    uint64_t hash_planes(const PackedByteArray& y_data, const PackedByteArray& uv_data);
+    int64_t get_raw_plane_bytes() const;
+
+protected:
+    static void _bind_methods();
+
+public:
+    StreamDisplay();
+    ~StreamDisplay();
+
+    // Queue a compressed packet; decoded on the next process callback
+    void push_packet(const PackedByteArray& h264_data);
+
+    // Decoder instance (configure threads/streaming stores here)
+    Ref<H264Decoder> get_decoder() const { return decoder; }
+
+    // Ready-to-bind spatial material sampling y_tex / uv_tex
+    Ref<ShaderMaterial> get_material() const { return material; }
+    Ref<ImageTexture> get_y_texture() const { return y_texture; }
+    Ref<ImageTexture> get_uv_texture() const { return uv_texture; }
+
+    // Cursor shape/position packets; applied immediately, drawn next frame
+    bool push_cursor_packet(const PackedByteArray& data);
+    Ref<CursorChannel> get_cursor_channel() const { return cursor; }
+
+    // Offer every decoded frame to a snapshot service (it rate-limits thumbnails)
+    void set_snapshot_service(const Ref<SnapshotService>& service) { snapshot_service = service; }
+    Ref<SnapshotService> get_snapshot_service() const { return snapshot_service; }
+
+    // Show a motion-extrapolated frame when the next one is late
+    void set_extrapolate_late_frames(bool enabled);
+    bool get_extrapolate_late_frames() const { return extrapolate_late_frames; }
+
+    // Process ticks without a change before the planes are block compressed; 0 disables.
+    // Stays 0 when neither encoder is available (checked once on first use).
+    void set_compress_after_static_frames(int frames);
+    int get_compress_after_static_frames() const { return compress_after_static_frames; }
+    bool is_static_compressed() const { return compressed_active; }
+
+    int get_frame_width() const { return texture_width; }
+    int get_frame_height() const { return texture_height; }
+
+    Dictionary get_stats() const;
+
+    void _process(double p_delta) override;
+};
+
+} // namespace godot
+
+#endif // STREAM_DISPLAY_H
@@ -0,0 +1,111 @@
+/*
+ * Stream Wire Format
+ * UDP framing used by the reference streamer (tools/reference_streamer)
+ *
+ * Every datagram starts with a 24-byte little-endian header:
+ *
+ *   offset  size  field
+ *   0       2     magic           0x4832 ("2H" on the wire)
+ *   2       1     version         WIRE_VERSION
+ *   3       1     type            WireType
+ *   4       4     frame_id        per-type counter, wraps
+ *   8       8     timestamp_usec  capture time, Unix epoch microseconds
+ *   16      2     fragment_index  0-based
+ *   18      2     fragment_count  >= 1
+ *   20      1     flags           WireFlags
+ *   21      3     reserved        zero
+ *
+ * followed by up to WIRE_MAX_PAYLOAD bytes. A message (one encoded video
+ * access unit, one ADPCM chunk, one cursor packet) is split across
+ * fragment_count datagrams with the same type and frame_id; payloads are
+ * concatenated in fragment_index order. Incomplete messages are dropped when
+ * a newer frame_id of the same type arrives.
+ *
+ * Payloads are exactly what the extension consumes:
+ *   WIRE_VIDEO   Annex B access unit for H264Decoder.decode_frame
+ *   WIRE_AUDIO   stereo IMA ADPCM for H264Decoder.decode_audio (adpcm.h)
+ *   WIRE_CURSOR  CursorChannel.push_packet payload
+ *   WIRE_REGION  H264Decoder.queue_region_commands payload
+ *
+ * The timestamp uses the wall clock so a client on the same machine can
+ * compare it against Time.get_unix_time_from_system().
+ */
+
+#ifndef STREAM_WIRE_H
+#define STREAM_WIRE_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace godot {
+
+static const uint16_t WIRE_MAGIC = 0x4832;
+static const uint8_t WIRE_VERSION = 1;
+static const size_t WIRE_HEADER_SIZE = 24;
+// Keeps datagrams under a 1280-byte IPv6 minimum MTU after IP/UDP headers
+static const size_t WIRE_MAX_PAYLOAD = 1200;
+
+enum WireType {
+    WIRE_VIDEO = 1,
+    WIRE_AUDIO = 2,
+    WIRE_CURSOR = 3,
+    WIRE_REGION = 4,
+};
+
+enum WireFlags {
+    WIRE_FLAG_KEYFRAME = 1 << 0,
+};
+
+struct WireHeader {
+    uint8_t type = 0;
+    uint32_t frame_id = 0;
+    uint64_t timestamp_usec = 0;
+    uint16_t fragment_index = 0;
+    uint16_t fragment_count = 1;
+    uint8_t flags = 0;
+};
+
+inline void wire_write_header(const WireHeader& header, uint8_t* out) {
+    auto put = [out](size_t offset, uint64_t value, int bytes) {
+        for (int i = 0; i < bytes; i++) {
+            out[offset + i] = (uint8_t)(value >> (8 * i));
+        }
+    };
+    put(0, WIRE_MAGIC, 2);
+    out[2] = WIRE_VERSION;
+    out[3] = header.type;
+    put(4, header.frame_id, 4);
+    put(8, header.timestamp_usec, 8);
+    put(16, header.fragment_index, 2);
+    put(18, header.fragment_count, 2);
+    out[20] = header.flags;
+    out[21] = out[22] = out[23] = 0;
+}
+
+// False for foreign or truncated datagrams
+inline bool wire_read_header(const uint8_t* data, size_t size, WireHeader& header) {
+    if (size < WIRE_HEADER_SIZE) {
+        return false;
+    }
+    auto get = [data](size_t offset, int bytes) {
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; i++) {
+            value |= (uint64_t)data[offset + i] << (8 * i);
+        }
+        return value;
+    };
+    if (get(0, 2) != WIRE_MAGIC || data[2] != WIRE_VERSION) {
+        return false;
+    }
+    header.type = data[3];
+    header.frame_id = (uint32_t)get(4, 4);
+    header.timestamp_usec = get(8, 8);
+    header.fragment_index = (uint16_t)get(16, 2);
+    header.fragment_count = (uint16_t)get(18, 2);
+    header.flags = data[20];
+    return header.fragment_count > 0 && header.fragment_index < header.fragment_count;
+}
+
+} // namespace godot
+
+#endif // STREAM_WIRE_H
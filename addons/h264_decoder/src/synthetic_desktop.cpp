@@ -0,0 +1,175 @@
+/*
+ * Synthetic Desktop Implementation
+ */
+
+#include "synthetic_desktop.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace godot;
+
+static const int GLYPH_WIDTH = 8;
+static const int GLYPH_HEIGHT = 16;
+static const int SCROLL_PIXELS_PER_FRAME = 2;
+
+static uint32_t hash32(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352d;
+    x ^= x >> 15;
+    x *= 0x846ca68b;
+    x ^= x >> 16;
+    return x;
+}
+
+SyntheticDesktop::SyntheticDesktop(int p_width, int p_height, Scene p_scene) :
+        width(p_width), height(p_height), scene(p_scene) {
+}
+
+bool SyntheticDesktop::parse_scene(const char* name, Scene& out) {
+    static const struct {
+        const char* name;
+        Scene scene;
+    } SCENES[] = {
+        { "text", SCENE_TEXT },
+        { "drag", SCENE_DRAG },
+        { "video", SCENE_VIDEO },
+        { "mixed", SCENE_MIXED },
+    };
+    for (const auto& entry : SCENES) {
+        if (strcmp(name, entry.name) == 0) {
+            out = entry.scene;
+            return true;
+        }
+    }
+    return false;
+}
+
+void SyntheticDesktop::fill(const Planes& planes, Rect rect, uint8_t y, uint8_t u, uint8_t v) const {
+    int x0 = std::max(rect.x, 0) & ~1;
+    int y0 = std::max(rect.y, 0) & ~1;
+    int x1 = std::min(rect.x + rect.w, width) & ~1;
+    int y1 = std::min(rect.y + rect.h, height) & ~1;
+    if (x1 <= x0 || y1 <= y0) {
+        return;
+    }
+    for (int row = y0; row < y1; row++) {
+        memset(planes.y + (size_t)row * planes.y_stride + x0, y, x1 - x0);
+    }
+    for (int row = y0 / 2; row < y1 / 2; row++) {
+        memset(planes.u + (size_t)row * planes.u_stride + x0 / 2, u, (x1 - x0) / 2);
+        memset(planes.v + (size_t)row * planes.v_stride + x0 / 2, v, (x1 - x0) / 2);
+    }
+}
+
+void SyntheticDesktop::draw_desktop(const Planes& planes) const {
+    fill(planes, { 0, 0, width, height }, 72, 150, 108);
+    int taskbar = std::max(height / 27, 16);
+    fill(planes, { 0, height - taskbar, width, taskbar }, 28, 128, 128);
+    // Static icons, so most macroblocks of the desktop stay skippable
+    int icon = std::max(height / 20, 16);
+    for (int i = 0; i < 6; i++) {
+        fill(planes, { icon / 2, icon / 2 + i * icon * 3 / 2, icon, icon }, (uint8_t)(120 + i * 20), 100, 160);
+    }
+}
+
+void SyntheticDesktop::draw_terminal(const Planes& planes, Rect rect, int frame_index) const {
+    fill(planes, rect, 20, 128, 128);
+
+    // Each text line is a row of pseudo-glyphs: a random 6x10 dot pattern per
+    // character, so the encoder sees text-like edges without a font
+    int scroll = frame_index * SCROLL_PIXELS_PER_FRAME;
+    int x_end = std::min(rect.x + rect.w, width);
+    int y_end = std::min(rect.y + rect.h, height);
+    for (int py = std::max(rect.y, 0); py < y_end; py++) {
+        int content_y = py - rect.y + scroll;
+        int line = content_y / GLYPH_HEIGHT;
+        int gy = content_y % GLYPH_HEIGHT - 3;
+        if (gy < 0 || gy >= 10) {
+            continue;
+        }
+        uint32_t line_hash = hash32((uint32_t)line * 2654435761u);
+        int line_length = 8 + (int)(line_hash % 70);
+        uint8_t* row = planes.y + (size_t)py * planes.y_stride;
+        for (int px = std::max(rect.x, 0); px < x_end; px++) {
+            int col = (px - rect.x) / GLYPH_WIDTH;
+            int gx = (px - rect.x) % GLYPH_WIDTH - 1;
+            if (col >= line_length || gx < 0 || gx >= 6) {
+                continue;
+            }
+            uint32_t glyph = hash32(line_hash ^ (uint32_t)col * 0x9e3779b9u);
+            if (glyph % 7 == 0) {
+                continue; // space
+            }
+            // 60 bits of pattern, bit per dot
+            uint64_t bits = ((uint64_t)glyph << 32) | hash32(glyph);
+            if ((bits >> (gy * 6 + gx)) & 1) {
+                row[px] = 225;
+            }
+        }
+    }
+}
+
+void SyntheticDesktop::draw_window(const Planes& planes, Rect rect) const {
+    int title = std::max(rect.h / 12, 12);
+    fill(planes, { rect.x - 2, rect.y - 2, rect.w + 4, rect.h + 4 }, 40, 128, 128);
+    fill(planes, rect, 235, 128, 128);
+    fill(planes, { rect.x, rect.y, rect.w, title }, 90, 170, 110);
+    // A few content bars inside the window body
+    for (int i = 0; i < 6; i++) {
+        int bar_y = rect.y + title + 8 + i * (rect.h - title) / 7;
+        fill(planes, { rect.x + 12, bar_y, rect.w * (40 + 9 * i) / 100, 8 }, 150, 128, 128);
+    }
+}
+
+void SyntheticDesktop::draw_video(const Planes& planes, Rect rect, int frame_index) const {
+    int x0 = std::max(rect.x, 0) & ~1;
+    int y0 = std::max(rect.y, 0) & ~1;
+    int x1 = std::min(rect.x + rect.w, width) & ~1;
+    int y1 = std::min(rect.y + rect.h, height) & ~1;
+    float t = frame_index * 0.05f;
+
+    // Moving plasma plus grain: every pixel changes, and not predictably
+    for (int py = y0; py < y1; py++) {
+        uint8_t* row = planes.y + (size_t)py * planes.y_stride;
+        for (int px = x0; px < x1; px++) {
+            float value = 128.0f + 50.0f * sinf(px * 0.02f + t) + 40.0f * sinf(py * 0.03f - t * 1.3f);
+            int grain = (int)(hash32((uint32_t)px * 73856093u ^ (uint32_t)py * 19349663u ^ (uint32_t)frame_index) & 15) - 8;
+            row[px] = (uint8_t)std::min(std::max((int)value + grain, 16), 235);
+        }
+    }
+    for (int py = y0 / 2; py < y1 / 2; py++) {
+        uint8_t* u_row = planes.u + (size_t)py * planes.u_stride;
+        uint8_t* v_row = planes.v + (size_t)py * planes.v_stride;
+        for (int px = x0 / 2; px < x1 / 2; px++) {
+            u_row[px] = (uint8_t)(128.0f + 40.0f * sinf(px * 0.05f + t * 0.7f));
+            v_row[px] = (uint8_t)(128.0f + 40.0f * cosf(py * 0.04f - t * 0.9f));
+        }
+    }
+}
+
+void SyntheticDesktop::render(int frame_index, const Planes& planes) const {
+    draw_desktop(planes);
+
+    bool mixed = scene == SCENE_MIXED;
+    if (scene == SCENE_TEXT || mixed) {
+        Rect terminal = mixed ? Rect{ width / 20, height / 12, width * 9 / 20, height * 3 / 4 }
+                              : Rect{ width / 10, height / 10, width * 8 / 10, height * 8 / 10 };
+        draw_terminal(planes, terminal, frame_index);
+    }
+    if (scene == SCENE_VIDEO || mixed) {
+        Rect video = mixed ? Rect{ width * 11 / 20, height / 12, width * 2 / 5, height * 2 / 5 }
+                           : Rect{ width / 8, height / 8, width * 3 / 4, height * 3 / 4 };
+        draw_video(planes, video, frame_index);
+    }
+    if (scene == SCENE_DRAG || mixed) {
+        // Lissajous path, so the drag changes direction like a hand would
+        int w = width * 3 / 10;
+        int h = height * 3 / 10;
+        float t = frame_index * 0.02f;
+        int x = (int)((width - w) * (0.5f + 0.45f * sinf(t * 1.7f)));
+        int y = (int)((height - h) * (0.5f + 0.40f * sinf(t * 1.1f + 0.6f)));
+        draw_window(planes, { x, y, w, h });
+    }
+}
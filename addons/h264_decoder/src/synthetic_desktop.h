@@ -0,0 +1,63 @@
+/*
+ * Synthetic Desktop
+ * Deterministic desktop-like test content for the reference streamer and QualityMeter
+ *
+ * Renders YUV 4:2:0 pictures with the kinds of change the real server
+ * sends: a terminal scrolling text, a window being dragged across a static
+ * background, and a video region that changes every pixel every frame.
+ * The same frame index always gives the same picture, so a client can
+ * rebuild the streamer's source frame to score what it decoded.
+ */
+
+#ifndef SYNTHETIC_DESKTOP_H
+#define SYNTHETIC_DESKTOP_H
+
+#include <cstdint>
+
+namespace godot {
+
+class SyntheticDesktop {
+public:
+    enum Scene {
+        SCENE_TEXT,  // scrolling terminal
+        SCENE_DRAG,  // window moving over the desktop
+        SCENE_VIDEO, // full-motion region
+        SCENE_MIXED, // all of the above at once
+    };
+
+    struct Planes {
+        uint8_t* y;
+        uint8_t* u;
+        uint8_t* v;
+        int y_stride;
+        int u_stride;
+        int v_stride;
+    };
+
+private:
+    int width;
+    int height;
+    Scene scene;
+
+    struct Rect {
+        int x, y, w, h;
+    };
+
+    void fill(const Planes& planes, Rect rect, uint8_t y, uint8_t u, uint8_t v) const;
+    void draw_desktop(const Planes& planes) const;
+    void draw_terminal(const Planes& planes, Rect rect, int frame_index) const;
+    void draw_window(const Planes& planes, Rect rect) const;
+    void draw_video(const Planes& planes, Rect rect, int frame_index) const;
+
+public:
+    SyntheticDesktop(int width, int height, Scene scene);
+
+    // Scene from its command-line name; false if unknown
+    static bool parse_scene(const char* name, Scene& out);
+
+    void render(int frame_index, const Planes& planes) const;
+};
+
+} // namespace godot
+
+#endif // SYNTHETIC_DESKTOP_H
@@ -0,0 +1,315 @@
+/*
+ * Thread Policy Implementation
+ */
+
+#include "thread_policy.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__) || defined(__ANDROID__)
+#include <dirent.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define THREAD_POLICY_LINUX
+#endif
+
+using namespace godot;
+
+// Low enough that audio and kernel RT threads still win
+static const int REALTIME_PRIORITY = 2;
+static const int HIGH_NICE = -10;
+
+#ifdef THREAD_POLICY_LINUX
+static long read_sysfs_long(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        return -1;
+    }
+    long value = -1;
+    if (fscanf(f, "%ld", &value) != 1) {
+        value = -1;
+    }
+    fclose(f);
+    return value;
+}
+
+// Numeric entries of a directory (cpuN under sysfs)
+static std::vector<int64_t> list_numbered(const char* dir_path, const char* prefix) {
+    std::vector<int64_t> ids;
+    DIR* dir = opendir(dir_path);
+    if (!dir) {
+        return ids;
+    }
+    size_t prefix_len = strlen(prefix);
+    while (dirent* entry = readdir(dir)) {
+        const char* name = entry->d_name;
+        if (strncmp(name, prefix, prefix_len) != 0) {
+            continue;
+        }
+        char* end = nullptr;
+        long long id = strtoll(name + prefix_len, &end, 10);
+        if (end != name + prefix_len && *end == '\0') {
+            ids.push_back(id);
+        }
+    }
+    closedir(dir);
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+static std::vector<int> detect_fast_cores() {
+    std::vector<std::pair<int, long>> capacities;
+    const char* sources[] = { "cpu_capacity", "cpufreq/cpuinfo_max_freq" };
+    for (const char* source : sources) {
+        capacities.clear();
+        for (int64_t cpu : list_numbered("/sys/devices/system/cpu", "cpu")) {
+            char path[128];
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/%s", (int)cpu, source);
+            long value = read_sysfs_long(path);
+            if (value > 0) {
+                capacities.emplace_back((int)cpu, value);
+            }
+        }
+        if (!capacities.empty()) {
+            break;
+        }
+    }
+
+    std::vector<int> fast;
+    if (capacities.empty()) {
+        return fast;
+    }
+    long lowest = capacities[0].second;
+    for (const auto& c : capacities) {
+        lowest = std::min(lowest, c.second);
+    }
+    for (const auto& c : capacities) {
+        if (c.second > lowest) {
+            fast.push_back(c.first);
+        }
+    }
+    return fast;
+}
+#endif
+
+const std::vector<int>& godot::thread_policy_fast_cores() {
+#ifdef THREAD_POLICY_LINUX
+    static const std::vector<int> cores = detect_fast_cores();
+#else
+    static const std::vector<int> cores;
+#endif
+    return cores;
+}
+
+int64_t godot::thread_policy_current_thread() {
+#if defined(_WIN32)
+    return (int64_t)GetCurrentThreadId();
+#elif defined(THREAD_POLICY_LINUX)
+    return (int64_t)syscall(SYS_gettid);
+#else
+    return 0;
+#endif
+}
+
+
+ThreadPolicyResult godot::thread_policy_apply(const ThreadPolicy& policy, int64_t thread_id) {
+    ThreadPolicyResult result;
+
+#if defined(_WIN32)
+    // No handle-by-id access to foreign threads without OpenThread rights
+    // we don't want to ask for; only the caller is placed
+    if (thread_id != 0 && thread_id != (int64_t)GetCurrentThreadId()) {
+        return result;
+    }
+    HANDLE thread = GetCurrentThread();
+
+    DWORD_PTR mask = 0;
+    for (int cpu : policy.cpus) {
+        if (cpu >= 0 && cpu < (int)(sizeof(DWORD_PTR) * 8)) {
+            mask |= (DWORD_PTR)1 << cpu;
+        }
+    }
+    if (!mask) {
+        DWORD_PTR system_mask = 0;
+        DWORD_PTR process_mask = 0;
+        GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask);
+        mask = process_mask;
+    }
+    result.affinity_applied = SetThreadAffinityMask(thread, mask) != 0 && !policy.cpus.empty();
+
+    if (policy.priority == ThreadPolicy::PRIORITY_REALTIME && SetThreadPriority(thread, THREAD_PRIORITY_TIME_CRITICAL)) {
+        result.priority_applied = ThreadPolicy::PRIORITY_REALTIME;
+    } else if (policy.priority != ThreadPolicy::PRIORITY_NORMAL && SetThreadPriority(thread, THREAD_PRIORITY_HIGHEST)) {
+        result.priority_applied = ThreadPolicy::PRIORITY_HIGH;
+    } else {
+        SetThreadPriority(thread, THREAD_PRIORITY_NORMAL);
+    }
+#elif defined(THREAD_POLICY_LINUX)
+    pid_t tid = thread_id != 0 ? (pid_t)thread_id : (pid_t)syscall(SYS_gettid);
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : policy.cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    if (CPU_COUNT(&set) == 0) {
+        // Back to every configured CPU
+        long count = sysconf(_SC_NPROCESSORS_CONF);
+        for (long cpu = 0; cpu < count && cpu < CPU_SETSIZE; cpu++) {
+            CPU_SET((int)cpu, &set);
+        }
+    }
+    result.affinity_applied = sched_setaffinity(tid, sizeof(set), &set) == 0 && !policy.cpus.empty();
+
+    // Each step falls back to the next when the kernel says no (EPERM
+    // without CAP_SYS_NICE / RLIMIT_RTPRIO, or a seccomp'd sandbox)
+    sched_param param = {};
+    if (policy.priority == ThreadPolicy::PRIORITY_REALTIME) {
+        param.sched_priority = REALTIME_PRIORITY;
+        if (sched_setscheduler(tid, SCHED_FIFO, &param) == 0) {
+            result.priority_applied = ThreadPolicy::PRIORITY_REALTIME;
+            return result;
+        }
+        param.sched_priority = 0;
+    }
+    sched_setscheduler(tid, SCHED_OTHER, &param);
+    if (policy.priority != ThreadPolicy::PRIORITY_NORMAL && setpriority(PRIO_PROCESS, (id_t)tid, HIGH_NICE) == 0) {
+        result.priority_applied = ThreadPolicy::PRIORITY_HIGH;
+    } else {
+        setpriority(PRIO_PROCESS, (id_t)tid, 0);
+    }
+#else
+    (void)policy;
+    (void)thread_id;
+#endif
+
+    return result;
+}
+
+// Contexts are looked up by pointer: ctx->opaque already belongs to the
+// frame buffer tracker
+static std::mutex tracker_registry_mutex;
+static std::unordered_map<const AVCodecContext*, CodecThreadTracker*>& tracker_registry() {
+    static std::unordered_map<const AVCodecContext*, CodecThreadTracker*> registry;
+    return registry;
+}
+
+CodecThreadTracker::~CodecThreadTracker() {
+    detach();
+}
+
+CodecThreadTracker* CodecThreadTracker::find(const AVCodecContext* ctx) {
+    std::lock_guard<std::mutex> lock(tracker_registry_mutex);
+    auto it = tracker_registry().find(ctx);
+    return it != tracker_registry().end() ? it->second : nullptr;
+}
+
+void CodecThreadTracker::attach(AVCodecContext* new_ctx) {
+    detach();
+    {
+        std::lock_guard<std::mutex> lock(tracker_registry_mutex);
+        tracker_registry()[new_ctx] = this;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    ctx = new_ctx;
+    thread_ids.clear();
+    original_execute = new_ctx->execute;
+    original_execute2 = new_ctx->execute2;
+    // Both are user-overridable for decoding; libavcodec calls through them
+    new_ctx->execute = &CodecThreadTracker::execute;
+    new_ctx->execute2 = &CodecThreadTracker::execute2;
+}
+
+void CodecThreadTracker::detach() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!ctx) {
+        return;
+    }
+    ctx->execute = original_execute;
+    ctx->execute2 = original_execute2;
+    {
+        std::lock_guard<std::mutex> registry_lock(tracker_registry_mutex);
+        tracker_registry().erase(ctx);
+    }
+    ctx = nullptr;
+}
+
+std::vector<int64_t> CodecThreadTracker::get_thread_ids() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return thread_ids;
+}
+
+void CodecThreadTracker::set_policy(const ThreadPolicy& new_policy, bool enabled) {
+    std::lock_guard<std::mutex> lock(mutex);
+    policy = new_policy;
+    place_threads = enabled;
+}
+
+void CodecThreadTracker::on_job_thread() {
+    int64_t id = thread_policy_current_thread();
+    ThreadPolicy to_apply;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (id == 0 || id == caller_id ||
+            std::find(thread_ids.begin(), thread_ids.end(), id) != thread_ids.end()) {
+            return;
+        }
+        thread_ids.push_back(id);
+        if (!place_threads) {
+            return;
+        }
+        to_apply = policy;
+    }
+    // From inside the thread, which also works on Windows
+    thread_policy_apply(to_apply, 0);
+}
+
+int CodecThreadTracker::run_job(AVCodecContext* ctx, void* arg) {
+    CodecThreadTracker* tracker = find(ctx);
+    tracker->on_job_thread();
+    return tracker->job(ctx, arg);
+}
+
+int CodecThreadTracker::run_job2(AVCodecContext* ctx, void* arg, int job, int thread) {
+    CodecThreadTracker* tracker = find(ctx);
+    tracker->on_job_thread();
+    return tracker->job2(ctx, arg, job, thread);
+}
+
+int CodecThreadTracker::execute(AVCodecContext* ctx, JobFunc func, void* arg, int* ret, int count, int size) {
+    CodecThreadTracker* tracker = find(ctx);
+    tracker->job = func;
+    {
+        std::lock_guard<std::mutex> lock(tracker->mutex);
+        tracker->caller_id = thread_policy_current_thread();
+    }
+    return tracker->original_execute(ctx, &CodecThreadTracker::run_job, arg, ret, count, size);
+}
+
+int CodecThreadTracker::execute2(AVCodecContext* ctx, JobFunc2 func, void* arg, int* ret, int count) {
+    CodecThreadTracker* tracker = find(ctx);
+    tracker->job2 = func;
+    {
+        std::lock_guard<std::mutex> lock(tracker->mutex);
+        tracker->caller_id = thread_policy_current_thread();
+    }
+    return tracker->original_execute2(ctx, &CodecThreadTracker::run_job2, arg, ret, count);
+}
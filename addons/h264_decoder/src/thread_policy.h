@@ -0,0 +1,102 @@
+/*
+ * Thread Policy
+ * CPU affinity and scheduling priority for decode-path threads
+ *
+ * libavcodec has no thread creation hook, so CodecThreadTracker wraps the
+ * context's execute/execute2 callbacks: the first job each slice thread
+ * runs records its id and places the thread from inside. Only threads that
+ * actually run the codec's jobs are touched, never whatever else happened
+ * to start while the codec was opening. Other threads are placed by id on
+ * Linux/Android; on Windows only the calling thread can be placed.
+ * Elsewhere everything is a no-op.
+ */
+
+#ifndef THREAD_POLICY_H
+#define THREAD_POLICY_H
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+struct AVCodecContext;
+
+namespace godot {
+
+struct ThreadPolicy {
+    enum Priority {
+        PRIORITY_NORMAL,
+        PRIORITY_HIGH,     // nice -10 / THREAD_PRIORITY_HIGHEST
+        PRIORITY_REALTIME, // SCHED_FIFO / THREAD_PRIORITY_TIME_CRITICAL
+    };
+
+    std::vector<int> cpus; // empty = any CPU
+    Priority priority = PRIORITY_NORMAL;
+};
+
+struct ThreadPolicyResult {
+    bool affinity_applied = false;
+    // What the OS accepted; REALTIME falls back to HIGH, HIGH to NORMAL
+    // when the process lacks the rights (CAP_SYS_NICE, RLIMIT_RTPRIO)
+    ThreadPolicy::Priority priority_applied = ThreadPolicy::PRIORITY_NORMAL;
+};
+
+// CPUs above the lowest cpu_capacity (cpufreq max as a fallback), i.e. the
+// big and prime clusters. Empty on symmetric systems or without sysfs.
+const std::vector<int>& thread_policy_fast_cores();
+
+// Kernel id of the calling thread (0 where unsupported)
+int64_t thread_policy_current_thread();
+
+// Apply to a thread by kernel id; 0 means the calling thread
+ThreadPolicyResult thread_policy_apply(const ThreadPolicy& policy, int64_t thread_id);
+
+// Learns a codec context's slice threads as they run jobs. The thread that
+// calls into libavcodec (which runs jobs too) is never recorded or placed.
+class CodecThreadTracker {
+public:
+    typedef int (*JobFunc)(AVCodecContext* ctx, void* arg);
+    typedef int (*JobFunc2)(AVCodecContext* ctx, void* arg, int job, int thread);
+    typedef int (*ExecuteFunc)(AVCodecContext* ctx, JobFunc func, void* arg, int* ret, int count, int size);
+    typedef int (*Execute2Func)(AVCodecContext* ctx, JobFunc2 func, void* arg, int* ret, int count);
+
+private:
+    mutable std::mutex mutex;
+    AVCodecContext* ctx = nullptr;
+    ExecuteFunc original_execute = nullptr;
+    Execute2Func original_execute2 = nullptr;
+    // The job of the execute call in flight (calls are serialized per context)
+    JobFunc job = nullptr;
+    JobFunc2 job2 = nullptr;
+    int64_t caller_id = 0;
+
+    std::vector<int64_t> thread_ids;
+    ThreadPolicy policy;
+    bool place_threads = false;
+
+    static CodecThreadTracker* find(const AVCodecContext* ctx);
+    void on_job_thread();
+    static int execute(AVCodecContext* ctx, JobFunc func, void* arg, int* ret, int count, int size);
+    static int execute2(AVCodecContext* ctx, JobFunc2 func, void* arg, int* ret, int count);
+    static int run_job(AVCodecContext* ctx, void* arg);
+    static int run_job2(AVCodecContext* ctx, void* arg, int job, int thread);
+
+public:
+    CodecThreadTracker() = default;
+    ~CodecThreadTracker();
+
+    CodecThreadTracker(const CodecThreadTracker&) = delete;
+    CodecThreadTracker& operator=(const CodecThreadTracker&) = delete;
+
+    // Hook an opened context (after avcodec_open2); forgets earlier threads
+    void attach(AVCodecContext* ctx);
+    // Unhook; call before the context is freed
+    void detach();
+
+    std::vector<int64_t> get_thread_ids() const;
+    // Policy applied by each newly seen thread to itself; disabled = leave them alone
+    void set_policy(const ThreadPolicy& policy, bool enabled);
+};
+
+} // namespace godot
+
+#endif // THREAD_POLICY_H
@@ -0,0 +1,246 @@
+/*
+ * Tile Cache Implementation
+ */
+
+#include "tile_cache.h"
+#include "frame_repack.h"
+
+#include <algorithm>
+#include <cstring>
+
+extern "C" {
+#include <libavutil/mem.h>
+#include <libavutil/murmur3.h>
+}
+
+using namespace godot;
+
+static const int TILE_CHROMA = TileCache::TILE_SIZE / 2;
+static const size_t TILE_LUMA_BYTES = TileCache::TILE_SIZE * TileCache::TILE_SIZE;
+static const size_t TILE_CHROMA_BYTES = TILE_CHROMA * TILE_CHROMA;
+
+TileCache::TileCache() {
+    hasher = av_murmur3_alloc();
+}
+
+TileCache::~TileCache() {
+    av_free(hasher);
+}
+
+void TileCache::unlink(int slot) {
+    Slot& s = slots[slot];
+    if (s.prev >= 0) {
+        slots[s.prev].next = s.next;
+    } else {
+        lru_head = s.next;
+    }
+    if (s.next >= 0) {
+        slots[s.next].prev = s.prev;
+    } else {
+        lru_tail = s.prev;
+    }
+    s.prev = -1;
+    s.next = -1;
+}
+
+void TileCache::push_front(int slot) {
+    Slot& s = slots[slot];
+    s.prev = -1;
+    s.next = lru_head;
+    if (lru_head >= 0) {
+        slots[lru_head].prev = slot;
+    }
+    lru_head = slot;
+    if (lru_tail < 0) {
+        lru_tail = slot;
+    }
+}
+
+void TileCache::evict_lru() {
+    int slot = lru_tail;
+    if (slot < 0) {
+        return;
+    }
+    unlink(slot);
+    index.erase(slots[slot].id);
+    evicted_ids.push_back(slots[slot].id);
+    slots[slot].used = false;
+    free_slots.push_back(slot);
+    evictions++;
+}
+
+int TileCache::allocate_slot() {
+    if (free_slots.empty()) {
+        evict_lru();
+    }
+    if (free_slots.empty()) {
+        return -1;
+    }
+    int slot = free_slots.back();
+    free_slots.pop_back();
+    return slot;
+}
+
+void TileCache::set_budget(size_t bytes) {
+    size_t new_count = bytes / TILE_BYTES;
+    budget_bytes = bytes;
+    if (new_count == slots.size()) {
+        return;
+    }
+
+    // Keep the most recently used tiles that still fit, in LRU order
+    std::vector<int> keep;
+    std::vector<bool> kept(slots.size(), false);
+    for (int slot = lru_head; slot >= 0 && keep.size() < new_count; slot = slots[slot].next) {
+        keep.push_back(slot);
+        kept[slot] = true;
+    }
+    for (int slot = lru_head; slot >= 0; slot = slots[slot].next) {
+        if (!kept[slot]) {
+            evicted_ids.push_back(slots[slot].id);
+            evictions++;
+        }
+    }
+
+    std::vector<uint8_t> new_arena(new_count * TILE_BYTES);
+    std::vector<Slot> new_slots(new_count);
+    index.clear();
+    for (size_t i = 0; i < keep.size(); i++) {
+        memcpy(new_arena.data() + i * TILE_BYTES, slot_data(keep[i]), TILE_BYTES);
+        new_slots[i].id = slots[keep[i]].id;
+        new_slots[i].used = true;
+        new_slots[i].prev = (int)i - 1;
+        new_slots[i].next = i + 1 < keep.size() ? (int)i + 1 : -1;
+        index[new_slots[i].id] = (int)i;
+    }
+
+    arena.swap(new_arena);
+    slots.swap(new_slots);
+    lru_head = keep.empty() ? -1 : 0;
+    lru_tail = keep.empty() ? -1 : (int)keep.size() - 1;
+
+    free_slots.clear();
+    for (size_t i = new_count; i > keep.size(); i--) {
+        free_slots.push_back((int)i - 1);
+    }
+}
+
+uint64_t TileCache::insert_from_planes(const uint8_t* y_plane, const uint8_t* uv_plane, int width, int height, int x, int y) {
+    if (!is_enabled() || x < 0 || y < 0 || x + TILE_SIZE > width || y + TILE_SIZE > height) {
+        return 0;
+    }
+    x &= ~1;
+    y &= ~1;
+
+    // Gather into a staging tile first so duplicates never cost an eviction
+    uint8_t staging[TILE_BYTES];
+    int uv_width = width / 2;
+    repack_copy_block(staging, TILE_SIZE, y_plane + (size_t)y * width + x, width, TILE_SIZE, TILE_SIZE);
+    const uint8_t* uv_src = uv_plane + (size_t)(y / 2) * width + x / 2;
+    repack_copy_block(staging + TILE_LUMA_BYTES, TILE_CHROMA, uv_src, width, TILE_CHROMA, TILE_CHROMA);
+    repack_copy_block(staging + TILE_LUMA_BYTES + TILE_CHROMA_BYTES, TILE_CHROMA, uv_src + uv_width, width,
+                      TILE_CHROMA, TILE_CHROMA);
+
+    uint8_t digest[16];
+    av_murmur3_init(hasher);
+    av_murmur3_update(hasher, staging, TILE_BYTES);
+    av_murmur3_final(hasher, digest);
+    uint64_t id;
+    memcpy(&id, digest, sizeof(id));
+    if (id == 0) {
+        id = 1; // 0 means "not stored"
+    }
+
+    auto it = index.find(id);
+    if (it != index.end()) {
+        unlink(it->second);
+        push_front(it->second);
+        return id;
+    }
+
+    int slot = allocate_slot();
+    if (slot < 0) {
+        return 0;
+    }
+    memcpy(slot_data(slot), staging, TILE_BYTES);
+    slots[slot].id = id;
+    slots[slot].used = true;
+    index[id] = slot;
+    push_front(slot);
+
+    inserts++;
+    added_ids.push_back(id);
+    return id;
+}
+
+int TileCache::insert_region(const uint8_t* y_plane, const uint8_t* uv_plane, int width, int height,
+                             int rx, int ry, int rw, int rh) {
+    int stored = 0;
+    int x0 = (std::max(rx, 0) + TILE_SIZE - 1) / TILE_SIZE * TILE_SIZE;
+    int y0 = (std::max(ry, 0) + TILE_SIZE - 1) / TILE_SIZE * TILE_SIZE;
+    for (int y = y0; y + TILE_SIZE <= std::min(ry + rh, height); y += TILE_SIZE) {
+        for (int x = x0; x + TILE_SIZE <= std::min(rx + rw, width); x += TILE_SIZE) {
+            if (insert_from_planes(y_plane, uv_plane, width, height, x, y) != 0) {
+                stored++;
+            }
+        }
+    }
+    return stored;
+}
+
+bool TileCache::blit_to_planes(uint64_t id, uint8_t* y_plane, uint8_t* uv_plane, int width, int height, int x, int y) {
+    auto it = index.find(id);
+    if (it == index.end()) {
+        misses++;
+        missed_ids.push_back(id);
+        return false;
+    }
+    hits++;
+    int slot = it->second;
+    unlink(slot);
+    push_front(slot);
+
+    x &= ~1;
+    y &= ~1;
+    int sx = std::max(-x, 0);
+    int sy = std::max(-y, 0);
+    int w = std::min(TILE_SIZE - sx, (width & ~1) - (x + sx));
+    int h = std::min(TILE_SIZE - sy, (height & ~1) - (y + sy));
+    if (w <= 0 || h <= 0) {
+        return true;
+    }
+
+    const uint8_t* src = slot_data(slot);
+    repack_copy_block(y_plane + (size_t)(y + sy) * width + x + sx, width,
+                      src + (size_t)sy * TILE_SIZE + sx, TILE_SIZE, w, h);
+
+    int uv_width = width / 2;
+    uint8_t* uv_dst = uv_plane + (size_t)((y + sy) / 2) * width + (x + sx) / 2;
+    const uint8_t* u_src = src + TILE_LUMA_BYTES + (size_t)(sy / 2) * TILE_CHROMA + sx / 2;
+    repack_copy_block(uv_dst, width, u_src, TILE_CHROMA, w / 2, h / 2);
+    repack_copy_block(uv_dst + uv_width, width, u_src + TILE_CHROMA_BYTES, TILE_CHROMA, w / 2, h / 2);
+    return true;
+}
+
+void TileCache::take_events(std::vector<uint64_t>& added, std::vector<uint64_t>& evicted, std::vector<uint64_t>& missed) {
+    added.swap(added_ids);
+    evicted.swap(evicted_ids);
+    missed.swap(missed_ids);
+    added_ids.clear();
+    evicted_ids.clear();
+    missed_ids.clear();
+}
+
+void TileCache::clear() {
+    for (int slot = lru_head; slot >= 0; slot = slots[slot].next) {
+        evicted_ids.push_back(slots[slot].id);
+    }
+    index.clear();
+    free_slots.clear();
+    for (size_t i = slots.size(); i > 0; i--) {
+        slots[i - 1] = Slot();
+        free_slots.push_back((int)i - 1);
+    }
+    lru_head = -1;
+    lru_tail = -1;
+}
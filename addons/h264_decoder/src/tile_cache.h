@@ -0,0 +1,111 @@
+/*
+ * Tile Cache
+ * Content-addressed LRU cache of decoded YUV tiles
+ *
+ * Tiles are TILE_SIZE x TILE_SIZE luma plus the matching U and V blocks,
+ * stored contiguously in a fixed arena sized from the memory budget. A
+ * tile's id is the murmur3 hash (libavutil) of its bytes, so identical
+ * content is stored once. The server references cached tiles by id instead
+ * of re-encoding them; ids added, evicted and missed are queued for the
+ * feedback channel so the server can mirror the cache.
+ *
+ * Planes use the decoder's output layout: Y rows, then U|V rows where each
+ * chroma row holds U in its left half and V in its right half.
+ */
+
+#ifndef TILE_CACHE_H
+#define TILE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+struct AVMurMur3;
+
+namespace godot {
+
+class TileCache {
+public:
+    static const int TILE_SIZE = 64;
+    static const size_t TILE_BYTES = TILE_SIZE * TILE_SIZE + 2 * (TILE_SIZE / 2) * (TILE_SIZE / 2);
+
+private:
+    struct Slot {
+        uint64_t id = 0;
+        int prev = -1; // towards most recently used
+        int next = -1; // towards least recently used
+        bool used = false;
+    };
+
+    std::vector<uint8_t> arena;
+    std::vector<Slot> slots;
+    std::vector<int> free_slots;
+    std::unordered_map<uint64_t, int> index;
+    int lru_head = -1; // most recently used
+    int lru_tail = -1; // least recently used
+    size_t budget_bytes = 0;
+
+    AVMurMur3* hasher = nullptr;
+
+    // Events for the feedback channel
+    std::vector<uint64_t> added_ids;
+    std::vector<uint64_t> evicted_ids;
+    std::vector<uint64_t> missed_ids;
+
+    // Stats
+    int64_t hits = 0;
+    int64_t misses = 0;
+    int64_t inserts = 0;
+    int64_t evictions = 0;
+
+    void unlink(int slot);
+    void push_front(int slot);
+    int allocate_slot();
+    void evict_lru();
+    uint8_t* slot_data(int slot) { return arena.data() + (size_t)slot * TILE_BYTES; }
+
+public:
+    TileCache();
+    ~TileCache();
+
+    TileCache(const TileCache&) = delete;
+    TileCache& operator=(const TileCache&) = delete;
+
+    // Resize the arena. Shrinking evicts least recently used tiles; 0 disables the cache.
+    void set_budget(size_t bytes);
+    size_t get_budget() const { return budget_bytes; }
+    bool is_enabled() const { return !slots.empty(); }
+
+    // Cache the tile whose top-left luma pixel is (x, y). Partial tiles at
+    // the frame edge are not cached. Returns the id, or 0 if nothing was stored.
+    uint64_t insert_from_planes(const uint8_t* y_plane, const uint8_t* uv_plane, int width, int height, int x, int y);
+
+    // Cache every whole tile on the TILE_SIZE grid inside a region
+    int insert_region(const uint8_t* y_plane, const uint8_t* uv_plane, int width, int height,
+                      int rx, int ry, int rw, int rh);
+
+    // Write a cached tile to (x, y) in the planes, clipped to the frame.
+    // Returns false on a miss (recorded for the feedback channel).
+    bool blit_to_planes(uint64_t id, uint8_t* y_plane, uint8_t* uv_plane, int width, int height, int x, int y);
+
+    bool contains(uint64_t id) const { return index.count(id) != 0; }
+
+    // Feedback events since the last call (ids are moved out)
+    void take_events(std::vector<uint64_t>& added, std::vector<uint64_t>& evicted, std::vector<uint64_t>& missed);
+
+    int64_t get_hits() const { return hits; }
+    int64_t get_misses() const { return misses; }
+    int64_t get_inserts() const { return inserts; }
+    int64_t get_evictions() const { return evictions; }
+    double get_hit_ratio() const { return hits + misses > 0 ? (double)hits / (double)(hits + misses) : 0.0; }
+    size_t get_entry_count() const { return index.size(); }
+    size_t get_used_bytes() const { return index.size() * TILE_BYTES; }
+    size_t get_memory_usage() const { return arena.capacity() + slots.capacity() * sizeof(Slot); }
+
+    void clear();
+};
+
+} // namespace godot
+
+#endif // TILE_CACHE_H
@@ -0,0 +1,485 @@
+/*
+ * Time-Shift Buffer Implementation
+ */
+
+#include "time_shift_buffer.h"
+
+#include <godot_cpp/variant/utility_functions.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__) || defined(__ANDROID__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace godot;
+
+static int64_t now_usec() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void TimeShiftBuffer::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("push_packet", "packet", "timestamp_usec"), &TimeShiftBuffer::push_packet, DEFVAL(-1));
+    ClassDB::bind_method(D_METHOD("request_frame_at", "timestamp_usec"), &TimeShiftBuffer::request_frame_at);
+    ClassDB::bind_method(D_METHOD("request_frame_ago", "msec"), &TimeShiftBuffer::request_frame_ago);
+    ClassDB::bind_method(D_METHOD("set_max_bytes", "bytes"), &TimeShiftBuffer::set_max_bytes);
+    ClassDB::bind_method(D_METHOD("get_max_bytes"), &TimeShiftBuffer::get_max_bytes);
+    ClassDB::bind_method(D_METHOD("set_max_duration_msec", "msec"), &TimeShiftBuffer::set_max_duration_msec);
+    ClassDB::bind_method(D_METHOD("get_max_duration_msec"), &TimeShiftBuffer::get_max_duration_msec);
+    ClassDB::bind_method(D_METHOD("get_oldest_timestamp_usec"), &TimeShiftBuffer::get_oldest_timestamp_usec);
+    ClassDB::bind_method(D_METHOD("get_newest_timestamp_usec"), &TimeShiftBuffer::get_newest_timestamp_usec);
+    ClassDB::bind_method(D_METHOD("get_buffered_msec"), &TimeShiftBuffer::get_buffered_msec);
+    ClassDB::bind_method(D_METHOD("get_memory_usage"), &TimeShiftBuffer::get_memory_usage);
+    ClassDB::bind_method(D_METHOD("clear"), &TimeShiftBuffer::clear);
+    ClassDB::bind_method(D_METHOD("get_stats"), &TimeShiftBuffer::get_stats);
+    ClassDB::bind_method(D_METHOD("_flush_results"), &TimeShiftBuffer::_flush_results);
+
+    ADD_SIGNAL(MethodInfo("rewind_frame_ready", PropertyInfo(Variant::INT, "request_id"),
+                          PropertyInfo(Variant::INT, "timestamp_usec"), PropertyInfo(Variant::PACKED_BYTE_ARRAY, "frame"),
+                          PropertyInfo(Variant::INT, "width"), PropertyInfo(Variant::INT, "height")));
+    ADD_SIGNAL(MethodInfo("rewind_failed", PropertyInfo(Variant::INT, "request_id")));
+}
+
+TimeShiftBuffer::TimeShiftBuffer() {
+    // Never competes with the live decoder: no hardware session, no watchdog
+    // reopen, one thread so it stays out of the shared pool, and outside
+    // the global memory budget
+    decoder.instantiate();
+    decoder->set_global_accounting(false);
+    decoder->set_software_only(true);
+    decoder->set_watchdog_enabled(false);
+    decoder->set_codec_threads(1);
+    decoder->set_repack_threads(1);
+    worker = std::thread(&TimeShiftBuffer::worker_loop, this);
+}
+
+TimeShiftBuffer::~TimeShiftBuffer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+    MemoryAccounting::add(-accounted_bytes);
+}
+
+bool TimeShiftBuffer::classify(const uint8_t* data, size_t size, int& recovery_frames) {
+    units.clear();
+    parse_nal_units(data, size, units);
+    for (const NalUnit& nal : units) {
+        if (nal.type == NAL_IDR) {
+            recovery_frames = 0;
+            return true;
+        }
+        RecoveryPoint point;
+        if (nal.type == NAL_SEI && parse_recovery_point(nal, point)) {
+            recovery_frames = point.recovery_frame_cnt;
+            return true;
+        }
+    }
+    return false;
+}
+
+void TimeShiftBuffer::push_packet(const PackedByteArray& packet, int64_t timestamp_usec) {
+    push_native_packet(packet.ptr(), (size_t)packet.size(), timestamp_usec);
+}
+
+void TimeShiftBuffer::push_native_packet(const uint8_t* data, size_t size, int64_t timestamp_usec) {
+    if (!data || size == 0) {
+        return;
+    }
+    Packet entry;
+    entry.timestamp_usec = timestamp_usec < 0 ? now_usec() : timestamp_usec;
+    entry.data = std::make_shared<const std::vector<uint8_t>>(data, data + size);
+    entry.sync = classify(data, size, entry.recovery_frames);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    parameter_sets.update(data, size);
+    if (!packets.empty()) {
+        entry.timestamp_usec = std::max(entry.timestamp_usec, packets.back().timestamp_usec);
+    }
+    entry.seq = next_seq++;
+    total_bytes += (int64_t)size;
+    packets.push_back(std::move(entry));
+    evict_locked();
+    update_accounting_locked();
+}
+
+void TimeShiftBuffer::evict_locked() {
+    if (packets.empty()) {
+        return;
+    }
+    int64_t limit = pressure_max_bytes > 0 ? std::min(max_bytes, pressure_max_bytes) : max_bytes;
+    int64_t max_duration_usec = (int64_t)max_duration_msec * 1000;
+    int64_t newest = packets.back().timestamp_usec;
+
+    // The newest sync point and its run stay, whatever the limits say
+    size_t evictable = packets.size();
+    for (size_t i = packets.size(); i-- > 0;) {
+        if (packets[i].sync) {
+            evictable = i;
+            break;
+        }
+    }
+    while (evictable > 0 &&
+           (total_bytes > limit || newest - packets.front().timestamp_usec > max_duration_usec)) {
+        total_bytes -= (int64_t)packets.front().data->size();
+        packets.pop_front();
+        evicted_packets++;
+        evictable--;
+    }
+    // Nothing before the first sync point can be decoded
+    while (!packets.empty() && !packets.front().sync) {
+        total_bytes -= (int64_t)packets.front().data->size();
+        packets.pop_front();
+        evicted_packets++;
+    }
+}
+
+int64_t TimeShiftBuffer::memory_usage_locked() const {
+    // Payload plus the per-packet bookkeeping (vector and control block)
+    return total_bytes + (int64_t)packets.size() * (int64_t)(sizeof(Packet) + sizeof(std::vector<uint8_t>) + 32);
+}
+
+void TimeShiftBuffer::update_accounting_locked() {
+    int64_t usage = memory_usage_locked();
+    MemoryAccounting::add(usage - accounted_bytes);
+    accounted_bytes = usage;
+
+    // Same levels as H264Decoder: shed over the budget, stop below 90%
+    double pressure = MemoryAccounting::get_pressure();
+    int64_t now = now_usec();
+    if (pressure > 1.0 && total_bytes > MIN_BYTES &&
+        now - last_shrink_usec >= (int64_t)SHRINK_INTERVAL_MSEC * 1000) {
+        // One halving per interval: the decoders shed on their next frames,
+        // and the pressure we read now doesn't show that yet
+        last_shrink_usec = now;
+        pressure_max_bytes = std::max((int64_t)MIN_BYTES, total_bytes / 2);
+        pressure_shrinks++;
+        evict_locked();
+        usage = memory_usage_locked();
+        MemoryAccounting::add(usage - accounted_bytes);
+        accounted_bytes = usage;
+    } else if (pressure <= 0.9) {
+        pressure_max_bytes = 0;
+    }
+}
+
+int TimeShiftBuffer::queue_request(int64_t timestamp_usec) {
+    int request_id;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (packets.empty()) {
+            return 0;
+        }
+        if (has_pending) {
+            requests_replaced++;
+        }
+        request_id = next_request_id++;
+        pending.request_id = request_id;
+        pending.timestamp_usec = timestamp_usec;
+        has_pending = true;
+    }
+    requests++;
+    cv.notify_one();
+    return request_id;
+}
+
+int TimeShiftBuffer::request_frame_at(int64_t timestamp_usec) {
+    return queue_request(timestamp_usec);
+}
+
+int TimeShiftBuffer::request_frame_ago(int msec) {
+    int64_t newest = get_newest_timestamp_usec();
+    return queue_request(newest - (int64_t)std::max(msec, 0) * 1000);
+}
+
+void TimeShiftBuffer::set_worker_priority() {
+    // Best effort: a rewind must lose to the live decode and render
+#if defined(_WIN32)
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#elif defined(__linux__) || defined(__ANDROID__)
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 10);
+#endif
+}
+
+void TimeShiftBuffer::worker_loop() {
+    set_worker_priority();
+
+    while (true) {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            auto ready = [this] { return stopping || has_pending; };
+            if (!decoder_open) {
+                cv.wait(lock, ready);
+            } else if (!cv.wait_for(lock, std::chrono::milliseconds((int64_t)DECODER_IDLE_MSEC), ready)) {
+                // Nobody is scrubbing: give back the codec and its frame pool
+                lock.unlock();
+                release_decoder();
+                continue;
+            }
+            if (stopping) {
+                return;
+            }
+            request = pending;
+            has_pending = false;
+        }
+
+        Result result = seek(request);
+        // Superseded mid-seek: the newer request reports instead
+        if (result.request_id != 0) {
+            push_result(std::move(result));
+        }
+    }
+}
+
+TimeShiftBuffer::Result TimeShiftBuffer::seek(const Request& request) {
+    int64_t start = now_usec();
+    Result result;
+    result.request_id = request.request_id;
+
+    // Pick the packets under the lock; the bytes are shared, not copied
+    std::vector<Packet> run;
+    std::vector<uint8_t> sets;
+    bool fresh = true;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (packets.empty()) {
+            requests_failed++;
+            return result;
+        }
+        int64_t count = (int64_t)packets.size();
+        int64_t target = 0;
+        while (target + 1 < count && packets[target + 1].timestamp_usec <= request.timestamp_usec) {
+            target++;
+        }
+
+        // Newest sync point whose picture is clean by the target
+        int64_t from = -1;
+        for (int64_t i = target; i >= 0; i--) {
+            if (packets[i].sync && i + packets[i].recovery_frames <= target) {
+                from = i;
+                break;
+            }
+        }
+        if (from < 0) {
+            // Target is older than the first clean picture: show that instead
+            from = 0;
+            target = std::min(count - 1, (int64_t)packets[0].recovery_frames);
+        }
+        result.timestamp_usec = packets[target].timestamp_usec;
+
+        int64_t first = from;
+        int64_t front_seq = packets.front().seq;
+        if (packets[from].seq == decoded_sync_seq && decoded_seq >= front_seq &&
+            decoded_seq <= packets[target].seq) {
+            // Scrubbing forward within the same run: no need to go back
+            first = decoded_seq - front_seq + 1;
+            fresh = false;
+            continued_seeks++;
+        } else {
+            sets = parameter_sets.build_annex_b();
+            decoded_sync_seq = packets[from].seq;
+        }
+        for (int64_t i = first; i <= target; i++) {
+            run.push_back(packets[i]);
+        }
+    }
+
+    bool have_frame = !fresh && decoder->get_current_frame() != nullptr;
+    if (fresh) {
+        decoder->cleanup();
+        decoded_seq = -1;
+    }
+    decoder_open = true;
+
+    std::vector<uint8_t> input;
+    int64_t fed = 0;
+    for (const Packet& packet : run) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping || has_pending) {
+                // Abandon this one; what was decoded so far stays valid
+                last_packets_decoded = fed;
+                result.request_id = 0;
+                return result;
+            }
+        }
+        const uint8_t* data = packet.data->data();
+        int64_t size = (int64_t)packet.data->size();
+        if (fresh && fed == 0 && !sets.empty()) {
+            // The SPS/PPS may have been sent long before this sync point
+            input.assign(sets.begin(), sets.end());
+            input.insert(input.end(), packet.data->begin(), packet.data->end());
+            data = input.data();
+            size = (int64_t)input.size();
+        }
+        H264Decoder::PacketStatus status = decoder->decode_packet(data, size);
+        if (status == H264Decoder::PACKET_DECODED) {
+            have_frame = true;
+            frames_decoded++;
+        }
+        decoded_seq = packet.seq;
+        fed++;
+    }
+    last_packets_decoded = fed;
+    decoder_bytes = (int64_t)decoder->get_memory_usage()["total"];
+
+    const AVFrame* current = decoder->get_current_frame();
+    int width = current ? current->width : 0;
+    int height = current ? current->height : 0;
+    if (have_frame && width > 0 && height > 0) {
+        int64_t y_size = (int64_t)width * height;
+        result.frame.resize(y_size * 3 / 2);
+        decoder->repack_yuv(result.frame.ptrw(), result.frame.ptrw() + y_size);
+        result.width = width;
+        result.height = height;
+        result.ok = true;
+    } else {
+        // Start from the sync point next time
+        decoded_sync_seq = -1;
+        requests_failed++;
+    }
+    last_seek_usec = now_usec() - start;
+    return result;
+}
+
+void TimeShiftBuffer::release_decoder() {
+    decoder->cleanup();
+    decoder_open = false;
+    decoded_sync_seq = -1;
+    decoded_seq = -1;
+    decoder_bytes = 0;
+    decoder_releases++;
+}
+
+void TimeShiftBuffer::push_result(Result&& result) {
+    bool schedule = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        results.push_back(std::move(result));
+        schedule = !flush_scheduled;
+        flush_scheduled = true;
+    }
+    if (schedule) {
+        call_deferred("_flush_results");
+    }
+}
+
+void TimeShiftBuffer::_flush_results() {
+    std::deque<Result> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.swap(results);
+        flush_scheduled = false;
+    }
+
+    for (Result& result : ready) {
+        if (result.ok) {
+            emit_signal("rewind_frame_ready", result.request_id, result.timestamp_usec, result.frame,
+                        result.width, result.height);
+        } else {
+            emit_signal("rewind_failed", result.request_id);
+        }
+    }
+}
+
+void TimeShiftBuffer::set_max_bytes(int64_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    max_bytes = std::max(bytes, (int64_t)MIN_BYTES);
+    evict_locked();
+    update_accounting_locked();
+}
+
+int64_t TimeShiftBuffer::get_max_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return max_bytes;
+}
+
+void TimeShiftBuffer::set_max_duration_msec(int msec) {
+    std::lock_guard<std::mutex> lock(mutex);
+    max_duration_msec = std::max(msec, 1000);
+    evict_locked();
+    update_accounting_locked();
+}
+
+int TimeShiftBuffer::get_max_duration_msec() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return max_duration_msec;
+}
+
+int64_t TimeShiftBuffer::get_oldest_timestamp_usec() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return packets.empty() ? 0 : packets.front().timestamp_usec;
+}
+
+int64_t TimeShiftBuffer::get_newest_timestamp_usec() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return packets.empty() ? 0 : packets.back().timestamp_usec;
+}
+
+int TimeShiftBuffer::get_buffered_msec() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (packets.empty()) {
+        return 0;
+    }
+    return (int)((packets.back().timestamp_usec - packets.front().timestamp_usec) / 1000);
+}
+
+int64_t TimeShiftBuffer::get_memory_usage() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return memory_usage_locked();
+}
+
+void TimeShiftBuffer::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    // Sequence numbers keep counting, so the worker never continues into
+    // packets that replaced the ones it decoded
+    packets.clear();
+    total_bytes = 0;
+    parameter_sets.clear();
+    update_accounting_locked();
+}
+
+Dictionary TimeShiftBuffer::get_stats() const {
+    Dictionary stats;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        int64_t sync_points = 0;
+        for (const Packet& packet : packets) {
+            sync_points += packet.sync ? 1 : 0;
+        }
+        stats["packets"] = (int64_t)packets.size();
+        stats["bytes"] = total_bytes;
+        stats["pressure_max_bytes"] = pressure_max_bytes;
+        stats["sync_points"] = sync_points;
+        stats["buffered_msec"] = packets.empty()
+            ? (int64_t)0 : (packets.back().timestamp_usec - packets.front().timestamp_usec) / 1000;
+    }
+    stats["memory_usage"] = get_memory_usage();
+    stats["evicted_packets"] = evicted_packets.load();
+    stats["requests"] = requests.load();
+    stats["requests_replaced"] = requests_replaced.load();
+    stats["requests_failed"] = requests_failed.load();
+    stats["frames_decoded"] = frames_decoded.load();
+    stats["continued_seeks"] = continued_seeks.load();
+    stats["seek_usec"] = last_seek_usec.load();
+    stats["packets_decoded"] = last_packets_decoded.load();
+    stats["decoder_bytes"] = decoder_bytes.load();
+    stats["decoder_releases"] = decoder_releases.load();
+    stats["pressure_shrinks"] = pressure_shrinks.load();
+    return stats;
+}
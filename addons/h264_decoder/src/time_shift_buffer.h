@@ -0,0 +1,185 @@
+/*
+ * Time-Shift Buffer
+ * The last few seconds of compressed stream, kept for instant rewind
+ *
+ * push_packet() stores each access unit as it arrives (a reference-counted
+ * copy of the compressed bytes, no decoding) and indexes the ones a decoder
+ * can start from: IDR pictures and recovery point SEIs. The ring is bounded
+ * by both a byte cap and a duration cap; eviction always leaves a sync
+ * point at the front, so everything still buffered stays decodable.
+ *
+ * request_frame_at() / request_frame_ago() hand the seek to a low-priority
+ * worker that owns its own software-only H264Decoder: it decodes from the
+ * nearest sync point before the target up to the requested packet and
+ * emits rewind_frame_ready with the packed YUV (same layout as
+ * H264Decoder::decode_frame). The live decoder is never touched, and a
+ * scrub that keeps moving forward continues from where the last seek
+ * stopped instead of going back to the sync point.
+ *
+ * Requests are latest-wins: a new one replaces a pending request and
+ * aborts the one in progress between packets. Replaced requests report
+ * nothing; only the newest gets a signal.
+ *
+ * Memory: the packet store is reported to MemoryAccounting like decoder
+ * memory, and while the global budget is exceeded the ring is halved
+ * (down to MIN_BYTES) at most once per SHRINK_INTERVAL_MSEC, giving the
+ * decoders' own shedding time to show, until pressure drops below the
+ * HIGH level again. Eviction never drops the newest sync point or the
+ * packets after it, so there is always something to rewind to. The rewind decoder stays out of the global budget, so a seek
+ * never makes the live decoders shed memory, and it is closed again once
+ * no request has come in for DECODER_IDLE_MSEC.
+ */
+
+#ifndef TIME_SHIFT_BUFFER_H
+#define TIME_SHIFT_BUFFER_H
+
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "h264_decoder.h"
+#include "memory_accounting.h"
+#include "nal_parser.h"
+
+namespace godot {
+
+class TimeShiftBuffer : public RefCounted {
+    GDCLASS(TimeShiftBuffer, RefCounted)
+
+public:
+    static const int64_t MIN_BYTES = 1024 * 1024;
+    static const int DECODER_IDLE_MSEC = 5000;
+    static const int SHRINK_INTERVAL_MSEC = 1000;
+
+private:
+    typedef std::shared_ptr<const std::vector<uint8_t>> PacketData;
+
+    struct Packet {
+        int64_t seq = 0;             // monotonic, survives eviction
+        int64_t timestamp_usec = 0;
+        PacketData data;
+        bool sync = false;           // IDR or recovery point
+        int recovery_frames = 0;     // packets until the picture is clean
+    };
+
+    struct Request {
+        int request_id = 0;
+        int64_t timestamp_usec = 0;
+    };
+
+    struct Result {
+        int request_id = 0;
+        int64_t timestamp_usec = 0;
+        PackedByteArray frame;
+        int width = 0;
+        int height = 0;
+        bool ok = false;
+    };
+
+    std::thread worker;
+    mutable std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping = false;
+
+    // Guarded by mutex
+    std::deque<Packet> packets;
+    int64_t total_bytes = 0;
+    int64_t next_seq = 0;
+    int64_t max_bytes = 64 * 1024 * 1024;
+    int64_t pressure_max_bytes = 0;  // ring cap while over the global budget, 0 = none
+    int64_t last_shrink_usec = 0;
+    int64_t accounted_bytes = 0;     // our share of MemoryAccounting's total
+    int max_duration_msec = 30000;
+    ParameterSetCache parameter_sets;
+    Request pending;
+    bool has_pending = false;
+    int next_request_id = 1;
+    std::deque<Result> results;
+    bool flush_scheduled = false;
+
+    // Pushing thread only
+    std::vector<NalUnit> units;
+
+    // Worker-only
+    Ref<H264Decoder> decoder;
+    int64_t decoded_sync_seq = -1;   // sync point the decoder started from
+    int64_t decoded_seq = -1;        // last packet it was fed
+    bool decoder_open = false;       // released after DECODER_IDLE_MSEC without requests
+
+    // Stats
+    std::atomic<int64_t> evicted_packets{0};
+    std::atomic<int64_t> requests{0};
+    std::atomic<int64_t> requests_replaced{0};
+    std::atomic<int64_t> requests_failed{0};
+    std::atomic<int64_t> frames_decoded{0};
+    std::atomic<int64_t> continued_seeks{0};
+    std::atomic<int64_t> last_seek_usec{0};
+    std::atomic<int64_t> last_packets_decoded{0};
+    std::atomic<int64_t> decoder_bytes{0};
+    std::atomic<int64_t> decoder_releases{0};
+    std::atomic<int64_t> pressure_shrinks{0};
+
+    bool classify(const uint8_t* data, size_t size, int& recovery_frames);
+    void evict_locked();
+    int64_t memory_usage_locked() const;
+    // Publish the store's size, then shrink or relax the ring for the
+    // global pressure
+    void update_accounting_locked();
+    int queue_request(int64_t timestamp_usec);
+
+    void worker_loop();
+    void set_worker_priority();
+    Result seek(const Request& request);
+    void release_decoder();
+    void push_result(Result&& result);
+    // Runs deferred on the main thread; emits the queued results
+    void _flush_results();
+
+protected:
+    static void _bind_methods();
+
+public:
+    TimeShiftBuffer();
+    ~TimeShiftBuffer();
+
+    // Store one access unit. timestamp_usec < 0 stamps it with the arrival
+    // time (steady clock); otherwise timestamps must not go backwards.
+    void push_packet(const PackedByteArray& packet, int64_t timestamp_usec = -1);
+    // Native callers
+    void push_native_packet(const uint8_t* data, size_t size, int64_t timestamp_usec = -1);
+
+    // Decode the picture shown at timestamp_usec (the newest packet at or
+    // before it). Returns the request id reported by rewind_frame_ready or
+    // rewind_failed, or 0 if nothing is buffered.
+    int request_frame_at(int64_t timestamp_usec);
+    // Same, relative to the newest buffered packet
+    int request_frame_ago(int msec);
+
+    // Caps; whichever is hit first evicts from the oldest end
+    void set_max_bytes(int64_t bytes);
+    int64_t get_max_bytes() const;
+    void set_max_duration_msec(int msec);
+    int get_max_duration_msec() const;
+
+    int64_t get_oldest_timestamp_usec() const;
+    int64_t get_newest_timestamp_usec() const;
+    int get_buffered_msec() const;
+    int64_t get_memory_usage() const;
+
+    void clear();
+
+    Dictionary get_stats() const;
+};
+
+} // namespace godot
+
+#endif // TIME_SHIFT_BUFFER_H
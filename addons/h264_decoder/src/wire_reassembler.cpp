@@ -0,0 +1,96 @@
+/*
+ * Wire Reassembler Implementation
+ */
+
+#include "wire_reassembler.h"
+
+#include <cstring>
+
+using namespace godot;
+
+void WireReassembler::begin(Slot& slot, const WireHeader& header) {
+    slot.started = true;
+    slot.collecting = true;
+    slot.frame_id = header.frame_id;
+    slot.timestamp_usec = header.timestamp_usec;
+    slot.flags = header.flags;
+    slot.count = header.fragment_count;
+    slot.received = 0;
+    slot.size = 0;
+    slot.buffer.resize((size_t)header.fragment_count * WIRE_MAX_PAYLOAD);
+    slot.have.assign(header.fragment_count, 0);
+}
+
+bool WireReassembler::push(const uint8_t* data, size_t size, Message& out) {
+    WireHeader header;
+    if (!wire_read_header(data, size, header) || header.type == 0 || header.type >= SLOT_COUNT ||
+        header.fragment_count > MAX_FRAGMENTS) {
+        malformed++;
+        return false;
+    }
+    const uint8_t* payload = data + WIRE_HEADER_SIZE;
+    size_t payload_size = size - WIRE_HEADER_SIZE;
+    // Every fragment but the last is full, which fixes its offset
+    bool last = header.fragment_index + 1 == header.fragment_count;
+    if (payload_size > WIRE_MAX_PAYLOAD || (!last && payload_size != WIRE_MAX_PAYLOAD)) {
+        malformed++;
+        return false;
+    }
+
+    Slot& slot = slots[header.type];
+    if (!slot.started) {
+        begin(slot, header);
+    } else {
+        int32_t ahead = (int32_t)(header.frame_id - slot.frame_id);
+        if (ahead < -RESTART_GAP || ahead > RESTART_GAP) {
+            // The sender restarted; only the message in flight is lost
+            lost += slot.collecting ? 1 : 0;
+            restarts++;
+            begin(slot, header);
+        } else if (ahead < 0 || (ahead == 0 && !slot.collecting)) {
+            late++;
+            return false;
+        } else if (ahead > 0) {
+            // The message in flight (if any) and every id skipped are gone
+            lost += (slot.collecting ? 1 : 0) + (ahead - 1);
+            begin(slot, header);
+        } else if (header.fragment_count != slot.count) {
+            malformed++;
+            return false;
+        }
+    }
+
+    if (slot.have[header.fragment_index]) {
+        return false; // duplicate
+    }
+    memcpy(slot.buffer.data() + (size_t)header.fragment_index * WIRE_MAX_PAYLOAD, payload, payload_size);
+    slot.have[header.fragment_index] = 1;
+    slot.received++;
+    if (last) {
+        slot.size = (size_t)header.fragment_index * WIRE_MAX_PAYLOAD + payload_size;
+    }
+    if (slot.received < slot.count) {
+        return false;
+    }
+
+    slot.collecting = false;
+    completed++;
+    out.type = header.type;
+    out.frame_id = slot.frame_id;
+    out.timestamp_usec = slot.timestamp_usec;
+    out.flags = slot.flags;
+    out.data = slot.buffer.data();
+    out.size = slot.size;
+    return true;
+}
+
+void WireReassembler::reset() {
+    for (Slot& slot : slots) {
+        slot = Slot();
+    }
+    completed = 0;
+    lost = 0;
+    late = 0;
+    malformed = 0;
+    restarts = 0;
+}
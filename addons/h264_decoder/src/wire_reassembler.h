@@ -0,0 +1,81 @@
+/*
+ * Wire Reassembler
+ * Rebuilds stream_wire.h messages from their datagrams
+ *
+ * The sender sends each message's fragments back to back, so one message
+ * per type is collected at a time. A datagram with a newer frame_id drops
+ * the incomplete message before it. Dropped messages and frame_id gaps
+ * count as lost, which gives callers a per-stream loss figure. Datagrams
+ * of older messages arrive too late to matter and are ignored. A frame_id
+ * more than RESTART_GAP away in either direction is a restarted sender with
+ * a new count, not reordering or loss, so the slot starts over on its ids.
+ */
+
+#ifndef WIRE_REASSEMBLER_H
+#define WIRE_REASSEMBLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "stream_wire.h"
+
+namespace godot {
+
+class WireReassembler {
+public:
+    struct Message {
+        uint8_t type = 0;
+        uint32_t frame_id = 0;
+        uint64_t timestamp_usec = 0;
+        uint8_t flags = 0;
+        const uint8_t* data = nullptr; // valid until the next push
+        size_t size = 0;
+    };
+
+    // Bounds the buffer a forged fragment_count can make us allocate
+    // (about 9.8 MB, well above a 4K IDR)
+    static const int MAX_FRAGMENTS = 8192;
+    // A frame_id jump this large is a sender restart (about 17 s at 60 fps)
+    static const int RESTART_GAP = 1024;
+
+private:
+    static const int SLOT_COUNT = WIRE_REGION + 1; // indexed by WireType
+
+    struct Slot {
+        bool started = false;   // frame_id is meaningful
+        bool collecting = false; // frame_id is still missing fragments
+        uint32_t frame_id = 0;
+        uint64_t timestamp_usec = 0;
+        uint8_t flags = 0;
+        uint16_t count = 0;
+        uint16_t received = 0;
+        size_t size = 0; // known once the last fragment is in
+        std::vector<uint8_t> buffer;
+        std::vector<uint8_t> have;
+    };
+    Slot slots[SLOT_COUNT];
+
+    int64_t completed = 0;
+    int64_t lost = 0;
+    int64_t late = 0;
+    int64_t malformed = 0;
+    int64_t restarts = 0;
+
+    void begin(Slot& slot, const WireHeader& header);
+
+public:
+    // Feed one datagram; true when it completed a message
+    bool push(const uint8_t* data, size_t size, Message& out);
+    void reset();
+
+    int64_t get_completed() const { return completed; }
+    int64_t get_lost() const { return lost; }
+    int64_t get_late() const { return late; }
+    int64_t get_malformed() const { return malformed; }
+    int64_t get_restarts() const { return restarts; }
+};
+
+} // namespace godot
+
+#endif // WIRE_REASSEMBLER_H
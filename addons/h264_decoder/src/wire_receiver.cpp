@@ -0,0 +1,60 @@
+/*
+ * Wire Receiver Implementation
+ */
+
+#include "wire_receiver.h"
+
+#include <cstring>
+
+using namespace godot;
+
+void WireReceiver::_bind_methods() {
+    ClassDB::bind_method(D_METHOD("push_datagram", "datagram"), &WireReceiver::push_datagram);
+    ClassDB::bind_method(D_METHOD("reset"), &WireReceiver::reset);
+    ClassDB::bind_method(D_METHOD("get_stats"), &WireReceiver::get_stats);
+
+    BIND_ENUM_CONSTANT(TYPE_VIDEO);
+    BIND_ENUM_CONSTANT(TYPE_AUDIO);
+    BIND_ENUM_CONSTANT(TYPE_CURSOR);
+    BIND_ENUM_CONSTANT(TYPE_REGION);
+}
+
+WireReceiver::WireReceiver() {
+}
+
+WireReceiver::~WireReceiver() {
+}
+
+Dictionary WireReceiver::push_datagram(const PackedByteArray& datagram) {
+    Dictionary result;
+    WireReassembler::Message message;
+    if (!reassembler.push(datagram.ptr(), (size_t)datagram.size(), message)) {
+        return result;
+    }
+
+    PackedByteArray payload;
+    payload.resize((int64_t)message.size);
+    if (message.size > 0) {
+        memcpy(payload.ptrw(), message.data, message.size);
+    }
+    result["type"] = (int)message.type;
+    result["frame_id"] = (int64_t)message.frame_id;
+    result["timestamp_usec"] = (int64_t)message.timestamp_usec;
+    result["keyframe"] = (message.flags & WIRE_FLAG_KEYFRAME) != 0;
+    result["payload"] = payload;
+    return result;
+}
+
+void WireReceiver::reset() {
+    reassembler.reset();
+}
+
+Dictionary WireReceiver::get_stats() const {
+    Dictionary stats;
+    stats["completed"] = reassembler.get_completed();
+    stats["lost"] = reassembler.get_lost();
+    stats["late"] = reassembler.get_late();
+    stats["malformed"] = reassembler.get_malformed();
+    stats["restarts"] = reassembler.get_restarts();
+    return stats;
+}
@@ -0,0 +1,66 @@
+/*
+ * Wire Receiver
+ * Client side of the stream_wire.h framing for script
+ *
+ * Feed every datagram from a PacketPeerUDP to push_datagram(); once a
+ * message is complete it comes back as a Dictionary:
+ *
+ *   type            MessageType (TYPE_VIDEO, TYPE_AUDIO, ...)
+ *   frame_id        per-type counter from the sender
+ *   timestamp_usec  capture time, Unix epoch microseconds
+ *   keyframe        WIRE_FLAG_KEYFRAME was set
+ *   payload         PackedByteArray for the matching consumer (stream_wire.h)
+ *
+ * and an empty Dictionary otherwise. Losses are counted the same way as
+ * SimulcastDecoder's per-layer reassembly (wire_reassembler.h).
+ */
+
+#ifndef WIRE_RECEIVER_H
+#define WIRE_RECEIVER_H
+
+#include <godot_cpp/classes/ref_counted.hpp>
+#include <godot_cpp/core/class_db.hpp>
+#include <godot_cpp/variant/dictionary.hpp>
+#include <godot_cpp/variant/packed_byte_array.hpp>
+
+#include "stream_wire.h"
+#include "wire_reassembler.h"
+
+namespace godot {
+
+class WireReceiver : public RefCounted {
+    GDCLASS(WireReceiver, RefCounted)
+
+public:
+    enum MessageType {
+        TYPE_VIDEO = WIRE_VIDEO,
+        TYPE_AUDIO = WIRE_AUDIO,
+        TYPE_CURSOR = WIRE_CURSOR,
+        TYPE_REGION = WIRE_REGION,
+    };
+
+private:
+    WireReassembler reassembler;
+
+protected:
+    static void _bind_methods();
+
+public:
+    WireReceiver();
+    ~WireReceiver();
+
+    // Empty until the datagram completes a message
+    Dictionary push_datagram(const PackedByteArray& datagram);
+
+    // Drop partially received messages, e.g. after the sender restarted
+    void reset();
+
+    // completed, lost, late and malformed counts from the reassembler
+    Dictionary get_stats() const;
+};
+
+} // namespace godot
+
+VARIANT_ENUM_CAST(WireReceiver::MessageType);
+
+#endif // WIRE_RECEIVER_H
@@ -0,0 +1,167 @@
+/*
+ * Worker Pool Implementation
+ */
+
+#include "worker_pool.h"
+#include "thread_policy.h"
+
+#include <atomic>
+#include <memory>
+
+using namespace godot;
+
+// More threads than this only adds wake-up latency for the band sizes we use
+static const int MAX_POOL_THREADS = 7;
+
+WorkerPool::WorkerPool(int thread_count) {
+    if (thread_count <= 0) {
+        int hw = (int)std::thread::hardware_concurrency();
+        thread_count = hw > 1 ? hw - 1 : 0;
+    }
+    if (thread_count > MAX_POOL_THREADS) {
+        thread_count = MAX_POOL_THREADS;
+    }
+
+    thread_ids.resize(thread_count, 0);
+    for (int i = 0; i < thread_count; i++) {
+        threads.emplace_back(&WorkerPool::worker_loop, this, i);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    for (std::thread& t : threads) {
+        t.join();
+    }
+}
+
+WorkerPool& WorkerPool::get_shared() {
+    static WorkerPool pool;
+    return pool;
+}
+
+std::vector<int64_t> WorkerPool::get_thread_ids() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return thread_ids;
+}
+
+int WorkerPool::set_thread_policy(const ThreadPolicy& new_policy) {
+    std::vector<int64_t> ids;
+    ThreadPolicy applied = new_policy;
+    if (applied.priority == ThreadPolicy::PRIORITY_REALTIME) {
+        applied.priority = ThreadPolicy::PRIORITY_HIGH;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        policy = applied;
+        has_policy = true;
+        ids = thread_ids;
+    }
+
+    int placed = 0;
+    for (int64_t id : ids) {
+        if (id == 0) {
+            continue;
+        }
+        ThreadPolicyResult result = thread_policy_apply(applied, id);
+        placed += result.affinity_applied || result.priority_applied != ThreadPolicy::PRIORITY_NORMAL;
+    }
+    return placed;
+}
+
+void WorkerPool::worker_loop(int index) {
+    ThreadPolicy start_policy;
+    bool place = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        thread_ids[index] = thread_policy_current_thread();
+        start_policy = policy;
+        place = has_policy;
+    }
+    if (place) {
+        thread_policy_apply(start_policy, 0);
+    }
+
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void WorkerPool::submit(std::function<void()> task) {
+    if (threads.empty()) {
+        task();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    cv.notify_one();
+}
+
+void WorkerPool::parallel_for(int count, const std::function<void(int)>& fn) {
+    if (count <= 0) {
+        return;
+    }
+    if (count == 1 || threads.empty()) {
+        for (int i = 0; i < count; i++) {
+            fn(i);
+        }
+        return;
+    }
+
+    // Every participant pulls indices until none are left. Helpers that start
+    // late simply find nothing to do, so we never wait on a queued task.
+    struct Job {
+        std::atomic<int> next{0};
+        std::atomic<int> done{0};
+        std::mutex mutex;
+        std::condition_variable cv;
+    };
+    std::shared_ptr<Job> job = std::make_shared<Job>();
+
+    auto run = [job, count, &fn]() {
+        for (;;) {
+            int i = job->next.fetch_add(1);
+            if (i >= count) {
+                return;
+            }
+            fn(i);
+            if (job->done.fetch_add(1) + 1 == count) {
+                std::lock_guard<std::mutex> lock(job->mutex);
+                job->cv.notify_all();
+            }
+        }
+    };
+
+    int helpers = count - 1;
+    if (helpers > (int)threads.size()) {
+        helpers = (int)threads.size();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int i = 0; i < helpers; i++) {
+            tasks.push_back(run);
+        }
+    }
+    cv.notify_all();
+
+    run();
+
+    std::unique_lock<std::mutex> lock(job->mutex);
+    job->cv.wait(lock, [&job, count] { return job->done.load() == count; });
+}
@@ -0,0 +1,68 @@
+/*
+ * Worker Pool
+ * Small fixed-size thread pool shared by all decoder instances
+ *
+ * Used to split per-frame CPU work (plane repacking etc.) into row bands
+ * once libavcodec has handed us a decoded picture.
+ */
+
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include "thread_policy.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace godot {
+
+class WorkerPool {
+private:
+    std::vector<std::thread> threads;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping = false;
+    std::vector<int64_t> thread_ids; // kernel ids, filled in as workers start
+    ThreadPolicy policy;             // applied by each worker to itself as it starts
+    bool has_policy = false;
+
+    void worker_loop(int index);
+
+public:
+    // thread_count = 0 picks hardware_concurrency - 1 (capped)
+    explicit WorkerPool(int thread_count = 0);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Process-wide pool, created on first use
+    static WorkerPool& get_shared();
+
+    int get_thread_count() const { return (int)threads.size(); }
+    // For placing workers with thread_policy_apply; 0 for workers not yet running
+    std::vector<int64_t> get_thread_ids();
+
+    // Placement of every worker, process-wide. Pool tasks are unbounded
+    // (extrapolation, compression, every decoder's bands), so REALTIME is
+    // lowered to HIGH: a SCHED_FIFO worker could starve the render thread.
+    // Returns the number of running workers placed.
+    int set_thread_policy(const ThreadPolicy& policy);
+
+    // Runs fn(0..count-1) on the pool and the calling thread, returns when all are done.
+    // The caller participates, so this is safe to call from inside a pool task.
+    void parallel_for(int count, const std::function<void(int)>& fn);
+
+    // Queue a fire-and-forget task
+    void submit(std::function<void()> task);
+};
+
+} // namespace godot
+
+#endif // WORKER_POOL_H
@@ -0,0 +1,145 @@
+/*
+ * Atlas Packer Tests
+ * Shelf placement, span merging on remove and defragmenting repacks
+ */
+
+#include "test_common.h"
+#include "atlas_packer.h"
+
+#include <vector>
+
+using namespace godot;
+
+static bool overlaps(const AtlasRect& a, const AtlasRect& b) {
+    return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
+}
+
+// Every listed id is placed inside the atlas and no two rects touch
+static bool layout_valid(const AtlasPacker& packer, const std::vector<int>& ids) {
+    std::vector<AtlasRect> rects;
+    for (int id : ids) {
+        AtlasRect rect;
+        if (!packer.get_rect(id, rect)) {
+            return false;
+        }
+        if (rect.x < 0 || rect.y < 0 || rect.x + rect.w > packer.get_width() ||
+            rect.y + rect.h > packer.get_height()) {
+            return false;
+        }
+        for (const AtlasRect& other : rects) {
+            if (overlaps(rect, other)) {
+                return false;
+            }
+        }
+        rects.push_back(rect);
+    }
+    return true;
+}
+
+static void test_insert() {
+    AtlasPacker packer;
+    packer.reset(256, 256);
+    AtlasRect rect;
+
+    // 100x60 takes a 104x64 cell; the second one shares the shelf
+    CHECK(packer.insert(1, 100, 60, rect));
+    CHECK(rect.x == 0 && rect.y == 0 && rect.w == 100 && rect.h == 60);
+    CHECK(packer.insert(2, 100, 60, rect));
+    CHECK(rect.x == 104 && rect.y == 0);
+
+    // Too tall for the first shelf: opens a new one below it
+    CHECK(packer.insert(3, 50, 100, rect));
+    CHECK(rect.x == 0 && rect.y == 64);
+
+    // Short enough for the first shelf, which still has a 48 wide span
+    CHECK(packer.insert(4, 30, 30, rect));
+    CHECK(rect.x == 208 && rect.y == 0);
+
+    // No room left for a new shelf this tall
+    CHECK(!packer.insert(5, 200, 100, rect));
+    CHECK(!packer.get_rect(5, rect));
+    CHECK(!packer.insert(6, 0, 10, rect));
+    CHECK(packer.get_count() == 4);
+    CHECK(layout_valid(packer, { 1, 2, 3, 4 }));
+
+    // Re-inserting an id moves it instead of allocating twice
+    CHECK(packer.insert(4, 50, 90, rect));
+    CHECK(rect.x == 56 && rect.y == 64);
+    CHECK(packer.get_count() == 4);
+    CHECK(layout_valid(packer, { 1, 2, 3, 4 }));
+}
+
+static void test_remove_merges_spans() {
+    AtlasPacker packer;
+    packer.reset(256, 128);
+    AtlasRect rect;
+
+    for (int id = 0; id < 3; id++) {
+        CHECK(packer.insert(id, 60, 60, rect));
+        CHECK(rect.x == id * 64 && rect.y == 0);
+    }
+
+    // Two adjacent 64 wide holes merge into one span that fits a 124 cell
+    packer.remove(0);
+    packer.remove(1);
+    CHECK(packer.get_count() == 1);
+    CHECK(packer.insert(3, 120, 60, rect));
+    CHECK(rect.x == 0 && rect.y == 0);
+
+    // Freeing the whole top shelf gives its height back to new shelves
+    packer.remove(3);
+    packer.remove(2);
+    packer.remove(2);
+    CHECK(packer.get_count() == 0);
+    CHECK(packer.get_occupancy() == 0.0);
+    CHECK(packer.insert(4, 252, 124, rect));
+    CHECK(rect.x == 0 && rect.y == 0);
+}
+
+static void test_repack() {
+    AtlasPacker packer;
+    packer.reset(128, 64);
+    AtlasRect rect;
+
+    // Two full shelves of 32x32 cells, then every other one freed
+    for (int id = 0; id < 8; id++) {
+        CHECK(packer.insert(id, 28, 28, rect));
+    }
+    packer.remove(0);
+    packer.remove(2);
+    packer.remove(5);
+    packer.remove(7);
+
+    // Half the atlas is free, but no hole is 64 wide
+    CHECK(!packer.insert(8, 60, 28, rect));
+    CHECK(packer.get_count() == 4);
+
+    std::vector<AtlasPacker::Entry> entries = {
+        { 1, 28, 28 }, { 3, 28, 28 }, { 4, 28, 28 }, { 6, 28, 28 }, { 8, 60, 28 },
+    };
+    CHECK(packer.repack(entries));
+    CHECK(packer.get_count() == 5);
+    CHECK(layout_valid(packer, { 1, 3, 4, 6, 8 }));
+    CHECK(packer.get_occupancy() == 0.75);
+
+    // Tallest first, so the tall entry opens the first shelf
+    packer.reset(128, 128);
+    CHECK(packer.repack({ { 1, 28, 28 }, { 2, 28, 60 } }));
+    CHECK(packer.get_rect(2, rect));
+    CHECK(rect.x == 0 && rect.y == 0);
+    CHECK(packer.get_rect(1, rect));
+    CHECK(rect.x == 32 && rect.y == 0);
+
+    // Entries that don't all fit report failure but keep what was placed
+    packer.reset(64, 64);
+    CHECK(!packer.repack({ { 1, 60, 60 }, { 2, 28, 28 } }));
+    CHECK(packer.get_rect(1, rect));
+    CHECK(!packer.get_rect(2, rect));
+}
+
+int main() {
+    test_insert();
+    test_remove_merges_spans();
+    test_repack();
+    return TEST_RESULT();
+}
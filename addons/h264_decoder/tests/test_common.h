@@ -0,0 +1,25 @@
+/*
+ * Native Test Helpers
+ * Plain executables run by ctest; no Godot runtime involved
+ */
+
+#ifndef TEST_COMMON_H
+#define TEST_COMMON_H
+
+#include <cstdio>
+
+static int test_failures = 0;
+
+#define CHECK(condition)                                                  \
+    do {                                                                  \
+        if (!(condition)) {                                               \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__,  \
+                         __LINE__, #condition);                           \
+            test_failures++;                                              \
+        }                                                                 \
+    } while (0)
+
+// Exit code for main()
+#define TEST_RESULT() (test_failures == 0 ? 0 : 1)
+
+#endif // TEST_COMMON_H
@@ -0,0 +1,88 @@
+/*
+ * Quality Metrics Tests
+ * PSNR/SSIM kernels on identical planes and on a known offset
+ */
+
+#include "test_common.h"
+#include "quality_metrics.h"
+
+#include <cmath>
+#include <vector>
+
+using namespace godot;
+
+// Odd sizes so the SIMD loops leave scalar tails
+static const int WIDTH = 101;
+static const int HEIGHT = 67;
+
+static std::vector<uint8_t> make_plane(int stride) {
+    std::vector<uint8_t> plane((size_t)stride * HEIGHT);
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < WIDTH; x++) {
+            // Textured, and kept below 255 so an offset of 1 never clips
+            plane[(size_t)y * stride + x] = (uint8_t)((x * 7 + y * 13 + (x * y) % 23) % 250);
+        }
+    }
+    return plane;
+}
+
+static bool near(double a, double b, double tolerance) {
+    return std::fabs(a - b) <= tolerance;
+}
+
+static void test_identical_planes() {
+    std::vector<uint8_t> a = make_plane(WIDTH);
+    // Different stride, same pixels
+    std::vector<uint8_t> b((size_t)(WIDTH + 27) * HEIGHT, 0xEE);
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < WIDTH; x++) {
+            b[(size_t)y * (WIDTH + 27) + x] = a[(size_t)y * WIDTH + x];
+        }
+    }
+    std::vector<int> scratch;
+
+    uint64_t sse = quality_plane_sse(a.data(), WIDTH, b.data(), WIDTH + 27, WIDTH, HEIGHT);
+    CHECK(sse == 0);
+    CHECK(quality_psnr(sse, (uint64_t)WIDTH * HEIGHT) == QUALITY_PSNR_MAX);
+    CHECK(quality_plane_ssim(a.data(), WIDTH, b.data(), WIDTH + 27, WIDTH, HEIGHT, scratch) == 1.0);
+}
+
+static void test_fixed_offset() {
+    std::vector<uint8_t> a = make_plane(WIDTH);
+    std::vector<uint8_t> b = a;
+    for (uint8_t& v : b) {
+        v += 1;
+    }
+    std::vector<int> scratch;
+
+    // Every sample off by one: MSE 1, PSNR = 20 * log10(255)
+    uint64_t sse = quality_plane_sse(a.data(), WIDTH, b.data(), WIDTH, WIDTH, HEIGHT);
+    CHECK(sse == (uint64_t)WIDTH * HEIGHT);
+    CHECK(near(quality_psnr(sse, (uint64_t)WIDTH * HEIGHT), 48.1308, 1e-3));
+
+    // Off by 3 everywhere: MSE 9
+    for (uint8_t& v : b) {
+        v += 2;
+    }
+    sse = quality_plane_sse(a.data(), WIDTH, b.data(), WIDTH, WIDTH, HEIGHT);
+    CHECK(sse == (uint64_t)WIDTH * HEIGHT * 9);
+    CHECK(near(quality_psnr(sse, (uint64_t)WIDTH * HEIGHT), 38.5884, 1e-3));
+
+    // Flat planes 100 and 110: only the luminance term is left,
+    // (2 * 100 * 110 + C1) / (100^2 + 110^2 + C1) with C1 = (0.01 * 255)^2
+    std::vector<uint8_t> flat_a((size_t)WIDTH * HEIGHT, 100);
+    std::vector<uint8_t> flat_b((size_t)WIDTH * HEIGHT, 110);
+    double c1 = 0.01 * 255 * 0.01 * 255;
+    double expected = (2.0 * 100 * 110 + c1) / (100.0 * 100 + 110.0 * 110 + c1);
+    CHECK(near(quality_plane_ssim(flat_a.data(), WIDTH, flat_b.data(), WIDTH, WIDTH, HEIGHT, scratch), expected, 1e-4));
+
+    // Texture plus offset stays close to, but below, 1
+    double ssim = quality_plane_ssim(a.data(), WIDTH, b.data(), WIDTH, WIDTH, HEIGHT, scratch);
+    CHECK(ssim < 1.0 && ssim > 0.99);
+}
+
+int main() {
+    test_identical_planes();
+    test_fixed_offset();
+    return TEST_RESULT();
+}
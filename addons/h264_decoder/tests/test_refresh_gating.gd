@@ -0,0 +1,91 @@
+extends Node
+## Refresh gating scene test
+##
+## A clean picture and a damaged one decoded in the same decode_batch call
+## must hand back the clean picture: the batch output comes from
+## get_current_frame(), not from the newest (gated) frame.
+##
+##   godot --headless --path . res://addons/h264_decoder/tests/test_refresh_gating.tscn -- \
+##       --stream=/path/to/desktop.h264
+##
+## Without --stream, the first .h264 file in tests/streams/ is used; with
+## none the test exits with SKIP_EXIT_CODE. The damaged packet is the next
+## P picture cut in half, which libavcodec conceals and flags.
+
+const AnnexB := preload("res://addons/h264_decoder/tools/annex_b.gd")
+const STREAMS_DIR := "res://addons/h264_decoder/tests/streams"
+const SKIP_EXIT_CODE := 77
+
+var _failures := 0
+
+
+func _ready() -> void:
+	var options := AnnexB.parse_options()
+	var stream_path: String = options.get("stream", AnnexB.find_default_stream(STREAMS_DIR))
+	var data := FileAccess.get_file_as_bytes(stream_path) if not stream_path.is_empty() else PackedByteArray()
+	var units := AnnexB.split_access_units(data)
+	if units.is_empty():
+		print("[RefreshGatingTest] No stream, skipped: pass --stream=FILE.h264 or put one in ", STREAMS_DIR)
+		get_tree().quit(SKIP_EXIT_CODE)
+		return
+
+	# Reference run: the last clean picture before a P picture
+	var reference := _new_decoder()
+	var clean_index := -1
+	var expected := PackedByteArray()
+	for i in units.size() - 1:
+		var picture := reference.decode_frame(units[i])
+		var clean: bool = reference.get_stats()["refresh_state"] == H264Decoder.REFRESH_CLEAN
+		if not picture.is_empty() and clean and _is_p_picture(units[i + 1]):
+			clean_index = i
+			expected = picture
+			break
+	reference.cleanup()
+	_check(clean_index >= 0, "stream has a clean picture followed by a P picture")
+	if clean_index < 0:
+		get_tree().quit(1)
+		return
+
+	# Same prefix, then the clean picture and a damaged one in a single batch
+	var decoder := _new_decoder()
+	for i in clean_index:
+		decoder.decode_frame(units[i])
+	var damaged := units[clean_index + 1].slice(0, units[clean_index + 1].size() / 2)
+	var result := decoder.decode_batch([units[clean_index], damaged])
+	var status: PackedInt32Array = result["status"]
+	var stats := decoder.get_stats()
+
+	_check(status[0] == H264Decoder.PACKET_DECODED, "clean picture decoded")
+	_check(status[1] != H264Decoder.PACKET_DECODED, "damaged picture held back")
+	_check(stats["refresh_state"] != H264Decoder.REFRESH_CLEAN, "damage detected")
+	_check(result["frame"] == expected, "batch output is the clean picture")
+	decoder.cleanup()
+
+	if _failures == 0:
+		print("[RefreshGatingTest] Passed")
+	get_tree().quit(0 if _failures == 0 else 1)
+
+
+func _new_decoder() -> H264Decoder:
+	var decoder := H264Decoder.new()
+	decoder.set_output_format(H264Decoder.OUTPUT_YUV)
+	decoder.set_refresh_gating(true)
+	return decoder
+
+
+# Non-IDR slice data (type 1) and no IDR slice in the unit
+func _is_p_picture(unit: PackedByteArray) -> bool:
+	var has_slice := false
+	for header in AnnexB.find_nal_starts(unit):
+		var nal_type := unit[header] & 0x1F
+		if nal_type == 5:
+			return false
+		if nal_type == 1:
+			has_slice = true
+	return has_slice
+
+
+func _check(condition: bool, what: String) -> void:
+	if not condition:
+		printerr("[RefreshGatingTest] CHECK failed: ", what)
+		_failures += 1
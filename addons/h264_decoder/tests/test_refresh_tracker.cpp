@@ -0,0 +1,109 @@
+/*
+ * Refresh Tracker Tests
+ * State progression on a recovery point stream, damage and IDR restarts
+ */
+
+#include "test_common.h"
+#include "refresh_tracker.h"
+
+#include <vector>
+
+using namespace godot;
+
+typedef std::vector<uint8_t> Packet;
+
+static const uint8_t START_CODE[] = { 0, 0, 0, 1 };
+
+static void append_nal(Packet& packet, std::initializer_list<uint8_t> nal) {
+    packet.insert(packet.end(), START_CODE, START_CODE + sizeof(START_CODE));
+    packet.insert(packet.end(), nal);
+}
+
+// First slice of a picture: first_mb_in_slice ue(v) 0 is a single 1 bit
+static Packet slice(bool idr = false) {
+    Packet packet;
+    append_nal(packet, { (uint8_t)(idr ? 0x65 : 0x41), 0x88, 0x84 });
+    return packet;
+}
+
+// recovery_point SEI with recovery_frame_cnt 3 (ue 00100), exact_match 1,
+// broken_link 0, in front of the picture it applies to
+static Packet recovery_point_slice() {
+    Packet packet;
+    append_nal(packet, { 0x06, 0x06, 0x01, 0x24, 0x80 });
+    Packet picture = slice();
+    packet.insert(packet.end(), picture.begin(), picture.end());
+    return packet;
+}
+
+static void push(RefreshTracker& tracker, const Packet& packet, int64_t now_usec) {
+    tracker.on_packet(packet.data(), packet.size(), now_usec);
+}
+
+static void test_recovery_point_stream() {
+    RefreshTracker tracker;
+    int64_t time_to_clean = 0;
+
+    // Joined mid-stream: pictures before the recovery point can't be shown
+    push(tracker, slice(), 1000);
+    push(tracker, slice(), 2000);
+    CHECK(tracker.get_state() == RefreshTracker::STATE_WAITING);
+    CHECK(tracker.get_progress() == 0.0f);
+
+    push(tracker, recovery_point_slice(), 3000);
+    CHECK(tracker.get_state() == RefreshTracker::STATE_REFRESHING);
+    CHECK(tracker.get_recovery_points() == 1);
+    CHECK(tracker.get_progress() == 0.25f);
+
+    push(tracker, slice(), 4000);
+    push(tracker, slice(), 5000);
+    CHECK(tracker.is_refreshing());
+    CHECK(tracker.get_progress() == 0.75f);
+    CHECK(!tracker.take_clean_transition(time_to_clean));
+
+    // recovery_frame_cnt pictures after the recovery point
+    push(tracker, slice(), 6000);
+    CHECK(tracker.is_clean());
+    CHECK(tracker.get_progress() == 1.0f);
+    CHECK(tracker.take_clean_transition(time_to_clean));
+    CHECK(time_to_clean == 5000);
+    CHECK(!tracker.take_clean_transition(time_to_clean));
+
+    // Periodic recovery points on a clean stream change nothing
+    push(tracker, recovery_point_slice(), 7000);
+    CHECK(tracker.is_clean());
+    CHECK(tracker.get_recovery_points() == 2);
+}
+
+static void test_damage_and_idr() {
+    RefreshTracker tracker;
+    int64_t time_to_clean = 0;
+
+    push(tracker, slice(true), 1000);
+    CHECK(tracker.is_clean());
+    CHECK(tracker.take_clean_transition(time_to_clean));
+
+    // Damage waits for the next recovery point; plain pictures don't help
+    tracker.on_damage(2000);
+    CHECK(tracker.get_state() == RefreshTracker::STATE_WAITING);
+    push(tracker, slice(), 3000);
+    CHECK(tracker.get_state() == RefreshTracker::STATE_WAITING);
+
+    push(tracker, recovery_point_slice(), 4000);
+    CHECK(tracker.is_refreshing());
+    // An IDR ends the refresh early
+    push(tracker, slice(true), 5000);
+    CHECK(tracker.is_clean());
+    CHECK(tracker.take_clean_transition(time_to_clean));
+    CHECK(time_to_clean == 3000);
+    CHECK(tracker.get_last_time_to_clean_usec() == 3000);
+
+    tracker.reset();
+    CHECK(tracker.get_state() == RefreshTracker::STATE_WAITING);
+}
+
+int main() {
+    test_recovery_point_stream();
+    test_damage_and_idr();
+    return TEST_RESULT();
+}
@@ -0,0 +1,157 @@
+/*
+ * Tile Cache Tests
+ * Synthetic tile streams: hit, miss, LRU eviction and budget shrink
+ */
+
+#include "test_common.h"
+#include "tile_cache.h"
+
+#include <cstring>
+#include <vector>
+
+using namespace godot;
+
+static const int WIDTH = 256;
+static const int HEIGHT = 128;
+static const int SIZE = TileCache::TILE_SIZE;
+
+struct Planes {
+    std::vector<uint8_t> y = std::vector<uint8_t>((size_t)WIDTH * HEIGHT);
+    std::vector<uint8_t> uv = std::vector<uint8_t>((size_t)WIDTH * HEIGHT / 2);
+};
+
+// Fill the tile at (x, y) with a pattern unique to seed
+static void paint_tile(Planes& planes, int x, int y, int seed) {
+    for (int row = 0; row < SIZE; row++) {
+        for (int col = 0; col < SIZE; col++) {
+            planes.y[(size_t)(y + row) * WIDTH + x + col] = (uint8_t)(seed * 31 + row * 3 + col);
+        }
+    }
+    for (int row = 0; row < SIZE / 2; row++) {
+        uint8_t* uv_row = planes.uv.data() + (size_t)(y / 2 + row) * WIDTH;
+        for (int col = 0; col < SIZE / 2; col++) {
+            uv_row[x / 2 + col] = (uint8_t)(seed * 7 + row);
+            uv_row[WIDTH / 2 + x / 2 + col] = (uint8_t)(seed * 11 + col);
+        }
+    }
+}
+
+static bool tile_equals(const Planes& a, const Planes& b, int x, int y) {
+    for (int row = 0; row < SIZE; row++) {
+        if (memcmp(&a.y[(size_t)(y + row) * WIDTH + x], &b.y[(size_t)(y + row) * WIDTH + x], SIZE) != 0) {
+            return false;
+        }
+    }
+    for (int row = 0; row < SIZE / 2; row++) {
+        size_t offset = (size_t)(y / 2 + row) * WIDTH;
+        if (memcmp(&a.uv[offset + x / 2], &b.uv[offset + x / 2], SIZE / 2) != 0 ||
+            memcmp(&a.uv[offset + WIDTH / 2 + x / 2], &b.uv[offset + WIDTH / 2 + x / 2], SIZE / 2) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void test_hit_and_miss() {
+    TileCache cache;
+    cache.set_budget(TileCache::TILE_BYTES * 4);
+    Planes source;
+    paint_tile(source, 0, 0, 1);
+
+    uint64_t id = cache.insert_from_planes(source.y.data(), source.uv.data(), WIDTH, HEIGHT, 0, 0);
+    CHECK(id != 0);
+    CHECK(cache.contains(id));
+    // Same content is stored once
+    CHECK(cache.insert_from_planes(source.y.data(), source.uv.data(), WIDTH, HEIGHT, 0, 0) == id);
+    CHECK(cache.get_inserts() == 1);
+
+    Planes target;
+    CHECK(cache.blit_to_planes(id, target.y.data(), target.uv.data(), WIDTH, HEIGHT, 128, 64));
+    Planes moved;
+    paint_tile(moved, 128, 64, 1);
+    CHECK(tile_equals(moved, target, 128, 64));
+    CHECK(cache.get_hits() == 1);
+
+    CHECK(!cache.blit_to_planes(id + 1, target.y.data(), target.uv.data(), WIDTH, HEIGHT, 0, 0));
+    CHECK(cache.get_misses() == 1);
+
+    std::vector<uint64_t> added, evicted, missed;
+    cache.take_events(added, evicted, missed);
+    CHECK(added.size() == 1 && added[0] == id);
+    CHECK(evicted.empty());
+    CHECK(missed.size() == 1 && missed[0] == id + 1);
+
+    // Partial tiles at the frame edge are not cached
+    CHECK(cache.insert_from_planes(source.y.data(), source.uv.data(), WIDTH, HEIGHT, WIDTH - SIZE / 2, 0) == 0);
+}
+
+static void test_lru_eviction() {
+    TileCache cache;
+    cache.set_budget(TileCache::TILE_BYTES * 2);
+    Planes planes;
+    paint_tile(planes, 0, 0, 1);
+    paint_tile(planes, 64, 0, 2);
+    paint_tile(planes, 128, 0, 3);
+
+    uint64_t a = cache.insert_from_planes(planes.y.data(), planes.uv.data(), WIDTH, HEIGHT, 0, 0);
+    uint64_t b = cache.insert_from_planes(planes.y.data(), planes.uv.data(), WIDTH, HEIGHT, 64, 0);
+    // Touch a so b becomes least recently used
+    Planes scratch;
+    CHECK(cache.blit_to_planes(a, scratch.y.data(), scratch.uv.data(), WIDTH, HEIGHT, 0, 0));
+    uint64_t c = cache.insert_from_planes(planes.y.data(), planes.uv.data(), WIDTH, HEIGHT, 128, 0);
+
+    CHECK(c != 0);
+    CHECK(cache.contains(a));
+    CHECK(!cache.contains(b));
+    CHECK(cache.contains(c));
+    CHECK(cache.get_evictions() == 1);
+    CHECK(cache.get_entry_count() == 2);
+
+    std::vector<uint64_t> added, evicted, missed;
+    cache.take_events(added, evicted, missed);
+    CHECK(evicted.size() == 1 && evicted[0] == b);
+}
+
+static void test_budget_shrink() {
+    TileCache cache;
+    cache.set_budget(TileCache::TILE_BYTES * 4);
+    Planes planes;
+    uint64_t ids[4];
+    for (int i = 0; i < 4; i++) {
+        paint_tile(planes, i * SIZE, 0, i + 1);
+        ids[i] = cache.insert_from_planes(planes.y.data(), planes.uv.data(), WIDTH, HEIGHT, i * SIZE, 0);
+    }
+    CHECK(cache.get_entry_count() == 4);
+
+    // Memory pressure halves the budget: the two most recent tiles survive
+    // with their content intact
+    cache.set_budget(TileCache::TILE_BYTES * 2);
+    CHECK(cache.get_entry_count() == 2);
+    CHECK(!cache.contains(ids[0]) && !cache.contains(ids[1]));
+    CHECK(cache.contains(ids[2]) && cache.contains(ids[3]));
+    CHECK(cache.get_memory_usage() < TileCache::TILE_BYTES * 3);
+
+    Planes target;
+    CHECK(cache.blit_to_planes(ids[3], target.y.data(), target.uv.data(), WIDTH, HEIGHT, 3 * SIZE, 0));
+    CHECK(tile_equals(planes, target, 3 * SIZE, 0));
+
+    std::vector<uint64_t> added, evicted, missed;
+    cache.take_events(added, evicted, missed);
+    CHECK(evicted.size() == 2);
+
+    // Still usable after the shrink, and 0 disables it
+    paint_tile(planes, 0, 64, 9);
+    CHECK(cache.insert_from_planes(planes.y.data(), planes.uv.data(), WIDTH, HEIGHT, 0, 64) != 0);
+    CHECK(cache.get_entry_count() == 2);
+    cache.set_budget(0);
+    CHECK(!cache.is_enabled());
+    CHECK(cache.get_entry_count() == 0);
+    CHECK(cache.insert_from_planes(planes.y.data(), planes.uv.data(), WIDTH, HEIGHT, 0, 0) == 0);
+}
+
+int main() {
+    test_hit_and_miss();
+    test_lru_eviction();
+    test_budget_shrink();
+    return TEST_RESULT();
+}
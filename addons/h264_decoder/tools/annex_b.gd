@@ -0,0 +1,87 @@
+extends RefCounted
+## Annex B stream helpers shared by the headless scenes
+##
+## The benchmark, the PGO training run and the scene tests all play a
+## recorded stream as whole access units. They preload this script rather
+## than each keeping a splitter:
+##
+##   const AnnexB := preload("res://addons/h264_decoder/tools/annex_b.gd")
+##   var units := AnnexB.split_access_units(FileAccess.get_file_as_bytes(path))
+##
+## The rules match reference_streamer's replay, which does the same in C++.
+
+
+## --key=value arguments after "--" on the command line
+static func parse_options() -> Dictionary:
+	var options := {}
+	for arg in OS.get_cmdline_user_args():
+		if arg.begins_with("--") and "=" in arg:
+			var eq := arg.find("=")
+			options[arg.substr(2, eq - 2)] = arg.substr(eq + 1)
+	return options
+
+
+## First .h264 file in streams_dir, or "" when there is none
+static func find_default_stream(streams_dir: String) -> String:
+	var dir := DirAccess.open(streams_dir)
+	if dir == null:
+		return ""
+	for file_name in dir.get_files():
+		if file_name.get_extension() == "h264":
+			return streams_dir.path_join(file_name)
+	return ""
+
+
+## Every .h264 file in streams_dir, sorted by name
+static func find_streams(streams_dir: String) -> PackedStringArray:
+	var paths := PackedStringArray()
+	var dir := DirAccess.open(streams_dir)
+	if dir == null:
+		return paths
+	var names := dir.get_files()
+	names.sort()
+	for file_name in names:
+		if file_name.get_extension() == "h264":
+			paths.append(streams_dir.path_join(file_name))
+	return paths
+
+
+## Offsets of the NAL headers. Start codes are found with
+## PackedByteArray.find, so preparing a long recording doesn't loop over
+## every byte in script.
+static func find_nal_starts(data: PackedByteArray) -> PackedInt32Array:
+	var starts := PackedInt32Array()
+	var pos := data.find(1)
+	while pos >= 0:
+		if pos >= 2 and data[pos - 1] == 0 and data[pos - 2] == 0 and pos + 1 < data.size():
+			starts.append(pos + 1) # NAL header
+		pos = data.find(1, pos + 1)
+	return starts
+
+
+## A new unit starts at an AUD, an SPS, or the first slice of a picture
+## once the unit has a slice. Each unit keeps its leading start code.
+static func split_access_units(data: PackedByteArray) -> Array[PackedByteArray]:
+	var units: Array[PackedByteArray] = []
+	var starts := find_nal_starts(data)
+	var unit_begin := -1
+	var has_slice := false
+	for i in starts.size():
+		var header := starts[i]
+		# Include the start code (3 or 4 bytes) in the unit
+		var code_begin := header - 3
+		if code_begin > 0 and data[code_begin - 1] == 0:
+			code_begin -= 1
+		var nal_type := data[header] & 0x1F
+		var first_slice := (nal_type == 1 or nal_type == 5) and header + 1 < data.size() and (data[header + 1] & 0x80) != 0
+		if unit_begin < 0:
+			unit_begin = code_begin
+		elif has_slice and (nal_type == 9 or nal_type == 7 or first_slice):
+			units.append(data.slice(unit_begin, code_begin))
+			unit_begin = code_begin
+			has_slice = false
+		if nal_type == 1 or nal_type == 5:
+			has_slice = true
+	if unit_begin >= 0 and has_slice:
+		units.append(data.slice(unit_begin))
+	return units
@@ -0,0 +1,565 @@
+/*
+ * Reference Streamer
+ * Native stand-in for the streaming server, for benchmarking the client on Linux
+ *
+ * Encodes synthetic desktop content (or replays a recorded Annex B stream),
+ * adds a stereo ADPCM tone, and sends both over UDP in the stream_wire.h
+ * framing. Every message carries its capture time so the client can measure
+ * end-to-end latency on the same machine.
+ *
+ *   reference_streamer [--host 127.0.0.1] [--port 9000] [--width 1920]
+ *                      [--height 1080] [--fps 60] [--bitrate 8000]
+ *                      [--gop 120] [--scene text|drag|video|mixed]
+ *                      [--encoder NAME] [--replay FILE.h264]
+ *                      [--duration SECONDS] [--no-audio]
+ *                      [--latency-probe] [--record FILE.h264]
+ *
+ * --latency-probe paints a timestamp marker (latency_probe.h) into the top
+ * left corner of every synthetic frame, for H264Decoder's latency probe.
+ * --record also writes the encoded stream to an Annex B file, which the
+ * benchmark scene (benchmark/benchmark.tscn) and --replay play back.
+ * client/wire_client.tscn receives the stream in Godot.
+ */
+
+#include "synthetic_desktop.h"
+#include "adpcm.h"
+#include "latency_probe.h"
+#include "nal_parser.h"
+#include "stream_wire.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/opt.h>
+}
+
+using namespace godot;
+
+static const int AUDIO_SAMPLE_RATE = 48000;
+static const float AUDIO_TONE_HZ = 440.0f;
+
+static volatile sig_atomic_t running = 1;
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = 9000;
+    int width = 1920;
+    int height = 1080;
+    int fps = 60;
+    int bitrate_kbps = 8000;
+    int gop = 120;
+    SyntheticDesktop::Scene scene = SyntheticDesktop::SCENE_MIXED;
+    std::string encoder;
+    std::string replay;
+    double duration = 0.0; // 0 runs until interrupted
+    bool audio = true;
+    bool latency_probe = false;
+    std::string record;
+};
+
+static uint64_t unix_usec() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static void print_usage() {
+    fprintf(stderr,
+        "usage: reference_streamer [--host ADDR] [--port N] [--width N] [--height N]\n"
+        "                          [--fps N] [--bitrate KBPS] [--gop N]\n"
+        "                          [--scene text|drag|video|mixed] [--encoder NAME]\n"
+        "                          [--replay FILE.h264] [--duration SECONDS] [--no-audio]\n"
+        "                          [--latency-probe] [--record FILE.h264]\n");
+}
+
+static bool parse_options(int argc, char** argv, Options& opts) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--no-audio") {
+            opts.audio = false;
+            continue;
+        }
+        if (arg == "--latency-probe") {
+            opts.latency_probe = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            fprintf(stderr, "[ReferenceStreamer] Missing value for %s\n", arg.c_str());
+            return false;
+        }
+        const char* value = argv[++i];
+        if (arg == "--host") opts.host = value;
+        else if (arg == "--port") opts.port = atoi(value);
+        else if (arg == "--width") opts.width = atoi(value) & ~1;
+        else if (arg == "--height") opts.height = atoi(value) & ~1;
+        else if (arg == "--fps") opts.fps = atoi(value);
+        else if (arg == "--bitrate") opts.bitrate_kbps = atoi(value);
+        else if (arg == "--gop") opts.gop = atoi(value);
+        else if (arg == "--encoder") opts.encoder = value;
+        else if (arg == "--replay") opts.replay = value;
+        else if (arg == "--record") opts.record = value;
+        else if (arg == "--duration") opts.duration = atof(value);
+        else if (arg == "--scene") {
+            if (!SyntheticDesktop::parse_scene(value, opts.scene)) {
+                fprintf(stderr, "[ReferenceStreamer] Unknown scene: %s\n", value);
+                return false;
+            }
+        } else {
+            fprintf(stderr, "[ReferenceStreamer] Unknown option: %s\n", arg.c_str());
+            return false;
+        }
+    }
+    if (opts.width < 16 || opts.height < 16 || opts.fps <= 0 || opts.port <= 0 || opts.gop <= 0) {
+        fprintf(stderr, "[ReferenceStreamer] Invalid size, fps, gop or port\n");
+        return false;
+    }
+    if (opts.latency_probe && (opts.width < LATENCY_MARKER_WIDTH || opts.height < LATENCY_MARKER_HEIGHT)) {
+        fprintf(stderr, "[ReferenceStreamer] --latency-probe needs at least %dx%d\n",
+            LATENCY_MARKER_WIDTH, LATENCY_MARKER_HEIGHT);
+        return false;
+    }
+    return true;
+}
+
+// UDP sender that fragments each message per stream_wire.h
+class WireSender {
+private:
+    int fd = -1;
+    sockaddr_in address = {};
+    uint32_t next_id[5] = {};
+    std::vector<uint8_t> datagram;
+
+public:
+    uint64_t bytes_sent = 0;
+    uint64_t send_errors = 0;
+
+    bool open(const std::string& host, int port) {
+        fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd < 0) {
+            perror("[ReferenceStreamer] socket");
+            return false;
+        }
+        // Large keyframes go out as one burst; don't let the kernel drop them
+        int buffer = 4 * 1024 * 1024;
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buffer, sizeof(buffer));
+
+        address.sin_family = AF_INET;
+        address.sin_port = htons((uint16_t)port);
+        if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1) {
+            fprintf(stderr, "[ReferenceStreamer] Invalid IPv4 address: %s\n", host.c_str());
+            return false;
+        }
+        datagram.resize(WIRE_HEADER_SIZE + WIRE_MAX_PAYLOAD);
+        return true;
+    }
+
+    // frame_id < 0 takes the next id for this type
+    void send(WireType type, const uint8_t* data, size_t size, uint64_t timestamp_usec, uint8_t flags,
+              int64_t frame_id = -1) {
+        size_t count = std::max<size_t>((size + WIRE_MAX_PAYLOAD - 1) / WIRE_MAX_PAYLOAD, 1);
+        if (count > 0xFFFF) {
+            send_errors++;
+            return;
+        }
+
+        WireHeader header;
+        header.type = (uint8_t)type;
+        header.frame_id = frame_id >= 0 ? (uint32_t)frame_id : next_id[type]++;
+        header.timestamp_usec = timestamp_usec;
+        header.fragment_count = (uint16_t)count;
+        header.flags = flags;
+        for (size_t i = 0; i < count; i++) {
+            size_t offset = i * WIRE_MAX_PAYLOAD;
+            size_t chunk = std::min(WIRE_MAX_PAYLOAD, size - offset);
+            header.fragment_index = (uint16_t)i;
+            wire_write_header(header, datagram.data());
+            if (chunk > 0) {
+                memcpy(datagram.data() + WIRE_HEADER_SIZE, data + offset, chunk);
+            }
+            ssize_t sent = sendto(fd, datagram.data(), WIRE_HEADER_SIZE + chunk, 0,
+                (const sockaddr*)&address, sizeof(address));
+            if (sent < 0) {
+                send_errors++;
+            } else {
+                bytes_sent += (uint64_t)sent;
+            }
+        }
+    }
+
+    ~WireSender() {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+};
+
+// Low-latency H.264 encoder: no B-frames, in-band SPS/PPS on every keyframe
+class SyntheticEncoder {
+private:
+    AVCodecContext* context = nullptr;
+    AVFrame* frame = nullptr;
+    AVPacket* packet = nullptr;
+
+    void configure_low_latency(const char* name) {
+        if (strcmp(name, "libx264") == 0) {
+            av_opt_set(context->priv_data, "preset", "ultrafast", 0);
+            av_opt_set(context->priv_data, "tune", "zerolatency", 0);
+        } else if (strcmp(name, "h264_nvenc") == 0) {
+            av_opt_set(context->priv_data, "preset", "p1", 0);
+            av_opt_set(context->priv_data, "tune", "ull", 0);
+            av_opt_set_int(context->priv_data, "zerolatency", 1, 0);
+        } else if (strcmp(name, "libopenh264") == 0) {
+            av_opt_set(context->priv_data, "rc_mode", "bitrate", 0);
+        }
+    }
+
+    bool try_open(const AVCodec* codec, const Options& opts) {
+        context = avcodec_alloc_context3(codec);
+        if (!context) {
+            return false;
+        }
+        context->width = opts.width;
+        context->height = opts.height;
+        context->pix_fmt = AV_PIX_FMT_YUV420P;
+        context->time_base = AVRational{ 1, opts.fps };
+        context->framerate = AVRational{ opts.fps, 1 };
+        context->bit_rate = (int64_t)opts.bitrate_kbps * 1000;
+        context->gop_size = opts.gop;
+        context->max_b_frames = 0;
+        context->flags |= AV_CODEC_FLAG_LOW_DELAY;
+        configure_low_latency(codec->name);
+
+        if (avcodec_open2(context, codec, nullptr) < 0) {
+            avcodec_free_context(&context);
+            return false;
+        }
+        return true;
+    }
+
+public:
+    const char* name = "";
+
+    bool open(const Options& opts) {
+        std::vector<const AVCodec*> candidates;
+        if (!opts.encoder.empty()) {
+            candidates.push_back(avcodec_find_encoder_by_name(opts.encoder.c_str()));
+        } else {
+            for (const char* preferred : { "libx264", "h264_nvenc", "libopenh264" }) {
+                candidates.push_back(avcodec_find_encoder_by_name(preferred));
+            }
+            candidates.push_back(avcodec_find_encoder(AV_CODEC_ID_H264));
+        }
+
+        for (const AVCodec* codec : candidates) {
+            if (codec && try_open(codec, opts)) {
+                name = codec->name;
+                break;
+            }
+        }
+        if (!context) {
+            fprintf(stderr, "[ReferenceStreamer] No usable H.264 encoder%s%s\n",
+                opts.encoder.empty() ? "" : ": ", opts.encoder.c_str());
+            return false;
+        }
+
+        frame = av_frame_alloc();
+        packet = av_packet_alloc();
+        if (!frame || !packet) {
+            return false;
+        }
+        frame->format = AV_PIX_FMT_YUV420P;
+        frame->width = opts.width;
+        frame->height = opts.height;
+        return av_frame_get_buffer(frame, 0) >= 0;
+    }
+
+    SyntheticDesktop::Planes planes() {
+        // The encoder may still reference the last buffer
+        av_frame_make_writable(frame);
+        return { frame->data[0], frame->data[1], frame->data[2],
+            frame->linesize[0], frame->linesize[1], frame->linesize[2] };
+    }
+
+    // Encode the current planes; appends each finished access unit with
+    // the frame index it was rendered from (the wire frame_id, which lets
+    // QualityMeter rebuild the source picture)
+    bool encode(int64_t pts, std::vector<std::vector<uint8_t>>& out, std::vector<bool>& keyframe,
+                std::vector<int64_t>& frame_ids) {
+        frame->pts = pts;
+        if (avcodec_send_frame(context, frame) < 0) {
+            return false;
+        }
+        while (avcodec_receive_packet(context, packet) == 0) {
+            out.emplace_back(packet->data, packet->data + packet->size);
+            keyframe.push_back((packet->flags & AV_PKT_FLAG_KEY) != 0);
+            frame_ids.push_back(packet->pts);
+            av_packet_unref(packet);
+        }
+        return true;
+    }
+
+    ~SyntheticEncoder() {
+        av_packet_free(&packet);
+        av_frame_free(&frame);
+        avcodec_free_context(&context);
+    }
+};
+
+// Split a recorded Annex B stream into access units. A new unit starts at
+// an AUD, an SPS, or the first slice of a picture once the current unit
+// already has a slice. The Godot scenes split with tools/annex_b.gd, which
+// follows the same rules; change both together.
+static void split_access_units(const std::vector<uint8_t>& stream,
+        std::vector<std::vector<uint8_t>>& units, std::vector<bool>& keyframe) {
+    std::vector<NalUnit> nals;
+    parse_nal_units(stream.data(), stream.size(), nals);
+
+    std::vector<uint8_t> current;
+    bool has_slice = false;
+    bool is_key = false;
+    auto flush = [&]() {
+        if (has_slice) {
+            units.push_back(std::move(current));
+            keyframe.push_back(is_key);
+        }
+        current.clear();
+        has_slice = false;
+        is_key = false;
+    };
+
+    static const uint8_t START_CODE[] = { 0, 0, 0, 1 };
+    for (const NalUnit& nal : nals) {
+        bool vcl = nal.type == NAL_SLICE || nal.type == NAL_IDR;
+        if (has_slice && (nal.type == NAL_AUD || nal.type == NAL_SPS || nal_starts_picture(nal))) {
+            flush();
+        }
+        current.insert(current.end(), START_CODE, START_CODE + 4);
+        current.insert(current.end(), nal.data, nal.data + nal.size);
+        has_slice |= vcl;
+        is_key |= nal.type == NAL_IDR;
+    }
+    flush();
+}
+
+static bool load_replay(const std::string& path,
+        std::vector<std::vector<uint8_t>>& units, std::vector<bool>& keyframe) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        perror("[ReferenceStreamer] replay");
+        return false;
+    }
+    std::vector<uint8_t> stream;
+    uint8_t buffer[65536];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        stream.insert(stream.end(), buffer, buffer + read);
+    }
+    fclose(file);
+
+    split_access_units(stream, units, keyframe);
+    if (units.empty()) {
+        fprintf(stderr, "[ReferenceStreamer] No access units in %s\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Stereo test tone: left at AUDIO_TONE_HZ, right a fifth above, so a swapped
+// channel is audible
+class ToneSource {
+private:
+    double phase = 0.0;
+    int predicted_l = 0, index_l = 0;
+    int predicted_r = 0, index_r = 0;
+    double pending_samples = 0.0;
+
+public:
+    // One byte per sample frame, left in the high nibble
+    void generate(double seconds, std::vector<uint8_t>& out) {
+        pending_samples += seconds * AUDIO_SAMPLE_RATE;
+        int count = (int)pending_samples;
+        pending_samples -= count;
+
+        out.resize(count);
+        for (int i = 0; i < count; i++) {
+            double t = phase / AUDIO_SAMPLE_RATE;
+            int left = (int)(8000.0 * sin(2.0 * M_PI * AUDIO_TONE_HZ * t));
+            int right = (int)(8000.0 * sin(2.0 * M_PI * AUDIO_TONE_HZ * 1.5 * t));
+            uint8_t high = adpcm_encode_sample(left, predicted_l, index_l);
+            uint8_t low = adpcm_encode_sample(right, predicted_r, index_r);
+            out[i] = (uint8_t)((high << 4) | low);
+            phase += 1.0;
+        }
+        // Keep the phase small; both tones are whole cycles per second
+        if (phase >= AUDIO_SAMPLE_RATE) {
+            phase -= AUDIO_SAMPLE_RATE;
+        }
+    }
+};
+
+static void handle_signal(int) {
+    running = 0;
+}
+
+int main(int argc, char** argv) {
+    Options opts;
+    if (!parse_options(argc, argv, opts)) {
+        print_usage();
+        return 2;
+    }
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+
+    WireSender sender;
+    if (!sender.open(opts.host, opts.port)) {
+        return 1;
+    }
+
+    bool replay = !opts.replay.empty();
+    std::vector<std::vector<uint8_t>> replay_units;
+    std::vector<bool> replay_keyframes;
+    SyntheticEncoder encoder;
+    SyntheticDesktop desktop(opts.width, opts.height, opts.scene);
+    if (replay) {
+        if (!load_replay(opts.replay, replay_units, replay_keyframes)) {
+            return 1;
+        }
+        printf("[ReferenceStreamer] Replaying %zu access units from %s at %d fps\n",
+            replay_units.size(), opts.replay.c_str(), opts.fps);
+        if (opts.latency_probe) {
+            fprintf(stderr, "[ReferenceStreamer] --latency-probe has no effect on replayed streams\n");
+        }
+    } else {
+        if (!encoder.open(opts)) {
+            return 1;
+        }
+        printf("[ReferenceStreamer] Encoding %dx%d@%d with %s, %d kbps\n",
+            opts.width, opts.height, opts.fps, encoder.name, opts.bitrate_kbps);
+    }
+    printf("[ReferenceStreamer] Sending to %s:%d\n", opts.host.c_str(), opts.port);
+
+    FILE* record = nullptr;
+    if (!opts.record.empty()) {
+        record = fopen(opts.record.c_str(), "wb");
+        if (!record) {
+            perror("[ReferenceStreamer] record");
+            return 1;
+        }
+        printf("[ReferenceStreamer] Recording to %s\n", opts.record.c_str());
+    }
+
+    ToneSource tone;
+    std::vector<uint8_t> audio;
+    std::vector<std::vector<uint8_t>> units;
+    std::vector<bool> keyframes;
+    std::vector<int64_t> frame_ids;
+
+    using clock = std::chrono::steady_clock;
+    const auto interval = std::chrono::nanoseconds(1000000000LL / opts.fps);
+    const auto start = clock::now();
+    auto next_frame = start;
+    auto stats_start = start;
+    int stats_frames = 0;
+    int stats_keyframes = 0;
+    int64_t stats_encode_usec = 0;
+    int64_t stats_encode_max = 0;
+    uint64_t stats_bytes = 0;
+
+    for (int64_t frame_index = 0; running; frame_index++) {
+        if (opts.duration > 0.0 &&
+                std::chrono::duration<double>(clock::now() - start).count() >= opts.duration) {
+            break;
+        }
+        std::this_thread::sleep_until(next_frame);
+        next_frame += interval;
+        // Fell more than a frame behind (slow encoder): drop the backlog
+        // instead of bursting, like a capture-paced server would
+        if (clock::now() > next_frame + interval) {
+            next_frame = clock::now() + interval;
+        }
+
+        uint64_t capture_usec = unix_usec();
+        units.clear();
+        keyframes.clear();
+        frame_ids.clear();
+
+        auto encode_start = clock::now();
+        if (replay) {
+            size_t i = (size_t)(frame_index % (int64_t)replay_units.size());
+            units.push_back(replay_units[i]);
+            keyframes.push_back(replay_keyframes[i]);
+            frame_ids.push_back(frame_index);
+        } else {
+            SyntheticDesktop::Planes planes = encoder.planes();
+            desktop.render((int)frame_index, planes);
+            if (opts.latency_probe) {
+                LatencyMarker marker;
+                marker.timestamp_usec = (uint32_t)capture_usec;
+                marker.sequence = (uint8_t)frame_index;
+                latency_marker_paint(planes.y, planes.y_stride, marker);
+            }
+            if (!encoder.encode(frame_index, units, keyframes, frame_ids)) {
+                fprintf(stderr, "[ReferenceStreamer] Encode failed at frame %lld\n", (long long)frame_index);
+                return 1;
+            }
+        }
+        int64_t encode_usec = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - encode_start).count();
+
+        uint64_t before = sender.bytes_sent;
+        for (size_t i = 0; i < units.size(); i++) {
+            sender.send(WIRE_VIDEO, units[i].data(), units[i].size(), capture_usec,
+                keyframes[i] ? WIRE_FLAG_KEYFRAME : 0, frame_ids[i]);
+            if (record) {
+                fwrite(units[i].data(), 1, units[i].size(), record);
+            }
+            stats_keyframes += keyframes[i];
+        }
+        if (opts.audio) {
+            tone.generate(1.0 / opts.fps, audio);
+            if (!audio.empty()) {
+                sender.send(WIRE_AUDIO, audio.data(), audio.size(), capture_usec, 0);
+            }
+        }
+
+        stats_frames += (int)units.size();
+        stats_encode_usec += encode_usec;
+        stats_encode_max = std::max(stats_encode_max, encode_usec);
+        stats_bytes += sender.bytes_sent - before;
+
+        double elapsed = std::chrono::duration<double>(clock::now() - stats_start).count();
+        if (elapsed >= 1.0) {
+            int loops = std::max(stats_frames, 1);
+            printf("[ReferenceStreamer] %.1f fps, %.0f kbps, encode %lld/%lld usec (mean/max), %d keyframes, %llu send errors\n",
+                stats_frames / elapsed, stats_bytes * 8.0 / 1000.0 / elapsed,
+                (long long)(stats_encode_usec / loops), (long long)stats_encode_max,
+                stats_keyframes, (unsigned long long)sender.send_errors);
+            fflush(stdout);
+            stats_start = clock::now();
+            stats_frames = 0;
+            stats_keyframes = 0;
+            stats_encode_usec = 0;
+            stats_encode_max = 0;
+            stats_bytes = 0;
+        }
+    }
+
+    if (record) {
+        fclose(record);
+    }
+    printf("[ReferenceStreamer] Stopped\n");
+    return 0;
+}
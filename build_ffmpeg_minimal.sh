@@ -0,0 +1,98 @@
+#!/usr/bin/env bash
+# Builds a trimmed static FFmpeg for H264_STATIC_FFMPEG=ON
+#
+# Only what addons/h264_decoder uses: the h264 decoder (plus the platform's
+# hardware wrapper), avutil and swscale. --disable-everything turns off all
+# components, then configure re-enables what the chosen decoders select:
+# nothing extra for h264 alone, the h264_mp4toannexb bitstream filter for
+# h264_cuvid, and that filter plus the h264 parser for h264_mediacodec. No
+# formats, filters, network or other external libraries.
+#
+# Usage: ./build_ffmpeg_minimal.sh <ffmpeg-source-dir> [linux|android|windows]
+# Android needs ANDROID_NDK_HOME; windows runs from an MSYS2 shell with MSVC
+# (vcvars) on PATH. Output goes to addons/h264_decoder/ffmpeg_static, which
+# CMake picks up as FFMPEG_STATIC_PATH.
+
+set -euo pipefail
+
+SRC_DIR="${1:?usage: $0 <ffmpeg-source-dir> [linux|android|windows]}"
+TARGET="${2:-linux}"
+ROOT_DIR="$(cd "$(dirname "$0")" && pwd)"
+PREFIX="$ROOT_DIR/addons/h264_decoder/ffmpeg_static"
+JOBS="$(nproc 2>/dev/null || echo 4)"
+
+COMMON_FLAGS=(
+    --prefix="$PREFIX"
+    --disable-everything
+    --disable-autodetect
+    --disable-programs
+    --disable-doc
+    --disable-debug
+    --disable-network
+    --disable-avformat
+    --disable-avdevice
+    --disable-avfilter
+    --disable-swresample
+    --disable-postproc
+    --enable-static
+    --disable-shared
+    --enable-pic
+    --enable-avcodec
+    --enable-avutil
+    --enable-swscale
+    --enable-decoder=h264
+)
+
+case "$TARGET" in
+    linux)
+        # h264_cuvid is looked up first on desktop; it needs nv-codec-headers
+        # (ffnvcodec.pc) at configure time and loads the driver at runtime
+        PLATFORM_FLAGS=(--enable-pthreads)
+        if pkg-config --exists ffnvcodec 2>/dev/null; then
+            PLATFORM_FLAGS+=(--enable-ffnvcodec --enable-cuvid --enable-decoder=h264_cuvid)
+        fi
+        ;;
+    android)
+        : "${ANDROID_NDK_HOME:?set ANDROID_NDK_HOME}"
+        API=29
+        TOOLCHAIN="$ANDROID_NDK_HOME/toolchains/llvm/prebuilt/linux-x86_64"
+        PLATFORM_FLAGS=(
+            --target-os=android
+            --arch=aarch64
+            --cpu=armv8.2-a
+            --enable-cross-compile
+            --cc="$TOOLCHAIN/bin/aarch64-linux-android$API-clang"
+            --cxx="$TOOLCHAIN/bin/aarch64-linux-android$API-clang++"
+            --nm="$TOOLCHAIN/bin/llvm-nm"
+            --ar="$TOOLCHAIN/bin/llvm-ar"
+            --ranlib="$TOOLCHAIN/bin/llvm-ranlib"
+            --strip="$TOOLCHAIN/bin/llvm-strip"
+            --sysroot="$TOOLCHAIN/sysroot"
+            --enable-pthreads
+            --enable-jni
+            --enable-mediacodec
+            --enable-decoder=h264_mediacodec
+        )
+        ;;
+    windows)
+        PLATFORM_FLAGS=(--toolchain=msvc --enable-w32threads)
+        if pkg-config --exists ffnvcodec 2>/dev/null; then
+            PLATFORM_FLAGS+=(--enable-ffnvcodec --enable-cuvid --enable-decoder=h264_cuvid)
+        fi
+        ;;
+    *)
+        echo "Unknown target: $TARGET" >&2
+        exit 1
+        ;;
+esac
+
+BUILD_DIR="$(mktemp -d)"
+trap 'rm -rf "$BUILD_DIR"' EXIT
+
+cd "$BUILD_DIR"
+"$SRC_DIR/configure" "${COMMON_FLAGS[@]}" "${PLATFORM_FLAGS[@]}"
+make -j"$JOBS"
+make install
+
+echo "Static FFmpeg installed to $PREFIX"
+du -ch "$PREFIX"/lib/*.a "$PREFIX"/lib/*.lib 2>/dev/null | tail -n 1